@@ -3,10 +3,27 @@
 layout (location = 0) in vec3 a_Position;
 
 uniform mat4 u_Projection;
-uniform mat4 u_Model;
 uniform mat4 u_View;
 
+// One per draw, picked by the indirect command's base instance. Must match SceneRenderer::DrawData
+struct DrawData
+{
+    mat4 model;
+    vec4 positionScale; // Compact vertices store positions within their material group's bounds
+    vec4 positionOffset;
+    uint material;
+    uint octNormals;
+    uint padding0;
+    uint padding1;
+};
+
+layout (std430, binding = 2) readonly buffer Draws
+{
+    DrawData u_Draws[];
+};
+
 void main()
 {
-    gl_Position = u_Projection * u_View * u_Model * vec4(a_Position, 1.0);
+    DrawData draw = u_Draws[gl_BaseInstance];
+    gl_Position = u_Projection * u_View * draw.model * vec4(draw.positionOffset.xyz + draw.positionScale.xyz * a_Position, 1.0);
 }
\ No newline at end of file
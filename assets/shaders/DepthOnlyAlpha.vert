@@ -7,10 +7,14 @@ uniform mat4 u_Projection;
 uniform mat4 u_Model;
 uniform mat4 u_View;
 
+// Compact vertices store positions within their material group's bounds
+uniform vec3 u_PositionScale = vec3(1.0);
+uniform vec3 u_PositionOffset = vec3(0.0);
+
 out vec2 v_TexCoord;
 
 void main()
 {
     v_TexCoord = a_TexCoord;
-     gl_Position = u_Projection * u_View * u_Model * vec4(a_Position, 1.0);
+     gl_Position = u_Projection * u_View * u_Model * vec4(u_PositionOffset + u_PositionScale * a_Position, 1.0);
 }
@@ -0,0 +1,6 @@
+#version 460
+
+void main()
+{
+    // Never runs, HiZCull is drawn with rasterisation off
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#version 460
+
+// One vertex per held back draw, drawn as points with rasterisation off. Tests the draw's bounds against this frame's depth pyramid
+// and turns its indirect command on or off. The same test as HiZSnapshot::isVisible, see HiZPyramid.h for the pyramid's layout
+
+struct Candidate
+{
+    vec4 boundsMin; // World space, w unused
+    vec4 boundsMax;
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Candidates { Candidate candidates[]; };
+layout(std430, binding = 1) buffer Commands { DrawCommand commands[]; };
+
+uniform mat4 u_ViewProj;
+uniform vec2 u_ScreenSize; // Of the full resolution depth
+uniform sampler2D u_HiZ;
+
+bool isVisible(vec3 boundsMin, vec3 boundsMax)
+{
+    vec2 ndcMin = vec2(1e30);
+    vec2 ndcMax = vec2(-1e30);
+    float nearestDepth = 1.0;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = vec3((i & 1) != 0 ? boundsMax.x : boundsMin.x, (i & 2) != 0 ? boundsMax.y : boundsMin.y, (i & 4) != 0 ? boundsMax.z : boundsMin.z);
+        vec4 clip = u_ViewProj * vec4(corner, 1.0);
+
+        // At or behind the camera the projection flips, so there's no screen rect to test
+        if (clip.w <= 1e-5)
+            return true;
+
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc.xy);
+        ndcMax = max(ndcMax, ndc.xy);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    vec2 pixelMin = (ndcMin * 0.5 + 0.5) * u_ScreenSize;
+    vec2 pixelMax = (ndcMax * 0.5 + 0.5) * u_ScreenSize;
+
+    // Nothing is known about what's off screen
+    if (pixelMax.x < 0.0 || pixelMax.y < 0.0 || pixelMin.x >= u_ScreenSize.x || pixelMin.y >= u_ScreenSize.y)
+        return true;
+
+    ivec2 screenSize = ivec2(u_ScreenSize);
+    ivec2 p0 = clamp(ivec2(floor(pixelMin)), ivec2(0), screenSize - 1);
+    ivec2 p1 = clamp(ivec2(floor(pixelMax)), ivec2(0), screenSize - 1);
+
+    // The finest level where the rect covers at most 2x2 texels
+    int levelCount = textureQueryLevels(u_HiZ);
+    int level = 0;
+    ivec2 t0, t1;
+    while (true)
+    {
+        ivec2 size = textureSize(u_HiZ, level);
+        t0 = min(p0 >> (level + 1), size - 1);
+        t1 = min(p1 >> (level + 1), size - 1);
+
+        if ((t1.x - t0.x <= 1 && t1.y - t0.y <= 1) || level + 1 == levelCount)
+            break;
+        level++;
+    }
+
+    float farthest = 0.0;
+    for (int y = t0.y; y <= t1.y; ++y)
+    {
+        for (int x = t0.x; x <= t1.x; ++x)
+            farthest = max(farthest, texelFetch(u_HiZ, ivec2(x, y), level).r);
+    }
+
+    return nearestDepth <= farthest;
+}
+
+void main()
+{
+    Candidate candidate = candidates[gl_VertexID];
+    commands[gl_VertexID].instanceCount = isVisible(candidate.boundsMin.xyz, candidate.boundsMax.xyz) ? 1u : 0u;
+
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
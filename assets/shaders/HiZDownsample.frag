@@ -0,0 +1,26 @@
+#version 460
+
+// One level of the depth pyramid from the one below, see HiZPyramid.h for the layout
+uniform sampler2D u_Source;
+
+out float o_Depth;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(u_Source, 0);
+    ivec2 destSize = max(sourceSize / 2, ivec2(1));
+    ivec2 dest = ivec2(gl_FragCoord.xy);
+
+    // The last row and column also take in the leftover texel of an odd size
+    ivec2 first = min(dest * 2, sourceSize - 1);
+    ivec2 last = mix(dest * 2 + 1, sourceSize - 1, equal(dest, destSize - 1));
+
+    float farthest = 0.0;
+    for (int y = first.y; y <= last.y; ++y)
+    {
+        for (int x = first.x; x <= last.x; ++x)
+            farthest = max(farthest, texelFetch(u_Source, ivec2(x, y), 0).r);
+    }
+
+    o_Depth = farthest;
+}
\ No newline at end of file
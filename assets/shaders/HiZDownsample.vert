@@ -0,0 +1,8 @@
+#version 460
+
+layout(location = 0) in vec3 a_Position;
+
+void main()
+{
+    gl_Position = vec4(a_Position.xy * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
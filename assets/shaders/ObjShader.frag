@@ -5,14 +5,71 @@
 
 #define MAX_IBL_LOD 5
 
+// Per frame values, shared by every program through binding 0. Must match SceneRenderer::FrameData
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_LightSpaceMatrices[MAX_NUM_CASCADES];
+    vec4 u_CascadeTexelSizes[MAX_NUM_CASCADES]; // x texel scale relative to cascade 0, y world units per texel
+
+    vec4 u_AlbedoFallback;
+    vec3 u_ViewPos;
+    int u_NumCascades;
+    vec3 u_EmissiveFallback;
+    float u_MetallicFallback;
+    vec2 u_InvColorResolution; // 1/width, 1/height of color buffer
+    float u_RoughnessFallback;
+    float u_AOFallback;
+
+    float u_ShadowBiasSlope;
+    float u_ShadowBiasMin;
+    float u_NormalOffsetScale;
+    float u_PCSSBase;
+    float u_PCSSScale;
+
+    bool u_UseSSAO;
+    float u_AOStrength; // 0..1 (how much to dim diffuse IBL)
+    float u_AOSpecScale; // 0..1 (gentler dim on specular IBL)
+    float u_AOMin; // 0..1 (floor to avoid pitch-black, e.g. 0.05)
+};
+
 in vec2 v_TexCoord;
 in vec3 v_Normal;
 in vec3 v_FragPos;
 
-uniform vec3 u_ViewPos;
+flat in uint v_Material;
 
-uniform int u_AlphaMode;    // 0 OPAQUE, 1 MASK, 2 BLEND
-uniform float u_AlphaCutoff;  // used when u_AlphaMode == 1
+// Every material of every model drawn, copied from each model's material buffer by the SceneRenderer. Must match Model::MaterialData
+struct MaterialData
+{
+    vec4 baseColorFactor;
+    vec3 emissiveFactor;       // default vec3(0.0)
+    float metallicFactor;
+    float roughnessFactor;
+    float normalScale;         // default 1.0
+    float occlusionStrength;   // default 1.0
+    float transmissionFactor;  // default 0.0 (KHR_materials_transmission)
+    float ior;                 // default 1.5
+    float alphaCutoff;         // used when alphaMode == 1
+    int alphaMode;             // 0 OPAQUE, 1 MASK, 2 BLEND
+
+    // "Has map" flags
+    bool hasAlbedoMap;
+    bool hasNormalMap;
+    bool hasMetallicRoughnessMap;
+    bool hasOcclusionMap;
+    bool hasEmissiveMap;
+    bool hasTransmissionTex;
+    int padding0;
+    int padding1;
+    int padding2;
+};
+
+layout (std430, binding = 3) readonly buffer Materials
+{
+    MaterialData u_Materials[];
+};
 
 // Texture samplers
 uniform sampler2D u_AlbedoMap;
@@ -20,36 +77,7 @@ uniform sampler2D u_NormalMap;
 uniform sampler2D u_MetallicRoughnessMap;
 uniform sampler2D u_OcclusionMap;
 uniform sampler2D u_EmissiveMap;
-
-// "Has map" flags (bools)
-uniform bool u_HasAlbedoMap;
-uniform bool u_HasNormalMap;
-uniform bool u_HasMetallicRoughnessMap;
-uniform bool u_HasOcclusionMap;
-uniform bool u_HasEmissiveMap;
-
-// Factors
-uniform vec4  u_BaseColorFactor;
-uniform float u_MetallicFactor;
-uniform float u_RoughnessFactor;
-
-// Fallback values
-uniform vec4  u_AlbedoFallback;      // default vec4(1,1,1,1)
-uniform float u_MetallicFallback;    // default 0.0
-uniform float u_RoughnessFallback;   // default 1.0
-uniform float u_AOFallback;          // default 1.0
-uniform vec3  u_EmissiveFallback;    // default vec3(0.0)
-
-// Extra core factors from glTF
-uniform float u_NormalScale;         // default 1.0
-uniform float u_OcclusionStrength;   // default 1.0
-uniform vec3 u_EmissiveFactor;       // default vec3(0.0)
-
-// Thin-glass support (KHR_materials_transmission + ior)
-uniform float u_TransmissionFactor;  // default 0.0
-uniform bool u_HasTransmissionTex;   // default false
 uniform sampler2D u_TransmissionTex; // R channel if present
-uniform float u_IOR;                 // default 1.5
 
 // Direct light (directional)
 uniform vec3 u_DirLightDirection;
@@ -57,19 +85,7 @@ uniform vec3 u_DirLightColor;
 uniform float u_DirLightIntensity;
 
 // Shadowing
-uniform int u_NumCascades;
 uniform sampler2D u_ShadowMaps[MAX_NUM_CASCADES];
-uniform mat4 u_LightSpaceMatrices[MAX_NUM_CASCADES];
-uniform float u_CascadeTexelScale[MAX_NUM_CASCADES];
-uniform float u_CascadeWorldTexelSize[MAX_NUM_CASCADES];
-
-uniform float u_ShadowBiasSlope;
-uniform float u_ShadowBiasMin;
-uniform float u_NormalOffsetScale;
-
-// PCSS
-uniform float u_PCSSBase;
-uniform float u_PCSSScale;
 
 // IBL
 uniform samplerCube u_IrradianceCube;
@@ -82,12 +98,7 @@ uniform float u_EnvIntensity;
 in vec2 v_ScreenUV;
 
 // SSAO
-uniform bool u_UseSSAO;
 uniform sampler2D u_SSAO; // AO texture: 1=open, 0=occluded
-uniform float u_AOStrength; // 0..1 (how much to dim diffuse IBL)
-uniform float u_AOSpecScale; // 0..1 (gentler dim on specular IBL)
-uniform float u_AOMin; // 0..1 (floor to avoid pitch-black, e.g. 0.05)
-uniform vec2 u_InvColorResolution; // 1/width, 1/height of color buffer
 
 out vec4 FragColor;
 
@@ -152,7 +163,7 @@ float ComputeShadowPCSS(sampler2D shadowMap, vec3 projCoords, float receiverDept
     float baseTexel  = max(texelSize.x, texelSize.y);
 
     // Cascade scale: 1.0 for reference cascade, <1 or >1 for others
-    float texelScale = u_CascadeTexelScale[cascadeIndex];
+    float texelScale = u_CascadeTexelSizes[cascadeIndex].x;
     float searchRadiusUV = u_PCSS_SearchRadiusTexels * baseTexel * texelScale;
 
     float blockerDepthSum = 0.0;
@@ -250,7 +261,7 @@ float ShadowCalculation(vec3 fragWorldPos, vec3 normal, vec3 lightDir)
 
     // Normal-offset shadows:
     // Move the receiver along the *geometric* normal, by ~N texels in world space
-    float worldTexel = u_CascadeWorldTexelSize[bestCascade];
+    float worldTexel = u_CascadeTexelSizes[bestCascade].y;
     vec3  offsetPos  = fragWorldPos + normal * (u_NormalOffsetScale * worldTexel);
 
     // Recompute light-space coords using the offset position
@@ -320,13 +331,15 @@ bool insideFrustumClip_MinusOneToOne(mat4 VP, vec3 worldPos)
 
 void main()
 {
+    MaterialData material = u_Materials[v_Material];
+
     // Albedo + alpha
     vec4 albedoTex;
 
-    if (u_AlphaMode == 1)
+    if (material.alphaMode == 1)
     {
         // MASK: clamp sampled mip level
-        if (u_HasAlbedoMap)
+        if (material.hasAlbedoMap)
         {
             float lod = textureQueryLod(u_AlbedoMap, v_TexCoord).x; // Hardware-chosen LOD
             float clampedLod = min(lod, 3.0);                       // Cap at mip 3 (specifically for fences)
@@ -340,18 +353,18 @@ void main()
     else
     {
         // OPAQUE / BLEND: normal sampling
-        albedoTex = u_HasAlbedoMap ? texture(u_AlbedoMap, v_TexCoord) : u_AlbedoFallback;
+        albedoTex = material.hasAlbedoMap ? texture(u_AlbedoMap, v_TexCoord) : u_AlbedoFallback;
     }
 
-    vec3  albedo = albedoTex.rgb * u_BaseColorFactor.rgb;
-    float alpha  = albedoTex.a   * u_BaseColorFactor.a;
+    vec3  albedo = albedoTex.rgb * material.baseColorFactor.rgb;
+    float alpha  = albedoTex.a   * material.baseColorFactor.a;
 
-    if (u_AlphaMode == 1)
+    if (material.alphaMode == 1)
     { // MASK
-        if (alpha < u_AlphaCutoff) discard;
+        if (alpha < material.alphaCutoff) discard;
         alpha = 1.0;
     }
-    else if (u_AlphaMode == 0)
+    else if (material.alphaMode == 0)
     { // OPAQUE
         alpha = 1.0;
     }
@@ -359,7 +372,7 @@ void main()
     // Metallic/Roughness (G=roughness, B=metallic)
     float roughnessTex;
     float metallicTex;
-    if (u_HasMetallicRoughnessMap)
+    if (material.hasMetallicRoughnessMap)
     {
         vec2 mr = texture(u_MetallicRoughnessMap, v_TexCoord).gb;
         roughnessTex = mr.x;
@@ -370,21 +383,21 @@ void main()
         roughnessTex = u_RoughnessFallback;
         metallicTex  = u_MetallicFallback;
     }
-    float metallic  = clamp(u_MetallicFactor  * metallicTex,  0.0, 1.0);
-    float roughness = clamp(u_RoughnessFactor * roughnessTex, 0.02, 1.0);
+    float metallic  = clamp(material.metallicFactor  * metallicTex,  0.0, 1.0);
+    float roughness = clamp(material.roughnessFactor * roughnessTex, 0.02, 1.0);
 
     // AO (R channel)
-    float aoSample = u_HasOcclusionMap ? texture(u_OcclusionMap, v_TexCoord).r : u_AOFallback;
-    float ao = mix(1.0, aoSample, u_OcclusionStrength);
+    float aoSample = material.hasOcclusionMap ? texture(u_OcclusionMap, v_TexCoord).r : u_AOFallback;
+    float ao = mix(1.0, aoSample, material.occlusionStrength);
 
     // Emissive
-    vec3 emissiveTex = u_HasEmissiveMap ? texture(u_EmissiveMap, v_TexCoord).rgb : u_EmissiveFallback;
-    vec3 emissive = emissiveTex * u_EmissiveFactor;
+    vec3 emissiveTex = material.hasEmissiveMap ? texture(u_EmissiveMap, v_TexCoord).rgb : u_EmissiveFallback;
+    vec3 emissive = emissiveTex * material.emissiveFactor;
 
     // Normal mapping
     vec3 Ngeom = safeNormalize(v_Normal);
     vec3 N = Ngeom ;
-    if (u_HasNormalMap)
+    if (material.hasNormalMap)
     {
         vec3 dp1 = dFdx(v_FragPos);
         vec3 dp2 = dFdy(v_FragPos);
@@ -401,7 +414,7 @@ void main()
         vec3 B = safeNormalize(-dp1 * duv2.x + dp2 * duv1.x);
         mat3 TBN = mat3(T, B, Ngeom);
         vec3 nSample = texture(u_NormalMap, v_TexCoord).xyz * 2.0 - 1.0;
-        nSample.xy *= u_NormalScale;
+        nSample.xy *= material.normalScale;
         nSample.z = sqrt(max(0.0, 1.0 - dot(nSample.xy, nSample.xy)));
         N = safeNormalize(TBN * safeNormalize(nSample));
     }
@@ -447,11 +460,11 @@ void main()
 
     // Some exporters put transmission only in the texture and leave factor = 0.
     // Read the texture first, then multiply.
-    float tTex = u_HasTransmissionTex ? texture(u_TransmissionTex, v_TexCoord).r : 1.0;
-    float transmission = clamp(u_TransmissionFactor * tTex, 0.0, 1.0);
+    float tTex = material.hasTransmissionTex ? texture(u_TransmissionTex, v_TexCoord).r : 1.0;
+    float transmission = clamp(material.transmissionFactor * tTex, 0.0, 1.0);
 
     // Treat as "glass" if either factor or texture wants it.
-    bool isGlass = (u_TransmissionFactor > 0.001) || (u_HasTransmissionTex && tTex > 0.001);
+    bool isGlass = (material.transmissionFactor > 0.001) || (material.hasTransmissionTex && tTex > 0.001);
 
     // For glass: no diffuse
     if (isGlass) kD = vec3(0.0);
@@ -496,7 +509,7 @@ void main()
     if (isGlass)
     {
         // Thin-surface transmission via refracted IBL
-        float eta  = max(u_IOR, 1.0001);
+        float eta  = max(material.ior, 1.0001);
         vec3 Tdir = refract(-V, N, 1.0 / eta);
         vec3 envT = textureLod(u_PrefilterEnv, Tdir, lod).rgb;
 
@@ -514,7 +527,7 @@ void main()
     // After computing Fibl (roughness-aware Fresnel) and 'transmission'
     float outAlpha = alpha;
 
-    if (u_AlphaMode == 2)
+    if (material.alphaMode == 2)
     {
         float transVis = transmission * (1.0 - Fibl.r);
         float roughBoost = mix(0.0, 0.3, clamp(roughness, 0.0, 1.0));
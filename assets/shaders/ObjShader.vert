@@ -7,17 +7,76 @@ layout (location = 2) in vec3 a_Normal;
 out vec2 v_TexCoord;
 out vec3 v_Normal;
 out vec3 v_FragPos;
+flat out uint v_Material;
 
-uniform mat4 u_Projection;
-uniform mat4 u_Model;
-uniform mat4 u_View;
+#define MAX_NUM_CASCADES 5
 
+// Per frame values, the same block as ObjShader.frag
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 u_View;
+	mat4 u_Projection;
+	mat4 u_LightSpaceMatrices[MAX_NUM_CASCADES];
+	vec4 u_CascadeTexelSizes[MAX_NUM_CASCADES];
+
+	vec4 u_AlbedoFallback;
+	vec3 u_ViewPos;
+	int u_NumCascades;
+	vec3 u_EmissiveFallback;
+	float u_MetallicFallback;
+	vec2 u_InvColorResolution;
+	float u_RoughnessFallback;
+	float u_AOFallback;
+
+	float u_ShadowBiasSlope;
+	float u_ShadowBiasMin;
+	float u_NormalOffsetScale;
+	float u_PCSSBase;
+	float u_PCSSScale;
+
+	bool u_UseSSAO;
+	float u_AOStrength;
+	float u_AOSpecScale;
+	float u_AOMin;
+};
+
+// One per draw, picked by the indirect command's base instance. Must match SceneRenderer::DrawData
+struct DrawData
+{
+	mat4 model;
+	vec4 positionScale; // Vertex format decode, see Model::VertexFormat
+	vec4 positionOffset;
+	uint material; // Into ObjShader.frag's material table
+	uint octNormals;
+	uint padding0;
+	uint padding1;
+};
+
+layout (std430, binding = 2) readonly buffer Draws
+{
+	DrawData u_Draws[];
+};
+
+vec3 DecodeOctahedral(vec2 _e)
+{
+	vec3 n = vec3(_e, 1.0 - abs(_e.x) - abs(_e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
-	gl_Position = u_Projection * u_View * u_Model * vec4(a_Position, 1.0);
+	DrawData draw = u_Draws[gl_BaseInstance];
+
+	vec3 position = draw.positionOffset.xyz + draw.positionScale.xyz * a_Position;
+	vec3 normal = draw.octNormals != 0u ? DecodeOctahedral(a_Normal.xy) : a_Normal;
+
+	gl_Position = u_Projection * u_View * draw.model * vec4(position, 1.0);
 	v_TexCoord = a_TexCoord;
 	
-	v_Normal = mat3(u_Model) * a_Normal;
-	v_FragPos = vec3(u_Model * vec4(a_Position, 1.0));
+	v_Normal = mat3(draw.model) * normal;
+	v_FragPos = vec3(draw.model * vec4(position, 1.0));
+	v_Material = draw.material;
 }
\ No newline at end of file
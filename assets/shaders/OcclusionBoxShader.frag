@@ -1,6 +0,0 @@
-#version 460
-
-void main()
-{
-    // No outputs needed. Depth is written by the pipeline if depth writes are enabled.
-}
\ No newline at end of file
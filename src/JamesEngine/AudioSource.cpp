@@ -17,6 +17,10 @@ namespace JamesEngine
 
 	void AudioSource::OnInitialize()
 	{
+		// No audio context when headless, so there is no source. AL calls without a context are ignored, so the setters are still safe
+		if (GetCore()->IsHeadless())
+			return;
+
 		alGenSources(1, &mSourceId);
 		
 		alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
@@ -31,12 +35,20 @@ namespace JamesEngine
 
 	void AudioSource::OnDestroy()
 	{
+		if (mSourceId == 0)
+			return;
+
 		alDeleteSources(1, &mSourceId);
 	}
 
 	void AudioSource::OnTick()
 	{
 		std::shared_ptr<Core> core = GetEntity()->GetCore();
+
+		// There may not be a camera to listen from
+		if (core->IsHeadless())
+			return;
+
 		glm::vec3 cameraPosition = core->GetCamera()->GetPosition();
 		glm::vec3 cameraForward = core->GetCamera()->GetTransform()->GetForward();
 		glm::vec3 cameraUp = -core->GetCamera()->GetTransform()->GetUp();
@@ -94,6 +106,9 @@ namespace JamesEngine
 
 	bool AudioSource::IsPlaying()
 	{
+		if (mSourceId == 0)
+			return false;
+
 		int state = 0; 
 		alGetSourcei(mSourceId, AL_SOURCE_STATE, &state); 
 		if (state == AL_PLAYING)
@@ -104,7 +119,7 @@ namespace JamesEngine
 
 	void AudioSource::Play()
 	{
-		if (mSound != nullptr)
+		if (mSound != nullptr && mSourceId != 0)
 			alSourcePlay(mSourceId);
 	}
 
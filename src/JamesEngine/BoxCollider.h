@@ -29,7 +29,7 @@ namespace JamesEngine
 		glm::vec3 mSize{ 1 };
 
 #ifdef JAMES_DEBUG
-		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/cube.obj");
+		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/cube.obj", false);
 #endif
 	};
 
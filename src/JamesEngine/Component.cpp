@@ -111,41 +111,6 @@ namespace JamesEngine
 
 
 
-	void Component::Tick()
-	{
-		OnTick();
-	}
-
-	void Component::EarlyFixedTick()
-	{
-		OnEarlyFixedTick();
-	}
-
-	void Component::FixedTick()
-	{
-		OnFixedTick();
-	}
-
-	void Component::LateFixedTick()
-	{
-		OnLateFixedTick();
-	}
-
-	void Component::Render()
-	{
-		OnRender();
-	}
-
-	void Component::ShadowRender(const glm::mat4& _lightSpaceMatrix)
-	{
-		OnShadowRender(_lightSpaceMatrix);
-	}
-
-	void Component::GUI()
-	{
-		OnGUI();
-	}
-
 	void Component::Destroy()
 	{
 		OnDestroy();
@@ -1,13 +1,39 @@
 #pragma once
 
+#include "SlotMap.h"
+
 #include <glm/glm.hpp>
 
 #include <string>
 #include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 
 namespace JamesEngine
 {
 
+	using ComponentTypeId = std::size_t;
+
+	inline ComponentTypeId NextComponentTypeId()
+	{
+		static std::atomic<ComponentTypeId> counter{ 0 };
+		return counter++;
+	}
+
+	/**
+	 * @brief Gets a unique id for type T, assigned the first time it is asked for. Used to index the component registry without RTTI.
+	 * @tparam T The type to get the id of.
+	 * @return The id of T.
+	 */
+	template <typename T>
+	ComponentTypeId GetComponentTypeId()
+	{
+		static const ComponentTypeId id = NextComponentTypeId();
+		return id;
+	}
+
 	class Entity;
 	class Input;
 	class Keyboard;
@@ -16,6 +42,51 @@ namespace JamesEngine
 	class Transform;
 	class Core;
 
+	/**
+	 * @brief The fixed tick phases, run one after the other with a barrier between each.
+	 */
+	enum class TickPhase
+	{
+		EarlyFixedTick,
+		FixedTick,
+		LateFixedTick
+	};
+
+	/**
+	 * @brief The hooks Core calls every frame. Core keeps a list per hook of only the components that override it.
+	 */
+	enum class ComponentHook
+	{
+		Tick,
+		EarlyFixedTick,
+		FixedTick,
+		LateFixedTick,
+		Render,
+		GUI,
+		Count
+	};
+
+	inline ComponentHook GetComponentHook(TickPhase _phase)
+	{
+		switch (_phase)
+		{
+		case TickPhase::EarlyFixedTick:
+			return ComponentHook::EarlyFixedTick;
+		case TickPhase::FixedTick:
+			return ComponentHook::FixedTick;
+		default:
+			return ComponentHook::LateFixedTick;
+		}
+	}
+
+	/**
+	 * @brief Works out which hooks T (or one of its bases) overrides, at compile time. If nothing between T and Component overrides a hook, &T::OnX is still a pointer to a Component member.
+	 * @tparam T The component type.
+	 * @return A bit mask with bit (1 << ComponentHook) set for each overridden hook.
+	 */
+	template <typename T>
+	unsigned int GetOverriddenHooks();
+
 	/**
 	 * @class Component
 	 * @brief Base class for all components.
@@ -88,19 +159,57 @@ namespace JamesEngine
 		 */
 		virtual void OnAlive() {}
 
+		/**
+		 * @brief Override to opt in to running a fixed tick phase on a worker thread alongside other entities.
+		 * Only return true if, for that phase, the component writes nothing but its own state (reading other entities and raycasting is fine).
+		 * Parallel components still run in hook order: a run of them between two serial components is one batch, which finishes before the next serial component starts. Only asked once, when the component is added.
+		 * @param _phase The phase being run.
+		 */
+		virtual bool IsParallelSafe(TickPhase /*_phase*/) { return false; }
+
+		/**
+		 * @brief Gets the type id of the concrete type this component was added as.
+		 */
+		ComponentTypeId GetTypeId() const { return mTypeId; }
+
 	private:
 		friend class JamesEngine::Entity;
+		friend class JamesEngine::Core;
 
 		std::weak_ptr<Entity> mEntity;
 
-		void Tick();
-		void EarlyFixedTick();
-		void FixedTick();
-		void LateFixedTick();
-		void Render();
-		void ShadowRender(const glm::mat4& _lightSpaceMatrix);
-		void GUI();
+		ComponentTypeId mTypeId = 0;
+
+		// Set by Core when registered, and nulled when the entity is removed
+		Handle<Component> mHandle;
+
+		// Which hooks are overridden, from GetOverriddenHooks
+		unsigned int mHooks = 0;
+		// Entity id then index in the entity, so the hook lists run in the same order as the entities
+		uint64_t mHookOrder = 0;
+
 		void Destroy();
 		void Alive();
 	};
+
+	template <typename T>
+	unsigned int GetOverriddenHooks()
+	{
+		unsigned int hooks = 0;
+
+		if (!std::is_same_v<decltype(&T::OnTick), decltype(&Component::OnTick)>)
+			hooks |= 1u << (int)ComponentHook::Tick;
+		if (!std::is_same_v<decltype(&T::OnEarlyFixedTick), decltype(&Component::OnEarlyFixedTick)>)
+			hooks |= 1u << (int)ComponentHook::EarlyFixedTick;
+		if (!std::is_same_v<decltype(&T::OnFixedTick), decltype(&Component::OnFixedTick)>)
+			hooks |= 1u << (int)ComponentHook::FixedTick;
+		if (!std::is_same_v<decltype(&T::OnLateFixedTick), decltype(&Component::OnLateFixedTick)>)
+			hooks |= 1u << (int)ComponentHook::LateFixedTick;
+		if (!std::is_same_v<decltype(&T::OnRender), decltype(&Component::OnRender)>)
+			hooks |= 1u << (int)ComponentHook::Render;
+		if (!std::is_same_v<decltype(&T::OnGUI), decltype(&Component::OnGUI)>)
+			hooks |= 1u << (int)ComponentHook::GUI;
+
+		return hooks;
+	}
 }
\ No newline at end of file
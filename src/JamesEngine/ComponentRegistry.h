@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Component.h"
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace JamesEngine
+{
+
+	/**
+	 * @class ComponentBucketBase
+	 * @brief Type erased list of all components in the scene that are a given type.
+	 */
+	class ComponentBucketBase
+	{
+	public:
+		virtual ~ComponentBucketBase() {}
+
+		virtual void Add(const std::shared_ptr<Component>& _component) = 0;
+		// Removes every component the predicate returns true for in one pass
+		virtual void RemoveIf(const std::function<bool(const Component&)>& _predicate) = 0;
+	};
+
+	/**
+	 * @class ComponentBucket
+	 * @brief Holds every component in the scene that is a T (including types derived from T), in the order they were registered.
+	 * @tparam T The type of component the bucket holds.
+	 */
+	template <typename T>
+	class ComponentBucket : public ComponentBucketBase
+	{
+	public:
+		void Add(const std::shared_ptr<Component>& _component) override
+		{
+			if (Accepts(*_component))
+				mComponents.push_back(std::static_pointer_cast<T>(_component));
+		}
+
+		void RemoveIf(const std::function<bool(const Component&)>& _predicate) override
+		{
+			// Keep the order so "first found" queries behave the same as before
+			mComponents.erase(std::remove_if(mComponents.begin(), mComponents.end(),
+				[&_predicate](const std::shared_ptr<T>& _component) { return _predicate(*_component); }), mComponents.end());
+		}
+
+		const std::vector<std::shared_ptr<T>>& GetComponents() const { return mComponents; }
+
+	private:
+		// Only does a dynamic_cast the first time a concrete type is seen, after that it is a lookup
+		bool Accepts(const Component& _component)
+		{
+			ComponentTypeId id = _component.GetTypeId();
+
+			if (id >= mAccepts.size())
+				mAccepts.resize(id + 1, -1);
+
+			if (mAccepts[id] == -1)
+				mAccepts[id] = dynamic_cast<const T*>(&_component) ? 1 : 0;
+
+			return mAccepts[id] == 1;
+		}
+
+		std::vector<std::shared_ptr<T>> mComponents;
+
+		// Indexed by concrete component type id. -1 = not checked yet, 0 = not a T, 1 = is a T
+		std::vector<signed char> mAccepts;
+	};
+
+}
\ No newline at end of file
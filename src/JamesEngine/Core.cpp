@@ -4,14 +4,19 @@
 #include "Transform.h"
 #include "Resources.h"
 #include "Input.h"
+#include "Keyboard.h"
 #include "Camera.h"
 #include "Timer.h"
+#include "Profiler.h"
 #include "Skybox.h"
 #include "Texture.h"
 #include "Shader.h"
 
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
 
 #ifdef JAMES_DEBUG
 #include <imgui.h>
@@ -25,6 +30,16 @@
 namespace JamesEngine
 {
 
+	namespace
+	{
+		// Set JAMES_PROFILE_TRACE to a file path to have a Chrome trace written when the core stops running
+		void WriteRequestedProfilerTrace()
+		{
+			if (const char* path = std::getenv("JAMES_PROFILE_TRACE"))
+				Profiler::WriteChromeTrace(path);
+		}
+	}
+
 	std::shared_ptr<Core> Core::Initialize(glm::ivec2 _windowSize)
 	{
 		std::shared_ptr<Core> rtn = std::make_shared<Core>();
@@ -36,6 +51,25 @@ namespace JamesEngine
 		rtn->mSkybox = std::make_shared<Skybox>(rtn);
 		rtn->mSceneRenderer = std::make_shared<SceneRenderer>(rtn);
 		rtn->mRaycastSystem = std::make_shared<RaycastSystem>(rtn);
+		rtn->mJobSystem = std::make_shared<JobSystem>();
+		rtn->mInput = std::make_shared<Input>();
+
+		rtn->mSelf = rtn;
+
+		return rtn;
+	}
+
+	std::shared_ptr<Core> Core::InitializeHeadless(float _realTimeMultiple)
+	{
+		std::shared_ptr<Core> rtn = std::make_shared<Core>();
+		rtn->mHeadless = true;
+		rtn->mRealTimeMultiple = _realTimeMultiple;
+
+		// No window, audio, GUI, skybox or scene renderer, they all need a GL or audio context
+		rtn->mResources = std::make_shared<Resources>(true);
+		rtn->mLightManager = std::make_shared<LightManager>();
+		rtn->mRaycastSystem = std::make_shared<RaycastSystem>(rtn);
+		rtn->mJobSystem = std::make_shared<JobSystem>();
 		rtn->mInput = std::make_shared<Input>();
 
 		rtn->mSelf = rtn;
@@ -45,6 +79,48 @@ namespace JamesEngine
 
 	void Core::SetLoadingScreen(std::shared_ptr<Texture> _texture)
 	{
+		if (mHeadless)
+			return;
+
+		mLoadingScreen = _texture;
+
+		DrawLoadingScreen();
+	}
+
+	void Core::WaitForAsyncLoads()
+	{
+		while (mResources->GetPendingLoadCount() > 0)
+		{
+			JAMES_PROFILE_ZONE("Core::WaitForAsyncLoads");
+
+			if (!mHeadless)
+			{
+				SDL_Event event = {};
+				while (SDL_PollEvent(&event))
+				{
+					if (event.type == SDL_QUIT)
+						mIsRunning = false;
+				}
+			}
+
+			if (!mIsRunning)
+				return;
+
+			// Nothing else is happening, so most of the frame can go on uploads
+			mResources->ProcessUploads(12.f);
+
+			if (mLoadingScreen)
+				DrawLoadingScreen(); // Swapping waits for vsync, which keeps this from spinning
+			else
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	void Core::DrawLoadingScreen()
+	{
+		if (mHeadless || !mLoadingScreen)
+			return;
+
 		mWindow->Update();
 		mWindow->ClearWindow();
 
@@ -55,13 +131,20 @@ namespace JamesEngine
 		mGUI->PreUploadGlobalStaticUniformsUI();
 		mGUI->UploadGlobalUniformsUI();
 
-		mGUI->Image(glm::vec2(width/2, height/2), glm::vec2(width, height), _texture);
+		mGUI->Image(glm::vec2(width/2, height/2), glm::vec2(width, height), mLoadingScreen);
 
 		mWindow->SwapWindows();
 	}
 
 	void Core::Run()
 	{
+		if (mHeadless)
+		{
+			RunHeadless();
+			WriteRequestedProfilerTrace();
+			return;
+		}
+
 		PreUploadGlobalStaticUniforms();
 		mGUI->PreUploadGlobalStaticUniformsUI();
 
@@ -82,14 +165,10 @@ namespace JamesEngine
 
 		Timer mDeltaTimer;
 
-		// For GPU timing
-		GLuint sceneTimeQuery[3] = { 0,0,0 };
-		glGenQueries(3, sceneTimeQuery);
-		int sceneQ = 0; // ring-buffer index [0..2]
-
 		while (mIsRunning)
 		{
-			//ScopedTimer timer("Core::Run");
+			Profiler::BeginFrame();
+
 			mDeltaTime = mDeltaTimer.Stop();
 
 			//std::cout << "FPS: " << 1.0f / mDeltaTime << std::endl;
@@ -115,7 +194,7 @@ namespace JamesEngine
 			}
 
 			{
-				//ScopedTimer timer("Core::HandleInputs");
+				JAMES_PROFILE_ZONE("Core::HandleInputs");
 				// Handle input events
 				mInput->Update();
 
@@ -135,8 +214,15 @@ namespace JamesEngine
 						mInput->HandleInput(event);
 					}
 				}
+
+				// Captures whatever is still in the profiler's buffers (the last few seconds) without touching any code
+				if (mInput->GetKeyboard()->IsKeyDown(SDLK_F9))
+					Profiler::WriteChromeTrace("profile.json");
 			}
 
+			// Finish off any async loads that are done decoding, a few at a time so the frame doesn't hitch
+			mResources->ProcessUploads(mAsyncUploadBudgetMs);
+
 #ifdef JAMES_DEBUG
 			ImGui_ImplOpenGL3_NewFrame();
 			ImGui_ImplSDL2_NewFrame();
@@ -144,12 +230,9 @@ namespace JamesEngine
 #endif
 
 			{
-				//ScopedTimer timer("Core::Tick");
+				JAMES_PROFILE_ZONE("Core::Tick");
 				// Run tick on all entities
-				for (size_t ei = 0; ei < mEntities.size(); ++ei)
-				{
-					mEntities[ei]->OnTick();
-				}
+				TickEntities();
 			}
 
 			{
@@ -163,22 +246,11 @@ namespace JamesEngine
 
 				while (mFixedTimeAccumulator >= mFixedDeltaTime)
 				{
-					//ScopedTimer timer("Core::FixedTick");
+					JAMES_PROFILE_ZONE("Core::FixedTick");
 
-					for (size_t ei = 0; ei < mEntities.size(); ++ei)
-					{
-						mEntities[ei]->OnEarlyFixedTick();
-					}
-
-					for (size_t ei = 0; ei < mEntities.size(); ++ei)
-					{
-						mEntities[ei]->OnFixedTick();
-					}
-
-					for (size_t ei = 0; ei < mEntities.size(); ++ei)
-					{
-						mEntities[ei]->OnLateFixedTick();
-					}
+					RunFixedTickPhase(TickPhase::EarlyFixedTick);
+					RunFixedTickPhase(TickPhase::FixedTick);
+					RunFixedTickPhase(TickPhase::LateFixedTick);
 
 					numFixedUpdates++;
 
@@ -187,28 +259,15 @@ namespace JamesEngine
 			}
 
 			// Delete entities that have been destroyed this frame
-			for (size_t ei = 0; ei < mEntities.size(); ei++)
-			{
-				if (mEntities.at(ei)->mAlive == false)
-				{
-					mEntities.erase(mEntities.begin() + ei);
-					ei--;
-				}
-			}
-
-			// Clear the raycast cache (currently holds all colliders in current scene)
-			mRaycastSystem->ClearCache();
+			RemoveDestroyedEntities();
 
 			// Render the scene and GUI
 			{
-				//ScopedTimer timer("Core::Render");
-
-				glBeginQuery(GL_TIME_ELAPSED, sceneTimeQuery[sceneQ]);
+				JAMES_PROFILE_ZONE("Core::Render");
 
+				// GPU time per pass is tracked by the scene renderer, see SceneRenderer::GetGpuPassTimings
 				RenderScene();
 
-				glEndQuery(GL_TIME_ELAPSED);
-
 				RenderGUI();
 
 #ifdef JAMES_DEBUG
@@ -230,38 +289,258 @@ namespace JamesEngine
 				// Present the rendered frame
 				mWindow->SwapWindows();
 			}
+		}
+
+		WriteRequestedProfilerTrace();
+	}
+
+	void Core::RunHeadless()
+	{
+		Timer realTimer;
+		realTimer.Start();
+
+		double simulatedTime = 0.0;
+
+		while (mIsRunning)
+		{
+			Profiler::BeginFrame();
+
+			// Time scale is ignored here, use the real time multiple instead
+			mLastFrameTime = mFixedDeltaTime;
+			mDeltaTime = mFixedDeltaTime;
+
+			// No events to handle, but keeps the pressed/released lists cleared
+			mInput->Update();
+
+			{
+				JAMES_PROFILE_ZONE("Core::Tick");
+				TickEntities();
+			}
 
-			// Read back previous frames result to avoid stall
-			int prev = (sceneQ + 2) % 3;
-			GLuint available = 0;
-			glGetQueryObjectuiv(sceneTimeQuery[prev], GL_QUERY_RESULT_AVAILABLE, &available);
-			if (available)
 			{
-				GLuint64 ns = 0;
-				glGetQueryObjectui64v(sceneTimeQuery[prev], GL_QUERY_RESULT, &ns);
-				double sceneGpuMs = ns / 1e6; // nanoseconds -> ms
-				std::cout << "GPU Scene: " << sceneGpuMs << "ms\n";
+				JAMES_PROFILE_ZONE("Core::FixedTick");
+				RunFixedTickPhase(TickPhase::EarlyFixedTick);
+				RunFixedTickPhase(TickPhase::FixedTick);
+				RunFixedTickPhase(TickPhase::LateFixedTick);
 			}
 
-			sceneQ = (sceneQ + 1) % 3;
+			RemoveDestroyedEntities();
+
+			simulatedTime += mFixedDeltaTime;
+
+			if (mRealTimeMultiple > 0.f)
+			{
+				// Sleep off however far ahead of the multiple we are
+				double aheadBy = simulatedTime / mRealTimeMultiple - realTimer.GetElapsedSeconds();
+				if (aheadBy > 0.0)
+					std::this_thread::sleep_for(std::chrono::duration<double>(aheadBy));
+			}
+		}
+	}
+
+	void Core::RemoveDestroyedEntities()
+	{
+		// Null the handles of everything being removed first, while the entities are still alive for the hook lists to check
+		bool anyDestroyed = false;
+		for (size_t ei = 0; ei < mEntities.size(); ei++)
+		{
+			std::shared_ptr<Entity>& e = mEntities[ei];
+			if (e->mAlive)
+				continue;
+
+			for (size_t ci = 0; ci < e->mComponents.size(); ++ci)
+			{
+				mComponentSlots.Remove(e->mComponents[ci]->mHandle);
+				e->mComponents[ci]->mHandle = Handle<Component>();
+			}
+
+			mEntitySlots.Remove(e->mHandle);
+			anyDestroyed = true;
+		}
+
+		if (!anyDestroyed)
+			return;
+
+		for (int h = 0; h < (int)ComponentHook::Count; ++h)
+		{
+			std::vector<HookEntry>& hooks = mHookLists[h];
+			hooks.erase(std::remove_if(hooks.begin(), hooks.end(),
+				[](const HookEntry& _entry) { return _entry.component->mHandle.IsNull(); }), hooks.end());
+		}
+
+		for (size_t i = 0; i < mComponentBuckets.size(); ++i)
+		{
+			if (mComponentBuckets[i])
+				mComponentBuckets[i]->RemoveIf([](const Component& _component) { return _component.mHandle.IsNull(); });
+		}
+
+		// Compacts in one pass rather than erasing each entity, so removing lots at once (like a scene reload) is O(n) not O(n^2)
+		// Not swap and pop, as the tick order matters (tires apply forces to the car body before it integrates)
+		size_t aliveCount = 0;
+		for (size_t ei = 0; ei < mEntities.size(); ei++)
+		{
+			if (!mEntities[ei]->mAlive)
+				continue;
+
+			if (aliveCount != ei)
+				mEntities[aliveCount] = std::move(mEntities[ei]);
+
+			aliveCount++;
+		}
+
+		mEntities.resize(aliveCount);
+	}
+
+	void Core::AliveNewEntities()
+	{
+		// By index, as entities can be added in OnAlive
+		for (size_t i = 0; i < mNewEntities.size(); ++i)
+		{
+			mNewEntities[i]->OnAlive();
+		}
+		mNewEntities.clear();
+	}
+
+	void Core::TickEntities()
+	{
+		AliveNewEntities();
+
+		mIteratingHooks = true;
+
+		std::vector<HookEntry>& hooks = mHookLists[(int)ComponentHook::Tick];
+		for (size_t i = 0; i < hooks.size(); ++i)
+		{
+			hooks[i].component->OnTick();
+		}
+
+		mIteratingHooks = false;
+		FlushPendingHookComponents();
+	}
+
+	void Core::RunFixedTickPhase(TickPhase _phase)
+	{
+		// Entities added since the last tick or phase, their components are already on the hook lists
+		AliveNewEntities();
+
+		mIteratingHooks = true;
+
+		std::vector<HookEntry>& hooks = mHookLists[(int)GetComponentHook(_phase)];
+
+		// Parallel safe components are gathered into a batch until the next serial one, which waits for the batch to finish first.
+		// So the list's order still holds, anything before a component (in its own entity or an earlier one) has run by the time it does
+		mParallelGroups.clear();
+
+		for (size_t i = 0; i < hooks.size(); ++i)
+		{
+			HookEntry& entry = hooks[i];
+
+			if (entry.parallelSafe)
+			{
+				// Top 32 bits of the order are the entity id
+				if (mParallelGroups.empty() || (hooks[mParallelGroups.back()].order >> 32) != (entry.order >> 32))
+					mParallelGroups.push_back(i);
+				continue;
+			}
+
+			if (!mParallelGroups.empty())
+				RunParallelBatch(hooks, i, _phase);
+
+			CallFixedTick(*entry.component, _phase);
+		}
+
+		if (!mParallelGroups.empty())
+			RunParallelBatch(hooks, hooks.size(), _phase);
+
+		mIteratingHooks = false;
+		FlushPendingHookComponents();
+	}
+
+	void Core::RunParallelBatch(std::vector<HookEntry>& _hooks, size_t _end, TickPhase _phase)
+	{
+		// One entity has nothing to run alongside, so it runs here like a serial component would
+		if (mParallelGroups.size() == 1)
+		{
+			for (size_t i = mParallelGroups[0]; i < _end; ++i)
+			{
+				CallFixedTick(*_hooks[i].component, _phase);
+			}
+			mParallelGroups.clear();
+			return;
+		}
+
+		// Transforms cache their world values on read, so bring them all up to date now to make reads on the workers const.
+		// Skipped if nothing has moved and no entity has been added since the last batch, which is most batches
+		if (Transform::GetWorldDirtyCount() != mTransformsUpdatedAt || mEntityIdCounter != mTransformsUpdatedEntities)
+		{
+			const std::vector<std::shared_ptr<Transform>>& transforms = GetComponents<Transform>();
+			for (size_t i = 0; i < transforms.size(); ++i)
+			{
+				transforms[i]->UpdateWorld();
+			}
+
+			mTransformsUpdatedAt = Transform::GetWorldDirtyCount();
+			mTransformsUpdatedEntities = mEntityIdCounter;
+		}
+
+		mRunningParallelPhase = true;
+
+		// Each entity's parallel components run together on one worker, in their usual order. Everything in the batch is parallel safe,
+		// so an entity's components run from its group's start up to the next group (or the end of the batch)
+		mJobSystem->ParallelFor(mParallelGroups.size(), 1, [this, &_hooks, _end, _phase](size_t _begin, size_t _groupEnd)
+			{
+				JAMES_PROFILE_ZONE("Core::ParallelFixedTick");
+
+				for (size_t g = _begin; g < _groupEnd; ++g)
+				{
+					const size_t last = g + 1 < mParallelGroups.size() ? mParallelGroups[g + 1] : _end;
+					for (size_t i = mParallelGroups[g]; i < last; ++i)
+					{
+						CallFixedTick(*_hooks[i].component, _phase);
+					}
+				}
+			});
+
+		mRunningParallelPhase = false;
+		mParallelGroups.clear();
+	}
+
+	void Core::CallFixedTick(Component& _component, TickPhase _phase)
+	{
+		switch (_phase)
+		{
+		case TickPhase::EarlyFixedTick:
+			_component.OnEarlyFixedTick();
+			break;
+		case TickPhase::FixedTick:
+			_component.OnFixedTick();
+			break;
+		case TickPhase::LateFixedTick:
+			_component.OnLateFixedTick();
+			break;
 		}
 	}
 
 	void Core::RenderScene()
 	{
-		//ScopedTimer timer("Core::RenderScene");
+		JAMES_PROFILE_ZONE("Core::RenderScene");
+
+		mIteratingHooks = true;
 
-		for (size_t ei = 0; ei < mEntities.size(); ++ei)
+		std::vector<HookEntry>& hooks = mHookLists[(int)ComponentHook::Render];
+		for (size_t i = 0; i < hooks.size(); ++i)
 		{
-			mEntities[ei]->OnRender();
+			hooks[i].component->OnRender();
 		}
 
+		mIteratingHooks = false;
+		FlushPendingHookComponents();
+
 		mSceneRenderer->RenderScene();
 	}
 
 	void Core::RenderGUI()
 	{
-		//ScopedTimer timer("Core::RenderGUI");
+		JAMES_PROFILE_ZONE("Core::RenderGUI");
 
 		mWindow->ResetGLModes();
 
@@ -269,11 +548,17 @@ namespace JamesEngine
 
 		glDisable(GL_DEPTH_TEST);
 
-		for (size_t ei = 0; ei < mEntities.size(); ++ei)
+		mIteratingHooks = true;
+
+		std::vector<HookEntry>& hooks = mHookLists[(int)ComponentHook::GUI];
+		for (size_t i = 0; i < hooks.size(); ++i)
 		{
-			mEntities[ei]->OnGUI();
+			hooks[i].component->OnGUI();
 		}
 
+		mIteratingHooks = false;
+		FlushPendingHookComponents();
+
 		glEnable(GL_DEPTH_TEST);
 	}
 
@@ -289,54 +574,89 @@ namespace JamesEngine
 		objShader->mShader->unuse();
 	}
 
-	void Core::UploadGlobalUniforms()
-	{
-		std::shared_ptr<Camera> camera = GetCamera();
-		auto objShader = mResources->Load<Shader>("shaders/ObjShader");
-		objShader->mShader->use();
-		objShader->mShader->uniform("u_Projection", camera->GetProjectionMatrix());
-		objShader->mShader->uniform("u_View", camera->GetViewMatrix());
-		objShader->mShader->uniform("u_ViewPos", camera->GetPosition());
-
-		// Wanted to upload shadow maps in the UploadGlobalUniforms function, but it needs to be done after the shadow maps are rendered
-		std::vector<std::shared_ptr<Renderer::RenderTexture>> shadowMaps;
-		shadowMaps.reserve(mLightManager->GetShadowCascades().size());
-		std::vector<glm::mat4> shadowMatrices;
-		shadowMatrices.reserve(mLightManager->GetShadowCascades().size());
-
-		for (const ShadowCascade& cascade : mLightManager->GetShadowCascades())
-		{
-			shadowMaps.emplace_back(cascade.renderTexture);
-			shadowMatrices.emplace_back(cascade.lightSpaceMatrix);
-		}
-
-		objShader->mShader->uniform("u_NumCascades", (int)shadowMaps.size());
-		objShader->mShader->uniform("u_ShadowMaps", shadowMaps, 20);
-		objShader->mShader->uniform("u_LightSpaceMatrices", shadowMatrices);
-
-		objShader->mShader->uniform("u_NumPreBaked", 0);
-		objShader->mShader->unuse();
-	}
-
 	std::shared_ptr<Entity> Core::AddEntity()
 	{
 		std::shared_ptr<Entity> rtn = std::make_shared<Entity>();
-		rtn->AddComponent<Transform>();
 		rtn->mSelf = rtn;
 		rtn->mCore = mSelf;
 		rtn->mId = mEntityIdCounter;
 		mEntityIdCounter++;
+		rtn->mHandle = mEntitySlots.Insert(rtn);
+
+		// Needs mSelf and mCore set first so the transform gets registered
+		rtn->AddComponent<Transform>();
 
 		mEntities.push_back(rtn);
+		mNewEntities.push_back(rtn);
 
 		return rtn;
 	}
 
+	void Core::RegisterComponent(const std::shared_ptr<Component>& _component)
+	{
+		_component->mHandle = mComponentSlots.Insert(_component);
+
+		for (size_t i = 0; i < mComponentBuckets.size(); ++i)
+		{
+			if (mComponentBuckets[i])
+				mComponentBuckets[i]->Add(_component);
+		}
+
+		// Worked out now, as the entity may have more components by the time a pending one is added
+		std::shared_ptr<Entity> entity = _component->GetEntity();
+		_component->mHookOrder = ((uint64_t)(uint32_t)entity->mId << 32) | (uint32_t)(entity->mComponents.size() - 1);
+
+		if (mIteratingHooks)
+			mPendingHookComponents.push_back(_component);
+		else
+			AddToHookLists(_component);
+	}
+
+	void Core::AddToHookLists(const std::shared_ptr<Component>& _component)
+	{
+		for (int h = 0; h < (int)ComponentHook::Count; ++h)
+		{
+			if ((_component->mHooks & (1u << h)) == 0)
+				continue;
+
+			HookEntry entry;
+			entry.component = _component.get();
+			entry.order = _component->mHookOrder;
+
+			if (h == (int)ComponentHook::EarlyFixedTick)
+				entry.parallelSafe = _component->IsParallelSafe(TickPhase::EarlyFixedTick);
+			else if (h == (int)ComponentHook::FixedTick)
+				entry.parallelSafe = _component->IsParallelSafe(TickPhase::FixedTick);
+			else if (h == (int)ComponentHook::LateFixedTick)
+				entry.parallelSafe = _component->IsParallelSafe(TickPhase::LateFixedTick);
+
+			// Almost always added to the newest entity, so usually goes on the end
+			std::vector<HookEntry>& hooks = mHookLists[h];
+			if (hooks.empty() || hooks.back().order < entry.order)
+			{
+				hooks.push_back(entry);
+			}
+			else
+			{
+				hooks.insert(std::upper_bound(hooks.begin(), hooks.end(), entry,
+					[](const HookEntry& _a, const HookEntry& _b) { return _a.order < _b.order; }), entry);
+			}
+		}
+	}
+
+	void Core::FlushPendingHookComponents()
+	{
+		for (size_t i = 0; i < mPendingHookComponents.size(); ++i)
+		{
+			AddToHookLists(mPendingHookComponents[i]);
+		}
+		mPendingHookComponents.clear();
+	}
+
 	// Returns the camera with the highest priority, if both have the same priority the first one found is returned
 	std::shared_ptr<Camera> Core::GetCamera()
 	{
-		std::vector<std::shared_ptr<Camera>> cameras;
-		FindComponents(cameras);
+		const std::vector<std::shared_ptr<Camera>>& cameras = GetComponents<Camera>();
 
 		if (cameras.size() == 0)
 		{
@@ -7,9 +7,13 @@
 #include "LightManager.h"
 #include "RaycastSystem.h"
 #include "Entity.h"
+#include "ComponentRegistry.h"
+#include "SlotMap.h"
+#include "JobSystem.h"
 
 #include <memory>
 #include <vector>
+#include <mutex>
 
 namespace JamesEngine
 {
@@ -33,8 +37,30 @@ namespace JamesEngine
 		 */
 		static std::shared_ptr<Core> Initialize(glm::ivec2 _windowSize);
 
+		/**
+		 * @brief Initializes a Core with no window, GL context or audio, that only runs the tick and fixed tick loop. Used for running the simulation in batches without a GPU.
+		 * Resources that need GL or audio are stubbed, models only load their geometry (so colliders still work). The window, audio, GUI, skybox and scene renderer are null.
+		 * @param _realTimeMultiple How many times faster than real time to run. 0 runs as fast as possible.
+		 * @return A shared pointer to the initialized Core.
+		 */
+		static std::shared_ptr<Core> InitializeHeadless(float _realTimeMultiple = 0.f);
+
+		bool IsHeadless() const { return mHeadless; }
+
 		void SetLoadingScreen(std::shared_ptr<Texture> _texture);
 
+		/**
+		 * @brief Keeps drawing the loading screen and uploading async loads until none are left, so the window stays responsive while assets decode in the background.
+		 * Call after starting the loads with Resources::LoadAsync and before Run, for anything that has to be loaded before the first frame.
+		 */
+		void WaitForAsyncLoads();
+
+		/**
+		 * @brief Sets how long each frame can spend creating GL/audio objects for async loads.
+		 * @param _budgetMs Time per frame in milliseconds.
+		 */
+		void SetAsyncUploadBudget(float _budgetMs) { mAsyncUploadBudgetMs = _budgetMs; }
+
 		/**
 		 * @brief Runs the main loop of the engine.
 		 */
@@ -52,6 +78,7 @@ namespace JamesEngine
 		std::shared_ptr<Skybox> GetSkybox() const { return mSkybox; }
 		std::shared_ptr<SceneRenderer> GetSceneRenderer() const { return mSceneRenderer; }
 		std::shared_ptr<RaycastSystem> GetRaycastSystem() const { return mRaycastSystem; }
+		std::shared_ptr<JobSystem> GetJobSystem() const { return mJobSystem; }
 
 		/**
 		 * @brief Adds a new entity to the engine.
@@ -59,6 +86,47 @@ namespace JamesEngine
 		 */
 		std::shared_ptr<Entity> AddEntity();
 
+		/**
+		 * @brief Gets the entity a handle refers to.
+		 * @param _handle A handle from Entity::GetHandle.
+		 * @return The entity, or nullptr if it has been removed.
+		 */
+		std::shared_ptr<Entity> GetEntity(EntityHandle _handle) const { return mEntitySlots.Get(_handle); }
+
+		/**
+		 * @brief Gets a handle to a component, which can be held instead of a shared pointer. Resolves to nullptr once the component's entity has been removed.
+		 * @tparam T The type of the component.
+		 * @param _component The component to get a handle to.
+		 * @return The handle, or a null handle if the component isn't registered.
+		 */
+		template <typename T>
+		Handle<T> GetHandle(const std::shared_ptr<T>& _component) const
+		{
+			Handle<T> rtn;
+			if (!_component)
+				return rtn;
+
+			const Component& component = *_component;
+			rtn.index = component.mHandle.index;
+			rtn.generation = component.mHandle.generation;
+			return rtn;
+		}
+
+		/**
+		 * @brief Gets the component a handle refers to.
+		 * @tparam T The type of the component.
+		 * @param _handle A handle from GetHandle.
+		 * @return The component, or nullptr if it has been removed.
+		 */
+		template <typename T>
+		std::shared_ptr<T> GetComponent(Handle<T> _handle) const
+		{
+			Handle<Component> handle;
+			handle.index = _handle.index;
+			handle.generation = _handle.generation;
+			return std::static_pointer_cast<T>(mComponentSlots.Get(handle));
+		}
+
 		/**
 		 * @brief Gets the current camera with the highest priority.
 		 * @return A shared pointer to the camera.
@@ -84,6 +152,17 @@ namespace JamesEngine
 		*/
 		std::shared_ptr<Entity> GetEntityByTag(std::string _tag);
 
+		/**
+		 * @brief Gets all components of type T (including types derived from T) in the order they were added. The list is kept up to date by Entity::AddComponent and entity removal, so it is O(1) after the first call for each T.
+		 * @tparam T The type of components to get.
+		 * @return A reference to the contiguous list of components. Adding components can reallocate it, so don't hold it across AddComponent.
+		 */
+		template <typename T>
+		const std::vector<std::shared_ptr<T>>& GetComponents()
+		{
+			return GetComponentBucket<T>().GetComponents();
+		}
+
 		/**
 		 * @brief Finds all components of type T in the entities.
 		 * @tparam T The type of components to find.
@@ -92,20 +171,8 @@ namespace JamesEngine
 		template <typename T>
 		void FindComponents(std::vector<std::shared_ptr<T>>& _out)
 		{
-			for (size_t ei = 0; ei < mEntities.size(); ++ei)
-			{
-				std::shared_ptr<Entity> e = mEntities.at(ei);
-				for (size_t ci = 0; ci < e->mComponents.size(); ++ci)
-				{
-					std::shared_ptr<Component> c = e->mComponents.at(ci);
-					std::shared_ptr<T> t = std::dynamic_pointer_cast<T>(c);
-
-					if (t)
-					{
-						_out.push_back(t);
-					}
-				}
-			}
+			const std::vector<std::shared_ptr<T>>& components = GetComponents<T>();
+			_out.insert(_out.end(), components.begin(), components.end());
 		}
 
 		/**
@@ -116,22 +183,12 @@ namespace JamesEngine
 		template <typename T>
 		std::shared_ptr<T> FindComponent()
 		{
-			for (size_t ei = 0; ei < mEntities.size(); ++ei)
-			{
-				std::shared_ptr<Entity> e = mEntities.at(ei);
-				for (size_t ci = 0; ci < e->mComponents.size(); ++ci)
-				{
-					std::shared_ptr<Component> c = e->mComponents.at(ci);
-					std::shared_ptr<T> t = std::dynamic_pointer_cast<T>(c);
+			const std::vector<std::shared_ptr<T>>& components = GetComponents<T>();
 
-					if (t)
-					{
-						return t;
-					}
-				}
-			}
+			if (components.empty())
+				return nullptr;
 
-			return nullptr;
+			return components.front();
 		}
 
 		// Overwrite the file if it already exists
@@ -169,6 +226,7 @@ namespace JamesEngine
 
 	private:
 		friend class SceneRenderer;
+		friend class Entity;
 
 		std::shared_ptr<Window> mWindow;
 		std::shared_ptr<Audio> mAudio;
@@ -179,19 +237,114 @@ namespace JamesEngine
 		std::shared_ptr<RaycastSystem> mRaycastSystem;
 		std::shared_ptr<Resources> mResources;
 		std::shared_ptr<SceneRenderer> mSceneRenderer;
+		std::shared_ptr<JobSystem> mJobSystem;
 		std::vector<std::shared_ptr<Entity>> mEntities;
 		std::weak_ptr<Core> mSelf;
 
+		// Back the handles, mEntities is still what gets iterated as it keeps the order entities were added in
+		SlotMap<Entity> mEntitySlots;
+		SlotMap<Component> mComponentSlots;
+
+		// Indexed by GetComponentTypeId<T>(), buckets are only created once something asks for that type
+		std::vector<std::unique_ptr<ComponentBucketBase>> mComponentBuckets;
+
+		// Only locked while a fixed tick phase is running on the worker threads, as buckets can be created lazily
+		std::mutex mComponentBucketMutex;
+		bool mRunningParallelPhase = false;
+
+		template <typename T>
+		ComponentBucket<T>& GetComponentBucket()
+		{
+			std::unique_lock<std::mutex> lock(mComponentBucketMutex, std::defer_lock);
+			if (mRunningParallelPhase)
+				lock.lock();
+
+			ComponentTypeId id = GetComponentTypeId<T>();
+
+			if (id >= mComponentBuckets.size())
+				mComponentBuckets.resize(id + 1);
+
+			if (!mComponentBuckets[id])
+			{
+				// First time this type has been asked for, so fill it with what is already in the scene
+				std::unique_ptr<ComponentBucket<T>> bucket = std::make_unique<ComponentBucket<T>>();
+				for (size_t ei = 0; ei < mEntities.size(); ++ei)
+				{
+					std::shared_ptr<Entity> e = mEntities[ei];
+					for (size_t ci = 0; ci < e->mComponents.size(); ++ci)
+					{
+						bucket->Add(e->mComponents[ci]);
+					}
+				}
+
+				mComponentBuckets[id] = std::move(bucket);
+			}
+
+			return static_cast<ComponentBucket<T>&>(*mComponentBuckets[id]);
+		}
+
+		// Called by Entity when a component is added
+		void RegisterComponent(const std::shared_ptr<Component>& _component);
+
+		// A component that overrides a hook. The lists are sorted by Component::mHookOrder, so hooks run in the same order as iterating the entities would
+		struct HookEntry
+		{
+			Component* component = nullptr;
+			uint64_t order = 0;
+			bool parallelSafe = false; // Only used by the fixed tick phases
+		};
+
+		std::vector<HookEntry> mHookLists[(int)ComponentHook::Count];
+
+		// Components added while a hook list is being iterated wait here until it finishes, so the list doesn't move under the loop
+		std::vector<std::shared_ptr<Component>> mPendingHookComponents;
+		bool mIteratingHooks = false;
+
+		void AddToHookLists(const std::shared_ptr<Component>& _component);
+		void FlushPendingHookComponents();
+
+		// Entities that haven't had OnAlive called yet
+		std::vector<std::shared_ptr<Entity>> mNewEntities;
+
+		// Calls OnAlive on new entities. Done before every tick and fixed tick phase, so an entity added part way through a frame never
+		// gets a tick before its OnAlive
+		void AliveNewEntities();
+
+		// Calls OnAlive on new entities, then OnTick on every component that overrides it
+		void TickEntities();
+
 		// Used to upload uniforms that only need uploading once
 		void PreUploadGlobalStaticUniforms();
-		// Used to upload uniforms that need to be updated every frame, but not for every entity
-		void UploadGlobalUniforms();
 
 		void RenderScene();
 		void RenderGUI();
 
+		// Every frame is exactly one fixed step, so a run gives the same results however fast the machine is
+		void RunHeadless();
+
+		void RemoveDestroyedEntities();
+
+		void DrawLoadingScreen();
+		std::shared_ptr<Texture> mLoadingScreen;
+
+		float mAsyncUploadBudgetMs = 2.f;
+
+		// Runs the phase's hook list in order. Runs of parallel safe components between serial ones go across the job system as one batch
+		void RunFixedTickPhase(TickPhase _phase);
+		// Runs the batch in mParallelGroups, which ends at _end in the hook list, and waits for it
+		void RunParallelBatch(std::vector<HookEntry>& _hooks, size_t _end, TickPhase _phase);
+		static void CallFixedTick(Component& _component, TickPhase _phase);
+		// Index into the phase's hook list of the first component of each entity in the current parallel batch
+		std::vector<size_t> mParallelGroups;
+		// Transform::GetWorldDirtyCount() and mEntityIdCounter when the transforms were last brought up to date for a batch
+		uint64_t mTransformsUpdatedAt = ~0ull;
+		int mTransformsUpdatedEntities = -1;
+
 		bool mIsRunning = true;
 
+		bool mHeadless = false;
+		float mRealTimeMultiple = 0.f; // 0 = as fast as possible
+
 		float mLastFrameTime = 0.0f; // Not affected by time scale
 
 		float mDeltaTime = 0.0f;
@@ -11,68 +11,17 @@ namespace JamesEngine
 		return mCore.lock();
 	}
 
-	void Entity::OnTick()
+	void Entity::RegisterComponent(const std::shared_ptr<Component>& _component)
 	{
-		if (mJustCreated)
-		{
-			mJustCreated = false;
-			for (size_t ci = 0; ci < mComponents.size(); ++ci)
-			{
-				mComponents.at(ci)->Alive();
-			}
-		}
-
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->Tick();
-		}
-	}
-
-	void Entity::OnEarlyFixedTick()
-	{
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->EarlyFixedTick();
-		}
-	}
-
-	void Entity::OnFixedTick()
-	{
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->FixedTick();
-		}
-	}
-
-	void Entity::OnLateFixedTick()
-	{
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->LateFixedTick();
-		}
-	}
-
-	void Entity::OnRender()
-	{
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->Render();
-		}
-	}
-
-	void Entity::OnShadowRender(const glm::mat4& _lightSpaceMatrix)
-	{
-		for (size_t ci = 0; ci < mComponents.size(); ++ci)
-		{
-			mComponents.at(ci)->ShadowRender(_lightSpaceMatrix);
-		}
+		if (std::shared_ptr<Core> core = mCore.lock())
+			core->RegisterComponent(_component);
 	}
 
-	void Entity::OnGUI()
+	void Entity::OnAlive()
 	{
 		for (size_t ci = 0; ci < mComponents.size(); ++ci)
 		{
-			mComponents.at(ci)->GUI();
+			mComponents.at(ci)->Alive();
 		}
 	}
 
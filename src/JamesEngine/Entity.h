@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Component.h"
+
 #include <glm/glm.hpp>
 
 #include <iostream>
@@ -13,6 +15,9 @@ namespace JamesEngine
 
 	class Core;
 	class Component;
+	class Entity;
+
+	using EntityHandle = Handle<Entity>;
 
 	/**
 	 * @class Entity
@@ -32,6 +37,11 @@ namespace JamesEngine
 
 		int GetId() { return mId; }
 
+		/**
+		 * @brief Gets a handle to the entity, which can be held instead of a shared pointer and resolved with Core::GetEntity. Resolves to nullptr once the entity has been removed.
+		 */
+		EntityHandle GetHandle() const { return mHandle; }
+
 		/**
 		 * @brief Adds a component to the entity. Has ability to pass arguments to the component's constructor (not used).
 		 * @tparam T The type of the component.
@@ -45,20 +55,33 @@ namespace JamesEngine
 			std::shared_ptr<T> rtn = std::make_shared<T>(std::forward<Args>(args)...);
 
 			rtn->mEntity = mSelf;
+			rtn->mTypeId = GetComponentTypeId<T>();
+			rtn->mHooks = GetOverriddenHooks<T>();
 			rtn->OnInitialize();
 			mComponents.push_back(rtn);
 
+			RegisterComponent(rtn);
+
 			return rtn;
 		}
 
 		/**
-		 * @brief Gets a component of the specified type.
+		 * @brief Gets a component of the specified type. Exact type matches are found by type id, only base class lookups (e.g. Collider) fall back to a dynamic cast.
 		 * @tparam T The type of the component.
 		 * @return A shared pointer to the component, or nullptr if not found.
 		 */
 		template <typename T>
 		std::shared_ptr<T> GetComponent()
 		{
+			ComponentTypeId id = GetComponentTypeId<T>();
+			for (size_t i = 0; i < mComponents.size(); ++i)
+			{
+				if (mComponents[i]->GetTypeId() == id)
+				{
+					return std::static_pointer_cast<T>(mComponents[i]);
+				}
+			}
+
 			for (size_t i = 0; i < mComponents.size(); ++i)
 			{
 				std::shared_ptr<T> rtn = std::dynamic_pointer_cast<T>(mComponents[i]);
@@ -88,18 +111,14 @@ namespace JamesEngine
 		std::string mTag = "Default";
 
 		int mId = -1;
+		EntityHandle mHandle;
 
 		bool mAlive = true;
 
-		bool mJustCreated = true;
+		void RegisterComponent(const std::shared_ptr<Component>& _component);
 
-		void OnTick();
-		void OnEarlyFixedTick();
-		void OnFixedTick();
-		void OnLateFixedTick();
-		void OnRender();
-		void OnShadowRender(const glm::mat4& _lightSpaceMatrix);
-		void OnGUI();
+		// Called by Core before the first tick after the entity was added
+		void OnAlive();
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace JamesEngine
+{
+
+	namespace
+	{
+		// Which system the current thread is a worker of, and its queue index. Any other thread helps out from queue 0 while it waits
+		thread_local const JobSystem* tJobSystem = nullptr;
+		thread_local unsigned int tWorkerIndex = 0;
+	}
+
+	JobSystem::JobSystem(unsigned int _numThreads)
+	{
+		if (_numThreads == 0)
+			_numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned int i = 0; i < _numThreads; ++i)
+		{
+			mQueues.emplace_back(std::make_unique<WorkerQueue>());
+		}
+
+		// Queue 0 belongs to the creating thread, so only start the rest
+		for (unsigned int i = 1; i < _numThreads; ++i)
+		{
+			mThreads.emplace_back(&JobSystem::WorkerLoop, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mRunning = false;
+		}
+		mSleepCondition.notify_all();
+
+		for (std::thread& thread : mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	JobHandle JobSystem::Schedule(std::function<void()> _work, const std::vector<JobHandle>& _dependencies)
+	{
+		JobHandle job = std::make_shared<Job>();
+		job->work = std::move(_work);
+
+		// Holds the job back until all dependencies are hooked up, in case one finishes part way through
+		job->pendingDependencies = 1;
+
+		for (const JobHandle& dependency : _dependencies)
+		{
+			if (!dependency)
+				continue;
+
+			std::lock_guard<std::mutex> lock(dependency->continuationMutex);
+			if (!dependency->IsFinished())
+			{
+				job->pendingDependencies++;
+				dependency->continuations.push_back(job);
+			}
+			else if (dependency->exception)
+			{
+				// Dependencies hooked up already could be finishing and setting it too
+				std::lock_guard<std::mutex> jobLock(job->continuationMutex);
+				if (!job->exception)
+					job->exception = dependency->exception;
+			}
+		}
+
+		if (--job->pendingDependencies == 0)
+			Push(job);
+
+		return job;
+	}
+
+	void JobSystem::Wait(const JobHandle& _job)
+	{
+		unsigned int index = GetWorkerIndex();
+
+		while (!_job->IsFinished())
+		{
+			if (!RunOne(index))
+				std::this_thread::yield();
+		}
+
+		if (_job->exception)
+			std::rethrow_exception(_job->exception);
+	}
+
+	void JobSystem::ParallelFor(size_t _count, size_t _grainSize, const std::function<void(size_t, size_t)>& _func)
+	{
+		if (_count == 0)
+			return;
+
+		_grainSize = std::max<size_t>(1, _grainSize);
+
+		// Not worth the overhead, or no one to share with
+		if (_count <= _grainSize || mQueues.size() == 1)
+		{
+			_func(0, _count);
+			return;
+		}
+
+		std::vector<JobHandle> jobs;
+		jobs.reserve((_count + _grainSize - 1) / _grainSize);
+
+		// The first chunk is run on this thread, so the rest get a head start on the workers
+		for (size_t begin = _grainSize; begin < _count; begin += _grainSize)
+		{
+			size_t end = std::min(begin + _grainSize, _count);
+			jobs.push_back(Schedule([&_func, begin, end]() { _func(begin, end); }));
+		}
+
+		// Every chunk has to finish before this returns, even after one throws, as they all use _func
+		std::exception_ptr exception;
+		try
+		{
+			_func(0, _grainSize);
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		for (const JobHandle& job : jobs)
+		{
+			try
+			{
+				Wait(job);
+			}
+			catch (...)
+			{
+				if (!exception)
+					exception = std::current_exception();
+			}
+		}
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void JobSystem::WorkerLoop(unsigned int _index)
+	{
+		tJobSystem = this;
+		tWorkerIndex = _index;
+
+		while (mRunning)
+		{
+			if (RunOne(_index))
+				continue;
+
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			mSleepCondition.wait(lock, [this]() { return mQueuedJobs > 0 || !mRunning; });
+		}
+	}
+
+	void JobSystem::Push(const JobHandle& _job)
+	{
+		WorkerQueue& queue = *mQueues[GetPushIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(_job);
+		}
+
+		{
+			// Incremented under the sleep mutex so a worker can't miss it between checking and waiting
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mQueuedJobs++;
+		}
+		mSleepCondition.notify_one();
+	}
+
+	JobHandle JobSystem::Pop(unsigned int _index)
+	{
+		// Newest job from our own queue first, it is most likely to still be in cache
+		{
+			WorkerQueue& queue = *mQueues[_index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				JobHandle job = queue.jobs.back();
+				queue.jobs.pop_back();
+				mQueuedJobs--;
+				return job;
+			}
+		}
+
+		// Otherwise steal the oldest job from someone else
+		for (size_t i = 1; i < mQueues.size(); ++i)
+		{
+			WorkerQueue& queue = *mQueues[(_index + i) % mQueues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				JobHandle job = queue.jobs.front();
+				queue.jobs.pop_front();
+				mQueuedJobs--;
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool JobSystem::RunOne(unsigned int _index)
+	{
+		JobHandle job = Pop(_index);
+		if (!job)
+			return false;
+
+		Execute(job);
+		return true;
+	}
+
+	void JobSystem::Execute(const JobHandle& _job)
+	{
+		// Caught so the job still finishes, otherwise anything waiting on it would wait forever. Wait rethrows it
+		if (_job->work && !_job->exception)
+		{
+			try
+			{
+				_job->work();
+			}
+			catch (...)
+			{
+				_job->exception = std::current_exception();
+			}
+		}
+
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> lock(_job->continuationMutex);
+			_job->finished.store(true, std::memory_order_release);
+			continuations.swap(_job->continuations);
+		}
+
+		for (const JobHandle& continuation : continuations)
+		{
+			// Jobs that depend on this one are skipped and pass the exception on. Set under the continuation's lock as its other dependencies
+			// may be finishing too, and read only once the last of them has
+			if (_job->exception)
+			{
+				std::lock_guard<std::mutex> lock(continuation->continuationMutex);
+				if (!continuation->exception)
+					continuation->exception = _job->exception;
+			}
+
+			if (--continuation->pendingDependencies == 0)
+				Push(continuation);
+		}
+	}
+
+	unsigned int JobSystem::GetWorkerIndex() const
+	{
+		return tJobSystem == this ? tWorkerIndex : 0;
+	}
+
+	unsigned int JobSystem::GetPushIndex()
+	{
+		if (tJobSystem == this)
+			return tWorkerIndex;
+
+		// Everything from the creating thread or any other thread outside the pool would otherwise pile up on queue 0, where every worker
+		// then fights over its lock to steal
+		return mNextQueue.fetch_add(1, std::memory_order_relaxed) % (unsigned int)mQueues.size();
+	}
+
+}
\ No newline at end of file
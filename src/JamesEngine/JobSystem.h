@@ -0,0 +1,109 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace JamesEngine
+{
+
+	/**
+	 * @struct Job
+	 * @brief A unit of work for the job system. Only runs once all of its dependencies have finished.
+	 */
+	struct Job
+	{
+		std::function<void()> work;
+
+		bool IsFinished() const { return finished.load(std::memory_order_acquire); }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int> pendingDependencies{ 0 };
+		std::atomic<bool> finished{ false };
+
+		// What work threw, or what a dependency threw (then work is skipped). Rethrown by JobSystem::Wait
+		std::exception_ptr exception;
+
+		// Jobs waiting on this one, pushed to a queue when this finishes
+		std::mutex continuationMutex;
+		std::vector<std::shared_ptr<Job>> continuations;
+	};
+
+	using JobHandle = std::shared_ptr<Job>;
+
+	/**
+	 * @class JobSystem
+	 * @brief Work-stealing thread pool. Each worker has its own deque, takes its newest job first and steals the oldest job from other workers when it runs out.
+	 * The thread that created the job system is worker 0, and helps run jobs while it waits.
+	 */
+	class JobSystem
+	{
+	public:
+		/**
+		 * @brief Starts the worker threads.
+		 * @param _numThreads Total number of threads including the calling one. 0 uses the hardware thread count.
+		 */
+		JobSystem(unsigned int _numThreads = 0);
+		~JobSystem();
+
+		/**
+		 * @brief Schedules a job to run once all of its dependencies have finished.
+		 * @param _work The work to run.
+		 * @param _dependencies Jobs that must finish before this one starts.
+		 * @return A handle that can be waited on or used as a dependency.
+		 */
+		JobHandle Schedule(std::function<void()> _work, const std::vector<JobHandle>& _dependencies = {});
+
+		/**
+		 * @brief Blocks until the job has finished, running other jobs on this thread in the meantime. Rethrows anything the job (or one of its dependencies) threw.
+		 */
+		void Wait(const JobHandle& _job);
+
+		/**
+		 * @brief Splits [0, _count) into chunks of _grainSize and runs _func(begin, end) on each across all workers. Returns once every chunk is done, then rethrows the first exception any chunk threw.
+		 */
+		void ParallelFor(size_t _count, size_t _grainSize, const std::function<void(size_t, size_t)>& _func);
+
+		unsigned int GetNumThreads() const { return (unsigned int)mQueues.size(); }
+
+	private:
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<JobHandle> jobs;
+		};
+
+		void WorkerLoop(unsigned int _index);
+
+		void Push(const JobHandle& _job);
+		JobHandle Pop(unsigned int _index);
+		bool RunOne(unsigned int _index);
+		void Execute(const JobHandle& _job);
+
+		unsigned int GetWorkerIndex() const;
+		// The queue a job pushed from this thread goes on
+		unsigned int GetPushIndex();
+
+		std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+		std::vector<std::thread> mThreads;
+
+		std::atomic<bool> mRunning{ true };
+
+		// Sleeping workers wait on this when there is nothing to steal
+		std::mutex mSleepMutex;
+		std::condition_variable mSleepCondition;
+		std::atomic<int> mQueuedJobs{ 0 };
+
+		// Threads outside the pool take turns pushing to each queue
+		std::atomic<unsigned int> mNextQueue{ 0 };
+	};
+
+}
\ No newline at end of file
@@ -13,7 +13,47 @@ namespace JamesEngine
 	class Model : public Resource
 	{
 	public:
-		void OnLoad() { mModel = std::make_shared<Renderer::Model>(GetPath()); }
+		void OnLoad()
+		{
+			mModel = std::make_shared<Renderer::Model>(GetPath(), false);
+			mModel->set_vertex_format(mVertexFormat);
+			mModel->upload();
+			mGeometryUploaded = true;
+		}
+		// Colliders still need the geometry, just not the GPU buffers
+		void OnLoadHeadless() { mModel = std::make_shared<Renderer::Model>(GetPath(), false); }
+
+		void OnDecode() { mModel = std::make_shared<Renderer::Model>(GetPath(), false); }
+		// Geometry on the first call, then one embedded texture per call so a model with lots of textures is spread over frames
+		bool OnUpload()
+		{
+			const auto& embedded = mModel->GetEmbeddedTextures();
+
+			if (!mGeometryUploaded)
+			{
+				mModel->set_vertex_format(mVertexFormat);
+				mModel->upload();
+				mGeometryUploaded = true;
+			}
+			else if (mUploadedTextures < embedded.size())
+			{
+				embedded[mUploadedTextures].id();
+				mUploadedTextures++;
+			}
+
+			return mGeometryUploaded && mUploadedTextures >= embedded.size();
+		}
+
+		/**
+		 * @brief Sets how the model's vertices are stored on the GPU. Compact halves the vertex size, at the cost of positions being quantized to about 1/65000th of each material group's size.
+		 * Can be called before an async load has finished, otherwise the geometry is uploaded again.
+		 */
+		void SetVertexFormat(Renderer::Model::VertexFormat _format)
+		{
+			mVertexFormat = _format;
+			if (mGeometryUploaded)
+				mModel->set_vertex_format(_format);
+		}
 
 	private:
 		friend class SceneRenderer;
@@ -23,6 +63,12 @@ namespace JamesEngine
 		friend class BoxCollider;
 
 		std::shared_ptr<Renderer::Model> mModel;
+
+		Renderer::Model::VertexFormat mVertexFormat = Renderer::Model::VertexFormat::Float;
+
+		// Async upload progress
+		bool mGeometryUploaded = false;
+		size_t mUploadedTextures = 0;
 	};
 
 }
\ No newline at end of file
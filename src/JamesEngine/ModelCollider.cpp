@@ -67,9 +67,19 @@ namespace JamesEngine
             return;
         }
 
+        // Still loading asynchronously, OnTick builds the BVH once it has loaded
+        if (!mModel->IsLoaded())
+            return;
+
 		// Build the BVH from the model's triangles.
         mBVHRoot = BuildBVH(mModel->mModel->GetFaces(), mBVHLeafThreshold);
-        const std::vector<Renderer::Model::Face>& faces = mModel->mModel->GetFaces();
+    }
+
+    void ModelCollider::OnTick()
+    {
+        // The first tick after an async model finishes loading, which is before that frame's fixed ticks
+        if (!mBVHRoot && mModel && mModel->IsLoaded())
+            mBVHRoot = BuildBVH(mModel->mModel->GetFaces(), mBVHLeafThreshold);
     }
 
     bool ModelCollider::IsColliding(std::shared_ptr<Collider> _other, glm::vec3& _collisionPoint, glm::vec3& _normal, float& _penetrationDepth)
@@ -80,7 +90,7 @@ namespace JamesEngine
             return false;
         }
 
-        if (mModel == nullptr)
+        if (mModel == nullptr || !mModel->IsLoaded())
         {
             return false;
         }
@@ -236,6 +246,9 @@ namespace JamesEngine
         std::shared_ptr<ModelCollider> otherModel = std::dynamic_pointer_cast<ModelCollider>(_other);
         if (otherModel)
         {
+            if (otherModel->GetModel() == nullptr || !otherModel->GetModel()->IsLoaded())
+                return false;
+
             // Build world transform for "this" model.
             glm::vec3 modelPos = GetPosition() + GetPositionOffset();
             glm::vec3 modelScale = GetScale();
@@ -608,15 +621,12 @@ namespace JamesEngine
     std::vector<Renderer::Model::Face> ModelCollider::GetTriangles(const glm::vec3& boxPos, const glm::vec3& boxRotation, const glm::vec3& boxSize)
     {
         std::vector<Renderer::Model::Face> result;
-        if (mModel == nullptr)
+        if (mModel == nullptr || !mModel->IsLoaded())
             return result;
 
-        // (Re)build the BVH if it hasn?t been built yet or if the leaf threshold has changed.
+        // Built on the main thread by OnAlive or OnTick, this can be called from parallel fixed ticks so never builds it here
         if (!mBVHRoot)
-        {
-            const std::vector<Renderer::Model::Face>& faces = mModel->mModel->GetFaces();
-            mBVHRoot = BuildBVH(faces, mBVHLeafThreshold);
-        }
+            return result;
 
         // Compute the world transformation for this model.
         glm::vec3 modelPos = GetPosition() + GetPositionOffset();
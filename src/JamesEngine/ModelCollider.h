@@ -19,13 +19,15 @@ namespace JamesEngine
         void OnGUI();
 #endif
 		void OnAlive();
+        // Builds the BVH for a model that was still loading in OnAlive. Only ever on the main thread, raycasts from parallel fixed ticks read it
+        void OnTick();
 
         bool IsColliding(std::shared_ptr<Collider> _other, glm::vec3& _collisionPoint, glm::vec3& _normal, float& _penetrationDepth);
         bool RayCollision(const Ray& _ray, RaycastHit& _outHit);
 
         glm::mat3 UpdateInertiaTensor(float _mass);
 
-        void SetModel(std::shared_ptr<Model> _model) { mModel = _model; }
+        void SetModel(std::shared_ptr<Model> _model) { mModel = _model; mBVHRoot.reset(); }
         std::shared_ptr<Model> GetModel() { return mModel; }
 
         // GetTriangles returns the candidate triangles (in model space)
@@ -39,9 +39,12 @@ namespace JamesEngine
 			}
 		}
 
-		if (!mPreBakeShadows || !mModel)
-			return;
+		// The bake needs the model's size and geometry, so an async model is baked by OnRender once it has loaded
+		mPreBakePending = mPreBakeShadows && mModel && !GetCore()->IsHeadless();
+	}
 
+	void ModelRenderer::PreBakeShadowMaps()
+	{
 		if (!mSplitPrebakedShadowMap)
 		{
 			// Prebake a shadow map for static models
@@ -126,7 +129,10 @@ namespace JamesEngine
 			std::cout << "Pre-baked shadow map for " << GetEntity()->GetTag() << " with a texture size of " << maxTextureSize << std::endl;
 
 			// Not sustainable, only works with one model with baked shadow map
-			GetEntity()->GetCore()->GetResources()->Load<Shader>("shaders/ObjShader")->mShader->uniform("u_NumPreBaked", 1);
+			auto objShader = GetEntity()->GetCore()->GetResources()->Load<Shader>("shaders/ObjShader");
+			objShader->mShader->use();
+			objShader->mShader->uniform("u_NumPreBaked", 1);
+			objShader->mShader->unuse();
 		}
 		else
 		{
@@ -234,7 +240,10 @@ namespace JamesEngine
 			}
 
 			// Not sustainable, only works with one model with baked shadow map
-			GetEntity()->GetCore()->GetResources()->Load<Shader>("shaders/ObjShader")->mShader->uniform("u_NumPreBaked", 4);
+			auto objShader = GetEntity()->GetCore()->GetResources()->Load<Shader>("shaders/ObjShader");
+			objShader->mShader->use();
+			objShader->mShader->uniform("u_NumPreBaked", 4);
+			objShader->mShader->unuse();
 
 			// Restore GL state
 			glEnable(GL_CULL_FACE);
@@ -246,9 +255,56 @@ namespace JamesEngine
 
 	void ModelRenderer::OnRender()
 	{
-		if (!mModel)
+		std::shared_ptr<SceneRenderer> sceneRenderer = GetCore()->GetSceneRenderer();
+
+		// A model swapped at runtime is registered again from scratch
+		if (mProxyModelChanged && !mProxy.IsNull())
+		{
+			sceneRenderer->RemoveProxy(mProxy);
+			mProxy = {};
+		}
+		mProxyModelChanged = false;
+
+		// Still loading asynchronously
+		if (!mModel || !mModel->IsLoaded() || (mShadowModel && !mShadowModel->IsLoaded()))
 			return;
 
+		if (mPreBakePending)
+		{
+			mPreBakePending = false;
+			PreBakeShadowMaps();
+		}
+
+		const uint32_t transformVersion = GetEntity()->GetComponent<Transform>()->GetWorldVersion();
+
+		if (mProxy.IsNull())
+		{
+			// Register with the scene renderer, it keeps drawing the model until OnDestroy
+			if (!mShadowModel)
+				mProxy = sceneRenderer->AddProxy(GetEntity()->GetId(), mModel, GetRenderTransform(), {}, mOccluderMode); // Normal shadow
+			else
+				mProxy = sceneRenderer->AddProxy(GetEntity()->GetId(), mModel, GetRenderTransform(), { ShadowMode::Proxy, mShadowModel }, mOccluderMode); // Proxy shadow
+		}
+		else if (mProxyTransformChanged || transformVersion != mProxyTransformVersion)
+		{
+			sceneRenderer->UpdateProxy(mProxy, GetRenderTransform());
+		}
+
+		mProxyTransformVersion = transformVersion;
+		mProxyTransformChanged = false;
+	}
+
+	void ModelRenderer::OnDestroy()
+	{
+		std::shared_ptr<SceneRenderer> sceneRenderer = GetCore()->GetSceneRenderer();
+		if (sceneRenderer && !mProxy.IsNull())
+			sceneRenderer->RemoveProxy(mProxy);
+
+		mProxy = {};
+	}
+
+	glm::mat4 ModelRenderer::GetRenderTransform()
+	{
 		glm::mat4 entityModel = GetEntity()->GetComponent<Transform>()->GetModel();
 
 		glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(mRotationOffset.x), glm::vec3(1, 0, 0)) *
@@ -256,13 +312,7 @@ namespace JamesEngine
 			glm::rotate(glm::mat4(1.0f), glm::radians(mRotationOffset.z), glm::vec3(0, 0, 1));
 		glm::mat4 offsetMatrix = glm::translate(glm::mat4(1.0f), mPositionOffset) * rotationMatrix;
 
-		glm::mat4 model = entityModel * offsetMatrix;
-
-		// Submit model to scene renderer for rendering
-		if (!mShadowModel)
-			GetCore()->GetSceneRenderer()->AddModel(GetEntity()->GetId(), mModel, model); // Upload model with normal shadow
-		else
-			GetCore()->GetSceneRenderer()->AddModel(GetEntity()->GetId(), mModel, model, { ShadowMode::Proxy, mShadowModel }); // Upload model with proxy shadow
+		return entityModel * offsetMatrix;
 	}
 
 	void ModelRenderer::OnShadowRender(const glm::mat4& _lightSpaceMatrix)
@@ -273,16 +323,7 @@ namespace JamesEngine
 
 		Renderer::Model* modelToDraw = mModel ? mModel->mModel.get() : (mShadowModel ? mShadowModel->mModel.get() : nullptr);
 
-		glm::mat4 entityModel = GetEntity()->GetComponent<Transform>()->GetModel();
-
-		glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(mRotationOffset.x), glm::vec3(1, 0, 0)) *
-			glm::rotate(glm::mat4(1.0f), glm::radians(mRotationOffset.y), glm::vec3(0, 1, 0)) *
-			glm::rotate(glm::mat4(1.0f), glm::radians(mRotationOffset.z), glm::vec3(0, 0, 1));
-		glm::mat4 offsetMatrix = glm::translate(glm::mat4(1.0f), mPositionOffset) * rotationMatrix;
-
-		glm::mat4 model = entityModel * offsetMatrix;
-
-		mDepthShader->mShader->uniform("u_Model", model);
+		mDepthShader->mShader->uniform("u_Model", GetRenderTransform());
 
 		mDepthShader->mShader->uniform("u_LightSpaceMatrix", _lightSpaceMatrix);
 		mDepthShader->mShader->uniform("u_AlphaCutoff", mAlphaCutoff);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Component.h"
+#include "SlotMap.h"
+#include "SceneRenderer.h"
 
 #include "Renderer/Texture.h"
 
@@ -11,6 +13,7 @@ namespace JamesEngine
 	class Model;
 	class Texture;
 	class Shader;
+	struct RenderProxy;
 
 	class ModelRenderer : public Component
 	{
@@ -19,12 +22,13 @@ namespace JamesEngine
 		void OnAlive();
 		void OnRender();
 		void OnShadowRender(const glm::mat4& _lightSpaceMatrix);
+		void OnDestroy();
 
-		void SetModel(std::shared_ptr<Model> _model) { mModel = _model; }
+		void SetModel(std::shared_ptr<Model> _model) { mModel = _model; mProxyModelChanged = true; }
 		void AddTexture(std::shared_ptr<Texture> _texture) { mTextures.push_back(_texture); }
 		void SetShader(std::shared_ptr<Shader> _shader) { mShader = _shader; }
 
-		void SetShadowModel(std::shared_ptr<Model> _model) { mShadowModel = _model; }
+		void SetShadowModel(std::shared_ptr<Model> _model) { mShadowModel = _model; mProxyModelChanged = true; }
 
 		void SetSpecularStrength(float _strength) { mSpecularStrength = _strength; }
 
@@ -34,10 +38,10 @@ namespace JamesEngine
 		void SetAOStrength(float _aoStrength) { mAOStrength = glm::clamp(_aoStrength, 0.f, 1.f); }
 		void SetEmmisive(glm::vec3 _emmisive) { mEmmisive = _emmisive; }
 
-		void SetPositionOffset(glm::vec3 _offset) { mPositionOffset = _offset; }
+		void SetPositionOffset(glm::vec3 _offset) { mPositionOffset = _offset; mProxyTransformChanged = true; }
 		glm::vec3 GetPositionOffset() { return mPositionOffset; }
 
-		void SetRotationOffset(glm::vec3 _offset) { mRotationOffset = _offset; }
+		void SetRotationOffset(glm::vec3 _offset) { mRotationOffset = _offset; mProxyTransformChanged = true; }
 		glm::vec3 GetRotationOffset() { return mRotationOffset; }
 
         void SetAlphaCutoff(float _cutoff) { mAlphaCutoff = glm::clamp(_cutoff, 0.f, 1.f); }
@@ -46,7 +50,16 @@ namespace JamesEngine
 		void SetPreBakeShadows(bool _preBake) { mPreBakeShadows = _preBake; }
 		bool GetPreBakeShadows() { return mPreBakeShadows; }
 
+		// Marks the model as something big that hides a lot behind it, like terrain or a building, or stops it ever being used as an occluder
+		void SetOccluderMode(OccluderMode _mode) { mOccluderMode = _mode; mProxyModelChanged = true; }
+		OccluderMode GetOccluderMode() { return mOccluderMode; }
+
 	private:
+		// The entity's transform with the position and rotation offsets applied
+		glm::mat4 GetRenderTransform();
+		// Renders the static shadow maps once, from OnRender after the model has loaded
+		void PreBakeShadowMaps();
+
 		std::shared_ptr<Model> mModel = nullptr;
 		std::shared_ptr<Shader> mShader = nullptr;
 
@@ -68,9 +81,18 @@ namespace JamesEngine
 
 		std::shared_ptr<Shader> mDepthShader;
 
+		// Registered with the SceneRenderer once the models have loaded, then only updated when something moves it
+		Handle<RenderProxy> mProxy;
+		uint32_t mProxyTransformVersion = 0;
+		bool mProxyModelChanged = false;
+		bool mProxyTransformChanged = false;
+
 		float mAlphaCutoff = 0.5f;
 
 		bool mPreBakeShadows = false;
+		bool mPreBakePending = false;
+
+		OccluderMode mOccluderMode = OccluderMode::Auto;
 		glm::vec3 mCustomCenter{ 0, -65, 0 }; // Used for pre-baked shadows, if the model is not centered at the origin
 		glm::ivec2 mCustomShadowMapSize{ 2000, 1500 }; // Custom shadow map size for pre-baked shadows
 		bool mSplitPrebakedShadowMap = true;
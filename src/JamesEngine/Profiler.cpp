@@ -0,0 +1,228 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+namespace JamesEngine
+{
+
+	std::atomic<bool> Profiler::sEnabled{ true };
+	std::atomic<uint64_t> Profiler::sFrameIndex{ 0 };
+	std::mutex Profiler::sBuffersMutex;
+	std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::sBuffers;
+
+	namespace
+	{
+		thread_local void* tThreadBuffer = nullptr;
+
+		// Start of the frame currently being recorded, 0 before the first frame
+		uint64_t sFrameStartNs = 0;
+
+		const std::chrono::steady_clock::time_point sStartTime = std::chrono::steady_clock::now();
+	}
+
+	uint64_t Profiler::NowNs()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sStartTime).count();
+	}
+
+	void Profiler::BeginFrame()
+	{
+		uint64_t now = NowNs();
+
+		if (sFrameStartNs != 0 && IsEnabled())
+			Record(GetThreadBuffer(), "Frame", sFrameStartNs, now, 0);
+
+		sFrameStartNs = now;
+		sFrameIndex.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+	{
+		if (!tThreadBuffer)
+		{
+			std::lock_guard<std::mutex> lock(sBuffersMutex);
+
+			std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+			buffer->threadIndex = (uint32_t)sBuffers.size();
+			tThreadBuffer = buffer.get();
+			sBuffers.push_back(std::move(buffer));
+		}
+
+		return *static_cast<ThreadBuffer*>(tThreadBuffer);
+	}
+
+	void Profiler::Record(ThreadBuffer& _buffer, const char* _name, uint64_t _startNs, uint64_t _endNs, uint32_t _depth)
+	{
+		uint64_t index = _buffer.writeIndex.load(std::memory_order_relaxed);
+
+		Event& event = _buffer.events[index % kEventsPerThread];
+		event.name = _name;
+		event.startNs = _startNs;
+		event.endNs = _endNs;
+		event.depth = _depth;
+
+		// Publishes the event to readers
+		_buffer.writeIndex.store(index + 1, std::memory_order_release);
+	}
+
+	void Profiler::CopyEvents(ThreadBuffer& _buffer, std::vector<Event>& _out)
+	{
+		uint64_t end = _buffer.writeIndex.load(std::memory_order_acquire);
+		uint64_t begin = std::max(_buffer.readStart.load(std::memory_order_relaxed), end > kEventsPerThread ? end - kEventsPerThread : 0);
+
+		size_t firstCopied = _out.size();
+		for (uint64_t i = begin; i < end; ++i)
+		{
+			_out.push_back(_buffer.events[i % kEventsPerThread]);
+		}
+
+		// If the thread kept writing while we copied, the oldest events we copied may have been overwritten part way through
+		uint64_t endAfter = _buffer.writeIndex.load(std::memory_order_acquire);
+		uint64_t firstSafe = endAfter > kEventsPerThread ? endAfter - kEventsPerThread : 0;
+		if (firstSafe > begin)
+		{
+			size_t overwritten = (size_t)std::min(firstSafe - begin, end - begin);
+			_out.erase(_out.begin() + firstCopied, _out.begin() + firstCopied + overwritten);
+		}
+	}
+
+	std::vector<ProfileZoneStats> Profiler::GetZoneStats()
+	{
+		std::vector<Event> events;
+		{
+			std::lock_guard<std::mutex> lock(sBuffersMutex);
+			for (size_t i = 0; i < sBuffers.size(); ++i)
+			{
+				CopyEvents(*sBuffers[i], events);
+			}
+		}
+
+		// By name rather than pointer, the same literal can have a different address in each translation unit
+		std::map<std::string, std::vector<double>> durations;
+		for (const Event& event : events)
+		{
+			durations[event.name].push_back((event.endNs - event.startNs) / 1e6);
+		}
+
+		std::vector<ProfileZoneStats> rtn;
+		rtn.reserve(durations.size());
+
+		for (auto& [name, times] : durations)
+		{
+			std::sort(times.begin(), times.end());
+
+			ProfileZoneStats stats;
+			stats.name = name;
+			stats.count = times.size();
+			stats.minMs = times.front();
+			stats.maxMs = times.back();
+
+			double total = 0.0;
+			for (double t : times)
+				total += t;
+			stats.avgMs = total / times.size();
+
+			size_t p99Index = std::min(times.size() - 1, (size_t)(times.size() * 0.99));
+			stats.p99Ms = times[p99Index];
+
+			rtn.push_back(stats);
+		}
+
+		std::sort(rtn.begin(), rtn.end(), [](const ProfileZoneStats& _a, const ProfileZoneStats& _b) { return _a.avgMs > _b.avgMs; });
+
+		return rtn;
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& _filePath)
+	{
+		std::ofstream out(_filePath, std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "Failed to open profiler trace for writing: " << _filePath << std::endl;
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(sBuffersMutex);
+
+		out << "{\"traceEvents\":[\n";
+
+		bool first = true;
+		std::vector<Event> events;
+		for (size_t bi = 0; bi < sBuffers.size(); ++bi)
+		{
+			events.clear();
+			CopyEvents(*sBuffers[bi], events);
+
+			uint32_t tid = sBuffers[bi]->threadIndex;
+
+			// Names the track, thread 0 is whichever thread recorded first (normally the main thread)
+			if (!first)
+				out << ",\n";
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"args\":{\"name\":\"" << (tid == 0 ? "Main" : "Worker " + std::to_string(tid)) << "\"}}";
+			first = false;
+
+			for (const Event& event : events)
+			{
+				out << ",\n{\"name\":\"";
+				for (const char* c = event.name; *c; ++c)
+				{
+					if (*c == '"' || *c == '\\')
+						out << '\\';
+					out << *c;
+				}
+
+				// Chrome trace times are in microseconds
+				out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+					<< ",\"ts\":" << event.startNs / 1000 << "." << (event.startNs % 1000) / 100
+					<< ",\"dur\":" << (event.endNs - event.startNs) / 1000 << "." << ((event.endNs - event.startNs) % 1000) / 100
+					<< "}";
+			}
+		}
+
+		out << "\n]}\n";
+
+		if (!out.good())
+		{
+			std::cout << "Failed to write profiler trace: " << _filePath << std::endl;
+			return false;
+		}
+
+		std::cout << "Wrote profiler trace to " << _filePath << std::endl;
+		return true;
+	}
+
+	void Profiler::Clear()
+	{
+		std::lock_guard<std::mutex> lock(sBuffersMutex);
+		for (size_t i = 0; i < sBuffers.size(); ++i)
+		{
+			sBuffers[i]->readStart.store(sBuffers[i]->writeIndex.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+	}
+
+	ProfileZone::ProfileZone(const char* _name)
+	{
+		if (!Profiler::IsEnabled())
+			return;
+
+		mName = _name;
+		mBuffer = &Profiler::GetThreadBuffer();
+		mBuffer->depth++;
+		mStartNs = Profiler::NowNs();
+	}
+
+	ProfileZone::~ProfileZone()
+	{
+		if (!mBuffer)
+			return;
+
+		uint64_t endNs = Profiler::NowNs();
+		mBuffer->depth--;
+		Profiler::Record(*mBuffer, mName, mStartNs, endNs, mBuffer->depth);
+	}
+
+}
\ No newline at end of file
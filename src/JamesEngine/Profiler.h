@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records a zone from here to the end of the scope. _name has to outlive the profiler, so use a string literal
+#define JAMES_PROFILE_CONCAT_INNER(_a, _b) _a##_b
+#define JAMES_PROFILE_CONCAT(_a, _b) JAMES_PROFILE_CONCAT_INNER(_a, _b)
+#define JAMES_PROFILE_ZONE(_name) JamesEngine::ProfileZone JAMES_PROFILE_CONCAT(profileZone, __LINE__)(_name)
+
+namespace JamesEngine
+{
+
+	/**
+	 * @struct ProfileZoneStats
+	 * @brief Timings of one zone over everything still in the ring buffers, in milliseconds.
+	 */
+	struct ProfileZoneStats
+	{
+		std::string name;
+		size_t count = 0;
+		double minMs = 0.0;
+		double avgMs = 0.0;
+		double p99Ms = 0.0;
+		double maxMs = 0.0;
+	};
+
+	/**
+	 * @class Profiler
+	 * @brief Records nested timing zones from any thread into per-thread ring buffers, with no locking once a thread has recorded its first zone.
+	 * Keeps the last few thousand zones per thread, which can be turned into stats or written out as a Chrome trace (open in chrome://tracing or ui.perfetto.dev).
+	 */
+	class Profiler
+	{
+	public:
+		// Zones kept per thread before the oldest are overwritten
+		static constexpr size_t kEventsPerThread = 1 << 14;
+
+		static void SetEnabled(bool _enabled) { sEnabled.store(_enabled, std::memory_order_relaxed); }
+		static bool IsEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+		/**
+		 * @brief Marks the start of a new frame, called by Core. Records the previous frame as a "Frame" zone, so it gets stats and shows up in the trace around everything else.
+		 */
+		static void BeginFrame();
+		static uint64_t GetFrameIndex() { return sFrameIndex.load(std::memory_order_relaxed); }
+
+		/**
+		 * @brief Gets min/avg/p99/max for every zone name still in the ring buffers, slowest average first.
+		 * Best called between frames, zones being written at the same time may be missed.
+		 */
+		static std::vector<ProfileZoneStats> GetZoneStats();
+
+		/**
+		 * @brief Writes everything still in the ring buffers as Chrome trace event JSON.
+		 * @param _filePath Where to write the trace, relative to the working directory.
+		 * @return False if the file couldn't be written.
+		 */
+		static bool WriteChromeTrace(const std::string& _filePath);
+
+		/**
+		 * @brief Throws away everything recorded so far.
+		 */
+		static void Clear();
+
+		// Time since the profiler started, used for the zone timestamps
+		static uint64_t NowNs();
+
+	private:
+		friend class ProfileZone;
+
+		struct Event
+		{
+			const char* name = nullptr;
+			uint64_t startNs = 0;
+			uint64_t endNs = 0;
+			uint32_t depth = 0;
+		};
+
+		// Only written by its own thread. Readers copy events out, then throw away any that may have been overwritten while copying
+		struct ThreadBuffer
+		{
+			std::array<Event, kEventsPerThread> events;
+			std::atomic<uint64_t> writeIndex{ 0 };
+			// Cleared events are those before this index
+			std::atomic<uint64_t> readStart{ 0 };
+			uint32_t threadIndex = 0;
+			uint32_t depth = 0;
+		};
+
+		static ThreadBuffer& GetThreadBuffer();
+		static void Record(ThreadBuffer& _buffer, const char* _name, uint64_t _startNs, uint64_t _endNs, uint32_t _depth);
+
+		// Copies out the events that are still valid in a buffer
+		static void CopyEvents(ThreadBuffer& _buffer, std::vector<Event>& _out);
+
+		static std::atomic<bool> sEnabled;
+		static std::atomic<uint64_t> sFrameIndex;
+
+		// Only locked when a thread records its first zone, and when reading
+		static std::mutex sBuffersMutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> sBuffers;
+	};
+
+	/**
+	 * @class ProfileZone
+	 * @brief Times its own lifetime as a zone. Use JAMES_PROFILE_ZONE("Name") rather than making one directly.
+	 */
+	class ProfileZone
+	{
+	public:
+		ProfileZone(const char* _name);
+		~ProfileZone();
+
+	private:
+		const char* mName = nullptr;
+		uint64_t mStartNs = 0;
+		Profiler::ThreadBuffer* mBuffer = nullptr;
+	};
+
+}
\ No newline at end of file
@@ -40,7 +40,7 @@ namespace JamesEngine
 		float mMinPenetrationPercentage = 0.2f;
 
 #ifdef JAMES_DEBUG
-		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/cylinder.obj");
+		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/cylinder.obj", false);
 #endif
 	};
 
@@ -21,14 +21,13 @@ namespace JamesEngine
 		}
 
 		// Get all colliders in the scene
-		if (mCollidersInScene.empty())
-			mCore.lock()->FindComponents(mCollidersInScene);
+		const std::vector<std::shared_ptr<Collider>>& colliders = mCore.lock()->GetComponents<Collider>();
 
 		bool hitSomething = false;
 		float closestDist = _ray.length;
 		RaycastHit tempHit;
 
-		for (auto& collider : mCollidersInScene)
+		for (auto& collider : colliders)
 		{
 			if (collider->RayCollision(_ray, tempHit))
 			{
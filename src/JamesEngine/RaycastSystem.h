@@ -37,15 +37,6 @@ namespace JamesEngine
 		bool Raycast(const Ray& _ray, RaycastHit& _outHit);
 
 	private:
-		friend class Core;
-
-		void ClearCache()
-		{
-			mCollidersInScene.clear();
-		}
-
-		std::vector<std::shared_ptr<Collider>> mCollidersInScene;
-
 		std::weak_ptr<Core> mCore;
 	};
 
@@ -5,17 +5,34 @@
 namespace JamesEngine
 {
 
+	class Resources;
+
 	class Resource
 	{
 	public:
 		virtual void OnLoad() = 0;
+		// Called instead of OnLoad by a headless core. Anything that needs GL or audio should stay stubbed, so by default nothing is loaded
+		virtual void OnLoadHeadless() {}
+
+		// Async loading is split in two. OnDecode runs on a loader thread and does the file reading and decoding, so it can't touch GL or audio.
+		// OnUpload then runs on the main thread and creates the GL or audio objects, and is called again each time it returns false so big uploads can be spread over frames.
+		// By default nothing is decoded off the main thread and OnUpload does the whole load
+		virtual void OnDecode() {}
+		virtual bool OnUpload() { OnLoad(); return true; }
 
 		void SetPath(std::string _path) { mPath = _path; }
-		std::string GetPath() const { return mPath; }
+		const std::string& GetPath() const { return mPath; }
+
+		// False while an async load is still in progress
+		bool IsLoaded() const { return mLoaded; }
 
 	private:
+		friend class Resources;
+
 		std::string mPath;
 
+		bool mLoaded = false;
+
 		void Load();
 	};
 
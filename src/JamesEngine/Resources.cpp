@@ -0,0 +1,150 @@
+#include "Resources.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace JamesEngine
+{
+
+	namespace
+	{
+		const std::string_view kAssetsPrefix = "../assets/";
+	}
+
+	Resources::~Resources()
+	{
+		// Stops the loader threads before anything they might be decoding is freed
+		mLoaderJobs.reset();
+	}
+
+	void Resources::ProcessUploads(float _budgetMs)
+	{
+		if (mPendingLoads.empty())
+			return;
+
+		JAMES_PROFILE_ZONE("Resources::ProcessUploads");
+
+		const auto start = std::chrono::steady_clock::now();
+		auto overBudget = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= _budgetMs; };
+
+		size_t i = 0;
+		while (i < mPendingLoads.size())
+		{
+			// Copied, OnUpload could add more pending loads and move the vector
+			PendingLoad load = mPendingLoads[i];
+
+			if (!load.decodeJob->IsFinished())
+			{
+				++i;
+				continue;
+			}
+
+			if (*load.error)
+			{
+				mPendingLoads.erase(mPendingLoads.begin() + i);
+				std::rethrow_exception(*load.error);
+			}
+
+			bool finished = false;
+			do
+			{
+				finished = load.resource->OnUpload();
+			} while (!finished && !overBudget());
+
+			if (finished)
+			{
+				MarkLoaded(*load.resource);
+				mPendingLoads.erase(mPendingLoads.begin() + i);
+			}
+
+			if (overBudget())
+				return;
+		}
+	}
+
+	void Resources::StartDecode(std::shared_ptr<Resource> _resource)
+	{
+		if (!mLoaderJobs)
+		{
+			// Thread 0 is this thread, which never waits on loads unless something needs one right away
+			mLoaderJobs = std::make_unique<JobSystem>(1 + std::max(1u, std::thread::hardware_concurrency() / 2));
+		}
+
+		PendingLoad load;
+		load.resource = _resource;
+		load.error = std::make_shared<std::exception_ptr>();
+
+		std::shared_ptr<std::exception_ptr> error = load.error;
+		load.decodeJob = mLoaderJobs->Schedule([_resource, error]()
+			{
+				JAMES_PROFILE_ZONE("Resources::Decode");
+
+				try
+				{
+					_resource->OnDecode();
+				}
+				catch (...)
+				{
+					*error = std::current_exception();
+				}
+			});
+
+		mPendingLoads.push_back(load);
+	}
+
+	void Resources::FinishLoad(const std::shared_ptr<Resource>& _resource)
+	{
+		auto iterator = std::find_if(mPendingLoads.begin(), mPendingLoads.end(), [&](const PendingLoad& _load) { return _load.resource == _resource; });
+		if (iterator == mPendingLoads.end())
+			return;
+
+		PendingLoad load = *iterator;
+		mPendingLoads.erase(iterator);
+
+		mLoaderJobs->Wait(load.decodeJob);
+
+		if (*load.error)
+			std::rethrow_exception(*load.error);
+
+		while (!load.resource->OnUpload())
+		{
+		}
+
+		MarkLoaded(*load.resource);
+	}
+
+	bool Resources::NeedsNormalizing(std::string_view _path)
+	{
+		return _path.find('\\') != std::string_view::npos
+			|| _path.substr(0, 2) == "./"
+			|| _path.substr(0, kAssetsPrefix.size()) == kAssetsPrefix;
+	}
+
+	std::string Resources::Normalize(std::string_view _path)
+	{
+		std::string rtn(_path);
+
+		for (char& c : rtn)
+		{
+			if (c == '\\')
+				c = '/';
+		}
+
+		if (rtn.compare(0, kAssetsPrefix.size(), kAssetsPrefix) == 0)
+			rtn.erase(0, kAssetsPrefix.size());
+
+		while (rtn.compare(0, 2, "./") == 0)
+			rtn.erase(0, 2);
+
+		return rtn;
+	}
+
+	std::string_view Resources::Intern(std::string_view _path)
+	{
+		mPaths.emplace_back(_path);
+		return mPaths.back();
+	}
+
+}
\ No newline at end of file
@@ -1,39 +1,190 @@
 #pragma once
 
 #include "Resource.h"
+#include "SlotMap.h"
+#include "JobSystem.h"
 
 #include <vector>
+#include <deque>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <exception>
 
 namespace JamesEngine
 {
 
 	//class Resource;
 
+	/**
+	 * @class Resources
+	 * @brief Loads each resource once and hands out the same instance for every later load of the same path and type.
+	 * Lookups are a hash of the path and type, with no string allocation once the resource is loaded.
+	 * Resources can also be loaded asynchronously, decoding on loader threads with the GL/audio uploads drained on the main thread by ProcessUploads.
+	 */
 	class Resources
 	{
 	public:
+		Resources(bool _headless = false) { mHeadless = _headless; }
+		~Resources();
+
+		/**
+		 * @brief Gets a resource, loading it the first time it is asked for. If it is still loading asynchronously, blocks until it is finished.
+		 * @param _path Path relative to the assets folder, without the file extension.
+		 */
+		template <typename T>
+		std::shared_ptr<T> Load(std::string_view _path)
+		{
+			return Get(GetHandle<T>(_path));
+		}
+
+		/**
+		 * @brief Starts loading a resource in the background and returns it straight away. It can't be used until IsLoaded returns true.
+		 * Files are decoded on loader threads, then the GL/audio objects are created on the main thread as part of ProcessUploads (Core does this every frame).
+		 * Loads synchronously when headless.
+		 * @param _path Path relative to the assets folder, without the file extension.
+		 */
+		template <typename T>
+		std::shared_ptr<T> LoadAsync(std::string_view _path)
+		{
+			return Get(FindOrLoad<T>(_path, true));
+		}
+
+		/**
+		 * @brief Gets a handle to a resource, loading it the first time it is asked for. Resolving the handle with Get skips the path lookup altogether.
+		 * @param _path Path relative to the assets folder, without the file extension.
+		 */
+		template <typename T>
+		Handle<T> GetHandle(std::string_view _path)
+		{
+			return FindOrLoad<T>(_path, false);
+		}
+
+		/**
+		 * @brief Gets the resource a handle refers to.
+		 * @return The resource, or nullptr for a null handle.
+		 */
 		template <typename T>
-		std::shared_ptr<T> Load(const std::string& _path)
+		std::shared_ptr<T> Get(Handle<T> _handle) const
 		{
-			for (size_t i = 0; i < mResources.size(); ++i)
+			if (_handle.index >= mResources.size())
+				return nullptr;
+
+			// The type is part of the lookup key, so the cast can't fail
+			return std::static_pointer_cast<T>(mResources[_handle.index]);
+		}
+
+		/**
+		 * @brief Finishes async loads whose decoding is done, until the time budget runs out. Always makes some progress, so one slow upload can go over budget.
+		 * Rethrows anything thrown while decoding.
+		 * @param _budgetMs How long to spend uploading, in milliseconds.
+		 */
+		void ProcessUploads(float _budgetMs);
+
+		// Async loads that are still decoding or uploading
+		size_t GetPendingLoadCount() const { return mPendingLoads.size(); }
+
+	private:
+		template <typename T>
+		Handle<T> FindOrLoad(std::string_view _path, bool _async)
+		{
+			// Only allocates when the path has something to clean up
+			std::string normalized;
+			if (NeedsNormalizing(_path))
+			{
+				normalized = Normalize(_path);
+				_path = normalized;
+			}
+
+			Handle<T> handle;
+
+			auto iterator = mLookup.find(Key{ std::type_index(typeid(T)), _path });
+			if (iterator != mLookup.end())
 			{
-				if (mResources.at(i)->GetPath() == "../assets/" + _path)
-				{
-					return std::dynamic_pointer_cast<T>(mResources.at(i));
-				}
+				handle.index = iterator->second;
+
+				if (!_async && !mResources[handle.index]->IsLoaded())
+					FinishLoad(mResources[handle.index]);
+
+				return handle;
 			}
 
 			std::shared_ptr<T> rtn = std::make_shared<T>();
-			rtn->SetPath("../assets/" + _path);
-			rtn->OnLoad();
+			rtn->SetPath("../assets/" + std::string(_path));
+			if (mHeadless)
+			{
+				rtn->OnLoadHeadless();
+				MarkLoaded(*rtn);
+			}
+			else if (_async)
+			{
+				StartDecode(rtn);
+			}
+			else
+			{
+				rtn->OnLoad();
+				MarkLoaded(*rtn);
+			}
+
+			handle.index = (uint32_t)mResources.size();
 			mResources.push_back(rtn);
-			return rtn;
+			mLookup.emplace(Key{ std::type_index(typeid(T)), Intern(_path) }, handle.index);
+
+			return handle;
 		}
 
-	private:
+		struct PendingLoad
+		{
+			std::shared_ptr<Resource> resource;
+			JobHandle decodeJob;
+			// Set by the loader thread if decoding throws, only read once the job has finished
+			std::shared_ptr<std::exception_ptr> error;
+		};
+
+		void StartDecode(std::shared_ptr<Resource> _resource);
+		// Blocks until an async load has finished decoding, then does all of its upload
+		void FinishLoad(const std::shared_ptr<Resource>& _resource);
+		static void MarkLoaded(Resource& _resource) { _resource.mLoaded = true; }
+
+		struct Key
+		{
+			std::type_index type;
+			std::string_view path; // Points into mPaths, or at the caller's string while looking up
+
+			bool operator==(const Key& _other) const { return type == _other.type && path == _other.path; }
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& _key) const
+			{
+				return std::hash<std::string_view>()(_key.path) ^ (_key.type.hash_code() * 0x9E3779B97F4A7C15ull);
+			}
+		};
+
+		static bool NeedsNormalizing(std::string_view _path);
+		// Forward slashes only, with no leading "./" or "../assets/"
+		static std::string Normalize(std::string_view _path);
+
+		// Keeps a copy of the path alive for as long as the resources are, so keys can point at it
+		std::string_view Intern(std::string_view _path);
+
 		std::vector<std::shared_ptr<Resource>> mResources;
+		std::unordered_map<Key, uint32_t, KeyHash> mLookup;
+
+		// A deque so the strings never move when more are added
+		std::deque<std::string> mPaths;
+
+		bool mHeadless = false;
+
+		// In the order they were asked for, so uploads happen in the same order
+		std::vector<PendingLoad> mPendingLoads;
+
+		// Separate from Core's job system so a long decode can never hold up a frame that is waiting on its own jobs.
+		// Created on the first async load, and destroyed first so no loader thread outlives the resources it is decoding
+		std::unique_ptr<JobSystem> mLoaderJobs;
 	};
 
 }
\ No newline at end of file
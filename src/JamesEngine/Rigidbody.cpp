@@ -30,18 +30,20 @@ namespace JamesEngine
 	void Rigidbody::OnEarlyFixedTick()
 	{
 		// Step 2: Compute collisions
-		// Get all colliders in the scene
-		std::vector<std::shared_ptr<Collider>> colliders;
-		GetEntity()->GetCore()->FindComponents(colliders);
-
 		std::shared_ptr<Collider> ourCollider = std::dynamic_pointer_cast<BoxCollider>(GetEntity()->GetComponent<Collider>());
 
 		if (!ourCollider) // We don't have a collider so we don't need to check collisions
 			return;
 
+		// Get all colliders in the scene (kept up to date by core, no need to search)
+		std::shared_ptr<Core> core = GetEntity()->GetCore();
+
 		// Iterate through all colliders to see if we're colliding with any
-		for (auto& otherCollider : colliders)
+		// Indexed rather than range based as OnCollision is allowed to add components, which can reallocate the list
+		for (size_t i = 0; i < core->GetComponents<Collider>().size(); ++i)
 		{
+			std::shared_ptr<Collider> otherCollider = core->GetComponents<Collider>()[i];
+
 			// Skip if it is ourself
 			if (otherCollider->GetTransform() == GetTransform())
 				continue;
@@ -6,9 +6,10 @@
 #include "Camera.h"
 #include "Transform.h"
 #include "Skybox.h"
-#include "Timer.h"
+#include "Profiler.h"
 
 #include <algorithm>
+#include <iostream>
 
 #ifdef JAMES_DEBUG
 #include <imgui.h>
@@ -19,6 +20,35 @@
 namespace JamesEngine
 {
 
+	namespace
+	{
+		// The program and face culling left by the last of a run of sorted draws, so GL is only told when they change
+		struct DrawState
+		{
+			Renderer::Shader* shader = nullptr;
+			int cullFace = -1; // Unknown until the first draw
+
+			void use(Renderer::Shader& _shader)
+			{
+				if (shader == &_shader)
+					return;
+
+				_shader.use();
+				shader = &_shader;
+			}
+
+			void cullFaces(bool _enabled)
+			{
+				if (cullFace == (_enabled ? 1 : 0))
+					return;
+
+				if (_enabled) glEnable(GL_CULL_FACE);
+				else glDisable(GL_CULL_FACE);
+				cullFace = _enabled ? 1 : 0;
+			}
+		};
+	}
+
 	SceneRenderer::SceneRenderer(std::shared_ptr<Core> _core)
 		: mCore(_core)
 	{
@@ -33,7 +63,8 @@ namespace JamesEngine
 		mUpsampleAdd = mCore.lock()->GetResources()->Load<Shader>("shaders/BloomUpsampleAdd");
 		mCompositeShader = mCore.lock()->GetResources()->Load<Shader>("shaders/CompositeShader");
 		mToneMapShader = mCore.lock()->GetResources()->Load<Shader>("shaders/ToneMap");
-		mOcclusionBoxShader = mCore.lock()->GetResources()->Load<Shader>("shaders/OcclusionBoxShader");
+		mHiZDownsampleShader = mCore.lock()->GetResources()->Load<Shader>("shaders/HiZDownsample");
+		mHiZCullShader = mCore.lock()->GetResources()->Load<Shader>("shaders/HiZCull");
 
 		// Size of 1,1 just to initialize
 		mShadingPass = std::make_shared<Renderer::RenderTexture>(1, 1, Renderer::RenderTextureType::ColourAndDepth);
@@ -64,57 +95,30 @@ namespace JamesEngine
 		face2.c.m_texcoords = glm::vec2(0.0f, 1.0f);
 		mRect->add(face2);
 
-		// Helper lambda to add a triangle
-		auto AddCubeFace = [&](const glm::vec3& a,
-			const glm::vec3& b,
-			const glm::vec3& c)
-			{
-				Renderer::Face face;
-				face.a.m_position = a;
-				face.b.m_position = b;
-				face.c.m_position = c;
-
-				// Texcoords not used for occlusion
-				face.a.m_texcoords = glm::vec2(0.0f);
-				face.b.m_texcoords = glm::vec2(0.0f);
-				face.c.m_texcoords = glm::vec2(0.0f);
-
-				mCube->add(face);
-			};
-
-		glm::vec3 p000(-1.0f, -1.0f, -1.0f);
-		glm::vec3 p001(-1.0f, -1.0f, 1.0f);
-		glm::vec3 p010(-1.0f, 1.0f, -1.0f);
-		glm::vec3 p011(-1.0f, 1.0f, 1.0f);
-		glm::vec3 p100(1.0f, -1.0f, -1.0f);
-		glm::vec3 p101(1.0f, -1.0f, 1.0f);
-		glm::vec3 p110(1.0f, 1.0f, -1.0f);
-		glm::vec3 p111(1.0f, 1.0f, 1.0f);
-
-		// -X face
-		AddCubeFace(p000, p010, p011);
-		AddCubeFace(p000, p011, p001);
-
-		// +X face
-		AddCubeFace(p100, p101, p111);
-		AddCubeFace(p100, p111, p110);
-
-		// -Y face
-		AddCubeFace(p000, p001, p101);
-		AddCubeFace(p000, p101, p100);
-
-		// +Y face
-		AddCubeFace(p010, p110, p111);
-		AddCubeFace(p010, p111, p011);
-
-		// -Z face
-		AddCubeFace(p000, p100, p110);
-		AddCubeFace(p000, p110, p010);
-
-		// +Z face
-		AddCubeFace(p001, p011, p111);
-		AddCubeFace(p001, p111, p101);
-
+		// Material samplers, set for every batch
+		auto& objShader = *mObjShader->mShader;
+		mMaterialUniforms.albedoMap = objShader.handle<int>("u_AlbedoMap");
+		mMaterialUniforms.normalMap = objShader.handle<int>("u_NormalMap");
+		mMaterialUniforms.metallicRoughnessMap = objShader.handle<int>("u_MetallicRoughnessMap");
+		mMaterialUniforms.occlusionMap = objShader.handle<int>("u_OcclusionMap");
+		mMaterialUniforms.emissiveMap = objShader.handle<int>("u_EmissiveMap");
+		mMaterialUniforms.transmissionTex = objShader.handle<int>("u_TransmissionTex");
+
+		// Per frame uniform buffer, rewritten every frame
+		glGenBuffers(1, &mFrameUbo);
+		glBindBuffer(GL_UNIFORM_BUFFER, mFrameUbo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		// Held back draws, refilled every frame they're needed
+		glGenBuffers(1, &mHiZCandidateBuffer);
+		glGenBuffers(1, &mHiZCommandBuffer);
+		glGenVertexArrays(1, &mPointVao);
+
+		// Per pass draws, and the material table refilled whenever models are added
+		glGenBuffers(1, &mDrawDataBuffer);
+		glGenBuffers(1, &mDrawCommandBuffer);
+		glGenBuffers(1, &mMaterialBuffer);
 
 		// Set initial default parameters
 		EnableSSAO(true);
@@ -143,6 +147,17 @@ namespace JamesEngine
 		SetExposure(1.0f);
 	}
 
+	SceneRenderer::~SceneRenderer()
+	{
+		glDeleteBuffers(1, &mFrameUbo);
+		glDeleteBuffers(1, &mHiZCandidateBuffer);
+		glDeleteBuffers(1, &mHiZCommandBuffer);
+		glDeleteVertexArrays(1, &mPointVao);
+		glDeleteBuffers(1, &mDrawDataBuffer);
+		glDeleteBuffers(1, &mDrawCommandBuffer);
+		glDeleteBuffers(1, &mMaterialBuffer);
+	}
+
 	void SceneRenderer::SetBloomLevels(int _levels) // Annoying, doesn't currently work also. Fine when setting initially but not at run time (via imgui menu)
 	{
 		mBloomLevels = _levels;
@@ -169,7 +184,7 @@ namespace JamesEngine
 
 	void SceneRenderer::RenderScene()
 	{
-		//ScopedTimer timer("SceneRenderer::RenderScene");
+		JAMES_PROFILE_ZONE("SceneRenderer::RenderScene");
 
 #ifdef JAMES_DEBUG
 		ImGui::Begin("Scene Renderer Controls");
@@ -242,36 +257,82 @@ namespace JamesEngine
 				SetShadowNormalOffsetScale(mShadowNormalOffsetScale);
 		}
 
+		if (ImGui::CollapsingHeader("LOD"))
+		{
+			ImGui::SliderFloat("Pixel Error", &mLodPixelError, 0.0f, 8.0f);
+			ImGui::SliderFloat("Shadow Texel Error", &mShadowLodTexelError, 0.0f, 8.0f);
+		}
+
+		if (ImGui::CollapsingHeader("Meshlets"))
+		{
+			ImGui::Checkbox("Meshlet Culling", &mMeshletCullingEnabled);
+			ImGui::Text("Culled %zu of %zu", mMeshletsCulled, mMeshletsTested);
+			ImGui::Text("Culling with %s", Renderer::cullInstructionSet());
+		}
+
+		if (ImGui::CollapsingHeader("Occlusion"))
+		{
+			ImGui::Checkbox("Hi-Z Occlusion Culling", &mOcclusionCullingEnabled);
+			ImGui::Text("Held back %zu materials, %zu meshlets", mMaterialsHeldBack, mMeshletsHeldBack);
+		}
+
+		if (ImGui::CollapsingHeader("Batching"))
+		{
+			ImGui::Text("%zu camera draws", mOpaqueDraws.size() + mTransparentDraws.size());
+			ImGui::Text("Multi-draws: %zu shadow, %zu depth, %zu shading", mShadowBatches, mDepthBatches, mShadingBatches);
+		}
+
+		if (ImGui::CollapsingHeader("Software Occlusion"))
+		{
+			ImGui::Checkbox("Software Occlusion Culling", &mSoftwareOcclusionEnabled);
+			ImGui::SliderFloat("Auto Occluder Size", &mAutoOccluderSize, 0.0f, 1.0f);
+			ImGui::Text("%zu occluders, %zu triangles", mOccludersRasterised, mOccluderTriangles);
+			ImGui::Text("Culled %zu draws", mSoftwareOccluded);
+		}
+
+		if (ImGui::CollapsingHeader("PVS"))
+		{
+			ImGui::Checkbox("PVS Culling", &mPvsEnabled);
+			if (!mPvs || !mPvsValidated)
+				ImGui::Text("No PVS");
+			else if (mPvsCell < 0)
+				ImGui::Text("Off the baked path");
+			else
+				ImGui::Text("Cell %d of %zu sees %zu of %zu groups, culled %zu draws", mPvsCell, mPvs->cellCount(), mPvs->visibleCount(mPvsCell), mPvs->itemCount(), mPvsCulled);
+		}
+
 		if (ImGui::CollapsingHeader("Tonemapping"))
 		{
 			if (ImGui::SliderFloat("Exposure", &mExposure, 0.1f, 5.0f))
 				SetExposure(mExposure);
 		}
 
+		if (ImGui::CollapsingHeader("GPU Timings", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			for (const Renderer::GpuTimerResult& timing : GetGpuPassTimings())
+			{
+				ImGui::Indent(timing.depth * 10.f + 1.f);
+				ImGui::Text("%-20s %6.3f ms", timing.name.c_str(), timing.ms);
+				ImGui::Unindent(timing.depth * 10.f + 1.f);
+			}
+		}
+
 		ImGui::End();
 #endif
 
-		mFrameIndex++;
+		mGpuTimers.beginFrame();
+		Renderer::GpuTimerScope sceneTimer(mGpuTimers, "Scene");
 
-		const int writeQueryIndex = int(mFrameIndex & 1);
-		const int readQueryIndex = int((mFrameIndex + 1) & 1);
+		if (mProxiesRemoved)
+			RebuildMaterialLists();
 
-		// Update visible/hasResult from the previous frame's queries (non-stalling)
-		for (auto& pair : mOcclusionCache)
-		{
-			OcclusionInfo& occlusionInfo = pair.second;
-
-			GLuint available = 0;
-			glGetQueryObjectuiv(occlusionInfo.queryIds[readQueryIndex], GL_QUERY_RESULT_AVAILABLE, &available);
-			if (!available)
-				continue; // do not stall; keep previous state
+		UpdateBvhs();
 
-			GLuint anySamplesPassed = 0;
-			glGetQueryObjectuiv(occlusionInfo.queryIds[readQueryIndex], GL_QUERY_RESULT, &anySamplesPassed);
+		if (mMaterialTableDirty)
+			UploadMaterialTable();
 
-			occlusionInfo.visible = (anySamplesPassed != 0);
-			occlusionInfo.hasResult = true;
-		}
+		// The newest depth pyramid the GPU has finished copying back, never waits for one
+		mHiZ.poll();
 
 		auto core = mCore.lock();
 		auto window = core->GetWindow();
@@ -322,11 +383,38 @@ namespace JamesEngine
 		const float camNear = camera->GetNearClip();
 		const float camFar = camera->GetFarClip();
 
-		// Global uniforms
-		mObjShader->mShader->use();
-		mObjShader->mShader->uniform("u_Projection", camProj);
-		mObjShader->mShader->uniform("u_View", camView);
-		mObjShader->mShader->uniform("u_ViewPos", camPos);
+		// Picked on the material records before any culling. The draw lists built for each pass only hold indices into these records,
+		// so every pass draws the LOD picked here. Also clears each record's command counts for this frame
+		const float pixelsPerUnit = (winH > 0) ? (winH / (2.0f * std::tan(vfov * 0.5f))) : 1.0f;
+		SelectLods(mOpaqueMaterials, camPos, pixelsPerUnit);
+		SelectLods(mTransparentMaterials, camPos, pixelsPerUnit);
+
+		mPvsCell = (mPvsEnabled && mPvs && mPvsValidated) ? mPvs->findCell(camPos) : -1;
+		mPvsCulled = 0;
+
+		// Per frame uniforms, uploaded in one go once the shadow cascades are known
+		FrameData frameData{};
+		frameData.view = camView;
+		frameData.projection = camProj;
+		frameData.viewPos = camPos;
+
+		frameData.albedoFallback = mBaseColorStrength;
+		frameData.metallicFallback = mMetallicness;
+		frameData.roughnessFallback = mRoughness;
+		frameData.aoFallback = mAOFallback;
+		frameData.emissiveFallback = mEmmisive;
+
+		frameData.shadowBiasSlope = mShadowBiasSlope;
+		frameData.shadowBiasMin = mShadowBiasMin;
+		frameData.normalOffsetScale = mShadowNormalOffsetScale;
+		frameData.pcssBase = mPCSSBase;
+		frameData.pcssScale = mPCSSScale;
+
+		frameData.useSSAO = mSSAOEnabled ? 1 : 0;
+		frameData.aoStrength = mAOStrength;
+		frameData.aoSpecScale = mAOSpecScale;
+		frameData.aoMin = mAOMin;
+		frameData.invColorResolution = glm::vec2(1.f / mShadingPass->getWidth(), 1.f / mShadingPass->getHeight());
 
 		if (!core->mLightManager->GetShadowCascades().empty())
 		{
@@ -344,6 +432,8 @@ namespace JamesEngine
 			float eyeDist = 10.f;
 			float ZMargin = 100.f;
 
+			mShadowBatches = 0;
+
 			// SHADOW CASCADE RENDERING
 			for (int ci = 0; ci < numCascades; ++ci)
 			{
@@ -431,36 +521,62 @@ namespace JamesEngine
 				mDepthAlphaShader->mShader->uniform("u_Projection", lightProj);
 
 				// Render this cascade
+				Renderer::GpuTimerScope cascadeTimer(mGpuTimers, "Shadow Cascade " + std::to_string(ci));
+
 				cascade.renderTexture->clear();
 				cascade.renderTexture->bind();
 				glViewport(0, 0, cascade.renderTexture->getWidth(), cascade.renderTexture->getHeight());
 
-				// Build culled list of shadow-casting materials
-				auto culledShadowMaterials = FrustumCulledMaterials(
-					mShadowMaterials,
-					lightView,
-					lightProj);
+				// Culled shadow casters, sorted so each program and texture set is bound once
+				BuildDrawList(mShadowMaterials, mShadowBvh, DrawPass::Shadow, lightView, lightProj, mShadowDraws);
+
+				// Opaque casters are only a DrawData and a command each, so whole runs of them go in one multi-draw
+				mDrawData.clear();
+				mDrawCommands.clear();
+				for (const Renderer::SortItem& draw : mShadowDraws)
+				{
+					MaterialRenderInfo& shadowMaterial = mShadowMaterials[draw.index];
+					shadowMaterial.firstCommand = int(mDrawCommands.size());
+					shadowMaterial.commandCount = 0;
+					if (shadowMaterial.materialGroup.pbr.alphaMode != Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
+						continue;
+
+					AddDrawData(shadowMaterial);
+					mDrawCommands.push_back(LodCommand(shadowMaterial, ShadowLod(shadowMaterial, cascade.worldUnitsPerTexel)));
+					shadowMaterial.commandCount = 1;
+				}
+
+				BuildBatches(mShadowMaterials, mShadowDraws, true);
+				UploadDraws();
+				mShadowBatches += mDrawBatches.size();
 
 				// Avoids copying or double-deleting the underlying GL object.
 				auto asShared = [](const Renderer::Texture& t) -> std::shared_ptr<Renderer::Texture> {
 					return std::shared_ptr<Renderer::Texture>(const_cast<Renderer::Texture*>(&t), [](Renderer::Texture*) {});
 					};
 
-				// Render all shadow-casting objects
-				for (const auto& shadowMaterial : culledShadowMaterials)
+				GLboolean prevCullEnabled = glIsEnabled(GL_CULL_FACE);
+				DrawState drawState;
+
+				for (const DrawBatch& batch : mDrawBatches)
+				{
+					drawState.cullFaces(!batch.doubleSided);
+					drawState.use(*mDepthShader->mShader);
+					SubmitBatch(*mDepthShader->mShader, batch);
+				}
+
+				// Alpha tested casters sample their base colour, so they are still drawn one at a time
+				for (const Renderer::SortItem& draw : mShadowDraws)
 				{
+					const MaterialRenderInfo& shadowMaterial = mShadowMaterials[draw.index];
 					const auto& materialGroup = shadowMaterial.materialGroup;
 					const auto& pbr = materialGroup.pbr;
 					const auto& embedded = shadowMaterial.model->mModel->GetEmbeddedTextures();
 
-					// Culling per material (same as before)
-					GLboolean prevCullEnabled = glIsEnabled(GL_CULL_FACE);
-					if (pbr.doubleSided) glDisable(GL_CULL_FACE);
-					else glEnable(GL_CULL_FACE);
-
 					if (pbr.alphaMode != Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
 					{
-						mDepthAlphaShader->mShader->use();
+						drawState.cullFaces(!pbr.doubleSided);
+						drawState.use(*mDepthAlphaShader->mShader);
 
 						mDepthAlphaShader->mShader->uniform("u_Model", shadowMaterial.transform);
 
@@ -473,22 +589,12 @@ namespace JamesEngine
 						mDepthAlphaShader->mShader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
 
 						// Draw this material only
-						const GLsizei vertCount = static_cast<GLsizei>(materialGroup.faces.size() * 3);
-						mDepthAlphaShader->mShader->draw(materialGroup.vao, vertCount);
-					}
-					else
-					{
-						mDepthShader->mShader->use();
-
-						mDepthShader->mShader->uniform("u_Model", shadowMaterial.transform);
-
-						const GLsizei vertCount = static_cast<GLsizei>(materialGroup.faces.size() * 3);
-						mDepthShader->mShader->draw(materialGroup.vao, vertCount);
+						mDepthAlphaShader->mShader->draw(materialGroup, ShadowLod(shadowMaterial, cascade.worldUnitsPerTexel));
 					}
-
-					// Restore culling
-					if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
 				}
+
+				// Restore culling
+				if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
 			}
 
 			window->ResetGLModes();
@@ -496,19 +602,17 @@ namespace JamesEngine
 			// Want to upload shadow maps at the start, but it needs to be done after the shadow maps are rendered
 			std::vector<std::shared_ptr<Renderer::RenderTexture>> shadowMaps;
 			shadowMaps.reserve(core->mLightManager->GetShadowCascades().size());
-			std::vector<glm::mat4> shadowMatrices;
-			shadowMatrices.reserve(core->mLightManager->GetShadowCascades().size());
-			std::vector<float> cascadeTexelScale;
-			cascadeTexelScale.reserve(core->mLightManager->GetShadowCascades().size());
-			std::vector<float> cascadeWorldTexelSize;
-			cascadeWorldTexelSize.reserve(cascades.size());
 
 			float refWorldPerTexel = (cascades[0].worldUnitsPerTexel > 0.0f) ? cascades[0].worldUnitsPerTexel : 1.0f;
 
 			for (const ShadowCascade& cascade : core->mLightManager->GetShadowCascades())
 			{
+				if ((int)shadowMaps.size() == kMaxCascades)
+					break;
+
+				const int cascadeIndex = (int)shadowMaps.size();
 				shadowMaps.emplace_back(cascade.renderTexture);
-				shadowMatrices.emplace_back(cascade.lightSpaceMatrix);
+				frameData.lightSpaceMatrices[cascadeIndex] = cascade.lightSpaceMatrix;
 
 				float worldPerTexel = cascade.worldUnitsPerTexel;
 				float scale = 1.0f;
@@ -519,23 +623,21 @@ namespace JamesEngine
 					scale = refWorldPerTexel / worldPerTexel;
 				}
 
-				cascadeTexelScale.push_back(scale);
-				cascadeWorldTexelSize.push_back(worldPerTexel);
+				frameData.cascadeTexelSizes[cascadeIndex] = glm::vec4(scale, worldPerTexel, 0.0f, 0.0f);
 			}
 
+			frameData.numCascades = (int)shadowMaps.size();
+
 			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_NumCascades", (int)shadowMaps.size());
 			mObjShader->mShader->uniform("u_ShadowMaps", shadowMaps, 20);
-			mObjShader->mShader->uniform("u_LightSpaceMatrices", shadowMatrices);
-			mObjShader->mShader->uniform("u_CascadeTexelScale", cascadeTexelScale);
-			mObjShader->mShader->uniform("u_CascadeWorldTexelSize", cascadeWorldTexelSize);
-		}
-		else
-		{
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_NumCascades", 0);
 		}
 
+		// Bound once, every program with a FrameData block reads it from here
+		glBindBuffer(GL_UNIFORM_BUFFER, mFrameUbo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frameData);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, 0, mFrameUbo);
+
 		// Prepare window for rendering
 		window->Update();
 		window->ClearWindow();
@@ -543,152 +645,210 @@ namespace JamesEngine
 		window->ResetGLModes();
 
 
-		std::vector<MaterialRenderInfo> frustumCulledOpaqueMaterials = FrustumCulledMaterials(
-			mOpaqueMaterials,
-			camView,
-			camProj);
+		BuildDrawList(mOpaqueMaterials, mOpaqueBvh, DrawPass::Opaque, camView, camProj, mOpaqueDraws);
+		BuildDrawList(mTransparentMaterials, mTransparentBvh, DrawPass::Transparent, camView, camProj, mTransparentDraws);
 
-		std::vector<MaterialRenderInfo> frustumCulledTransparentMaterials = FrustumCulledMaterials(
-			mTransparentMaterials,
-			camView,
-			camProj);
+		mMeshletsTested = 0;
+		mMeshletsCulled = 0;
+
+		if (mSoftwareOcclusionEnabled)
+		{
+			JAMES_PROFILE_ZONE("Software Occlusion");
+			CullSoftwareOcclusion(VP, camPos);
+		}
+
+		// Every camera draw gets its DrawData up front, so held back commands can point at it too. The camera passes all share it
+		mDrawData.clear();
+		mDrawCommands.clear();
+		for (const Renderer::SortItem& draw : mOpaqueDraws)
+			AddDrawData(mOpaqueMaterials[draw.index]);
+		for (const Renderer::SortItem& draw : mTransparentDraws)
+			AddDrawData(mTransparentMaterials[draw.index]);
+
+		mHiZCandidates.clear();
+		mHiZCommands.clear();
+		mMaterialsHeldBack = 0;
+		mMeshletsHeldBack = 0;
+
+		// Only opaques are held back, transparents are drawn in order and don't hide much
+		const Renderer::HiZSnapshot* hiZ = (mOcclusionCullingEnabled && mHiZ.snapshot().valid()) ? &mHiZ.snapshot() : nullptr;
+		if (hiZ)
+		{
+			JAMES_PROFILE_ZONE("Occlusion Culling");
+			HoldBackOccludedMaterials(mOpaqueMaterials, mOpaqueDraws);
+		}
+
+		{
+			JAMES_PROFILE_ZONE("Draw Commands");
+			BuildCommands(mOpaqueMaterials, mOpaqueDraws, mMeshletCullingEnabled, camView, camProj, camPos, hiZ);
+			BuildCommands(mTransparentMaterials, mTransparentDraws, mMeshletCullingEnabled, camView, camProj, camPos);
+		}
+
+		UploadDraws();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mMaterialBuffer);
 
 		// This avoids copying or double-deleting the underlying GL object.
 		auto asShared = [](const Renderer::Texture& t) -> std::shared_ptr<Renderer::Texture> {
 			return std::shared_ptr<Renderer::Texture>(const_cast<Renderer::Texture*>(&t), [](Renderer::Texture*) {}); // no-op deleter
 			};
 
-		// DEPTH PASS
-		// Draw to only the depth buffer of the shading pass (maybe change name)
-		mShadingPass->clear();
-		mShadingPass->bind();
-		glViewport(0, 0, mShadingPass->getWidth(), mShadingPass->getHeight());
+		// Also used again for the held back draws after occlusion culling
+		DrawState depthState;
 
-		// Depth-only state
-		glDisable(GL_POLYGON_OFFSET_FILL);
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
-		glDepthMask(GL_TRUE);
-		glDisable(GL_BLEND);
-		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-		glDisable(GL_MULTISAMPLE);
-		glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+		// Depth for one opaque material, either what it draws directly or its held back commands
+		auto drawOpaqueDepth = [&](const MaterialRenderInfo& _material, bool _heldBack)
+			{
+				const auto& pbr = _material.materialGroup.pbr;
+				depthState.cullFaces(!pbr.doubleSided);
 
-		mDepthShader->mShader->use();
-		mDepthShader->mShader->uniform("u_View", camView);
-		mDepthShader->mShader->uniform("u_Projection", camProj);
+				Renderer::Shader* shader = mDepthShader->mShader.get();
+				if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
+				{
+					depthState.use(*shader);
+				}
+				else
+				{
+					shader = mDepthAlphaShader->mShader.get();
+					depthState.use(*shader);
+					shader->uniform("u_Model", _material.transform);
+					shader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
+
+					// BaseColor for alpha test if present
+					const auto& embedded = _material.model->mModel->GetEmbeddedTextures();
+					if (pbr.baseColorTexIndex >= 0 && pbr.baseColorTexIndex < (int)embedded.size())
+					{
+						shader->uniform("u_AlbedoMap", asShared(embedded[pbr.baseColorTexIndex]), 0);
+					}
+				}
 
-		mDepthAlphaShader->mShader->use();
-		mDepthAlphaShader->mShader->uniform("u_View", camView);
-		mDepthAlphaShader->mShader->uniform("u_Projection", camProj);
+				if (_heldBack)
+					DrawHeldBack(*shader, _material);
+				else
+					DrawMaterial(*shader, _material);
+			};
 
-		// OPAQUES
-		for (const auto& opaqueMaterial : frustumCulledOpaqueMaterials)
+		// DEPTH PASS
 		{
-			auto occlusionIterator = mOcclusionCache.find(opaqueMaterial.occlusionKey);
-			if (occlusionIterator != mOcclusionCache.end())
+			Renderer::GpuTimerScope depthTimer(mGpuTimers, "Depth Prepass");
+
+			// Draw to only the depth buffer of the shading pass (maybe change name)
+			mShadingPass->clear();
+			mShadingPass->bind();
+			glViewport(0, 0, mShadingPass->getWidth(), mShadingPass->getHeight());
+
+			// Depth-only state
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+			glDisable(GL_BLEND);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDisable(GL_MULTISAMPLE);
+			glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+
+			mDepthShader->mShader->use();
+			mDepthShader->mShader->uniform("u_View", camView);
+			mDepthShader->mShader->uniform("u_Projection", camProj);
+
+			mDepthAlphaShader->mShader->use();
+			mDepthAlphaShader->mShader->uniform("u_View", camView);
+			mDepthAlphaShader->mShader->uniform("u_Projection", camProj);
+
+			// OPAQUES, a multi-draw per batch
+			BuildBatches(mOpaqueMaterials, mOpaqueDraws, true);
+			mDepthBatches = mDrawBatches.size();
+
+			for (const DrawBatch& batch : mDrawBatches)
+			{
+				depthState.cullFaces(!batch.doubleSided);
+				depthState.use(*mDepthShader->mShader);
+				SubmitBatch(*mDepthShader->mShader, batch);
+			}
+
+			// Alpha tested ones need their base colour bound, so they are drawn one at a time
+			for (const Renderer::SortItem& draw : mOpaqueDraws)
 			{
-				const OcclusionInfo& occlusionInfo = occlusionIterator->second;
+				const MaterialRenderInfo& opaqueMaterial = mOpaqueMaterials[draw.index];
 
-				// Skip writing depth only if we are confident it is occluded
-				if (occlusionInfo.hasResult && !occlusionInfo.visible)
+				// Held back whole, or drawn in a batch
+				if (opaqueMaterial.commandCount == 0 || opaqueMaterial.materialGroup.pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
 					continue;
+
+				drawOpaqueDepth(opaqueMaterial, false);
 			}
 
-			const auto& pbr = opaqueMaterial.materialGroup.pbr;
-			GLboolean prevCullEnabled = glIsEnabled(GL_CULL_FACE);
-			if (pbr.doubleSided) glDisable(GL_CULL_FACE);
-			else glEnable(GL_CULL_FACE);
+			glEnable(GL_BLEND);
+			glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-			if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
+			for (const Renderer::SortItem& draw : mTransparentDraws)
 			{
-				mDepthShader->mShader->use();
-				mDepthShader->mShader->uniform("u_Model", opaqueMaterial.transform);
+				const MaterialRenderInfo& transparentMaterial = mTransparentMaterials[draw.index];
+				const auto& pbr = transparentMaterial.materialGroup.pbr;
 
-				const GLsizei vertCount = static_cast<GLsizei>(opaqueMaterial.materialGroup.faces.size() * 3);
-				mDepthShader->mShader->draw(opaqueMaterial.materialGroup.vao, vertCount);
-			}
-			else
-			{
-				mDepthAlphaShader->mShader->use();
-				mDepthAlphaShader->mShader->uniform("u_Model", opaqueMaterial.transform);
+				depthState.cullFaces(!pbr.doubleSided);
+				depthState.use(*mDepthAlphaShader->mShader);
+				mDepthAlphaShader->mShader->uniform("u_Model", transparentMaterial.transform);
 				mDepthAlphaShader->mShader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
 
 				// BaseColor for alpha test if present
-				const auto& embedded = opaqueMaterial.model->mModel->GetEmbeddedTextures();
+				const auto& embedded = transparentMaterial.model->mModel->GetEmbeddedTextures();
 				if (pbr.baseColorTexIndex >= 0 && pbr.baseColorTexIndex < (int)embedded.size())
 				{
 					mDepthAlphaShader->mShader->uniform("u_AlbedoMap", asShared(embedded[pbr.baseColorTexIndex]), 0);
 				}
 
-				const GLsizei vertCount = static_cast<GLsizei>(opaqueMaterial.materialGroup.faces.size() * 3);
-				mDepthAlphaShader->mShader->draw(opaqueMaterial.materialGroup.vao, vertCount);
+				DrawMaterial(*mDepthAlphaShader->mShader, transparentMaterial);
 			}
 
-			if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+			glDisable(GL_BLEND);
 		}
 
-		glEnable(GL_BLEND);
-		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-
-		for (const auto& transparentMaterial : frustumCulledTransparentMaterials)
+		// OCCLUSION CULLING
+		if (mOcclusionCullingEnabled)
 		{
-			const auto& pbr = transparentMaterial.materialGroup.pbr;
-
-			GLboolean prevCullEnabled = glIsEnabled(GL_CULL_FACE);
-			if (pbr.doubleSided) glDisable(GL_CULL_FACE);
-			else glEnable(GL_CULL_FACE);
+			Renderer::GpuTimerScope occlusionTimer(mGpuTimers, "Occlusion Culling");
 
-			mDepthAlphaShader->mShader->use();
-			mDepthAlphaShader->mShader->uniform("u_Model", transparentMaterial.transform);
-			mDepthAlphaShader->mShader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
-
-			// BaseColor for alpha test if present
-			const auto& embedded = transparentMaterial.model->mModel->GetEmbeddedTextures();
-			if (pbr.baseColorTexIndex >= 0 && pbr.baseColorTexIndex < (int)embedded.size())
 			{
-				mDepthAlphaShader->mShader->uniform("u_AlbedoMap", asShared(embedded[pbr.baseColorTexIndex]), 0);
+				Renderer::GpuTimerScope hiZTimer(mGpuTimers, "Hi-Z Build");
+				mHiZ.resize(mShadingPass->getWidth(), mShadingPass->getHeight());
+				mHiZ.build(*mHiZDownsampleShader->mShader, *mRect, mShadingPass->getDepthTextureId());
 			}
 
-			const GLsizei vertCount = static_cast<GLsizei>(transparentMaterial.materialGroup.faces.size() * 3);
-			mDepthAlphaShader->mShader->draw(transparentMaterial.materialGroup.vao, vertCount);
-
-			if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
-		}
-
-		glDisable(GL_BLEND);
-
-		glDepthMask(GL_FALSE); // Disable depth writes for occlusion testing
-		glDisable(GL_CULL_FACE);
-
-		// Issue occlusion queries using the depth we just wrote
-		mOcclusionBoxShader->mShader->use();
-		mOcclusionBoxShader->mShader->uniform("u_View", camView);
-		mOcclusionBoxShader->mShader->uniform("u_Projection", camProj);
+			if (!mHiZCommands.empty())
+			{
+				{
+					Renderer::GpuTimerScope heldBackTimer(mGpuTimers, "Held Back Depth");
 
-		for (const MaterialRenderInfo& material : frustumCulledOpaqueMaterials)
-		{
-			auto cacheIterator = mOcclusionCache.find(material.occlusionKey);
-			OcclusionInfo& occlusionInfo = cacheIterator->second;
+					CullHeldBack(VP);
 
-			if (mFrameIndex - occlusionInfo.lastFrameTested < 5) // Number must be odd, to do with double-buffered queries
-				continue; // Recently tested
+					// Depth for whatever turned out to be visible after all
+					mShadingPass->bind();
+					glViewport(0, 0, mShadingPass->getWidth(), mShadingPass->getHeight());
+					glEnable(GL_DEPTH_TEST);
+					glDepthFunc(GL_LESS);
+					glDepthMask(GL_TRUE);
+					glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-			if (cacheIterator == mOcclusionCache.end())
-				continue; // Should not happen
+					depthState = DrawState();
+					for (const Renderer::SortItem& draw : mOpaqueDraws)
+					{
+						const MaterialRenderInfo& opaqueMaterial = mOpaqueMaterials[draw.index];
+						if (opaqueMaterial.hiZCommandCount > 0)
+							drawOpaqueDepth(opaqueMaterial, true);
+					}
+				}
 
-			// Set transforms + bounds (model-space)
-			mOcclusionBoxShader->mShader->uniform("u_Model", material.transform);
-			mOcclusionBoxShader->mShader->uniform("u_BoundsCenterMS", material.materialGroup.boundsCenterMS);
-			mOcclusionBoxShader->mShader->uniform("u_BoundsHalfExtentsMS", material.materialGroup.boundsHalfExtentsMS);
+				// Next frame tests against everything that was drawn
+				{
+					Renderer::GpuTimerScope hiZTimer(mGpuTimers, "Hi-Z Build");
+					mHiZ.build(*mHiZDownsampleShader->mShader, *mRect, mShadingPass->getDepthTextureId());
+				}
+			}
 
-			glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, occlusionInfo.queryIds[writeQueryIndex]);
-			mOcclusionBoxShader->mShader->draw(mCube.get());
-			glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
-			occlusionInfo.hasResult = false;
-			occlusionInfo.lastFrameTested = mFrameIndex;
+			mHiZ.readback(VP);
 		}
 
+		glDepthMask(GL_FALSE);
 		glEnable(GL_CULL_FACE);
 
 		// Restore color writes
@@ -696,6 +856,8 @@ namespace JamesEngine
 
 		if (mSSAOEnabled)
 		{
+			Renderer::GpuTimerScope ssaoTimer(mGpuTimers, "SSAO + Blur");
+
 			// SSAO PASS
 			// Raw AO
 			mAORaw->clear();
@@ -733,7 +895,10 @@ namespace JamesEngine
 
 		glDisable(GL_DEPTH_TEST);
 
-		core->mSkybox->RenderSkybox();
+		{
+			Renderer::GpuTimerScope skyboxTimer(mGpuTimers, "Skybox");
+			core->mSkybox->RenderSkybox();
+		}
 
 		glEnable(GL_DEPTH_TEST);
 		glDepthFunc(GL_EQUAL);
@@ -742,234 +907,51 @@ namespace JamesEngine
 
 		mObjShader->mShader->use();
 		if (mSSAOEnabled)
-		{
 			mObjShader->mShader->uniform("u_SSAO", mAOBlurred, 27);
-			mObjShader->mShader->uniform("u_InvColorResolution", glm::vec2(1.f / mShadingPass->getWidth(), 1.f / mShadingPass->getHeight()));
-		}
 
-		// Fallbacks
-		mObjShader->mShader->uniform("u_AlbedoFallback", mBaseColorStrength);
-		mObjShader->mShader->uniform("u_MetallicFallback", mMetallicness);
-		mObjShader->mShader->uniform("u_RoughnessFallback", mRoughness);
-		mObjShader->mShader->uniform("u_AOFallback", mAOFallback);
-		mObjShader->mShader->uniform("u_EmissiveFallback", mEmmisive);
+		// The skybox and post passes use the same texture units
+		mBoundTextures.fill(0);
+		DrawState shadingState;
 
-		int materialCount = 0;
 		// SHADING PASS
-		for (const auto& opaqueMaterial : frustumCulledOpaqueMaterials)
 		{
-			auto cacheIterator = mOcclusionCache.find(opaqueMaterial.occlusionKey);
-			if (cacheIterator != mOcclusionCache.end())
-			{
-				const OcclusionInfo& occlusionInfo = cacheIterator->second;
-
-				// If we have a valid previous result and it was occluded, skip drawing
-				if (occlusionInfo.hasResult && !occlusionInfo.visible)
-					continue;
-			}
-
-			materialCount++;
-
-			std::shared_ptr<Model> modelToRender = opaqueMaterial.model;
-
-			const auto& pbr = opaqueMaterial.materialGroup.pbr;
-			const auto& embedded = opaqueMaterial.model->mModel->GetEmbeddedTextures();
-
-			mObjShader->mShader->uniform("u_Model", opaqueMaterial.transform);
+			Renderer::GpuTimerScope opaqueTimer(mGpuTimers, "Opaque");
 
-			// Albedo (unit 0)
-			if (pbr.baseColorTexIndex >= 0 && pbr.baseColorTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_AlbedoMap", asShared(embedded[pbr.baseColorTexIndex]), 0);
-				mObjShader->mShader->uniform("u_HasAlbedoMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasAlbedoMap", 0);
-			}
-
-			// Normal (unit 1)
-			if (pbr.normalTexIndex >= 0 && pbr.normalTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_NormalMap", asShared(embedded[pbr.normalTexIndex]), 1);
-				mObjShader->mShader->uniform("u_HasNormalMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasNormalMap", 0);
-			}
-
-			// Metallic-Roughness (unit 2)
-			if (pbr.metallicRoughnessTexIndex >= 0 && pbr.metallicRoughnessTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_MetallicRoughnessMap", asShared(embedded[pbr.metallicRoughnessTexIndex]), 2);
-				mObjShader->mShader->uniform("u_HasMetallicRoughnessMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasMetallicRoughnessMap", 0);
-			}
+			// Draws sharing textures sort next to each other, so each batch binds its textures once
+			BuildBatches(mOpaqueMaterials, mOpaqueDraws, false);
+			mShadingBatches = mDrawBatches.size();
 
-			// Occlusion (unit 3)
-			if (pbr.occlusionTexIndex >= 0 && pbr.occlusionTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_OcclusionMap", asShared(embedded[pbr.occlusionTexIndex]), 3);
-				mObjShader->mShader->uniform("u_HasOcclusionMap", 1);
-			}
-			else
+			for (const DrawBatch& batch : mDrawBatches)
 			{
-				mObjShader->mShader->uniform("u_HasOcclusionMap", 0);
-			}
+				BindMaterialTextures(mOpaqueMaterials[mOpaqueDraws[batch.firstDraw].index]);
+				shadingState.cullFaces(!batch.doubleSided);
 
-			// Emissive (unit 4)
-			if (pbr.emissiveTexIndex >= 0 && pbr.emissiveTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_EmissiveMap", asShared(embedded[pbr.emissiveTexIndex]), 4);
-				mObjShader->mShader->uniform("u_HasEmissiveMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasEmissiveMap", 0);
-			}
+				SubmitBatch(*mObjShader->mShader, batch);
 
-			// Transmission (unit 5)
-			if (pbr.transmissionTexIndex >= 0 && pbr.transmissionTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_TransmissionTex", asShared(embedded[pbr.transmissionTexIndex]), 5);
-				mObjShader->mShader->uniform("u_HasTransmissionTex", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasTransmissionTex", 0);
+				// Whatever of the batch was held back and turned out to be visible, with the same textures
+				for (uint32_t i = batch.firstDraw; i < batch.firstDraw + batch.drawCount; ++i)
+					DrawHeldBack(*mObjShader->mShader, mOpaqueMaterials[mOpaqueDraws[i].index]);
 			}
-
-			// Material factors
-			mObjShader->mShader->uniform("u_BaseColorFactor", pbr.baseColorFactor);
-			mObjShader->mShader->uniform("u_MetallicFactor", pbr.metallicFactor);
-			mObjShader->mShader->uniform("u_RoughnessFactor", pbr.roughnessFactor);
-			mObjShader->mShader->uniform("u_NormalScale", pbr.normalScale);
-			mObjShader->mShader->uniform("u_OcclusionStrength", pbr.occlusionStrength);
-			mObjShader->mShader->uniform("u_EmissiveFactor", pbr.emissiveFactor);
-			mObjShader->mShader->uniform("u_TransmissionFactor", pbr.transmissionFactor);
-			mObjShader->mShader->uniform("u_IOR", pbr.ior);
-
-			// Alpha
-			int alphaMode = 0;
-			if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaMask)  alphaMode = 1;
-			if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaBlend) alphaMode = 2;
-			mObjShader->mShader->uniform("u_AlphaMode", alphaMode);
-			mObjShader->mShader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
-
-			if (pbr.doubleSided) glDisable(GL_CULL_FACE);
-			else glEnable(GL_CULL_FACE);
-
-			// Draw this material only
-			const GLsizei vertCount = static_cast<GLsizei>(opaqueMaterial.materialGroup.faces.size() * 3);
-			mObjShader->mShader->draw(opaqueMaterial.materialGroup.vao, vertCount);
 		}
 
 		glEnable(GL_BLEND);
 		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
 		// THEN RENDER TRANSPARENT MATERIALS
-		for (const auto& transparentMaterial : frustumCulledTransparentMaterials)
 		{
-			std::shared_ptr<Model> modelToRender = transparentMaterial.model;
-
-			const auto& pbr = transparentMaterial.materialGroup.pbr;
-			const auto& embedded = transparentMaterial.model->mModel->GetEmbeddedTextures();
+			Renderer::GpuTimerScope transparentTimer(mGpuTimers, "Transparent");
 
-			mObjShader->mShader->uniform("u_Model", transparentMaterial.transform);
+			// Only neighbours in the back to front order are merged, and a multi-draw draws its commands in order
+			BuildBatches(mTransparentMaterials, mTransparentDraws, false);
+			mShadingBatches += mDrawBatches.size();
 
-			// Albedo (unit 0)
-			if (pbr.baseColorTexIndex >= 0 && pbr.baseColorTexIndex < (int)embedded.size())
+			for (const DrawBatch& batch : mDrawBatches)
 			{
-				mObjShader->mShader->uniform("u_AlbedoMap", asShared(embedded[pbr.baseColorTexIndex]), 0);
-				mObjShader->mShader->uniform("u_HasAlbedoMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasAlbedoMap", 0);
-			}
-
-			// Normal (unit 1)
-			if (pbr.normalTexIndex >= 0 && pbr.normalTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_NormalMap", asShared(embedded[pbr.normalTexIndex]), 1);
-				mObjShader->mShader->uniform("u_HasNormalMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasNormalMap", 0);
-			}
-
-			// Metallic-Roughness (unit 2)
-			if (pbr.metallicRoughnessTexIndex >= 0 && pbr.metallicRoughnessTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_MetallicRoughnessMap", asShared(embedded[pbr.metallicRoughnessTexIndex]), 2);
-				mObjShader->mShader->uniform("u_HasMetallicRoughnessMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasMetallicRoughnessMap", 0);
-			}
+				BindMaterialTextures(mTransparentMaterials[mTransparentDraws[batch.firstDraw].index]);
+				shadingState.cullFaces(!batch.doubleSided);
 
-			// Occlusion (unit 3)
-			if (pbr.occlusionTexIndex >= 0 && pbr.occlusionTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_OcclusionMap", asShared(embedded[pbr.occlusionTexIndex]), 3);
-				mObjShader->mShader->uniform("u_HasOcclusionMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasOcclusionMap", 0);
-			}
-
-			// Emissive (unit 4)
-			if (pbr.emissiveTexIndex >= 0 && pbr.emissiveTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_EmissiveMap", asShared(embedded[pbr.emissiveTexIndex]), 4);
-				mObjShader->mShader->uniform("u_HasEmissiveMap", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasEmissiveMap", 0);
-			}
-
-			// Transmission (unit 5)
-			if (pbr.transmissionTexIndex >= 0 && pbr.transmissionTexIndex < (int)embedded.size())
-			{
-				mObjShader->mShader->uniform("u_TransmissionTex", asShared(embedded[pbr.transmissionTexIndex]), 5);
-				mObjShader->mShader->uniform("u_HasTransmissionTex", 1);
-			}
-			else
-			{
-				mObjShader->mShader->uniform("u_HasTransmissionTex", 0);
+				SubmitBatch(*mObjShader->mShader, batch);
 			}
-
-			// Material factors
-			mObjShader->mShader->uniform("u_BaseColorFactor", pbr.baseColorFactor);
-			mObjShader->mShader->uniform("u_MetallicFactor", pbr.metallicFactor);
-			mObjShader->mShader->uniform("u_RoughnessFactor", pbr.roughnessFactor);
-			mObjShader->mShader->uniform("u_NormalScale", pbr.normalScale);
-			mObjShader->mShader->uniform("u_OcclusionStrength", pbr.occlusionStrength);
-			mObjShader->mShader->uniform("u_EmissiveFactor", pbr.emissiveFactor);
-			mObjShader->mShader->uniform("u_TransmissionFactor", pbr.transmissionFactor);
-			mObjShader->mShader->uniform("u_IOR", pbr.ior);
-
-			// Alpha
-			int alphaMode = 0;
-			if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaMask)  alphaMode = 1;
-			if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaBlend) alphaMode = 2;
-			mObjShader->mShader->uniform("u_AlphaMode", alphaMode);
-			mObjShader->mShader->uniform("u_AlphaCutoff", pbr.alphaCutoff);
-
-			if (pbr.doubleSided) glDisable(GL_CULL_FACE);
-			else glEnable(GL_CULL_FACE);
-
-			// Draw this material only
-			const GLsizei vertCount = static_cast<GLsizei>(transparentMaterial.materialGroup.faces.size() * 3);
-			mObjShader->mShader->draw(transparentMaterial.materialGroup.vao, vertCount);
 		}
 
 		// States for post-process
@@ -982,58 +964,64 @@ namespace JamesEngine
 
 		if (mBloomEnabled)
 		{
-			// Bright pass, determine what contributes to bloom
-			mBrightPassScene->clear();
-			mBrightPassScene->bind();
-			glViewport(0, 0, mBrightPassScene->getWidth(), mBrightPassScene->getHeight());
-			mBrightPassShader->mShader->use();
-			mBrightPassShader->mShader->uniform("u_Scene", mShadingPass, 29);
-			mBrightPassShader->mShader->draw(mRect.get());
-
-			// Downsample and blur bright pass
+			Renderer::GpuTimerScope bloomTimer(mGpuTimers, "Bloom");
 			int usedLevels = 0;
-			std::shared_ptr<Renderer::RenderTexture> src = mBrightPassScene;
-			for (int i = 0; i < mBloomLevels; ++i)
 			{
-				auto& down = mBloomDown[i];
-				auto& temp = mBloomTemp[i];
-				auto& blur = mBloomBlur[i];
-
-				// Downsample src -> down
-				down->clear();
-				down->bind();
-				glViewport(0, 0, down->getWidth(), down->getHeight());
-				mDownsample2x->mShader->use();
-				mDownsample2x->mShader->uniform("u_RawTexture", src, 29);
-				mDownsample2x->mShader->draw(mRect.get());
-
-				// Horizontal
-				temp->clear();
-				temp->bind();
-				glViewport(0, 0, temp->getWidth(), temp->getHeight());
-				mVec3BlurShader->mShader->use();
-				mVec3BlurShader->mShader->uniform("u_Source", down);
-				mVec3BlurShader->mShader->uniform("u_InvResolution", glm::vec2(1.0f / down->getWidth(), 1.0f / down->getHeight()));
-				mVec3BlurShader->mShader->uniform("u_Direction", glm::vec2(1, 0));
-				mVec3BlurShader->mShader->draw(mRect.get());
-
-				// Vertical
-				blur->clear();
-				blur->bind();
-				glViewport(0, 0, blur->getWidth(), blur->getHeight());
-				mVec3BlurShader->mShader->use();
-				mVec3BlurShader->mShader->uniform("u_Source", temp);
-				mVec3BlurShader->mShader->uniform("u_Direction", glm::vec2(0, 1));
-				mVec3BlurShader->mShader->draw(mRect.get());
-
-				src = blur;
-				usedLevels = i + 1;
-
-				if (down->getWidth() <= mBloomMinSize || down->getHeight() <= mBloomMinSize)
-					break;
+				Renderer::GpuTimerScope bloomDownTimer(mGpuTimers, "Bloom Down");
+
+				// Bright pass, determine what contributes to bloom
+				mBrightPassScene->clear();
+				mBrightPassScene->bind();
+				glViewport(0, 0, mBrightPassScene->getWidth(), mBrightPassScene->getHeight());
+				mBrightPassShader->mShader->use();
+				mBrightPassShader->mShader->uniform("u_Scene", mShadingPass, 29);
+				mBrightPassShader->mShader->draw(mRect.get());
+
+				// Downsample and blur bright pass
+				std::shared_ptr<Renderer::RenderTexture> src = mBrightPassScene;
+				for (int i = 0; i < mBloomLevels; ++i)
+				{
+					auto& down = mBloomDown[i];
+					auto& temp = mBloomTemp[i];
+					auto& blur = mBloomBlur[i];
+
+					// Downsample src -> down
+					down->clear();
+					down->bind();
+					glViewport(0, 0, down->getWidth(), down->getHeight());
+					mDownsample2x->mShader->use();
+					mDownsample2x->mShader->uniform("u_RawTexture", src, 29);
+					mDownsample2x->mShader->draw(mRect.get());
+
+					// Horizontal
+					temp->clear();
+					temp->bind();
+					glViewport(0, 0, temp->getWidth(), temp->getHeight());
+					mVec3BlurShader->mShader->use();
+					mVec3BlurShader->mShader->uniform("u_Source", down);
+					mVec3BlurShader->mShader->uniform("u_InvResolution", glm::vec2(1.0f / down->getWidth(), 1.0f / down->getHeight()));
+					mVec3BlurShader->mShader->uniform("u_Direction", glm::vec2(1, 0));
+					mVec3BlurShader->mShader->draw(mRect.get());
+
+					// Vertical
+					blur->clear();
+					blur->bind();
+					glViewport(0, 0, blur->getWidth(), blur->getHeight());
+					mVec3BlurShader->mShader->use();
+					mVec3BlurShader->mShader->uniform("u_Source", temp);
+					mVec3BlurShader->mShader->uniform("u_Direction", glm::vec2(0, 1));
+					mVec3BlurShader->mShader->draw(mRect.get());
+
+					src = blur;
+					usedLevels = i + 1;
+
+					if (down->getWidth() <= mBloomMinSize || down->getHeight() <= mBloomMinSize)
+						break;
+				}
 			}
 
 			// Combine pyramid (smallest -> largest) into mBloom (ends up at half-res)
+			Renderer::GpuTimerScope bloomUpTimer(mGpuTimers, "Bloom Up");
 			if (usedLevels > 0)
 			{
 				int last = usedLevels - 1;
@@ -1090,263 +1078,884 @@ namespace JamesEngine
 
 
 		// COMBINE PASS
-		mCompositeScene->clear();
-		mCompositeScene->bind();
-		glViewport(0, 0, mCompositeScene->getWidth(), mCompositeScene->getHeight());
-		mCompositeShader->mShader->use();
-		mCompositeShader->mShader->uniform("u_Scene", mShadingPass, 29);
-		if (mBloomEnabled)
 		{
-			mCompositeShader->mShader->uniform("u_Bloom", mBloom, 26); // Should find a way to not eyeball the texture unit
+			Renderer::GpuTimerScope compositeTimer(mGpuTimers, "Composite");
+
+			mCompositeScene->clear();
+			mCompositeScene->bind();
+			glViewport(0, 0, mCompositeScene->getWidth(), mCompositeScene->getHeight());
+			mCompositeShader->mShader->use();
+			mCompositeShader->mShader->uniform("u_Scene", mShadingPass, 29);
+			if (mBloomEnabled)
+			{
+				mCompositeShader->mShader->uniform("u_Bloom", mBloom, 26); // Should find a way to not eyeball the texture unit
+			}
+			mCompositeShader->mShader->draw(mRect.get());
+			mCompositeScene->unbind();
 		}
-		mCompositeShader->mShader->draw(mRect.get());
-		mCompositeScene->unbind();
 
-		glViewport(0, 0, winW, winH);
-		mToneMapShader->mShader->use();
-		mToneMapShader->mShader->uniform("u_HDRScene", mCompositeScene, 29);
-		mToneMapShader->mShader->draw(mRect.get());
+		{
+			Renderer::GpuTimerScope tonemapTimer(mGpuTimers, "Tonemap");
 
-		window->ResetGLModes();
+			glViewport(0, 0, winW, winH);
+			mToneMapShader->mShader->use();
+			mToneMapShader->mShader->uniform("u_HDRScene", mCompositeScene, 29);
+			mToneMapShader->mShader->draw(mRect.get());
+		}
 
-		ClearScene();
+		window->ResetGLModes();
 	}
 
-	void SceneRenderer::AddModel(int _entityId, std::shared_ptr<Model> _model, const glm::mat4& _transform, const ShadowOverride& _shadow)
+	Handle<RenderProxy> SceneRenderer::AddProxy(int _entityId, std::shared_ptr<Model> _model, const glm::mat4& _transform, const ShadowOverride& _shadow,
+		OccluderMode _occluder)
 	{
-		auto opaque = Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque;
-		auto mask = Renderer::Model::PBRMaterial::AlphaMode::AlphaMask;
-		auto blend = Renderer::Model::PBRMaterial::AlphaMode::AlphaBlend;
+		std::shared_ptr<RenderProxy> proxy = std::make_shared<RenderProxy>();
+		proxy->entityId = _entityId;
+		proxy->model = _model;
+		proxy->shadow = _shadow;
+		proxy->occluder = _occluder;
+		proxy->transform = _transform;
 
-		uint32_t materialGroupIndex = 0; // For occlusion hash
-		for (const auto& materialGroup : _model->mModel->GetMaterialGroups())
-		{
-			materialGroupIndex++;
+		// Removed proxies' records have to go first, so this one's runs are at the end of each list
+		if (mProxiesRemoved)
+			RebuildMaterialLists();
 
-			uint64_t occlusionKey = (uint64_t(_entityId) << 32) | uint64_t(materialGroupIndex);
+		AddProxyMaterials(*proxy);
 
-			const auto& pbr = materialGroup.pbr;
+		return mProxies.Insert(proxy);
+	}
 
-			if (pbr.alphaMode == opaque || pbr.alphaMode == mask)
-			{
-				mOpaqueMaterials.push_back({ const_cast<Renderer::Model::MaterialGroup&>(materialGroup), _model, _transform, occlusionKey });
-			}
-			else if (pbr.alphaMode == blend)
-			{
-				mTransparentMaterials.push_back({ const_cast<Renderer::Model::MaterialGroup&>(materialGroup), _model, _transform, occlusionKey });
-			}
+	void SceneRenderer::UpdateProxy(Handle<RenderProxy> _proxy, const glm::mat4& _transform)
+	{
+		std::shared_ptr<RenderProxy> proxy = mProxies.Get(_proxy);
+		if (!proxy)
+			return;
 
-			auto [iterator, inserted] = mOcclusionCache.try_emplace(occlusionKey, OcclusionInfo{}); // Adds if not already there
-			OcclusionInfo& occlusionInfo = iterator->second;
+		proxy->transform = _transform;
 
-			if (inserted)
+		// The trees are refit in place, unless they are about to be rebuilt anyway
+		auto move = [&](std::vector<MaterialRenderInfo>& _materials, Renderer::Bvh& _bvh, uint32_t _first, uint32_t _count)
 			{
-				glGenQueries(2, occlusionInfo.queryIds);
-			}
+				for (uint32_t i = _first; i < _first + _count; ++i)
+				{
+					_materials[i].transform = _transform;
+					_materials[i].pvsItem = PvsItem(_materials[i]);
+					if (!mBvhsDirty)
+						_bvh.refit(i, WorldBounds(_materials[i]));
+				}
+			};
 
-			occlusionInfo.lastFrameSubmitted = mFrameIndex;
+		move(mOpaqueMaterials, mOpaqueBvh, proxy->firstOpaque, proxy->opaqueCount);
+		move(mTransparentMaterials, mTransparentBvh, proxy->firstTransparent, proxy->transparentCount);
+		move(mShadowMaterials, mShadowBvh, proxy->firstShadow, proxy->shadowCount);
+	}
 
-			if (_shadow.mode != ShadowMode::Proxy)
+	void SceneRenderer::RemoveProxy(Handle<RenderProxy> _proxy)
+	{
+		std::shared_ptr<RenderProxy> proxy = mProxies.Get(_proxy);
+		if (!proxy)
+			return;
+
+		for (size_t i = 0; i < proxy->model->mModel->GetMaterialGroups().size(); ++i)
+		{
+			uint64_t occlusionKey = (uint64_t(proxy->entityId) << 32) | uint64_t(i + 1);
+			mLodSelections.erase(occlusionKey);
+		}
+
+		mProxies.Remove(_proxy);
+
+		// Removals usually come in bunches (a whole level unloading), so the lists are compacted once before they are next used
+		mProxiesRemoved = true;
+	}
+
+	void SceneRenderer::AddProxyMaterials(RenderProxy& _proxy)
+	{
+		auto opaque = Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque;
+		auto mask = Renderer::Model::PBRMaterial::AlphaMode::AlphaMask;
+		auto blend = Renderer::Model::PBRMaterial::AlphaMode::AlphaBlend;
+
+		_proxy.firstOpaque = (uint32_t)mOpaqueMaterials.size();
+		_proxy.firstTransparent = (uint32_t)mTransparentMaterials.size();
+		_proxy.firstShadow = (uint32_t)mShadowMaterials.size();
+
+		// A PVS is checked against its model the first time the model is added, it has loaded by then
+		if (mPvs && _proxy.model == mPvsModel && !mPvsValidated)
+			ValidatePvs();
+		if (mPvs && _proxy.model == mPvsModel && !MatchesPvsTransform(_proxy.transform))
+			std::cout << "PVS for " << mPvsModel->GetPath() << " was baked with the model placed somewhere else, not using it for entity " << _proxy.entityId << std::endl;
+
+		const uint32_t materialBase = MaterialTableBase(_proxy.model);
+
+		uint32_t materialGroupIndex = 0; // For occlusion hash
+		for (const auto& materialGroup : _proxy.model->mModel->GetMaterialGroups())
+		{
+			materialGroupIndex++;
+
+			uint64_t occlusionKey = (uint64_t(_proxy.entityId) << 32) | uint64_t(materialGroupIndex);
+
+			const auto& pbr = materialGroup.pbr;
+
+			MaterialRenderInfo material{ const_cast<Renderer::Model::MaterialGroup&>(materialGroup), _proxy.model, _proxy.transform, occlusionKey, _proxy.occluder };
+			ResolveTextures(material);
+			material.material = materialBase + materialGroupIndex - 1;
+			material.pvsItem = PvsItem(material);
+
+			if (pbr.alphaMode == opaque || pbr.alphaMode == mask)
+			{
+				mOpaqueMaterials.push_back(material);
+			}
+			else if (pbr.alphaMode == blend)
 			{
-				mShadowMaterials.push_back({ const_cast<Renderer::Model::MaterialGroup&>(materialGroup), _model, _transform, occlusionKey });
+				mTransparentMaterials.push_back(material);
+			}
+
+			if (_proxy.shadow.mode != ShadowMode::Proxy)
+			{
+				mShadowMaterials.push_back(material);
 			}
 		}
 
-		if (_shadow.mode == ShadowMode::Proxy)
+		if (_proxy.shadow.mode == ShadowMode::Proxy)
 		{
-			for (const auto& materialGroup : _shadow.proxy->mModel->GetMaterialGroups())
+			const uint32_t shadowBase = MaterialTableBase(_proxy.shadow.proxy);
+
+			const auto& groups = _proxy.shadow.proxy->mModel->GetMaterialGroups();
+			for (size_t i = 0; i < groups.size(); ++i)
 			{
-				mShadowMaterials.push_back({ const_cast<Renderer::Model::MaterialGroup&>(materialGroup), _shadow.proxy, _transform });
+				MaterialRenderInfo material{ const_cast<Renderer::Model::MaterialGroup&>(groups[i]), _proxy.shadow.proxy, _proxy.transform };
+				ResolveTextures(material);
+				material.material = shadowBase + uint32_t(i);
+				mShadowMaterials.push_back(material);
 			}
 		}
+
+		_proxy.opaqueCount = (uint32_t)mOpaqueMaterials.size() - _proxy.firstOpaque;
+		_proxy.transparentCount = (uint32_t)mTransparentMaterials.size() - _proxy.firstTransparent;
+		_proxy.shadowCount = (uint32_t)mShadowMaterials.size() - _proxy.firstShadow;
+
+		mBvhsDirty = true;
+	}
+
+	void SceneRenderer::SetPvs(std::shared_ptr<Model> _model, std::shared_ptr<Renderer::Pvs> _pvs)
+	{
+		for (std::vector<MaterialRenderInfo>* materials : { &mOpaqueMaterials, &mTransparentMaterials })
+		{
+			for (MaterialRenderInfo& material : *materials)
+				material.pvsItem = -1;
+		}
+
+		mPvsModel = _pvs ? _model : nullptr;
+		mPvs = _model ? _pvs : nullptr;
+		mPvsValidated = false;
+
+		// Otherwise checked once the model has loaded and been added
+		if (mPvs && mPvsModel->IsLoaded())
+		{
+			ValidatePvs();
+			if (mPvs)
+				AssignPvsItems();
+		}
 	}
 
-	void SceneRenderer::ClearScene()
+	void SceneRenderer::ValidatePvs()
+	{
+		const auto& groups = mPvsModel->mModel->GetMaterialGroups();
+		if (mPvs->itemCount() != groups.size() || mPvs->sourceKey() != Renderer::Pvs::sourceKey(*mPvsModel->mModel))
+		{
+			std::cout << "PVS was baked from a different version of " << mPvsModel->GetPath() << ", not using it" << std::endl;
+			mPvs = nullptr;
+			mPvsModel = nullptr;
+			return;
+		}
+
+		mPvsValidated = true;
+	}
+
+	void SceneRenderer::AssignPvsItems()
+	{
+		for (std::vector<MaterialRenderInfo>* materials : { &mOpaqueMaterials, &mTransparentMaterials })
+		{
+			for (MaterialRenderInfo& material : *materials)
+				material.pvsItem = PvsItem(material);
+		}
+	}
+
+	bool SceneRenderer::MatchesPvsTransform(const glm::mat4& _transform) const
+	{
+		// Anything more than float noise means the model has moved since the bake
+		const glm::mat4& baked = mPvs->transform();
+		for (int c = 0; c < 4; ++c)
+		{
+			if (glm::any(glm::greaterThan(glm::abs(_transform[c] - baked[c]), glm::vec4(1e-3f))))
+				return false;
+		}
+		return true;
+	}
+
+	int SceneRenderer::PvsItem(const MaterialRenderInfo& _material) const
+	{
+		if (!mPvs || !mPvsValidated || _material.model != mPvsModel || !MatchesPvsTransform(_material.transform))
+			return -1;
+
+		// Groups are stored in one vector, so the index falls out of the address
+		const auto& groups = mPvsModel->mModel->GetMaterialGroups();
+		return int(&_material.materialGroup - groups.data());
+	}
+
+	void SceneRenderer::RebuildMaterialLists()
 	{
 		mOpaqueMaterials.clear();
 		mTransparentMaterials.clear();
 		mShadowMaterials.clear();
+
+		// Removed models drop out of the material table too
+		mMaterialBases.clear();
+		mMaterialModels.clear();
+		mMaterialCount = 0;
+
+		mProxies.ForEach([&](RenderProxy& _proxy) { AddProxyMaterials(_proxy); });
+
+		mProxiesRemoved = false;
 	}
 
-	std::vector<MaterialRenderInfo> SceneRenderer::FrustumCulledMaterials(
-		const std::vector<MaterialRenderInfo>& _materials,
-		const glm::mat4& _view,
-		const glm::mat4& _proj)
+	uint32_t SceneRenderer::MaterialTableBase(const std::shared_ptr<Model>& _model)
+	{
+		auto it = mMaterialBases.find(_model.get());
+		if (it != mMaterialBases.end())
+			return it->second;
+
+		const uint32_t base = mMaterialCount;
+		mMaterialBases[_model.get()] = base;
+		mMaterialModels.push_back(_model);
+		mMaterialCount += uint32_t(_model->mModel->GetMaterialGroups().size());
+		mMaterialTableDirty = true;
+		return base;
+	}
+
+	void SceneRenderer::UploadMaterialTable()
 	{
-		struct Plane
+		JAMES_PROFILE_ZONE("SceneRenderer::UploadMaterialTable");
+
+		const GLsizeiptr stride = Renderer::Model::kMaterialDataSize;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, mMaterialBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, std::max<GLsizeiptr>(mMaterialCount * stride, stride), nullptr, GL_STATIC_DRAW);
+
+		// Copied on the GPU from each model's own buffer, so the factors are never rebuilt on the CPU
+		mMaterialTableDirty = false;
+		for (const std::shared_ptr<Model>& model : mMaterialModels)
 		{
-			glm::vec3 n;
-			float d; // plane: nx + d >= 0 => inside
-		};
+			const GLuint source = model->mModel->material_buffer();
+			const size_t groupCount = model->mModel->GetMaterialGroups().size();
+			if (groupCount == 0)
+				continue;
 
-		const glm::mat4 VP = _proj * _view;
+			// Not uploaded yet, tried again next frame
+			if (!source)
+			{
+				mMaterialTableDirty = true;
+				continue;
+			}
 
-		// Extract rows from column-major matrix
-		auto getRow = [&](int r)
+			glBindBuffer(GL_COPY_READ_BUFFER, source);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, mMaterialBases[model.get()] * stride, groupCount * stride);
+		}
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void SceneRenderer::UpdateBvhs()
+	{
+		auto update = [&](const std::vector<MaterialRenderInfo>& _materials, Renderer::Bvh& _bvh)
 			{
-				return glm::vec4(VP[0][r], VP[1][r], VP[2][r], VP[3][r]);
+				if (!mBvhsDirty && _bvh.refitCount() <= _bvh.size())
+					return;
+
+				std::vector<Renderer::Aabb> bounds(_materials.size());
+				for (size_t i = 0; i < _materials.size(); ++i)
+					bounds[i] = WorldBounds(_materials[i]);
+
+				_bvh.build(bounds);
 			};
 
-		const glm::vec4 row0 = getRow(0);
-		const glm::vec4 row1 = getRow(1);
-		const glm::vec4 row2 = getRow(2);
-		const glm::vec4 row3 = getRow(3);
+		update(mOpaqueMaterials, mOpaqueBvh);
+		update(mTransparentMaterials, mTransparentBvh);
+		update(mShadowMaterials, mShadowBvh);
 
-		Plane planes[6] = {
-			{ glm::vec3(row3 + row0), (row3 + row0).w }, // Left
-			{ glm::vec3(row3 - row0), (row3 - row0).w }, // Right
-			{ glm::vec3(row3 + row1), (row3 + row1).w }, // Bottom
-			{ glm::vec3(row3 - row1), (row3 - row1).w }, // Top
-			{ glm::vec3(row3 + row2), (row3 + row2).w }, // Near
-			{ glm::vec3(row3 - row2), (row3 - row2).w }, // Far
-		};
+		mBvhsDirty = false;
+	}
 
-		// Normalise planes
-		for (Plane& p : planes)
+	Renderer::Aabb SceneRenderer::WorldBounds(const MaterialRenderInfo& _material)
+	{
+		const glm::mat4& M = _material.transform;
+		const glm::vec3 center = glm::vec3(M * glm::vec4(_material.materialGroup.boundsCenterMS, 1.0f));
+
+		// Each world axis extent is the model space half extents projected onto it
+		const glm::mat3 A = glm::mat3(M);
+		const glm::vec3 e = _material.materialGroup.boundsHalfExtentsMS;
+		const glm::vec3 extent = glm::abs(A[0]) * e.x + glm::abs(A[1]) * e.y + glm::abs(A[2]) * e.z;
+
+		return { center - extent, center + extent };
+	}
+
+	void SceneRenderer::ResolveTextures(MaterialRenderInfo& _material)
+	{
+		const auto& pbr = _material.materialGroup.pbr;
+		const auto& embedded = _material.model->mModel->GetEmbeddedTextures();
+
+		const int indices[6] = { pbr.baseColorTexIndex, pbr.normalTexIndex, pbr.metallicRoughnessTexIndex,
+			pbr.occlusionTexIndex, pbr.emissiveTexIndex, pbr.transmissionTexIndex };
+
+		uint32_t hash = 2166136261u;
+		for (int i = 0; i < 6; ++i)
 		{
-			float invLen = 1.0f / glm::length(p.n);
-			p.n *= invLen;
-			p.d *= invLen;
+			_material.textures[i] = (indices[i] >= 0 && indices[i] < (int)embedded.size()) ? embedded[indices[i]].id() : 0;
+			hash = (hash ^ _material.textures[i]) * 16777619u;
 		}
 
-		std::vector<MaterialRenderInfo> result;
-		result.reserve(_materials.size());
+		_material.textureSet = (uint16_t)(hash ^ (hash >> 16));
+	}
 
-		for (size_t i = 0; i < _materials.size(); ++i)
+	void SceneRenderer::SelectLods(std::vector<MaterialRenderInfo>& _materials, const glm::vec3& _camPos, float _pixelsPerUnit)
+	{
+		for (MaterialRenderInfo& material : _materials)
 		{
-			const auto& it = _materials[i];
+			material.commandCount = -1; // Until BuildCommands this frame
+			material.hiZCommandCount = 0;
 
-			const glm::mat4  M = it.transform;
-			const glm::vec3  e = it.materialGroup.boundsHalfExtentsMS;
-			const glm::vec3  cMS = it.materialGroup.boundsCenterMS;
-			const glm::vec3  cW = glm::vec3(M * glm::vec4(cMS, 1.0f));
-			const glm::mat3  A = glm::mat3(M); // columns are world axes * scale
+			const auto& lods = material.materialGroup.lods;
+			if (lods.size() < 2)
+			{
+				material.lod = 0;
+				continue;
+			}
 
-			// Conservative frustum cull (OBB vs plane SAT, world-space planes)
-			bool culled = false;
-			for (const Plane& pl : planes)
+			// Errors are in model units, scale by the largest axis so a stretched model never gets too coarse
+			const glm::mat3 basis(material.transform);
+			const float scale = std::max({ glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]) });
+
+			const glm::vec3 centerWS = glm::vec3(material.transform * glm::vec4(material.materialGroup.boundsCenterMS, 1.0f));
+			const float radiusWS = material.materialGroup.boundsSphereRadiusMS * scale;
+			const float distance = std::max(glm::length(centerWS - _camPos) - radiusWS, 0.01f);
+
+			auto previousIterator = mLodSelections.find(material.occlusionKey);
+			const int previous = (previousIterator != mLodSelections.end()) ? previousIterator->second : 0;
+
+			// Errors only grow with each level. Going coarser than last frame needs a bit of margin, going finer happens straight away
+			int lod = 0;
+			for (int i = 1; i < (int)lods.size(); ++i)
 			{
-				const float r =
-					std::abs(glm::dot(pl.n, A[0])) * e.x +
-					std::abs(glm::dot(pl.n, A[1])) * e.y +
-					std::abs(glm::dot(pl.n, A[2])) * e.z;
+				float pixels = lods[i].error * scale * _pixelsPerUnit / distance;
+				float threshold = (i > previous) ? mLodPixelError * mLodHysteresis : mLodPixelError;
+				if (pixels > threshold)
+					break;
 
-				const float s = glm::dot(pl.n, cW) + pl.d;
+				lod = i;
+			}
 
-				if (s < -r)
+			material.lod = lod;
+			mLodSelections[material.occlusionKey] = lod;
+		}
+	}
+
+	int SceneRenderer::ShadowLod(const MaterialRenderInfo& _material, float _worldUnitsPerTexel) const
+	{
+		const auto& lods = _material.materialGroup.lods;
+
+		const glm::mat3 basis(_material.transform);
+		const float scale = std::max({ glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]) });
+
+		// Orthographic, so the error in texels is the same at any distance
+		int lod = 0;
+		for (int i = 1; i < (int)lods.size(); ++i)
+		{
+			if (lods[i].error * scale > mShadowLodTexelError * _worldUnitsPerTexel)
+				break;
+
+			lod = i;
+		}
+
+		return lod;
+	}
+
+	void SceneRenderer::BuildCommands(std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws, bool _cullMeshlets, const glm::mat4& _view, const glm::mat4& _proj,
+		const glm::vec3& _camPos, const Renderer::HiZSnapshot* _hiZ)
+	{
+		const glm::mat4 VP = _proj * _view;
+
+		// Same world space planes as BuildDrawList
+		glm::vec4 planes[6];
+		for (int i = 0; i < 3; ++i)
+		{
+			glm::vec4 row(VP[0][i], VP[1][i], VP[2][i], VP[3][i]);
+			glm::vec4 row3(VP[0][3], VP[1][3], VP[2][3], VP[3][3]);
+			planes[i * 2] = row3 + row;
+			planes[i * 2 + 1] = row3 - row;
+		}
+		for (glm::vec4& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		for (const Renderer::SortItem& draw : _draws)
+		{
+			MaterialRenderInfo& material = _materials[draw.index];
+			const auto& group = material.materialGroup;
+
+			// Held back whole already
+			material.firstCommand = int(mDrawCommands.size());
+			if (material.commandCount == 0)
+				continue;
+
+			// Nothing to split
+			if (!_cullMeshlets || material.lod != 0 || group.meshlets.size() < 2)
+			{
+				mDrawCommands.push_back(LodCommand(material, material.lod));
+				material.commandCount = 1;
+				continue;
+			}
+
+			const glm::mat3 basis(material.transform);
+			const glm::vec3 axisScale(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+			const float scale = std::max({ axisScale.x, axisScale.y, axisScale.z });
+
+			// Cones only hold under rotation and uniform scale. A mirrored transform also flips which side is the front
+			const bool uniformScale = std::max({ axisScale.x, axisScale.y, axisScale.z }) <= 1.001f * std::min({ axisScale.x, axisScale.y, axisScale.z });
+			const bool coneCulling = !group.pbr.doubleSided && uniformScale && glm::determinant(basis) > 0.0f;
+
+			// The planes brought into model space and divided by the scale, so the meshlets' model space spheres are tested as they would be in world space
+			const glm::mat4 toModel = glm::transpose(material.transform) / scale;
+			glm::vec4 planesMS[6];
+			for (int i = 0; i < 6; ++i)
+				planesMS[i] = toModel * planes[i];
+
+			mMeshletVisibility.resize(Renderer::cullMaskWords(group.meshlets.size()));
+			Renderer::cullSpheres(planesMS, 6, group.meshletSpheres, 0, group.meshlets.size(), mMeshletVisibility.data());
+
+			for (size_t m = 0; m < group.meshlets.size(); ++m)
+			{
+				const Renderer::Meshlet& meshlet = group.meshlets[m];
+				mMeshletsTested++;
+
+				bool culled = !Renderer::cullMaskTest(mMeshletVisibility.data(), m);
+
+				const glm::vec3 centerWS = glm::vec3(material.transform * glm::vec4(meshlet.center, 1.0f));
+				const float radiusWS = meshlet.radius * scale;
+
+				// Back facing as a whole when the camera is behind every triangle's plane, anywhere in the bounding sphere
+				if (!culled && coneCulling && meshlet.coneCutoff < 1.0f)
 				{
-					culled = true;
-					break;
+					const glm::vec3 axisWS = basis * meshlet.coneAxis / scale;
+					const glm::vec3 toCenter = centerWS - _camPos;
+					if (glm::dot(toCenter, axisWS) >= meshlet.coneCutoff * glm::length(toCenter) + radiusWS)
+						culled = true;
 				}
+
+				if (culled)
+				{
+					mMeshletsCulled++;
+					continue;
+				}
+
+				if (_hiZ && !_hiZ->isVisible(centerWS - glm::vec3(radiusWS), centerWS + glm::vec3(radiusWS)))
+				{
+					HoldBack(material, { centerWS - glm::vec3(radiusWS), centerWS + glm::vec3(radiusWS) }, meshlet.indexOffset, meshlet.indexCount);
+					mMeshletsHeldBack++;
+					continue;
+				}
+
+				// Meshlets are back to back in the index buffer, so one that follows the last visible one just extends its command
+				const DrawCommand command = MakeCommand(material, meshlet.indexOffset, meshlet.indexCount);
+				if (int(mDrawCommands.size()) > material.firstCommand && mDrawCommands.back().firstIndex + mDrawCommands.back().count == command.firstIndex)
+					mDrawCommands.back().count += command.count;
+				else
+					mDrawCommands.push_back(command);
 			}
 
-			if (culled)
+			material.commandCount = int(mDrawCommands.size()) - material.firstCommand;
+		}
+	}
+
+	void SceneRenderer::BindMaterialTextures(const MaterialRenderInfo& _material)
+	{
+		auto& shader = *mObjShader->mShader;
+		const MaterialUniforms& uniforms = mMaterialUniforms;
+
+		// Texture units 0 to 5, the material's has flags tell the shader which to sample. Draws are sorted by texture set, so most of these are already bound
+		const Renderer::UniformHandle<int> samplers[6] = { uniforms.albedoMap, uniforms.normalMap, uniforms.metallicRoughnessMap,
+			uniforms.occlusionMap, uniforms.emissiveMap, uniforms.transmissionTex };
+
+		for (int unit = 0; unit < 6; ++unit)
+		{
+			const GLuint texture = _material.textures[unit];
+			if (texture == 0 || texture == mBoundTextures[unit])
 				continue;
 
-			// Survived culling: keep in original order
-			result.push_back(it);
+			shader.uniform(samplers[unit], unit);
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			mBoundTextures[unit] = texture;
 		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void SceneRenderer::DrawMaterial(Renderer::Shader& _shader, const MaterialRenderInfo& _material)
+	{
+		// Held back whole, or every meshlet culled
+		if (_material.commandCount <= 0)
+			return;
 
-		return result;
+		_shader.drawIndirect(_material.materialGroup, mDrawCommandBuffer, size_t(_material.firstCommand), GLsizei(_material.commandCount));
 	}
 
-	std::vector<MaterialRenderInfo> SceneRenderer::FrustumCulledDistanceSortedMaterials(
-		const std::vector<MaterialRenderInfo>& _materials,
-		const glm::mat4& _view,
-		const glm::mat4& _proj,
-		const glm::vec3& _posWS,
-		DepthSortMode _mode)
+	void SceneRenderer::SubmitBatch(Renderer::Shader& _shader, const DrawBatch& _batch)
+	{
+		_shader.multiDrawIndirect(_batch.vao, mDrawCommandBuffer, size_t(_batch.firstCommand), GLsizei(_batch.commandCount));
+	}
+
+	void SceneRenderer::AddDrawData(MaterialRenderInfo& _material)
 	{
-		struct Plane
+		const auto& group = _material.materialGroup;
+
+		DrawData data{};
+		data.model = _material.transform;
+		data.positionScale = glm::vec4(group.positionScale, 0.0f);
+		data.positionOffset = glm::vec4(group.positionOffset, 0.0f);
+		data.material = _material.material;
+		data.octNormals = group.octNormals ? 1 : 0;
+
+		_material.drawSlot = uint32_t(mDrawData.size());
+		mDrawData.push_back(data);
+	}
+
+	SceneRenderer::DrawCommand SceneRenderer::MakeCommand(const MaterialRenderInfo& _material, uint32_t _firstIndex, uint32_t _indexCount)
+	{
+		const auto& geometry = _material.materialGroup.geometry;
+		return { _indexCount, 1, geometry.firstIndex + _firstIndex, GLint(geometry.firstVertex), _material.drawSlot };
+	}
+
+	SceneRenderer::DrawCommand SceneRenderer::LodCommand(const MaterialRenderInfo& _material, int _lod)
+	{
+		const auto& group = _material.materialGroup;
+		if (group.lods.empty())
+			return MakeCommand(_material, 0, uint32_t(group.indexCount));
+
+		const auto& level = group.lods[std::clamp(_lod, 0, int(group.lods.size()) - 1)];
+		return MakeCommand(_material, level.indexOffset, uint32_t(level.indexCount));
+	}
+
+	void SceneRenderer::BuildBatches(const std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws, bool _depthOnly)
+	{
+		mDrawBatches.clear();
+
+		for (uint32_t i = 0; i < uint32_t(_draws.size()); ++i)
 		{
-			glm::vec3 n;
-			float d; // plane: nx + d >= 0 => inside
-		};
+			const MaterialRenderInfo& material = _materials[_draws[i].index];
+			const auto& group = material.materialGroup;
+
+			const uint32_t commandCount = uint32_t(std::max(material.commandCount, 0));
+			if (_depthOnly)
+			{
+				if (commandCount == 0 || group.pbr.alphaMode != Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque)
+					continue;
+			}
+			else if (commandCount == 0 && material.hiZCommandCount == 0)
+			{
+				continue;
+			}
+
+			// Runs are in draw order, so the next draw that isn't left out has the commands straight after the batch's.
+			// An alpha tested draw left out of a depth batch has commands of its own, which ends the batch
+			if (!mDrawBatches.empty())
+			{
+				DrawBatch& batch = mDrawBatches.back();
+				const MaterialRenderInfo& first = _materials[_draws[batch.firstDraw].index];
+
+				if (batch.vao == group.vao && batch.doubleSided == group.pbr.doubleSided && batch.firstCommand + batch.commandCount == uint32_t(material.firstCommand)
+					&& (_depthOnly || first.textures == material.textures))
+				{
+					batch.drawCount = i - batch.firstDraw + 1;
+					batch.commandCount += commandCount;
+					continue;
+				}
+			}
 
-		struct DepthKey
+			DrawBatch batch;
+			batch.vao = group.vao;
+			batch.doubleSided = group.pbr.doubleSided;
+			batch.firstDraw = i;
+			batch.drawCount = 1;
+			batch.firstCommand = uint32_t(material.firstCommand);
+			batch.commandCount = commandCount;
+			mDrawBatches.push_back(batch);
+		}
+	}
+
+	void SceneRenderer::UploadDraws()
+	{
+		// Orphaned every pass, so a pass never waits for the GPU to finish with the last one's
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, mDrawData.size() * sizeof(DrawData), mDrawData.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mDrawCommandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, mDrawCommands.size() * sizeof(DrawCommand), mDrawCommands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mDrawDataBuffer);
+	}
+
+	void SceneRenderer::HoldBackOccludedMaterials(std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws)
+	{
+		JAMES_PROFILE_ZONE("SceneRenderer::HoldBackOccludedMaterials");
+
+		const Renderer::HiZSnapshot& hiZ = mHiZ.snapshot();
+
+		for (const Renderer::SortItem& draw : _draws)
 		{
-			float  primary;      // zMax or zMin
-			float  farthest;     // distance^2 to farthest corner (when cameraInside)
-			bool   cameraInside; // true if camera is inside this OBB
-			size_t index;        // index into material array
-		};
+			MaterialRenderInfo& material = _materials[draw.index];
 
-		const glm::mat4 VP = _proj * _view;
+			const Renderer::Aabb bounds = WorldBounds(material);
+			if (hiZ.isVisible(bounds.min, bounds.max))
+				continue;
 
-		// Extract rows from column-major matrix
-		auto getRow = [&](int r)
+			const auto& lods = material.materialGroup.lods;
+			if (lods.empty())
 			{
-				return glm::vec4(VP[0][r], VP[1][r], VP[2][r], VP[3][r]);
-			};
+				HoldBack(material, bounds, 0, uint32_t(material.materialGroup.indexCount));
+			}
+			else
+			{
+				const auto& level = lods[std::clamp(material.lod, 0, int(lods.size()) - 1)];
+				HoldBack(material, bounds, level.indexOffset, uint32_t(level.indexCount));
+			}
 
-		const glm::vec4 row0 = getRow(0);
-		const glm::vec4 row1 = getRow(1);
-		const glm::vec4 row2 = getRow(2);
-		const glm::vec4 row3 = getRow(3);
+			// Nothing drawn directly, BuildCommands gives it an empty run
+			material.commandCount = 0;
+			mMaterialsHeldBack++;
+		}
+	}
 
-		Plane planes[6] = {
-			{ glm::vec3(row3 + row0), (row3 + row0).w }, // Left
-			{ glm::vec3(row3 - row0), (row3 - row0).w }, // Right
-			{ glm::vec3(row3 + row1), (row3 + row1).w }, // Bottom
-			{ glm::vec3(row3 - row1), (row3 - row1).w }, // Top
-			{ glm::vec3(row3 + row2), (row3 + row2).w }, // Near
-			{ glm::vec3(row3 - row2), (row3 - row2).w }, // Far
-		};
+	void SceneRenderer::HoldBack(MaterialRenderInfo& _material, const Renderer::Aabb& _bounds, uint32_t _firstIndex, uint32_t _indexCount)
+	{
+		// A material's commands are always added together, so they stay one contiguous run
+		if (_material.hiZCommandCount == 0)
+			_material.firstHiZCommand = uint32_t(mHiZCommands.size());
+
+		mHiZCandidates.push_back({ glm::vec4(_bounds.min, 0.0f), glm::vec4(_bounds.max, 0.0f) });
+		// Off until the GPU finds it visible
+		DrawCommand command = MakeCommand(_material, _firstIndex, _indexCount);
+		command.instanceCount = 0;
+		mHiZCommands.push_back(command);
+		_material.hiZCommandCount++;
+	}
 
-		// Normalise planes
-		for (Plane& p : planes)
+	void SceneRenderer::CullHeldBack(const glm::mat4& _viewProj)
+	{
+		JAMES_PROFILE_ZONE("SceneRenderer::CullHeldBack");
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mHiZCandidateBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, mHiZCandidates.size() * sizeof(HiZCandidate), mHiZCandidates.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, mHiZCommandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, mHiZCommands.size() * sizeof(DrawCommand), mHiZCommands.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mHiZCandidateBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mHiZCommandBuffer);
+
+		auto& cullShader = *mHiZCullShader->mShader;
+		cullShader.use();
+		cullShader.uniform("u_ViewProj", _viewProj);
+		cullShader.uniform("u_ScreenSize", glm::vec2(mHiZ.screenSize()));
+		cullShader.uniform("u_HiZ", mHiZ.texture(), 0);
+
+		// One point per candidate, the vertex shader writes its command's instance count and nothing is rasterised
+		glEnable(GL_RASTERIZER_DISCARD);
+		glBindVertexArray(mPointVao);
+		glDrawArrays(GL_POINTS, 0, GLsizei(mHiZCandidates.size()));
+		glBindVertexArray(0);
+		glDisable(GL_RASTERIZER_DISCARD);
+
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	}
+
+	void SceneRenderer::DrawHeldBack(Renderer::Shader& _shader, const MaterialRenderInfo& _material)
+	{
+		if (_material.hiZCommandCount == 0)
+			return;
+
+		_shader.drawIndirect(_material.materialGroup, mHiZCommandBuffer, size_t(_material.firstHiZCommand), GLsizei(_material.hiZCommandCount));
+	}
+
+	bool SceneRenderer::IsOccluder(const MaterialRenderInfo& _material, const glm::vec3& _camPos) const
+	{
+		const auto& group = _material.materialGroup;
+		if (group.pbr.alphaMode != Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque || group.vertexCount == 0)
+			return false;
+
+		switch (_material.occluder)
 		{
-			float invLen = 1.0f / glm::length(p.n);
-			p.n *= invLen;
-			p.d *= invLen;
+		case OccluderMode::Never:
+			return false;
+		case OccluderMode::Always:
+			return true;
+		case OccluderMode::Auto:
+			break;
 		}
 
-		// Helper: is camera inside this OBB (bounds in model space, transform to world)
-		auto IsCameraInsideOBB = [&](const glm::mat4& M,
-			const glm::vec3& centerMS,
-			const glm::vec3& halfExtentsMS) -> bool
-			{
-				glm::mat4 invM = glm::inverse(M);
-				glm::vec3 camMS = glm::vec3(invM * glm::vec4(_posWS, 1.0f));
+		const int lod = group.lods.empty() ? 0 : std::clamp(_material.lod, 0, int(group.lods.size()) - 1);
+		const size_t indexCount = group.lods.empty() ? size_t(group.indexCount) : size_t(group.lods[lod].indexCount);
+		if (indexCount > kMaxAutoOccluderTriangles * 3)
+			return false;
 
-				glm::vec3 d = camMS - centerMS;
-				return std::abs(d.x) <= halfExtentsMS.x &&
-					std::abs(d.y) <= halfExtentsMS.y &&
-					std::abs(d.z) <= halfExtentsMS.z;
-			};
+		const glm::mat4& M = _material.transform;
+		const float scale = std::max({ glm::length(glm::vec3(M[0])), glm::length(glm::vec3(M[1])), glm::length(glm::vec3(M[2])) });
+		const float radius = group.boundsSphereRadiusMS * scale;
+		const float distance = glm::length(glm::vec3(M * glm::vec4(group.boundsCenterMS, 1.0f)) - _camPos);
 
-		// Helper: squared distance to farthest corner of OBB from camera
-		auto FarthestCornerDistSq = [&](const glm::mat4& M,
-			const glm::vec3& centerMS,
-			const glm::vec3& halfExtentsMS) -> float
+		return distance <= radius || radius >= mAutoOccluderSize * distance;
+	}
+
+	void SceneRenderer::CullSoftwareOcclusion(const glm::mat4& _viewProj, const glm::vec3& _camPos)
+	{
+		const int height = std::max(mShadingPass->getHeight(), 1);
+		mOcclusionRasterizer.resize(kOcclusionBufferWidth, kOcclusionBufferWidth * height / std::max(mShadingPass->getWidth(), 1));
+		mOcclusionRasterizer.beginFrame(_viewProj);
+
+		// Occluders are drawn at the LOD picked for the screen, so they hide no more than what is actually drawn would
+		for (const Renderer::SortItem& draw : mOpaqueDraws)
+		{
+			const MaterialRenderInfo& material = mOpaqueMaterials[draw.index];
+			if (!IsOccluder(material, _camPos))
+				continue;
+
+			const auto& group = material.materialGroup;
+			uint32_t firstIndex = 0;
+			size_t indexCount = size_t(group.indexCount);
+			if (!group.lods.empty())
 			{
-				float maxDist2 = 0.0f;
+				const auto& level = group.lods[std::clamp(material.lod, 0, int(group.lods.size()) - 1)];
+				firstIndex = level.indexOffset;
+				indexCount = size_t(level.indexCount);
+			}
+
+			mOcclusionRasterizer.addOccluder(material.transform, &group.vertex_data()->position.x, sizeof(Renderer::Model::Vertex),
+				group.index_data() + firstIndex, indexCount, group.pbr.doubleSided);
+		}
+
+		mOccludersRasterised = mOcclusionRasterizer.occluderCount();
+		mOccluderTriangles = 0;
+		mSoftwareOccluded = 0;
 
-				for (int sx = -1; sx <= 1; sx += 2)
+		if (mOccludersRasterised == 0)
+			return;
+
+		std::shared_ptr<JobSystem> jobSystem = mCore.lock()->GetJobSystem();
+
+		{
+			JAMES_PROFILE_ZONE("Rasterise Occluders");
+
+			jobSystem->ParallelFor(mOcclusionRasterizer.occluderCount(), 1, [this](size_t _begin, size_t _end)
+				{
+					for (size_t i = _begin; i < _end; ++i)
+						mOcclusionRasterizer.setupOccluder(i);
+				});
+
+			jobSystem->ParallelFor(size_t(mOcclusionRasterizer.bandCount()), 1, [this](size_t _begin, size_t _end)
 				{
-					for (int sy = -1; sy <= 1; sy += 2)
+					for (size_t band = _begin; band < _end; ++band)
+						mOcclusionRasterizer.rasterizeBand(int(band));
+				});
+
+			mOccluderTriangles = mOcclusionRasterizer.triangleCount();
+		}
+
+		auto cull = [&](const std::vector<MaterialRenderInfo>& _materials, std::vector<Renderer::SortItem>& _draws)
+			{
+				mSoftwareVisible.resize(_draws.size());
+				jobSystem->ParallelFor(_draws.size(), 64, [&](size_t _begin, size_t _end)
 					{
-						for (int sz = -1; sz <= 1; sz += 2)
+						for (size_t i = _begin; i < _end; ++i)
 						{
-							glm::vec3 cornerMS = centerMS + glm::vec3(
-								float(sx) * halfExtentsMS.x,
-								float(sy) * halfExtentsMS.y,
-								float(sz) * halfExtentsMS.z
-							);
-							glm::vec3 cornerWS = glm::vec3(M * glm::vec4(cornerMS, 1.0f));
-							float d2 = glm::length(cornerWS - _posWS);
-							if (d2 > maxDist2) maxDist2 = d2;
+							const Renderer::Aabb bounds = WorldBounds(_materials[_draws[i].index]);
+							mSoftwareVisible[i] = mOcclusionRasterizer.isVisible(bounds.min, bounds.max) ? 1 : 0;
 						}
-					}
+					});
+
+				// Compacted in place so the draws stay sorted
+				size_t kept = 0;
+				for (size_t i = 0; i < _draws.size(); ++i)
+				{
+					if (mSoftwareVisible[i])
+						_draws[kept++] = _draws[i];
 				}
-				return maxDist2;
+
+				mSoftwareOccluded += _draws.size() - kept;
+				_draws.resize(kept);
 			};
 
-		// Build keys
-		std::vector<DepthKey> keys;
-		keys.reserve(_materials.size());
+		JAMES_PROFILE_ZONE("Test Draws");
+		cull(mOpaqueMaterials, mOpaqueDraws);
+		cull(mTransparentMaterials, mTransparentDraws);
+	}
+
+	void SceneRenderer::BuildDrawList(
+		const std::vector<MaterialRenderInfo>& _materials,
+		const Renderer::Bvh& _bvh,
+		DrawPass _pass,
+		const glm::mat4& _view,
+		const glm::mat4& _proj,
+		std::vector<Renderer::SortItem>& _draws)
+	{
+		const glm::mat4 VP = _proj * _view;
+
+		// Extract rows from column-major matrix
+		auto getRow = [&](int r)
+			{
+				return glm::vec4(VP[0][r], VP[1][r], VP[2][r], VP[3][r]);
+			};
+
+		const glm::vec4 row0 = getRow(0);
+		const glm::vec4 row1 = getRow(1);
+		const glm::vec4 row2 = getRow(2);
+		const glm::vec4 row3 = getRow(3);
+
+		// plane: dot(xyz, x) + w >= 0 => inside
+		glm::vec4 planes[6] = {
+			row3 + row0, // Left
+			row3 - row0, // Right
+			row3 + row1, // Bottom
+			row3 - row1, // Top
+			row3 + row2, // Near
+			row3 - row2, // Far
+		};
+
+		// Normalise planes
+		for (glm::vec4& p : planes)
+			p /= glm::length(glm::vec3(p));
+
+		mCullInside.clear();
+		mCullCrossing.clear();
+		_bvh.cull(planes, 6, mCullInside, mCullCrossing);
 
-		for (size_t i = 0; i < _materials.size(); ++i)
+		// Groups the camera's cell can't see are gone before any of the per record tests. Done on what the tree walk returns rather than ahead of it,
+		// as the tree skips whole branches outside the frustum for the price of one box test, and checking every record's bit first would cost more.
+		// Shadows are cast from out of sight too, so they never use it
+		if (_pass != DrawPass::Shadow && mPvsCell >= 0)
+		{
+			auto hidden = [&](uint32_t _i)
+				{
+					const int item = _materials[_i].pvsItem;
+					return item >= 0 && !mPvs->isVisible(mPvsCell, size_t(item));
+				};
+
+			const size_t before = mCullInside.size() + mCullCrossing.size();
+			mCullInside.erase(std::remove_if(mCullInside.begin(), mCullInside.end(), hidden), mCullInside.end());
+			mCullCrossing.erase(std::remove_if(mCullCrossing.begin(), mCullCrossing.end(), hidden), mCullCrossing.end());
+			mPvsCulled += before - (mCullInside.size() + mCullCrossing.size());
+		}
+
+		// The tree's boxes are world aligned around each record's oriented box, so a record crossing a plane can still be outside it
+		for (uint32_t i : mCullCrossing)
 		{
 			const auto& it = _materials[i];
 
@@ -1354,18 +1963,19 @@ namespace JamesEngine
 			const glm::vec3  e = it.materialGroup.boundsHalfExtentsMS;
 			const glm::vec3  cMS = it.materialGroup.boundsCenterMS;
 			const glm::vec3  cW = glm::vec3(M * glm::vec4(cMS, 1.0f));
-			const glm::mat3  A = glm::mat3(M);
+			const glm::mat3  A = glm::mat3(M); // columns are world axes * scale
 
 			// Conservative frustum cull (OBB vs plane SAT, world-space planes)
 			bool culled = false;
-			for (const Plane& pl : planes)
+			for (const glm::vec4& pl : planes)
 			{
+				const glm::vec3 n = glm::vec3(pl);
 				const float r =
-					std::abs(glm::dot(pl.n, A[0])) * e.x +
-					std::abs(glm::dot(pl.n, A[1])) * e.y +
-					std::abs(glm::dot(pl.n, A[2])) * e.z;
+					std::abs(glm::dot(n, A[0])) * e.x +
+					std::abs(glm::dot(n, A[1])) * e.y +
+					std::abs(glm::dot(n, A[2])) * e.z;
 
-				const float s = glm::dot(pl.n, cW) + pl.d;
+				const float s = glm::dot(n, cW) + pl.w;
 
 				if (s < -r)
 				{
@@ -1374,97 +1984,42 @@ namespace JamesEngine
 				}
 			}
 
-			if (culled) continue;
-
-			// View-space depth extents
-			const glm::mat4 VM = _view * M;
-			const glm::vec3 centerVS = glm::vec3(VM * glm::vec4(cMS, 1.0f));
-			const glm::mat3 AV = glm::mat3(VM);
-			const float projZ =
-				std::abs(AV[0][2]) * e.x +
-				std::abs(AV[1][2]) * e.y +
-				std::abs(AV[2][2]) * e.z;
-
-			float primary = 0.0f;
-			if (_mode == DepthSortMode::FrontToBack)
-			{
-				// opaque: zMax, larger first
-				const float zMax = centerVS.z + projZ;
-				primary = zMax;
-			}
-			else // BackToFront
-			{
-				// transparent: zMin, smaller first
-				const float zMin = centerVS.z - projZ;
-				primary = zMin;
-			}
-
-			const bool inside = IsCameraInsideOBB(M, cMS, e);
-			const float farDist = inside ? FarthestCornerDistSq(M, cMS, e) : 0.0f;
-
-			DepthKey k;
-			k.primary = primary;
-			k.farthest = farDist;
-			k.cameraInside = inside;
-			k.index = i;
-
-			keys.push_back(k);
+			if (!culled)
+				mCullInside.push_back(i);
 		}
 
-		// Sort
-		std::sort(keys.begin(), keys.end(),
-			[_mode](const DepthKey& a, const DepthKey& b)
-			{
-				const bool frontToBack = (_mode == DepthSortMode::FrontToBack);
+		_draws.clear();
+		_draws.reserve(mCullInside.size());
 
-				if (a.cameraInside && b.cameraInside)
-				{
-					if (frontToBack)
-					{
-						// opaque: both contain camera -> farthest corner closer first
-						return a.farthest < b.farthest;
-					}
-					else
-					{
-						// transparent: both contain camera -> farthest first (back->front)
-						return a.farthest > b.farthest;
-					}
-				}
-
-				if (a.cameraInside != b.cameraInside)
-				{
-					if (frontToBack)
-					{
-						// opaque: draw the ones we are inside first
-						return a.cameraInside && !b.cameraInside;
-					}
-					else
-					{
-						// transparent: treat "inside" as very close, so put it later
-						return !a.cameraInside && b.cameraInside;
-					}
-				}
-
-				// Neither contains camera: use existing primary depth behaviour
-				if (frontToBack)
-				{
-					// opaque: zMax, larger first
-					return a.primary > b.primary;
-				}
-				else
-				{
-					// transparent: zMin, smaller first
-					return a.primary < b.primary;
-				}
-			});
+		for (uint32_t i : mCullInside)
+		{
+			const auto& it = _materials[i];
+			const glm::vec3 cW = glm::vec3(it.transform * glm::vec4(it.materialGroup.boundsCenterMS, 1.0f));
+
+			// Distance in front of the camera as the top 24 bits of the float, positive floats sort the same as their bits
+			const float viewDepth = std::max(-(_view * glm::vec4(cW, 1.0f)).z, 0.0f);
+			uint32_t depthBits;
+			std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+			const uint64_t depth = depthBits >> 8;
+
+			// Program (depth only or alpha tested), culling and textures, the things that cost a state change between draws
+			const auto& pbr = it.materialGroup.pbr;
+			const uint64_t program = (pbr.alphaMode != Renderer::Model::PBRMaterial::AlphaMode::AlphaOpaque) ? 1 : 0;
+			const uint64_t doubleSided = pbr.doubleSided ? 1 : 0;
+			const uint64_t state = (program << 17) | (doubleSided << 16) | it.textureSet;
+
+			// From the top bit down. Opaque and shadow: pass (2), state (18), depth near to far (24).
+			// Transparent: pass (2), depth far to near (24), state (18). The bottom 20 bits are spare
+			uint64_t key = uint64_t(_pass) << 62;
+			if (_pass == DrawPass::Transparent)
+				key |= ((0xFFFFFFull - depth) << 38) | (state << 20);
+			else
+				key |= (state << 44) | (depth << 20);
 
-		// Build output list
-		std::vector<MaterialRenderInfo> result;
-		result.reserve(keys.size());
-		for (const auto& k : keys)
-			result.push_back(_materials[k.index]);
+			_draws.push_back({ key, (uint32_t)i });
+		}
 
-		return result;
+		Renderer::radixSort(_draws, mSortScratch);
 	}
 
 }
\ No newline at end of file
@@ -3,6 +3,17 @@
 #include "Model.h"
 #include "Shader.h"
 
+#include "SlotMap.h"
+
+#include "Renderer/GpuTimerPool.h"
+#include "Renderer/RadixSort.h"
+#include "Renderer/Bvh.h"
+#include "Renderer/HiZPyramid.h"
+#include "Renderer/OcclusionRasterizer.h"
+#include "Renderer/Pvs.h"
+
+#include <array>
+
 namespace JamesEngine
 {
 
@@ -21,40 +32,79 @@ namespace JamesEngine
 		std::shared_ptr<Model> proxy = nullptr; // Used only if mode == Proxy
 	};
 
+	// Whether a model's opaque material groups are rasterised into the CPU occlusion buffer to hide what is behind them
+	enum class OccluderMode
+	{
+		Auto,   // Groups that are big on screen and cheap enough to rasterise
+		Always, // Every group, however many triangles. For terrain, barriers and buildings
+		Never
+	};
+
 	struct MaterialRenderInfo
 	{
 		Renderer::Model::MaterialGroup& materialGroup;
 		std::shared_ptr<Model> model; // Reference to the model to get the embedded textures
 		glm::mat4 transform; // Model transform
 
-		uint64_t occlusionKey = 0; // Unique key for occlusion queries
+		uint64_t occlusionKey = 0; // Unique per proxy and material group, keys mLodSelections
+		OccluderMode occluder = OccluderMode::Auto; // The proxy's, see IsOccluder
+		int pvsItem = -1; // Its bit in mPvs, -1 when its model has no PVS
+
+		int lod = 0; // Which of the group's LODs to draw, picked each frame by SelectLods
+
+		uint32_t material = 0; // Its MaterialData in the SceneRenderer's material table
+		uint32_t drawSlot = 0; // Its DrawData in the pass being drawn, every command it draws has this as its base instance
+
+		// Its run of the pass's indirect commands, the whole LOD or the meshlets that survived culling. -1 until BuildCommands, 0 when held back whole
+		int firstCommand = 0;
+		int commandCount = -1;
+
+		// Draws held back because they were hidden in the last depth pyramid read back, a run of the SceneRenderer's per frame indirect commands.
+		// The GPU turns each one on or off once it has tested it against this frame's depth
+		uint32_t firstHiZCommand = 0;
+		uint32_t hiZCommandCount = 0;
+
+		// GL ids of the base colour, normal, metallic roughness, occlusion, emissive and transmission textures, 0 where there isn't one.
+		// textureSet is a hash of them, so draws sharing textures sort next to each other
+		std::array<GLuint, 6> textures{};
+		uint16_t textureSet = 0;
 	};
 
-	struct OcclusionInfo
+	// A model registered with the SceneRenderer, drawn every frame until it is removed
+	struct RenderProxy
 	{
-		GLuint queryIds[2];
-		bool visible = true;
-		bool hasResult = false;
-
-		uint64_t lastFrameTested = 0;
-		uint64_t lastFrameSubmitted = 0;
+		int entityId = 0;
+		std::shared_ptr<Model> model;
+		ShadowOverride shadow;
+		OccluderMode occluder = OccluderMode::Auto;
+		glm::mat4 transform{ 1.0f };
+
+		// Its records in the opaque, transparent and shadow material lists, one run in each
+		uint32_t firstOpaque = 0;
+		uint32_t opaqueCount = 0;
+		uint32_t firstTransparent = 0;
+		uint32_t transparentCount = 0;
+		uint32_t firstShadow = 0;
+		uint32_t shadowCount = 0;
 	};
 
 	class SceneRenderer
 	{
 	public:
 		SceneRenderer(std::shared_ptr<Core> _core);
-		~SceneRenderer() {}
+		~SceneRenderer();
 
 		void RenderScene();
 
+		/**
+		 * @brief Gets how long each render pass took on the GPU, from a frame a few frames ago so reading them never stalls.
+		 * Nested passes come straight after their parent with a higher depth.
+		 */
+		const std::vector<Renderer::GpuTimerResult>& GetGpuPassTimings() const { return mGpuTimers.getResults(); }
+
 		// User toggleable settings
 		// SSAO
-		void EnableSSAO(bool _enabled) {
-			mSSAOEnabled = _enabled;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_UseSSAO", mSSAOEnabled);
-		}
+		void EnableSSAO(bool _enabled) { mSSAOEnabled = _enabled; }
 		bool IsSSAOEnabled() const { return mSSAOEnabled; }
 		void SetSSAORadius(float _radius) {
 			mSSAORadius = _radius;
@@ -74,21 +124,9 @@ namespace JamesEngine
 		void SetSSAOBlurScale(float _blurScale) { mSSAOBlurScale = _blurScale; }
 
 		// AO application
-		void SetAOStrength(float _strength) {
-			mAOStrength = _strength;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_AOStrength", mAOStrength);
-		}
-		void SetAOSpecularScale(float _specScale) {
-			mAOSpecScale = _specScale;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_AOSpecScale", mAOSpecScale);
-		}
-		void SetAOMin(float _min) {
-			mAOMin = _min;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_AOMin", mAOMin);
-		}
+		void SetAOStrength(float _strength) { mAOStrength = _strength; }
+		void SetAOSpecularScale(float _specScale) { mAOSpecScale = _specScale; }
+		void SetAOMin(float _min) { mAOMin = _min; }
 
 		// Bloom
 		void EnableBloom(bool _enabled) {
@@ -119,31 +157,49 @@ namespace JamesEngine
 		}
 
 		// Shadows
-		void SetSoftShadowBase(float _base) {
-			mPCSSBase = _base;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_PCSSBase", mPCSSBase);
-		}
-		void SetSoftShadowScale(float _scale) {
-			mPCSSScale = _scale;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_PCSSScale", mPCSSScale);
-		}
-		void SetShadowBiasSlope(float _slope) {
-			mShadowBiasSlope = _slope;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_ShadowBiasSlope", mShadowBiasSlope);
-		}
-		void SetShadowBiasMin(float _min) {
-			mShadowBiasMin = _min;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_ShadowBiasMin", mShadowBiasMin);
-		}
-		void SetShadowNormalOffsetScale(float _scale) {
-			mShadowNormalOffsetScale = _scale;
-			mObjShader->mShader->use();
-			mObjShader->mShader->uniform("u_NormalOffsetScale", mShadowNormalOffsetScale);
-		}
+		void SetSoftShadowBase(float _base) { mPCSSBase = _base; }
+		void SetSoftShadowScale(float _scale) { mPCSSScale = _scale; }
+		void SetShadowBiasSlope(float _slope) { mShadowBiasSlope = _slope; }
+		void SetShadowBiasMin(float _min) { mShadowBiasMin = _min; }
+		void SetShadowNormalOffsetScale(float _scale) { mShadowNormalOffsetScale = _scale; }
+
+		// LOD
+		/**
+		 * @brief Sets how far, in pixels, a simplified LOD may move the surface on screen before the finer one is used. 0 always draws full detail.
+		 */
+		void SetLodPixelError(float _pixels) { mLodPixelError = _pixels; }
+		/**
+		 * @brief Sets how far, in shadow map texels, a LOD may move the surface before a finer one is used for that cascade.
+		 */
+		void SetShadowLodTexelError(float _texels) { mShadowLodTexelError = _texels; }
+
+		// Meshlets
+		/**
+		 * @brief Turns per meshlet frustum and back face culling of full detail material groups on or off.
+		 */
+		void EnableMeshletCulling(bool _enabled) { mMeshletCullingEnabled = _enabled; }
+		bool IsMeshletCullingEnabled() const { return mMeshletCullingEnabled; }
+
+		// Software occlusion
+		/**
+		 * @brief Turns culling draws hidden behind occluders rasterised on the CPU on or off.
+		 */
+		void EnableSoftwareOcclusion(bool _enabled) { mSoftwareOcclusionEnabled = _enabled; }
+		bool IsSoftwareOcclusionEnabled() const { return mSoftwareOcclusionEnabled; }
+		/**
+		 * @brief Sets how big on screen a material group's bounding sphere must be, as its radius over its distance, for OccluderMode::Auto to pick it.
+		 */
+		void SetAutoOccluderSize(float _size) { mAutoOccluderSize = _size; }
+
+		// Potentially visible sets
+		/**
+		 * @brief Uses a PVS baked for _model (see pvsbake) to skip its material groups that can't be seen from the camera's cell, before frustum culling.
+		 * Only the camera's draws are skipped, shadows still come from everything. A PVS baked from a different version of the model is ignored,
+		 * and so is it for any entity whose model isn't placed where it was baked. nullptr stops using one.
+		 */
+		void SetPvs(std::shared_ptr<Model> _model, std::shared_ptr<Renderer::Pvs> _pvs);
+		void EnablePvs(bool _enabled) { mPvsEnabled = _enabled; }
+		bool IsPvsEnabled() const { return mPvsEnabled; }
 
 		// Tone mapping
 		void SetExposure(float _exposure) {
@@ -155,27 +211,141 @@ namespace JamesEngine
 	private:
 		friend class ModelRenderer;
 
-		void AddModel(int _entityId, std::shared_ptr<Model> _model, const glm::mat4& _transform = glm::mat4(1.0f), const ShadowOverride& _shadow = {});
+		// Registers a model to be drawn every frame from now on, until RemoveProxy. Its material groups are only added to the lists here
+		Handle<RenderProxy> AddProxy(int _entityId, std::shared_ptr<Model> _model, const glm::mat4& _transform = glm::mat4(1.0f), const ShadowOverride& _shadow = {},
+			OccluderMode _occluder = OccluderMode::Auto);
+		// Moves a registered model, only needed when its transform has changed
+		void UpdateProxy(Handle<RenderProxy> _proxy, const glm::mat4& _transform);
+		void RemoveProxy(Handle<RenderProxy> _proxy);
 
-		void ClearScene(); // Clears all models from the scene for next frame
+		// Appends the proxy's material groups to the material lists and records where they went
+		void AddProxyMaterials(RenderProxy& _proxy);
+		// Rebuilds the material lists from the proxies still registered, after some have been removed
+		void RebuildMaterialLists();
 
-		std::vector<MaterialRenderInfo> FrustumCulledMaterials(
-			const std::vector<MaterialRenderInfo>& _materials,
-			const glm::mat4& _view,
-			const glm::mat4& _proj);
+		// Where the model's material groups start in the material table, adding them the first time it is seen
+		uint32_t MaterialTableBase(const std::shared_ptr<Model>& _model);
+		// Copies every model's material buffer into mMaterialBuffer when models were added. Stays dirty while one hasn't uploaded yet
+		void UploadMaterialTable();
+
+		// Rebuilds any culling tree whose material list changed, or that has been refit about once per item since it was built
+		void UpdateBvhs();
 
-		enum class DepthSortMode
+		// World space box around the material's model space bounds
+		static Renderer::Aabb WorldBounds(const MaterialRenderInfo& _material);
+
+		// Fills in the material's texture ids and texture set hash
+		static void ResolveTextures(MaterialRenderInfo& _material);
+
+		// Picks each material's LOD from how many pixels its simplification error covers at its distance from the camera
+		void SelectLods(std::vector<MaterialRenderInfo>& _materials, const glm::vec3& _camPos, float _pixelsPerUnit);
+
+		// Coarsest LOD whose error stays under mShadowLodTexelError texels of a cascade
+		int ShadowLod(const MaterialRenderInfo& _material, float _worldUnitsPerTexel) const;
+
+		// std430 layout of the DrawData struct in DepthOnly.vert and ObjShader.vert, one per material drawn in a pass
+		struct DrawData
+		{
+			glm::mat4 model;
+			glm::vec4 positionScale; // w unused
+			glm::vec4 positionOffset;
+			uint32_t material;
+			uint32_t octNormals;
+			uint32_t padding[2];
+		};
+		static_assert(sizeof(DrawData) == 112, "DrawData must be the array stride of the std430 struct");
+
+		struct DrawCommand
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+		static_assert(sizeof(DrawCommand) == 20, "DrawCommand must match DrawElementsIndirectCommand");
+
+		// Neighbouring draws of a pass's draw list whose commands are drawn in one call
+		struct DrawBatch
+		{
+			GLuint vao = 0;
+			bool doubleSided = false;
+			uint32_t firstDraw = 0; // Into the pass's draw list
+			uint32_t drawCount = 0;
+			uint32_t firstCommand = 0;
+			uint32_t commandCount = 0;
+		};
+
+		// Appends the material's DrawData to mDrawData and records its slot
+		void AddDrawData(MaterialRenderInfo& _material);
+		// A command for _indexCount of the group's indices from _firstIndex, offset to where the group is in its arena and pointed at the material's DrawData
+		static DrawCommand MakeCommand(const MaterialRenderInfo& _material, uint32_t _firstIndex, uint32_t _indexCount);
+		// The command for the whole of one of the group's LODs, clamped to the ones it has
+		static DrawCommand LodCommand(const MaterialRenderInfo& _material, int _lod);
+
+		// Appends each material in _draws' commands to mDrawCommands in draw order, so materials drawn one after another have neighbouring runs.
+		// With _cullMeshlets, full detail materials are split into meshlets culled against the frustum and, unless double sided, by their normal cones.
+		// With _hiZ, meshlets hidden in it are held back rather than drawn. Materials already held back whole get an empty run
+		void BuildCommands(std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws, bool _cullMeshlets, const glm::mat4& _view, const glm::mat4& _proj,
+			const glm::vec3& _camPos, const Renderer::HiZSnapshot* _hiZ = nullptr);
+
+		// Neighbouring draws in _draws that can go in one multi-draw: the same vertex array, face culling and, unless _depthOnly, textures.
+		// _depthOnly leaves out the alpha tested draws, which still need their own texture bound
+		void BuildBatches(const std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws, bool _depthOnly);
+		// Uploads mDrawData and mDrawCommands for the pass about to be drawn
+		void UploadDraws();
+
+		// Holds back every material in _draws whose bounds are hidden in the last depth pyramid read back, so it draws nothing directly this frame
+		void HoldBackOccludedMaterials(std::vector<MaterialRenderInfo>& _materials, const std::vector<Renderer::SortItem>& _draws);
+
+		// Adds an indirect command for _indexCount indices of the material from _firstIndex, tested against _bounds on the GPU
+		void HoldBack(MaterialRenderInfo& _material, const Renderer::Aabb& _bounds, uint32_t _firstIndex, uint32_t _indexCount);
+
+		// Uploads the held back draws and tests them against mHiZ, which must already hold this frame's depth
+		void CullHeldBack(const glm::mat4& _viewProj);
+
+		// Binds mObjShader's textures for one material, or a batch sharing them.
+		// Textures already bound by the previous material are left alone, reset mBoundTextures when something else may have used the units
+		void BindMaterialTextures(const MaterialRenderInfo& _material);
+
+		// Draws the material's own run of commands, for programs that still take the material as uniforms
+		void DrawMaterial(Renderer::Shader& _shader, const MaterialRenderInfo& _material);
+		// Draws every command of the batch in one call
+		void SubmitBatch(Renderer::Shader& _shader, const DrawBatch& _batch);
+		// Draws whichever of the material's held back commands CullHeldBack left on
+		void DrawHeldBack(Renderer::Shader& _shader, const MaterialRenderInfo& _material);
+
+		// Drops mPvs if it wasn't baked from mPvsModel's current material groups. The model has to have loaded
+		void ValidatePvs();
+		// Points every material of mPvsModel at its bit in mPvs
+		void AssignPvsItems();
+		// Whether a model placed by _transform is where mPvs was baked
+		bool MatchesPvsTransform(const glm::mat4& _transform) const;
+		// The material's bit in mPvs, -1 if it isn't mPvsModel's or its model isn't placed where the PVS was baked
+		int PvsItem(const MaterialRenderInfo& _material) const;
+
+		// Whether the material is rasterised into mOcclusionRasterizer this frame. Alpha tested groups have holes, so they never are
+		bool IsOccluder(const MaterialRenderInfo& _material, const glm::vec3& _camPos) const;
+
+		// Rasterises the occluders among this frame's opaque draws on the CPU, then drops every opaque and transparent draw hidden behind them
+		void CullSoftwareOcclusion(const glm::mat4& _viewProj, const glm::vec3& _camPos);
+
+		enum class DrawPass
 		{
-			FrontToBack,   // opaque
-			BackToFront    // transparent
+			Opaque,      // Grouped by program and textures, then front to back
+			Transparent, // Back to front, then by program and textures
+			Shadow       // Same as opaque
 		};
 
-		std::vector<MaterialRenderInfo> FrustumCulledDistanceSortedMaterials(
+		// Frustum culls _materials through their culling tree and fills _draws with a sort key and index for each one left, sorted into the order the pass draws them.
+		// Shadow cascades pass their light view and ortho projection, so the same query culls against the cascade's box
+		void BuildDrawList(
 			const std::vector<MaterialRenderInfo>& _materials,
+			const Renderer::Bvh& _bvh,
+			DrawPass _pass,
 			const glm::mat4& _view,
 			const glm::mat4& _proj,
-			const glm::vec3& _posWS,
-			DepthSortMode _mode);
+			std::vector<Renderer::SortItem>& _draws);
 
 		std::weak_ptr<Core> mCore;
 
@@ -183,7 +353,69 @@ namespace JamesEngine
 		std::vector<MaterialRenderInfo> mTransparentMaterials;
 		std::vector<MaterialRenderInfo> mShadowMaterials;
 
-		std::unordered_map<uint64_t, OcclusionInfo> mOcclusionCache;
+		SlotMap<RenderProxy> mProxies;
+		bool mProxiesRemoved = false; // The material lists still hold removed proxies' records until RebuildMaterialLists
+
+		// Culling trees over each material list, item i is record i of the list. Moving proxies refit them, adding or removing proxies rebuilds them
+		Renderer::Bvh mOpaqueBvh;
+		Renderer::Bvh mTransparentBvh;
+		Renderer::Bvh mShadowBvh;
+		bool mBvhsDirty = true;
+
+		// Records the trees found fully inside or crossing the frustum, reused every query
+		std::vector<uint32_t> mCullInside;
+		std::vector<uint32_t> mCullCrossing;
+
+		// Depth of this frame's big occluders, rasterised on the CPU across the job system before the camera's draws are submitted
+		Renderer::OcclusionRasterizer mOcclusionRasterizer;
+		std::vector<uint8_t> mSoftwareVisible; // Per draw, written by the jobs testing them
+		static constexpr int kOcclusionBufferWidth = 320; // Height follows the screen's aspect
+		static constexpr size_t kMaxAutoOccluderTriangles = 4096;
+
+		// This frame's culled and sorted draws, indices into the lists above. Kept so their memory is reused every frame
+		std::vector<Renderer::SortItem> mOpaqueDraws;
+		std::vector<Renderer::SortItem> mTransparentDraws;
+		std::vector<Renderer::SortItem> mShadowDraws;
+		std::vector<Renderer::SortItem> mSortScratch;
+
+		// Textures mObjShader's material units hold, so consecutive draws with the same set don't rebind them
+		std::array<GLuint, 6> mBoundTextures{};
+
+		std::vector<uint64_t> mMeshletVisibility; // One material's frustum culling bits at a time
+
+		// The pass being drawn's per draw values and indirect commands, uploaded once per pass and drawn a batch per multi-draw
+		std::vector<DrawData> mDrawData;
+		std::vector<DrawCommand> mDrawCommands;
+		std::vector<DrawBatch> mDrawBatches;
+		GLuint mDrawDataBuffer = 0;
+		GLuint mDrawCommandBuffer = 0;
+
+		// Every registered model's MaterialData, a run per model in the order they were first added. Bound to binding 3 for ObjShader
+		std::unordered_map<const Model*, uint32_t> mMaterialBases;
+		std::vector<std::shared_ptr<Model>> mMaterialModels;
+		uint32_t mMaterialCount = 0;
+		bool mMaterialTableDirty = false;
+		GLuint mMaterialBuffer = 0;
+
+		// Last LOD picked for each occlusionKey, so an object sitting at a switch distance doesn't flicker between two
+		std::unordered_map<uint64_t, int> mLodSelections;
+
+		// Two phase occlusion culling. Opaque draws hidden in the last depth pyramid read back are held back from the depth prepass,
+		// then the pyramid is rebuilt from what was drawn and the held back ones are tested against it on the GPU. Anything visible after all is drawn indirectly
+		Renderer::HiZPyramid mHiZ;
+
+		// std430 layouts of HiZCull.vert's buffers. Candidate i is the bounds of command i
+		struct HiZCandidate
+		{
+			glm::vec4 boundsMin; // World space, w unused
+			glm::vec4 boundsMax;
+		};
+
+		std::vector<HiZCandidate> mHiZCandidates;
+		std::vector<DrawCommand> mHiZCommands;
+		GLuint mHiZCandidateBuffer = 0;
+		GLuint mHiZCommandBuffer = 0;
+		GLuint mPointVao = 0; // Empty, the core profile needs one bound to draw HiZCull's points
 
 		// Fallback PBR values
 		glm::vec4 mBaseColorStrength{ 1.f };
@@ -204,7 +436,57 @@ namespace JamesEngine
 		std::shared_ptr<Shader> mUpsampleAdd;
 		std::shared_ptr<Shader> mCompositeShader;
 		std::shared_ptr<Shader> mToneMapShader;
-		std::shared_ptr<Shader> mOcclusionBoxShader;
+		std::shared_ptr<Shader> mHiZDownsampleShader;
+		std::shared_ptr<Shader> mHiZCullShader;
+
+		// mObjShader's material samplers, looked up once rather than by name for every batch. Everything else about a draw is in its DrawData
+		struct MaterialUniforms
+		{
+			Renderer::UniformHandle<int> albedoMap;
+			Renderer::UniformHandle<int> normalMap;
+			Renderer::UniformHandle<int> metallicRoughnessMap;
+			Renderer::UniformHandle<int> occlusionMap;
+			Renderer::UniformHandle<int> emissiveMap;
+			Renderer::UniformHandle<int> transmissionTex;
+		};
+		MaterialUniforms mMaterialUniforms;
+
+		static constexpr int kMaxCascades = 5; // MAX_NUM_CASCADES in ObjShader
+
+		// std140 layout of the FrameData block in ObjShader, uploaded once a frame and bound to binding 0 for every program
+		struct FrameData
+		{
+			glm::mat4 view;
+			glm::mat4 projection;
+			glm::mat4 lightSpaceMatrices[kMaxCascades];
+			glm::vec4 cascadeTexelSizes[kMaxCascades]; // x texel scale relative to cascade 0, y world units per texel
+
+			glm::vec4 albedoFallback;
+			glm::vec3 viewPos;
+			int32_t numCascades;
+			glm::vec3 emissiveFallback;
+			float metallicFallback;
+			glm::vec2 invColorResolution;
+			float roughnessFallback;
+			float aoFallback;
+
+			float shadowBiasSlope;
+			float shadowBiasMin;
+			float normalOffsetScale;
+			float pcssBase;
+			float pcssScale;
+
+			int32_t useSSAO;
+			float aoStrength;
+			float aoSpecScale;
+			float aoMin;
+			float padding[3];
+		};
+		static_assert(offsetof(FrameData, albedoFallback) == 528 && offsetof(FrameData, numCascades) == 556, "FrameData must follow std140");
+		static_assert(offsetof(FrameData, invColorResolution) == 576 && offsetof(FrameData, aoMin) == 624, "FrameData must follow std140");
+		static_assert(sizeof(FrameData) == 640, "FrameData must be the size of the std140 block");
+
+		GLuint mFrameUbo = 0;
 
 		// Textures
 		std::shared_ptr<Renderer::RenderTexture> mShadingPass;
@@ -223,9 +505,6 @@ namespace JamesEngine
 		// Quad mesh for full-screen passes
 		std::shared_ptr<Renderer::Mesh> mRect = std::make_shared<Renderer::Mesh>();
 
-		// Cube mesh for occlusion queries
-		std::shared_ptr<Renderer::Mesh> mCube = std::make_shared<Renderer::Mesh>();
-
 		// Bloom settings
 		bool mBloomEnabled = true;
 		float mBloomThreshold = 1.3f;
@@ -258,7 +537,43 @@ namespace JamesEngine
 		// Tone mapping settings
 		float mExposure = 1.f;
 
-		uint64_t mFrameIndex = 0;
+		// LOD settings
+		float mLodPixelError = 1.0f;
+		float mLodHysteresis = 0.75f; // Switching to a coarser LOD needs its error under this fraction of mLodPixelError
+		float mShadowLodTexelError = 1.0f;
+
+		// Meshlet settings
+		bool mMeshletCullingEnabled = true;
+		size_t mMeshletsTested = 0;
+		size_t mMeshletsCulled = 0;
+
+		// Occlusion settings
+		bool mOcclusionCullingEnabled = true;
+		size_t mMaterialsHeldBack = 0;
+		size_t mMeshletsHeldBack = 0;
+
+		// Multi-draw calls last frame
+		size_t mShadowBatches = 0;
+		size_t mDepthBatches = 0;
+		size_t mShadingBatches = 0;
+
+		// Software occlusion settings
+		bool mSoftwareOcclusionEnabled = true;
+		float mAutoOccluderSize = 0.25f;
+		size_t mOccludersRasterised = 0;
+		size_t mOccluderTriangles = 0;
+		size_t mSoftwareOccluded = 0;
+
+		// PVS settings
+		std::shared_ptr<Model> mPvsModel;
+		std::shared_ptr<Renderer::Pvs> mPvs;
+		bool mPvsValidated = false;
+		bool mPvsEnabled = true;
+		int mPvsCell = -1; // The camera's this frame, -1 when off the baked path
+		size_t mPvsCulled = 0;
+
+		// Per-pass GPU timings
+		Renderer::GpuTimerPool mGpuTimers;
 
 		// Misc
 		glm::ivec2 mLastViewportSize{ 1,1 };
@@ -135,7 +135,11 @@ namespace JamesEngine
 	void Skybox::SetEnvironmentIntensity(float _intensity)
 	{
 		mEnvironmentIntensity = _intensity;
-		mCore.lock()->GetResources()->Load<Shader>("shaders/ObjShader")->mShader->uniform("u_EnvIntensity", mEnvironmentIntensity);
+
+		auto objShader = mCore.lock()->GetResources()->Load<Shader>("shaders/ObjShader");
+		objShader->mShader->use();
+		objShader->mShader->uniform("u_EnvIntensity", mEnvironmentIntensity);
+		objShader->mShader->unuse();
 	}
 
 	void Skybox::RenderSkybox()
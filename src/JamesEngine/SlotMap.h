@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace JamesEngine
+{
+
+	/**
+	 * @struct Handle
+	 * @brief A weak reference to something stored in a SlotMap, made of the slot index and the generation of that slot.
+	 * Once the value is removed the slot's generation changes, so old handles resolve to nullptr instead of whatever reuses the slot.
+	 * @tparam T The type the handle refers to.
+	 */
+	template <typename T>
+	struct Handle
+	{
+		static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+		uint32_t index = InvalidIndex;
+		uint32_t generation = 0;
+
+		bool IsNull() const { return index == InvalidIndex; }
+
+		bool operator==(const Handle& _other) const { return index == _other.index && generation == _other.generation; }
+		bool operator!=(const Handle& _other) const { return !(*this == _other); }
+	};
+
+	/**
+	 * @class SlotMap
+	 * @brief Stores values in reusable slots, with O(1) insert, remove and handle lookup.
+	 * @tparam T The type of value stored.
+	 */
+	template <typename T>
+	class SlotMap
+	{
+	public:
+		Handle<T> Insert(std::shared_ptr<T> _value)
+		{
+			Handle<T> handle;
+
+			if (!mFreeSlots.empty())
+			{
+				handle.index = mFreeSlots.back();
+				mFreeSlots.pop_back();
+			}
+			else
+			{
+				handle.index = (uint32_t)mSlots.size();
+				mSlots.emplace_back();
+			}
+
+			Slot& slot = mSlots[handle.index];
+			slot.value = std::move(_value);
+			handle.generation = slot.generation;
+
+			mSize++;
+
+			return handle;
+		}
+
+		void Remove(Handle<T> _handle)
+		{
+			if (!Contains(_handle))
+				return;
+
+			Slot& slot = mSlots[_handle.index];
+			slot.value.reset();
+			slot.generation++;
+			mFreeSlots.push_back(_handle.index);
+
+			mSize--;
+		}
+
+		/**
+		 * @brief Gets the value the handle refers to.
+		 * @return The value, or nullptr if it has been removed.
+		 */
+		std::shared_ptr<T> Get(Handle<T> _handle) const
+		{
+			if (!Contains(_handle))
+				return nullptr;
+
+			return mSlots[_handle.index].value;
+		}
+
+		bool Contains(Handle<T> _handle) const
+		{
+			return _handle.index < mSlots.size() && mSlots[_handle.index].generation == _handle.generation && mSlots[_handle.index].value;
+		}
+
+		size_t Size() const { return mSize; }
+
+		/**
+		 * @brief Calls _function on every value in the map, in slot order.
+		 */
+		template <typename Function>
+		void ForEach(Function&& _function) const
+		{
+			for (const Slot& slot : mSlots)
+			{
+				if (slot.value)
+					_function(*slot.value);
+			}
+		}
+
+	private:
+		struct Slot
+		{
+			std::shared_ptr<T> value;
+			uint32_t generation = 0;
+		};
+
+		std::vector<Slot> mSlots;
+		std::vector<uint32_t> mFreeSlots;
+
+		size_t mSize = 0;
+	};
+
+}
\ No newline at end of file
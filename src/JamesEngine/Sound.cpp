@@ -10,8 +10,12 @@ namespace JamesEngine
 	
 	void Sound::OnLoad()
 	{
-		std::vector<unsigned char> data;
+		OnDecode();
+		OnUpload();
+	}
 
+	void Sound::OnDecode()
+	{
 		int channels = 0;
 		int sampleRate = 0;
 		short* output = NULL;
@@ -35,19 +39,27 @@ namespace JamesEngine
 		}
 
 		// Copy (# samples) * (1 or 2 channels) * (16 bits == 2 bytes == short)
-		data.resize(samples * channels * sizeof(short));
-		memcpy(&data.at(0), output, data.size());
+		mData.resize(samples * channels * sizeof(short));
+		memcpy(&mData.at(0), output, mData.size());
 
 		// Record the sample rate required by OpenAL
 		mFrequency = sampleRate;
 
 		// Clean up the read data
 		free(output);
+	}
 
+	bool Sound::OnUpload()
+	{
 		alGenBuffers(1, &mBufferId);
 
-		alBufferData(mBufferId, mFormat, &data.at(0),
-			static_cast<ALsizei>(data.size()), mFrequency);
+		alBufferData(mBufferId, mFormat, &mData.at(0),
+			static_cast<ALsizei>(mData.size()), mFrequency);
+
+		mData.clear();
+		mData.shrink_to_fit();
+
+		return true;
 	}
 
 }
\ No newline at end of file
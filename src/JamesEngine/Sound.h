@@ -4,6 +4,8 @@
 
 #include <AL/al.h>
 
+#include <vector>
+
 namespace JamesEngine
 {
 
@@ -14,9 +16,15 @@ namespace JamesEngine
 	public:
 		void OnLoad();
 
+		void OnDecode();
+		bool OnUpload();
+
 	private:
 		friend class AudioSource;
 
+		// Decoded samples, only kept until they are uploaded to the buffer
+		std::vector<unsigned char> mData;
+
 		ALuint mBufferId = 0;
 		ALenum mFormat = 0;
 		ALsizei mFrequency = 0;
@@ -29,7 +29,7 @@ namespace JamesEngine
 		float mRadius = 0.5f;
 
 #ifdef JAMES_DEBUG
-		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/sphere.obj");
+		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/sphere.obj", false);
 #endif
 	};
 
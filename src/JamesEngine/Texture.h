@@ -17,6 +17,9 @@ namespace JamesEngine
 	public:
 		void OnLoad() { mTexture = std::make_shared<Renderer::Texture>(GetPath() + ".png"); }
 
+		void OnDecode() { OnLoad(); }
+		bool OnUpload() { mTexture->id(); return true; }
+
 	private:
 		friend class ModelRenderer;
 		friend class GUI;
@@ -22,21 +22,4 @@ private:
     std::chrono::steady_clock::time_point mTempTimeStamp;
 
     bool mRunning = false;
-};
-
-class ScopedTimer
-{
-public:
-	ScopedTimer(const char* _name) : mName(_name)
-	{
-		mTimer.Start();
-	}
-	~ScopedTimer()
-	{
-		float elapsed = mTimer.GetElapsedMilliseconds();
-		std::cout << "ScopedTimer [" << mName << "] took " << elapsed << " milliseconds.\n";
-	}
-private:
-	const char* mName;
-	Timer mTimer;
 };
\ No newline at end of file
@@ -9,36 +9,133 @@
 namespace JamesEngine
 {
 
-    glm::vec3 Transform::GetPosition()
+    Transform::~Transform()
+    {
+        if (mParent)
+            mParent->RemoveChild(this);
+
+        for (Transform* child : mChildren)
+        {
+            child->mParent = nullptr;
+            child->MarkWorldDirty();
+        }
+    }
+
+    void Transform::SetParent(std::shared_ptr<Entity> _parent)
+    {
+        Transform* newParent = _parent ? _parent->GetComponent<Transform>().get() : nullptr;
+
+        if (newParent == mParent)
+            return;
+
+        if (mParent)
+            mParent->RemoveChild(this);
+
+        mParent = newParent;
+
+        if (mParent)
+            mParent->mChildren.push_back(this);
+
+        MarkWorldDirty();
+    }
+
+    void Transform::RemoveChild(Transform* _child)
     {
-        if (std::shared_ptr<Entity> parent = mParent.lock())
+        for (size_t i = 0; i < mChildren.size(); ++i)
         {
-            std::shared_ptr<Transform> parentTransform = parent->GetComponent<Transform>();
-            glm::vec3 parentPosition = parentTransform->GetPosition();
+            if (mChildren[i] == _child)
+            {
+                mChildren[i] = mChildren.back();
+                mChildren.pop_back();
+                return;
+            }
+        }
+    }
+
+    void Transform::MarkDirty()
+    {
+        mLocalDirty = true;
+        MarkWorldDirty();
+    }
+
+    void Transform::MarkWorldDirty()
+    {
+        // If we're already dirty our children will be too, so the subtree only gets walked once per change
+        if (mWorldDirty)
+            return;
+
+        mWorldDirty = true;
+        sWorldDirtyCount.fetch_add(1, std::memory_order_relaxed);
 
-            glm::mat4 rotationMatrix = glm::toMat4(parentTransform->GetWorldRotation());
+        for (Transform* child : mChildren)
+        {
+            child->MarkWorldDirty();
+        }
+    }
+
+    void Transform::UpdateWorld()
+    {
+        if (!mWorldDirty)
+            return;
+
+        if (mParent)
+        {
+            mParent->UpdateWorld();
+
+            glm::mat4 rotationMatrix = glm::toMat4(mParent->mWorldRotation);
             glm::vec4 rotatedPosition = rotationMatrix * glm::vec4(mPosition, 1.0f);
 
-            return glm::vec3(rotatedPosition) + parentPosition;
+            mWorldPosition = glm::vec3(rotatedPosition) + mParent->mWorldPosition;
+            mWorldRotation = mParent->mWorldRotation * mRotation;
+            mWorldScale = mScale * mParent->mWorldScale;
+        }
+        else
+        {
+            mWorldPosition = mPosition;
+            mWorldRotation = mRotation;
+            mWorldScale = mScale;
         }
-        return mPosition;
+
+        mWorldModel = glm::mat4(1.f);
+        mWorldModel = glm::translate(mWorldModel, mWorldPosition);
+        mWorldModel *= glm::toMat4(mWorldRotation);
+        mWorldModel = glm::scale(mWorldModel, mWorldScale);
+
+        mWorldDirty = false;
+        mWorldVersion++;
+    }
+
+    glm::vec3 Transform::GetPosition()
+    {
+        UpdateWorld();
+        return mWorldPosition;
     }
 
     glm::vec3 Transform::GetScale()
     {
-        if (std::shared_ptr<Entity> parent = mParent.lock())
-            return mScale * parent->GetComponent<Transform>()->GetScale();
-        return mScale;
+        UpdateWorld();
+        return mWorldScale;
     }
 
     glm::mat4 Transform::GetModel()
     {
-        glm::mat4 modelMatrix = glm::mat4(1.f);
-        modelMatrix = glm::translate(modelMatrix, GetPosition());
-        modelMatrix *= glm::toMat4(GetWorldRotation());
-        modelMatrix = glm::scale(modelMatrix, GetScale());
+        UpdateWorld();
+        return mWorldModel;
+    }
 
-        return modelMatrix;
+    glm::mat4 Transform::GetLocalModel()
+    {
+        if (mLocalDirty)
+        {
+            mLocalModel = glm::mat4(1.f);
+            mLocalModel = glm::translate(mLocalModel, mPosition);
+            mLocalModel *= glm::toMat4(mRotation);
+            mLocalModel = glm::scale(mLocalModel, mScale);
+
+            mLocalDirty = false;
+        }
+
+        return mLocalModel;
     }
 
     glm::vec3 Transform::GetForward()
@@ -61,12 +158,8 @@ namespace JamesEngine
 
     glm::quat Transform::GetWorldRotation()
     {
-        if (std::shared_ptr<Entity> parent = mParent.lock())
-        {
-            std::shared_ptr<Transform> parentTransform = parent->GetComponent<Transform>();
-            return parentTransform->GetWorldRotation() * mRotation;
-        }
-        return mRotation;
+        UpdateWorld();
+        return mWorldRotation;
     }
 
 	glm::vec3 Transform::GetWorldRotationEuler()
@@ -5,16 +5,23 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
 namespace JamesEngine
 {
 	class Transform : public Component
 	{
 	public:
+        ~Transform();
+
         glm::mat4 GetModel();
+        glm::mat4 GetLocalModel();
 
-        void SetParent(std::shared_ptr<Entity> _parent) { mParent = _parent; }
+        void SetParent(std::shared_ptr<Entity> _parent);
 
-        void SetPosition(glm::vec3 _position) { mPosition = _position; }
+        void SetPosition(glm::vec3 _position) { mPosition = _position; MarkDirty(); }
 		glm::vec3 GetLocalPosition() { return mPosition; }
         glm::vec3 GetPosition();
 
@@ -22,6 +29,7 @@ namespace JamesEngine
         {
             mEulerRotation = _rotation;
             mRotation = glm::quat(glm::radians(_rotation));
+            MarkDirty();
         }
         glm::vec3 GetRotation() { return mEulerRotation; }
 
@@ -32,31 +40,64 @@ namespace JamesEngine
             glm::vec3 euler = glm::degrees(glm::eulerAngles(quat));
             euler.x = -euler.x;
             mEulerRotation = euler;
+            MarkDirty();
         }
 
-        void SetScale(glm::vec3 _scale) { mScale = _scale; }
+        void SetScale(glm::vec3 _scale) { mScale = _scale; MarkDirty(); }
         glm::vec3 GetScale();
 
         glm::vec3 GetForward();
         glm::vec3 GetRight();
         glm::vec3 GetUp();
 
-        void Move(glm::vec3 _amount) { mPosition += _amount; }
+        void Move(glm::vec3 _amount) { mPosition += _amount; MarkDirty(); }
         void Rotate(glm::vec3 _rotation)
         {
             mEulerRotation += _rotation;
             mRotation = glm::quat(glm::radians(mEulerRotation));
+            MarkDirty();
         }
 
         glm::quat GetWorldRotation();
 		glm::vec3 GetWorldRotationEuler();
 
+        // Goes up every time the world transform changes, so something holding on to GetModel() can tell when it is out of date
+        uint32_t GetWorldVersion() { UpdateWorld(); return mWorldVersion; }
+
+        // Goes up every time any transform's world values go out of date, so Core can tell whether there is anything to bring up to date
+        static uint64_t GetWorldDirtyCount() { return sWorldDirtyCount.load(std::memory_order_relaxed); }
+
     private:
+        friend class Core;
+
+        // Called when our local values change
+        void MarkDirty();
+        // Marks this transform and everything parented to it as needing the world values recomputed
+        void MarkWorldDirty();
+        void UpdateWorld();
+
+        void RemoveChild(Transform* _child);
+
         glm::vec3 mPosition{ 0.f };
         glm::vec3 mEulerRotation{ 0.f };
         glm::quat mRotation{ 1.f, 0.f, 0.f, 0.f };
         glm::vec3 mScale{ 1.f };
 
-        std::weak_ptr<Entity> mParent;
+        // Raw pointers are kept valid by the destructor, which unhooks this transform from both sides
+        Transform* mParent = nullptr;
+        std::vector<Transform*> mChildren;
+
+        // Cached world space values, only recomputed when something up the chain has changed
+        glm::vec3 mWorldPosition{ 0.f };
+        glm::quat mWorldRotation{ 1.f, 0.f, 0.f, 0.f };
+        glm::vec3 mWorldScale{ 1.f };
+        glm::mat4 mWorldModel{ 1.f };
+        bool mWorldDirty = true;
+        uint32_t mWorldVersion = 0;
+
+        inline static std::atomic<uint64_t> sWorldDirtyCount{ 0 };
+
+        glm::mat4 mLocalModel{ 1.f };
+        bool mLocalDirty = true;
 	};
 }
\ No newline at end of file
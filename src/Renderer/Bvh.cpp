@@ -0,0 +1,211 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Renderer
+{
+	namespace
+	{
+		Aabb merge(const Aabb& _a, const Aabb& _b)
+		{
+			return { glm::min(_a.min, _b.min), glm::max(_a.max, _b.max) };
+		}
+
+		enum class Side { Outside, Crossing, Inside };
+
+		// Which side of the planes in _planeMask the box is on. Planes the box is fully inside are cleared from _planeMask
+		Side classify(const Aabb& _box, const glm::vec4* _planes, int _planeCount, uint32_t& _planeMask)
+		{
+			const glm::vec3 center = 0.5f * (_box.min + _box.max);
+			const glm::vec3 extent = 0.5f * (_box.max - _box.min);
+
+			for (int i = 0; i < _planeCount; ++i)
+			{
+				if (!(_planeMask & (1u << i)))
+					continue;
+
+				const glm::vec3 normal(_planes[i]);
+				const float distance = glm::dot(normal, center) + _planes[i].w;
+				const float radius = glm::dot(glm::abs(normal), extent);
+
+				if (distance < -radius)
+					return Side::Outside;
+				if (distance >= radius)
+					_planeMask &= ~(1u << i);
+			}
+
+			return _planeMask == 0 ? Side::Inside : Side::Crossing;
+		}
+	}
+
+	void Bvh::build(const std::vector<Aabb>& _bounds)
+	{
+		m_itemBounds = _bounds;
+		m_nodes.clear();
+		m_items.resize(_bounds.size());
+		std::iota(m_items.begin(), m_items.end(), 0u);
+		m_leafOf.assign(_bounds.size(), 0);
+		m_refitCount = 0;
+
+		if (_bounds.empty())
+			return;
+
+		std::vector<glm::vec3> centers(_bounds.size());
+		for (size_t i = 0; i < _bounds.size(); ++i)
+			centers[i] = 0.5f * (_bounds[i].min + _bounds[i].max);
+
+		m_nodes.reserve(2 * (_bounds.size() / kMaxLeafItems + 1));
+
+		Node root;
+		root.firstItem = 0;
+		root.itemCount = (uint32_t)_bounds.size();
+		m_nodes.push_back(root);
+
+		split(0, centers);
+
+		m_treeBounds.resize(m_items.size());
+		m_treePosition.resize(m_items.size());
+		for (uint32_t i = 0; i < (uint32_t)m_items.size(); ++i)
+		{
+			const Aabb& bounds = m_itemBounds[m_items[i]];
+			m_treeBounds.set(i, 0.5f * (bounds.min + bounds.max), 0.5f * (bounds.max - bounds.min));
+			m_treePosition[m_items[i]] = i;
+		}
+	}
+
+	void Bvh::split(uint32_t _node, const std::vector<glm::vec3>& _centers)
+	{
+		const uint32_t firstItem = m_nodes[_node].firstItem;
+		const uint32_t itemCount = m_nodes[_node].itemCount;
+
+		m_nodes[_node].bounds = itemsBounds(firstItem, itemCount);
+
+		if (itemCount <= kMaxLeafItems)
+		{
+			for (uint32_t i = firstItem; i < firstItem + itemCount; ++i)
+				m_leafOf[m_items[i]] = _node;
+			return;
+		}
+
+		// Median of the item centres along whichever axis they are most spread out on
+		glm::vec3 centerMin = _centers[m_items[firstItem]];
+		glm::vec3 centerMax = centerMin;
+		for (uint32_t i = firstItem + 1; i < firstItem + itemCount; ++i)
+		{
+			centerMin = glm::min(centerMin, _centers[m_items[i]]);
+			centerMax = glm::max(centerMax, _centers[m_items[i]]);
+		}
+
+		const glm::vec3 spread = centerMax - centerMin;
+		const int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+		const uint32_t half = itemCount / 2;
+		auto begin = m_items.begin() + firstItem;
+		std::nth_element(begin, begin + half, begin + itemCount,
+			[&](uint32_t _a, uint32_t _b) { return _centers[_a][axis] < _centers[_b][axis]; });
+
+		const uint32_t left = (uint32_t)m_nodes.size();
+
+		Node leftNode;
+		leftNode.firstItem = firstItem;
+		leftNode.itemCount = half;
+		leftNode.parent = _node;
+
+		Node rightNode;
+		rightNode.firstItem = firstItem + half;
+		rightNode.itemCount = itemCount - half;
+		rightNode.parent = _node;
+
+		m_nodes.push_back(leftNode);
+		m_nodes.push_back(rightNode);
+		m_nodes[_node].left = left;
+
+		split(left, _centers);
+		split(left + 1, _centers);
+	}
+
+	Aabb Bvh::itemsBounds(uint32_t _firstItem, uint32_t _itemCount) const
+	{
+		Aabb bounds = m_itemBounds[m_items[_firstItem]];
+		for (uint32_t i = _firstItem + 1; i < _firstItem + _itemCount; ++i)
+			bounds = merge(bounds, m_itemBounds[m_items[i]]);
+		return bounds;
+	}
+
+	void Bvh::refit(uint32_t _item, const Aabb& _bounds)
+	{
+		if (_item >= m_itemBounds.size())
+			return;
+
+		m_itemBounds[_item] = _bounds;
+		m_treeBounds.set(m_treePosition[_item], 0.5f * (_bounds.min + _bounds.max), 0.5f * (_bounds.max - _bounds.min));
+		m_refitCount++;
+
+		uint32_t node = m_leafOf[_item];
+		m_nodes[node].bounds = itemsBounds(m_nodes[node].firstItem, m_nodes[node].itemCount);
+
+		// Recomputed rather than grown, so a node shrinks again once something moves back out of it
+		for (node = m_nodes[node].parent; node != kNoParent; node = m_nodes[node].parent)
+		{
+			const uint32_t left = m_nodes[node].left;
+			m_nodes[node].bounds = merge(m_nodes[left].bounds, m_nodes[left + 1].bounds);
+		}
+	}
+
+	void Bvh::cull(const glm::vec4* _planes, int _planeCount, std::vector<uint32_t>& _inside, std::vector<uint32_t>& _crossing) const
+	{
+		if (m_nodes.empty() || _planeCount > 32)
+			return;
+
+		cullNode(0, _planes, _planeCount, _planeCount == 32 ? 0xFFFFFFFF : (1u << _planeCount) - 1, _inside, _crossing);
+	}
+
+	void Bvh::cullNode(uint32_t _node, const glm::vec4* _planes, int _planeCount, uint32_t _planeMask, std::vector<uint32_t>& _inside, std::vector<uint32_t>& _crossing) const
+	{
+		const Node& node = m_nodes[_node];
+
+		// Children only need testing against the planes this node crosses
+		const Side side = classify(node.bounds, _planes, _planeCount, _planeMask);
+		if (side == Side::Outside)
+			return;
+
+		if (side == Side::Inside)
+		{
+			_inside.insert(_inside.end(), m_items.begin() + node.firstItem, m_items.begin() + node.firstItem + node.itemCount);
+			return;
+		}
+
+		if (node.left != 0 && node.itemCount > kBatchItems)
+		{
+			cullNode(node.left, _planes, _planeCount, _planeMask, _inside, _crossing);
+			cullNode(node.left + 1, _planes, _planeCount, _planeMask, _inside, _crossing);
+			return;
+		}
+
+		// Few enough items left to test them all at once, against just the planes this node crosses
+		glm::vec4 crossedPlanes[32];
+		int crossedCount = 0;
+		for (int i = 0; i < _planeCount; ++i)
+		{
+			if (_planeMask & (1u << i))
+				crossedPlanes[crossedCount++] = _planes[i];
+		}
+
+		uint64_t visible = 0;
+		uint64_t inside = 0;
+		cullAabbs(crossedPlanes, crossedCount, m_treeBounds, node.firstItem, node.itemCount, &visible, &inside);
+
+		for (uint32_t i = 0; i < node.itemCount; ++i)
+		{
+			if (!(visible & (1ull << i)))
+				continue;
+
+			const uint32_t item = m_items[node.firstItem + i];
+			if (inside & (1ull << i))
+				_inside.push_back(item);
+			else
+				_crossing.push_back(item);
+		}
+	}
+}
\ No newline at end of file
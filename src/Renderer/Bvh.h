@@ -0,0 +1,68 @@
+#pragma once
+
+#include "FrustumCull.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	struct Aabb
+	{
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+
+	// Bounding volume hierarchy over boxes, so culling only walks the parts of the tree near what is visible.
+	// Items are numbered by their place in the array given to build(). Everything under a node is one run of items in tree order,
+	// so a node entirely inside a query is taken whole without visiting its children
+	class Bvh
+	{
+	public:
+		// Builds the tree from scratch, splitting at the median of the longest axis
+		void build(const std::vector<Aabb>& _bounds);
+
+		// Moves one item. The nodes above it are refit, which keeps the tree valid but looser than a rebuild would make it
+		void refit(uint32_t _item, const Aabb& _bounds);
+
+		// Items whose box is fully inside every plane go in _inside, those crossing a plane in _crossing. Planes are xyz normal pointing in, w distance, up to 32 of them
+		void cull(const glm::vec4* _planes, int _planeCount, std::vector<uint32_t>& _inside, std::vector<uint32_t>& _crossing) const;
+
+		size_t size() const { return m_itemBounds.size(); }
+
+		// How many refits since the last build, for deciding when the tree has loosened enough to rebuild
+		size_t refitCount() const { return m_refitCount; }
+
+	private:
+		struct Node
+		{
+			Aabb bounds;
+			uint32_t firstItem = 0; // The run of m_items under this node
+			uint32_t itemCount = 0;
+			uint32_t left = 0; // First child, the right one is left + 1. 0 for a leaf, since the root is never a child
+			uint32_t parent = kNoParent;
+		};
+
+		static constexpr uint32_t kNoParent = 0xFFFFFFFF;
+
+		static constexpr uint32_t kMaxLeafItems = 4;
+
+		// Crossing nodes with this many items or fewer test them all at once with cullAabbs instead of walking down to the leaves. At most 64, one mask word
+		static constexpr uint32_t kBatchItems = 32;
+
+		void split(uint32_t _node, const std::vector<glm::vec3>& _centers);
+		Aabb itemsBounds(uint32_t _firstItem, uint32_t _itemCount) const;
+		void cullNode(uint32_t _node, const glm::vec4* _planes, int _planeCount, uint32_t _planeMask, std::vector<uint32_t>& _inside, std::vector<uint32_t>& _crossing) const;
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_items;      // Item numbers in tree order
+		std::vector<uint32_t> m_leafOf;     // The leaf node each item is in
+		std::vector<Aabb> m_itemBounds;
+		AabbSoA m_treeBounds;               // The item boxes again in tree order, for cullAabbs
+		std::vector<uint32_t> m_treePosition; // Where each item is in m_items
+		size_t m_refitCount = 0;
+	};
+}
\ No newline at end of file
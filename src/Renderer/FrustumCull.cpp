@@ -0,0 +1,400 @@
+#include "FrustumCull.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RENDERER_CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX instructions in functions marked for them, MSVC allows them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define RENDERER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RENDERER_TARGET_AVX2
+#endif
+
+namespace Renderer
+{
+	void AabbSoA::resize(size_t _size)
+	{
+		centerX.resize(_size); centerY.resize(_size); centerZ.resize(_size);
+		extentX.resize(_size); extentY.resize(_size); extentZ.resize(_size);
+	}
+
+	void AabbSoA::set(size_t _index, const glm::vec3& _center, const glm::vec3& _extent)
+	{
+		centerX[_index] = _center.x; centerY[_index] = _center.y; centerZ[_index] = _center.z;
+		extentX[_index] = _extent.x; extentY[_index] = _extent.y; extentZ[_index] = _extent.z;
+	}
+
+	namespace
+	{
+		// More planes than this and the SIMD paths hand over to the scalar one, a frustum only needs 6
+		constexpr int kMaxSimdPlanes = 8;
+
+		// The sums are written out in the same order in every path, so they all round the same way and agree bit for bit
+
+		// Tests spheres _begin to _end (counted from _first) and ORs their bits into _visible
+		void cullSpheresRange(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _begin, size_t _end, uint64_t* _visible)
+		{
+			for (size_t i = _begin; i < _end; ++i)
+			{
+				const size_t s = _first + i;
+				const float negRadius = -_spheres.radius[s];
+
+				bool outside = false;
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const float distance = _planes[p].x * _spheres.x[s] + _planes[p].y * _spheres.y[s] + _planes[p].z * _spheres.z[s] + _planes[p].w;
+					if (distance < negRadius)
+					{
+						outside = true;
+						break;
+					}
+				}
+
+				if (!outside)
+					_visible[i >> 6] |= 1ull << (i & 63);
+			}
+		}
+
+		void cullAabbsRange(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _begin, size_t _end, uint64_t* _visible, uint64_t* _inside)
+		{
+			for (size_t i = _begin; i < _end; ++i)
+			{
+				const size_t b = _first + i;
+
+				bool outside = false;
+				bool inside = true;
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const float distance = _planes[p].x * _boxes.centerX[b] + _planes[p].y * _boxes.centerY[b] + _planes[p].z * _boxes.centerZ[b] + _planes[p].w;
+					const float radius = std::abs(_planes[p].x) * _boxes.extentX[b] + std::abs(_planes[p].y) * _boxes.extentY[b] + std::abs(_planes[p].z) * _boxes.extentZ[b];
+
+					if (distance < -radius)
+					{
+						outside = true;
+						break;
+					}
+					if (!(distance >= radius))
+						inside = false;
+				}
+
+				if (outside)
+					continue;
+
+				_visible[i >> 6] |= 1ull << (i & 63);
+				if (_inside && inside)
+					_inside[i >> 6] |= 1ull << (i & 63);
+			}
+		}
+
+		void clearMask(uint64_t* _mask, size_t _count)
+		{
+			if (_mask)
+				std::fill(_mask, _mask + cullMaskWords(_count), 0ull);
+		}
+
+#ifdef RENDERER_CULL_X86
+		// 4 at a time. Groups of 4 never straddle two mask words
+		void cullSpheresSse(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible)
+		{
+			__m128 nx[kMaxSimdPlanes], ny[kMaxSimdPlanes], nz[kMaxSimdPlanes], nw[kMaxSimdPlanes];
+			for (int p = 0; p < _planeCount; ++p)
+			{
+				nx[p] = _mm_set1_ps(_planes[p].x);
+				ny[p] = _mm_set1_ps(_planes[p].y);
+				nz[p] = _mm_set1_ps(_planes[p].z);
+				nw[p] = _mm_set1_ps(_planes[p].w);
+			}
+
+			const float* x = _spheres.x.data() + _first;
+			const float* y = _spheres.y.data() + _first;
+			const float* z = _spheres.z.data() + _first;
+			const float* r = _spheres.radius.data() + _first;
+
+			size_t i = 0;
+			for (; i + 4 <= _count; i += 4)
+			{
+				const __m128 cx = _mm_loadu_ps(x + i);
+				const __m128 cy = _mm_loadu_ps(y + i);
+				const __m128 cz = _mm_loadu_ps(z + i);
+				const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+
+				__m128 outside = _mm_setzero_ps();
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_mul_ps(nz[p], cz)), nw[p]);
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+				}
+
+				const uint64_t visible = uint64_t(~_mm_movemask_ps(outside) & 0xF);
+				_visible[i >> 6] |= visible << (i & 63);
+			}
+
+			cullSpheresRange(_planes, _planeCount, _spheres, _first, i, _count, _visible);
+		}
+
+		void cullAabbsSse(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside)
+		{
+			__m128 nx[kMaxSimdPlanes], ny[kMaxSimdPlanes], nz[kMaxSimdPlanes], nw[kMaxSimdPlanes];
+			__m128 ax[kMaxSimdPlanes], ay[kMaxSimdPlanes], az[kMaxSimdPlanes];
+			for (int p = 0; p < _planeCount; ++p)
+			{
+				nx[p] = _mm_set1_ps(_planes[p].x);
+				ny[p] = _mm_set1_ps(_planes[p].y);
+				nz[p] = _mm_set1_ps(_planes[p].z);
+				nw[p] = _mm_set1_ps(_planes[p].w);
+				ax[p] = _mm_set1_ps(std::abs(_planes[p].x));
+				ay[p] = _mm_set1_ps(std::abs(_planes[p].y));
+				az[p] = _mm_set1_ps(std::abs(_planes[p].z));
+			}
+
+			size_t i = 0;
+			for (; i + 4 <= _count; i += 4)
+			{
+				const size_t b = _first + i;
+				const __m128 cx = _mm_loadu_ps(_boxes.centerX.data() + b);
+				const __m128 cy = _mm_loadu_ps(_boxes.centerY.data() + b);
+				const __m128 cz = _mm_loadu_ps(_boxes.centerZ.data() + b);
+				const __m128 ex = _mm_loadu_ps(_boxes.extentX.data() + b);
+				const __m128 ey = _mm_loadu_ps(_boxes.extentY.data() + b);
+				const __m128 ez = _mm_loadu_ps(_boxes.extentZ.data() + b);
+
+				__m128 outside = _mm_setzero_ps();
+				__m128 crossing = _mm_setzero_ps();
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_mul_ps(nz[p], cz)), nw[p]);
+					const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+					crossing = _mm_or_ps(crossing, _mm_cmpnge_ps(distance, radius));
+				}
+
+				const uint64_t visible = uint64_t(~_mm_movemask_ps(outside) & 0xF);
+				_visible[i >> 6] |= visible << (i & 63);
+				if (_inside)
+					_inside[i >> 6] |= (visible & uint64_t(~_mm_movemask_ps(crossing) & 0xF)) << (i & 63);
+			}
+
+			cullAabbsRange(_planes, _planeCount, _boxes, _first, i, _count, _visible, _inside);
+		}
+
+		// 8 at a time, the same as the SSE path otherwise
+		RENDERER_TARGET_AVX2 void cullSpheresAvx2(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible)
+		{
+			__m256 nx[kMaxSimdPlanes], ny[kMaxSimdPlanes], nz[kMaxSimdPlanes], nw[kMaxSimdPlanes];
+			for (int p = 0; p < _planeCount; ++p)
+			{
+				nx[p] = _mm256_set1_ps(_planes[p].x);
+				ny[p] = _mm256_set1_ps(_planes[p].y);
+				nz[p] = _mm256_set1_ps(_planes[p].z);
+				nw[p] = _mm256_set1_ps(_planes[p].w);
+			}
+
+			const float* x = _spheres.x.data() + _first;
+			const float* y = _spheres.y.data() + _first;
+			const float* z = _spheres.z.data() + _first;
+			const float* r = _spheres.radius.data() + _first;
+
+			size_t i = 0;
+			for (; i + 8 <= _count; i += 8)
+			{
+				const __m256 cx = _mm256_loadu_ps(x + i);
+				const __m256 cy = _mm256_loadu_ps(y + i);
+				const __m256 cz = _mm256_loadu_ps(z + i);
+				const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+
+				__m256 outside = _mm256_setzero_ps();
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_mul_ps(nz[p], cz)), nw[p]);
+					outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negRadius, _CMP_LT_OQ));
+				}
+
+				const uint64_t visible = uint64_t(~_mm256_movemask_ps(outside) & 0xFF);
+				_visible[i >> 6] |= visible << (i & 63);
+			}
+
+			cullSpheresRange(_planes, _planeCount, _spheres, _first, i, _count, _visible);
+		}
+
+		RENDERER_TARGET_AVX2 void cullAabbsAvx2(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside)
+		{
+			__m256 nx[kMaxSimdPlanes], ny[kMaxSimdPlanes], nz[kMaxSimdPlanes], nw[kMaxSimdPlanes];
+			__m256 ax[kMaxSimdPlanes], ay[kMaxSimdPlanes], az[kMaxSimdPlanes];
+			for (int p = 0; p < _planeCount; ++p)
+			{
+				nx[p] = _mm256_set1_ps(_planes[p].x);
+				ny[p] = _mm256_set1_ps(_planes[p].y);
+				nz[p] = _mm256_set1_ps(_planes[p].z);
+				nw[p] = _mm256_set1_ps(_planes[p].w);
+				ax[p] = _mm256_set1_ps(std::abs(_planes[p].x));
+				ay[p] = _mm256_set1_ps(std::abs(_planes[p].y));
+				az[p] = _mm256_set1_ps(std::abs(_planes[p].z));
+			}
+
+			size_t i = 0;
+			for (; i + 8 <= _count; i += 8)
+			{
+				const size_t b = _first + i;
+				const __m256 cx = _mm256_loadu_ps(_boxes.centerX.data() + b);
+				const __m256 cy = _mm256_loadu_ps(_boxes.centerY.data() + b);
+				const __m256 cz = _mm256_loadu_ps(_boxes.centerZ.data() + b);
+				const __m256 ex = _mm256_loadu_ps(_boxes.extentX.data() + b);
+				const __m256 ey = _mm256_loadu_ps(_boxes.extentY.data() + b);
+				const __m256 ez = _mm256_loadu_ps(_boxes.extentZ.data() + b);
+
+				__m256 outside = _mm256_setzero_ps();
+				__m256 crossing = _mm256_setzero_ps();
+				for (int p = 0; p < _planeCount; ++p)
+				{
+					const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_mul_ps(nz[p], cz)), nw[p]);
+					const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+
+					outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), radius), _CMP_LT_OQ));
+					crossing = _mm256_or_ps(crossing, _mm256_cmp_ps(distance, radius, _CMP_NGE_UQ));
+				}
+
+				const uint64_t visible = uint64_t(~_mm256_movemask_ps(outside) & 0xFF);
+				_visible[i >> 6] |= visible << (i & 63);
+				if (_inside)
+					_inside[i >> 6] |= (visible & uint64_t(~_mm256_movemask_ps(crossing) & 0xFF)) << (i & 63);
+			}
+
+			cullAabbsRange(_planes, _planeCount, _boxes, _first, i, _count, _visible, _inside);
+		}
+
+		bool cpuHasAvx2()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// The OS has to save the upper halves of the registers too, or they're corrupted on a context switch
+			__cpuid(info, 1);
+			const bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			if (!osSavesAvx)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+		enum class CullPath { Scalar, Sse, Avx2 };
+
+		// Only changed by setCullInstructionSet
+		CullPath& cullPath()
+		{
+			static CullPath path = []
+				{
+#ifdef RENDERER_CULL_X86
+					return cpuHasAvx2() ? CullPath::Avx2 : CullPath::Sse; // Every x86 CPU the engine runs on has SSE
+#else
+					return CullPath::Scalar;
+#endif
+				}();
+			return path;
+		}
+	}
+
+	void cullSpheres(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible)
+	{
+		clearMask(_visible, _count);
+
+#ifdef RENDERER_CULL_X86
+		if (_planeCount <= kMaxSimdPlanes)
+		{
+			switch (cullPath())
+			{
+			case CullPath::Avx2: cullSpheresAvx2(_planes, _planeCount, _spheres, _first, _count, _visible); return;
+			case CullPath::Sse: cullSpheresSse(_planes, _planeCount, _spheres, _first, _count, _visible); return;
+			default: break;
+			}
+		}
+#endif
+
+		cullSpheresRange(_planes, _planeCount, _spheres, _first, 0, _count, _visible);
+	}
+
+	void cullAabbs(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside)
+	{
+		clearMask(_visible, _count);
+		clearMask(_inside, _count);
+
+#ifdef RENDERER_CULL_X86
+		if (_planeCount <= kMaxSimdPlanes)
+		{
+			switch (cullPath())
+			{
+			case CullPath::Avx2: cullAabbsAvx2(_planes, _planeCount, _boxes, _first, _count, _visible, _inside); return;
+			case CullPath::Sse: cullAabbsSse(_planes, _planeCount, _boxes, _first, _count, _visible, _inside); return;
+			default: break;
+			}
+		}
+#endif
+
+		cullAabbsRange(_planes, _planeCount, _boxes, _first, 0, _count, _visible, _inside);
+	}
+
+	void cullSpheresScalar(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible)
+	{
+		clearMask(_visible, _count);
+		cullSpheresRange(_planes, _planeCount, _spheres, _first, 0, _count, _visible);
+	}
+
+	void cullAabbsScalar(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside)
+	{
+		clearMask(_visible, _count);
+		clearMask(_inside, _count);
+		cullAabbsRange(_planes, _planeCount, _boxes, _first, 0, _count, _visible, _inside);
+	}
+
+	bool setCullInstructionSet(const char* _name)
+	{
+		const std::string name = _name;
+		if (name == "Scalar")
+		{
+			cullPath() = CullPath::Scalar;
+			return true;
+		}
+
+#ifdef RENDERER_CULL_X86
+		if (name == "SSE")
+		{
+			cullPath() = CullPath::Sse;
+			return true;
+		}
+		if (name == "AVX2" && cpuHasAvx2())
+		{
+			cullPath() = CullPath::Avx2;
+			return true;
+		}
+#endif
+
+		return false;
+	}
+
+	const char* cullInstructionSet()
+	{
+		switch (cullPath())
+		{
+		case CullPath::Avx2: return "AVX2";
+		case CullPath::Sse: return "SSE";
+		default: return "Scalar";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	// Bounding spheres with each component in its own array, so a run of them loads straight into SIMD registers
+	struct SphereSoA
+	{
+		std::vector<float> x, y, z, radius;
+
+		size_t size() const { return x.size(); }
+		void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+		void push_back(const glm::vec3& _center, float _radius) { x.push_back(_center.x); y.push_back(_center.y); z.push_back(_center.z); radius.push_back(_radius); }
+	};
+
+	// Axis aligned boxes as centres and half extents, laid out like SphereSoA
+	struct AabbSoA
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+
+		size_t size() const { return centerX.size(); }
+		void resize(size_t _size);
+		void set(size_t _index, const glm::vec3& _center, const glm::vec3& _extent);
+	};
+
+	// One bit per item, bit i of word i / 64
+	inline size_t cullMaskWords(size_t _count) { return (_count + 63) / 64; }
+	inline bool cullMaskTest(const uint64_t* _mask, size_t _index) { return (_mask[_index >> 6] >> (_index & 63)) & 1; }
+
+	// Sets bit i of _visible for each of the _count spheres from _first that isn't fully outside one of the planes.
+	// Planes are xyz normal pointing in, w distance, and only need to be normalised if the radii are in the same units.
+	// _visible needs cullMaskWords(_count) words, they are overwritten
+	void cullSpheres(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible);
+
+	// Same for boxes. _inside, if given, also gets a bit for each box fully inside every plane
+	void cullAabbs(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside = nullptr);
+
+	// One at a time versions, what the SIMD paths have to match
+	void cullSpheresScalar(const glm::vec4* _planes, int _planeCount, const SphereSoA& _spheres, size_t _first, size_t _count, uint64_t* _visible);
+	void cullAabbsScalar(const glm::vec4* _planes, int _planeCount, const AabbSoA& _boxes, size_t _first, size_t _count, uint64_t* _visible, uint64_t* _inside = nullptr);
+
+	// The instruction set the culling functions picked for this CPU, "AVX2", "SSE" or "Scalar"
+	const char* cullInstructionSet();
+
+	// Makes the culling functions use "AVX2", "SSE" or "Scalar" from now on, so tests and benchmarks can check every path on one CPU.
+	// Returns false, and changes nothing, if this CPU or build doesn't have it. Not thread safe, call it before culling anything
+	bool setCullInstructionSet(const char* _name);
+}
\ No newline at end of file
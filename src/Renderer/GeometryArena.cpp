@@ -0,0 +1,168 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace Renderer
+{
+	GeometryArena::GeometryArena(GLsizei _vertexSize, const std::vector<Attribute>& _attributes)
+		: m_vertexSize(_vertexSize)
+	{
+		glGenVertexArrays(1, &m_vao);
+		if (!m_vao)
+			throw std::runtime_error("Failed to generate vertex array");
+
+		// Every attribute reads from binding 0, so growing only has to point that binding at the new buffer
+		glBindVertexArray(m_vao);
+		for (const Attribute& attribute : _attributes)
+		{
+			glEnableVertexAttribArray(attribute.location);
+			glVertexAttribFormat(attribute.location, attribute.size, attribute.type, attribute.normalized, attribute.offset);
+			glVertexAttribBinding(attribute.location, 0);
+		}
+		glBindVertexArray(0);
+	}
+
+	GeometryArena::~GeometryArena()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+	}
+
+	GeometryArena::Range GeometryArena::allocate(const void* _vertices, size_t _vertexCount, const uint32_t* _indices, size_t _indexCount)
+	{
+		Range range;
+		range.vertexCount = uint32_t(_vertexCount);
+		range.indexCount = uint32_t(_indexCount);
+
+		bool grown = false;
+
+		if (_vertexCount > 0)
+		{
+			range.firstVertex = m_freeVertices.allocate(range.vertexCount);
+			if (range.firstVertex == std::numeric_limits<uint32_t>::max())
+			{
+				grow(m_vbo, m_vertexCapacity, m_freeVertices, size_t(m_vertexSize), m_vertexCapacity + _vertexCount);
+				range.firstVertex = m_freeVertices.allocate(range.vertexCount);
+				grown = true;
+			}
+
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(range.firstVertex) * m_vertexSize, GLsizeiptr(_vertexCount) * m_vertexSize, _vertices);
+		}
+
+		if (_indexCount > 0)
+		{
+			range.firstIndex = m_freeIndices.allocate(range.indexCount);
+			if (range.firstIndex == std::numeric_limits<uint32_t>::max())
+			{
+				grow(m_ebo, m_indexCapacity, m_freeIndices, sizeof(uint32_t), m_indexCapacity + _indexCount);
+				range.firstIndex = m_freeIndices.allocate(range.indexCount);
+				grown = true;
+			}
+
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(range.firstIndex) * sizeof(uint32_t), GLsizeiptr(_indexCount) * sizeof(uint32_t), _indices);
+		}
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		if (grown)
+		{
+			// The element buffer binding is part of the vertex array, like the vertex buffer binding
+			glBindVertexArray(m_vao);
+			glBindVertexBuffer(0, m_vbo, 0, m_vertexSize);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+			glBindVertexArray(0);
+		}
+
+		return range;
+	}
+
+	void GeometryArena::free(const Range& _range)
+	{
+		if (_range.vertexCount > 0)
+			m_freeVertices.release(_range.firstVertex, _range.vertexCount);
+		if (_range.indexCount > 0)
+			m_freeIndices.release(_range.firstIndex, _range.indexCount);
+	}
+
+	void GeometryArena::grow(GLuint& _buffer, size_t& _capacity, FreeList& _freeList, size_t _elementSize, size_t _needed)
+	{
+		const size_t initial = (&_freeList == &m_freeVertices) ? kInitialVertices : kInitialIndices;
+		const size_t capacity = std::max({ _needed, _capacity * 2, initial });
+
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		if (!buffer)
+			throw std::runtime_error("Failed to generate arena buffer");
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity * _elementSize), nullptr, GL_STATIC_DRAW);
+
+		// Copied on the GPU, nothing comes back to the CPU
+		if (_buffer)
+		{
+			glBindBuffer(GL_COPY_READ_BUFFER, _buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(_capacity * _elementSize));
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glDeleteBuffers(1, &_buffer);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		_freeList.release(uint32_t(_capacity), uint32_t(capacity - _capacity));
+		_buffer = buffer;
+		_capacity = capacity;
+	}
+
+	uint32_t GeometryArena::FreeList::allocate(uint32_t _count)
+	{
+		for (auto it = m_gaps.begin(); it != m_gaps.end(); ++it)
+		{
+			if (it->second < _count)
+				continue;
+
+			const uint32_t first = it->first;
+			const uint32_t left = it->second - _count;
+			m_gaps.erase(it);
+			if (left > 0)
+				m_gaps[first + _count] = left;
+			return first;
+		}
+
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	void GeometryArena::FreeList::release(uint32_t _first, uint32_t _count)
+	{
+		if (_count == 0)
+			return;
+
+		uint32_t first = _first;
+		uint32_t count = _count;
+
+		// Merge with the gap straight after it
+		auto next = m_gaps.find(first + count);
+		if (next != m_gaps.end())
+		{
+			count += next->second;
+			m_gaps.erase(next);
+		}
+
+		// And the one straight before it
+		auto after = m_gaps.lower_bound(first);
+		if (after != m_gaps.begin())
+		{
+			auto previous = std::prev(after);
+			if (previous->first + previous->second == first)
+			{
+				previous->second += count;
+				return;
+			}
+		}
+
+		m_gaps[first] = count;
+	}
+}
\ No newline at end of file
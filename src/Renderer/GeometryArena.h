@@ -0,0 +1,85 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	// One vertex buffer and one index buffer that many meshes are copied into, all drawn through the same vertex array with a base vertex.
+	// Draws of different meshes can then go in one glMultiDrawElementsIndirect. Indices are 32 bit and count from their own mesh's first vertex
+	class GeometryArena
+	{
+	public:
+		// One vertex attribute, at _offset bytes into each vertex
+		struct Attribute
+		{
+			GLuint location;
+			GLint size;
+			GLenum type;
+			GLboolean normalized;
+			GLuint offset;
+		};
+
+		// Where a mesh is in the buffers, in vertices and indices
+		struct Range
+		{
+			uint32_t firstVertex = 0;
+			uint32_t vertexCount = 0;
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+		};
+
+		GeometryArena(GLsizei _vertexSize, const std::vector<Attribute>& _attributes);
+		~GeometryArena();
+
+		GeometryArena(const GeometryArena&) = delete;
+		GeometryArena& operator=(const GeometryArena&) = delete;
+
+		// Copies a mesh in, growing the buffers when no gap left by a freed mesh is big enough. _vertices is _vertexCount vertices of the arena's size
+		Range allocate(const void* _vertices, size_t _vertexCount, const uint32_t* _indices, size_t _indexCount);
+		// Gives the range back to be reused. Only bookkeeping, so it is safe once the GL context has gone
+		void free(const Range& _range);
+
+		// The same for the arena's whole life, growing only swaps the buffers it reads from
+		GLuint vao() const { return m_vao; }
+
+		size_t vertexCapacity() const { return m_vertexCapacity; }
+		size_t indexCapacity() const { return m_indexCapacity; }
+
+	private:
+		// First fit over the gaps, neighbouring gaps are merged as ranges are freed
+		class FreeList
+		{
+		public:
+			// Start of a run of _count, or UINT32_MAX if no gap is big enough
+			uint32_t allocate(uint32_t _count);
+			void release(uint32_t _first, uint32_t _count);
+
+		private:
+			std::map<uint32_t, uint32_t> m_gaps; // First to count
+		};
+
+		// Makes _buffer at least _needed elements, copying what it held into the new one
+		void grow(GLuint& _buffer, size_t& _capacity, FreeList& _freeList, size_t _elementSize, size_t _needed);
+
+		GLsizei m_vertexSize = 0;
+
+		GLuint m_vao = 0;
+		GLuint m_vbo = 0;
+		GLuint m_ebo = 0;
+
+		size_t m_vertexCapacity = 0;
+		size_t m_indexCapacity = 0;
+
+		FreeList m_freeVertices;
+		FreeList m_freeIndices;
+
+		// The first buffers hold this many, then each grow at least doubles them
+		static constexpr size_t kInitialVertices = 1 << 16;
+		static constexpr size_t kInitialIndices = 1 << 18;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "GpuTimerPool.h"
+
+#include <iostream>
+
+namespace Renderer
+{
+	GpuTimerPool::~GpuTimerPool()
+	{
+		for (Frame& frame : m_frames)
+		{
+			if (!frame.queries.empty())
+				glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+		}
+	}
+
+	void GpuTimerPool::beginFrame()
+	{
+		if (!m_openTimers.empty())
+		{
+			std::cout << "GpuTimerPool: " << m_openTimers.size() << " timers were not ended last frame" << std::endl;
+			m_openTimers.clear();
+		}
+
+		m_frameIndex = (m_frameIndex + 1) % kFrameLatency;
+
+		// This frame's queries were last written kFrameLatency frames ago
+		Frame& frame = m_frames[m_frameIndex];
+		readBack(frame);
+
+		frame.usedQueries = 0;
+		frame.timers.clear();
+	}
+
+	void GpuTimerPool::begin(const std::string& _name)
+	{
+		if (m_frameIndex < 0)
+			return;
+
+		Frame& frame = m_frames[m_frameIndex];
+
+		Timer timer;
+		timer.name = _name;
+		timer.beginQuery = nextQuery(frame);
+		timer.depth = (int)m_openTimers.size();
+
+		glQueryCounter(timer.beginQuery, GL_TIMESTAMP);
+
+		m_openTimers.push_back((int)frame.timers.size());
+		frame.timers.push_back(timer);
+	}
+
+	void GpuTimerPool::end()
+	{
+		if (m_openTimers.empty())
+		{
+			std::cout << "GpuTimerPool: end() called without a matching begin()" << std::endl;
+			return;
+		}
+
+		Frame& frame = m_frames[m_frameIndex];
+
+		Timer& timer = frame.timers[m_openTimers.back()];
+		m_openTimers.pop_back();
+
+		timer.endQuery = nextQuery(frame);
+		glQueryCounter(timer.endQuery, GL_TIMESTAMP);
+	}
+
+	GLuint GpuTimerPool::nextQuery(Frame& _frame)
+	{
+		if (_frame.usedQueries == (int)_frame.queries.size())
+		{
+			GLuint query = 0;
+			glGenQueries(1, &query);
+			_frame.queries.push_back(query);
+		}
+
+		return _frame.queries[_frame.usedQueries++];
+	}
+
+	void GpuTimerPool::readBack(Frame& _frame)
+	{
+		if (_frame.timers.empty())
+			return;
+
+		// The last query written is the last the GPU will finish, if it is ready then so are the rest
+		GLuint available = 0;
+		glGetQueryObjectuiv(_frame.queries[_frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return; // Keep the previous results rather than stall
+
+		m_results.clear();
+		m_results.reserve(_frame.timers.size());
+
+		for (const Timer& timer : _frame.timers)
+		{
+			if (timer.endQuery == 0)
+				continue;
+
+			GLuint64 beginNs = 0;
+			GLuint64 endNs = 0;
+			glGetQueryObjectui64v(timer.beginQuery, GL_QUERY_RESULT, &beginNs);
+			glGetQueryObjectui64v(timer.endQuery, GL_QUERY_RESULT, &endNs);
+
+			GpuTimerResult result;
+			result.name = timer.name;
+			result.ms = (endNs - beginNs) / 1e6;
+			result.depth = timer.depth;
+			m_results.push_back(result);
+		}
+	}
+}
\ No newline at end of file
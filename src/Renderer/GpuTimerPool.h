@@ -0,0 +1,75 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+namespace Renderer
+{
+	struct GpuTimerResult
+	{
+		std::string name;
+		double ms = 0.0;
+		int depth = 0; // How many timers this one is nested in
+	};
+
+	// Times GPU work between begin() and end() with timestamp queries, which unlike GL_TIME_ELAPSED can be nested.
+	// Each frame writes its own set of queries and only reads them back kFrameLatency frames later, so the CPU never waits on the GPU.
+	class GpuTimerPool
+	{
+	public:
+		static constexpr int kFrameLatency = 3;
+
+		GpuTimerPool() {}
+		~GpuTimerPool();
+
+		// Reads back the oldest frame if the GPU has finished it, then starts recording into its queries
+		void beginFrame();
+
+		void begin(const std::string& _name);
+		void end();
+
+		// Timings from the most recent frame the GPU has finished, in the order the timers were started
+		const std::vector<GpuTimerResult>& getResults() const { return m_results; }
+
+	private:
+		struct Timer
+		{
+			std::string name;
+			GLuint beginQuery = 0;
+			GLuint endQuery = 0;
+			int depth = 0;
+		};
+
+		struct Frame
+		{
+			std::vector<GLuint> queries; // Grows as needed, reused every kFrameLatency frames
+			int usedQueries = 0;
+			std::vector<Timer> timers;
+		};
+
+		GLuint nextQuery(Frame& _frame);
+		void readBack(Frame& _frame);
+
+		Frame m_frames[kFrameLatency];
+		int m_frameIndex = -1;
+
+		std::vector<int> m_openTimers; // Indices into the current frame's timers
+		std::vector<GpuTimerResult> m_results;
+	};
+
+	// Times its own lifetime on the GPU
+	class GpuTimerScope
+	{
+	public:
+		GpuTimerScope(GpuTimerPool& _pool, const std::string& _name) : m_pool(_pool) { m_pool.begin(_name); }
+		~GpuTimerScope() { m_pool.end(); }
+
+		GpuTimerScope(const GpuTimerScope&) = delete;
+		GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+
+	private:
+		GpuTimerPool& m_pool;
+	};
+}
\ No newline at end of file
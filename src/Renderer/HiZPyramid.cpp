@@ -0,0 +1,295 @@
+#include "HiZPyramid.h"
+
+#include "Shader.h"
+#include "Mesh.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Renderer
+{
+	namespace
+	{
+		// The next level from _source, the same reduction HiZDownsample.frag does on the GPU
+		void downsample(const std::vector<float>& _source, const glm::ivec2& _sourceSize, std::vector<float>& _dest, const glm::ivec2& _destSize)
+		{
+			_dest.resize(size_t(_destSize.x) * _destSize.y);
+
+			for (int y = 0; y < _destSize.y; ++y)
+			{
+				const int y0 = std::min(y * 2, _sourceSize.y - 1);
+				const int y1 = (y == _destSize.y - 1) ? _sourceSize.y - 1 : y * 2 + 1;
+
+				for (int x = 0; x < _destSize.x; ++x)
+				{
+					const int x0 = std::min(x * 2, _sourceSize.x - 1);
+					const int x1 = (x == _destSize.x - 1) ? _sourceSize.x - 1 : x * 2 + 1;
+
+					float farthest = 0.0f;
+					for (int sy = y0; sy <= y1; ++sy)
+					{
+						for (int sx = x0; sx <= x1; ++sx)
+							farthest = std::max(farthest, _source[size_t(sy) * _sourceSize.x + sx]);
+					}
+
+					_dest[size_t(y) * _destSize.x + x] = farthest;
+				}
+			}
+		}
+	}
+
+	bool HiZSnapshot::isVisible(const glm::vec3& _min, const glm::vec3& _max) const
+	{
+		if (!valid())
+			return true;
+
+		glm::vec2 ndcMin(std::numeric_limits<float>::max());
+		glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+		float nearestDepth = 1.0f;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			const glm::vec3 corner((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+			const glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+
+			// At or behind the camera the projection flips, so there's no screen rect to test
+			if (clip.w <= 1e-5f)
+				return true;
+
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+			ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+			nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+		}
+
+		const glm::vec2 pixelMin = (ndcMin * 0.5f + 0.5f) * glm::vec2(screenSize);
+		const glm::vec2 pixelMax = (ndcMax * 0.5f + 0.5f) * glm::vec2(screenSize);
+
+		// Nothing is known about what was off screen
+		if (pixelMax.x < 0.0f || pixelMax.y < 0.0f || pixelMin.x >= screenSize.x || pixelMin.y >= screenSize.y)
+			return true;
+
+		const glm::ivec2 p0 = glm::clamp(glm::ivec2(glm::floor(pixelMin)), glm::ivec2(0), screenSize - 1);
+		const glm::ivec2 p1 = glm::clamp(glm::ivec2(glm::floor(pixelMax)), glm::ivec2(0), screenSize - 1);
+
+		// The finest level where the rect covers at most 2x2 texels
+		size_t level = 0;
+		glm::ivec2 t0, t1;
+		while (true)
+		{
+			const int shift = firstLevel + (int)level + 1;
+			t0 = glm::min(glm::ivec2(p0.x >> shift, p0.y >> shift), sizes[level] - 1);
+			t1 = glm::min(glm::ivec2(p1.x >> shift, p1.y >> shift), sizes[level] - 1);
+
+			if ((t1.x - t0.x <= 1 && t1.y - t0.y <= 1) || level + 1 == levels.size())
+				break;
+			level++;
+		}
+
+		float farthest = 0.0f;
+		for (int y = t0.y; y <= t1.y; ++y)
+		{
+			for (int x = t0.x; x <= t1.x; ++x)
+				farthest = std::max(farthest, levels[level][size_t(y) * sizes[level].x + x]);
+		}
+
+		return nearestDepth <= farthest;
+	}
+
+	HiZPyramid::~HiZPyramid()
+	{
+		destroyGL();
+
+		for (Readback& readback : m_readbacks)
+		{
+			if (readback.fence)
+				glDeleteSync(readback.fence);
+			if (readback.buffer)
+				glDeleteBuffers(1, &readback.buffer);
+		}
+	}
+
+	void HiZPyramid::destroyGL()
+	{
+		if (!m_fbos.empty())
+			glDeleteFramebuffers((GLsizei)m_fbos.size(), m_fbos.data());
+		m_fbos.clear();
+
+		if (m_texture)
+			glDeleteTextures(1, &m_texture);
+		m_texture = 0;
+	}
+
+	void HiZPyramid::resize(int _width, int _height)
+	{
+		const glm::ivec2 screenSize = glm::max(glm::ivec2(_width, _height), glm::ivec2(1));
+		if (screenSize == m_screenSize && m_texture)
+			return;
+
+		destroyGL();
+		m_screenSize = screenSize;
+
+		int levelCount = 1;
+		while (hiZLevelSize(m_screenSize, levelCount - 1) != glm::ivec2(1))
+			levelCount++;
+
+		const glm::ivec2 size = hiZLevelSize(m_screenSize, 0);
+
+		glGenTextures(1, &m_texture);
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_R32F, size.x, size.y);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		m_fbos.resize(levelCount);
+		glGenFramebuffers(levelCount, m_fbos.data());
+		for (int level = 0; level < levelCount; ++level)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[level]);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, level);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void HiZPyramid::build(Shader& _shader, Mesh& _quad, GLuint _depthTexture)
+	{
+		if (m_fbos.empty())
+			return;
+
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+		glDisable(GL_CULL_FACE);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		_shader.use();
+
+		for (int level = 0; level < levelCount(); ++level)
+		{
+			const glm::ivec2 size = hiZLevelSize(m_screenSize, level);
+			glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[level]);
+			glViewport(0, 0, size.x, size.y);
+
+			if (level == 0)
+			{
+				_shader.uniform("u_Source", _depthTexture, 0);
+			}
+			else
+			{
+				// Only the level below can be read, so the one being drawn into isn't also being sampled
+				glBindTexture(GL_TEXTURE_2D, m_texture);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+				_shader.uniform("u_Source", m_texture, 0);
+			}
+
+			_shader.draw(&_quad);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, m_texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount() - 1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void HiZPyramid::readback(const glm::mat4& _viewProj)
+	{
+		if (m_fbos.empty())
+			return;
+
+		int level = 0;
+		while (hiZLevelSize(m_screenSize, level).x > kMaxReadbackWidth && level + 1 < levelCount())
+			level++;
+
+		Readback& readback = m_readbacks[m_nextReadback];
+		m_nextReadback = (m_nextReadback + 1) % kReadbackLatency;
+
+		// Still not finished kReadbackLatency frames on, so it is dropped rather than waited for
+		if (readback.fence)
+		{
+			glDeleteSync(readback.fence);
+			readback.fence = nullptr;
+		}
+
+		if (!readback.buffer)
+			glGenBuffers(1, &readback.buffer);
+
+		readback.viewProj = _viewProj;
+		readback.screenSize = m_screenSize;
+		readback.level = level;
+		readback.size = hiZLevelSize(m_screenSize, level);
+
+		const GLsizeiptr bytes = GLsizeiptr(readback.size.x) * readback.size.y * sizeof(float);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[level]);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glReadPixels(0, 0, readback.size.x, readback.size.y, GL_RED, GL_FLOAT, nullptr);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	bool HiZPyramid::poll()
+	{
+		// Oldest first, fences pass in the order they were made so nothing after an unfinished one has finished either
+		Readback* newest = nullptr;
+		for (int i = 0; i < kReadbackLatency; ++i)
+		{
+			Readback& readback = m_readbacks[(m_nextReadback + i) % kReadbackLatency];
+			if (!readback.fence)
+				continue;
+
+			const GLenum status = glClientWaitSync(readback.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(readback.fence);
+			readback.fence = nullptr;
+			newest = &readback;
+		}
+
+		if (!newest)
+			return false;
+
+		const size_t texelCount = size_t(newest->size.x) * newest->size.y;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->buffer);
+		const float* texels = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, texelCount * sizeof(float), GL_MAP_READ_BIT));
+		if (!texels)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			return false;
+		}
+
+		m_snapshot.viewProj = newest->viewProj;
+		m_snapshot.screenSize = newest->screenSize;
+		m_snapshot.firstLevel = newest->level;
+		m_snapshot.sizes.clear();
+		m_snapshot.sizes.push_back(newest->size);
+		m_snapshot.levels.resize(1);
+		m_snapshot.levels[0].assign(texels, texels + texelCount);
+
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		// The rest of the pyramid is small enough to rebuild here rather than read back
+		while (m_snapshot.sizes.back() != glm::ivec2(1))
+		{
+			const size_t level = m_snapshot.sizes.size();
+			m_snapshot.sizes.push_back(hiZLevelSize(m_snapshot.screenSize, m_snapshot.firstLevel + (int)level));
+			m_snapshot.levels.emplace_back();
+			downsample(m_snapshot.levels[level - 1], m_snapshot.sizes[level - 1], m_snapshot.levels[level], m_snapshot.sizes[level]);
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
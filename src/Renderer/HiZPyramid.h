@@ -0,0 +1,96 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace Renderer
+{
+	class Shader;
+	class Mesh;
+
+	// Level l of a depth pyramid for a W x H depth buffer is max(1, W >> (l + 1)) by max(1, H >> (l + 1)), like a mip chain of a half size texture.
+	// Each texel holds the farthest depth of the 2x2 below it, and the last row and column also take in the leftover third one when the level below is odd.
+	// So full resolution pixel (x, y) is inside texel (min(x >> (l + 1), width - 1), min(y >> (l + 1), height - 1)) of level l
+
+	// A depth pyramid read back to the CPU, for testing against a recent frame's depth without waiting on the GPU
+	struct HiZSnapshot
+	{
+		glm::mat4 viewProj{ 1.0f }; // The camera the depth was drawn from, bounds are tested as they would have looked from it
+		glm::ivec2 screenSize{ 0 }; // Size of the full resolution depth buffer
+
+		int firstLevel = 0; // Pyramid level of levels[0], the coarser ones are built from it on the CPU
+		std::vector<glm::ivec2> sizes;
+		std::vector<std::vector<float>> levels;
+
+		bool valid() const { return !levels.empty(); }
+
+		// False only when the world space box is certainly behind the depth from viewProj. Boxes crossing the near plane or off the edge of the screen are visible
+		bool isVisible(const glm::vec3& _min, const glm::vec3& _max) const;
+	};
+
+	// Builds a depth pyramid on the GPU from a depth texture, and reads a coarse level of it back a few frames later
+	class HiZPyramid
+	{
+	public:
+		// Readbacks in flight. One is only looked at once its fence has passed, so the CPU never waits
+		static constexpr int kReadbackLatency = 3;
+
+		// The first level at most this wide is read back, coarser ones are rebuilt from it on the CPU
+		static constexpr int kMaxReadbackWidth = 256;
+
+		HiZPyramid() {}
+		~HiZPyramid();
+
+		HiZPyramid(const HiZPyramid&) = delete;
+		HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+		// Sizes the pyramid for a _width x _height depth buffer. Does nothing if it already is
+		void resize(int _width, int _height);
+
+		// Fills every level from _depthTexture. _shader is HiZDownsample, drawn over _quad once per level
+		void build(Shader& _shader, Mesh& _quad, GLuint _depthTexture);
+
+		// Starts copying the readback level to the CPU. It shows up in snapshot() a frame or more later, tested from _viewProj
+		void readback(const glm::mat4& _viewProj);
+
+		// Moves the newest finished readback into snapshot(). Returns false if none has finished since last time
+		bool poll();
+
+		const HiZSnapshot& snapshot() const { return m_snapshot; }
+
+		// R32F texture with every level as a mip
+		GLuint texture() const { return m_texture; }
+		int levelCount() const { return (int)m_fbos.size(); }
+		glm::ivec2 screenSize() const { return m_screenSize; }
+
+	private:
+		struct Readback
+		{
+			GLuint buffer = 0;
+			GLsync fence = nullptr;
+			glm::mat4 viewProj{ 1.0f };
+			glm::ivec2 screenSize{ 0 };
+			int level = 0;
+			glm::ivec2 size{ 0 };
+		};
+
+		void destroyGL();
+
+		glm::ivec2 m_screenSize{ 0 };
+		GLuint m_texture = 0;
+		std::vector<GLuint> m_fbos; // One per level, to draw into and read back from
+
+		Readback m_readbacks[kReadbackLatency];
+		int m_nextReadback = 0;
+
+		HiZSnapshot m_snapshot;
+	};
+
+	// Size of _level for a _screenSize depth buffer
+	inline glm::ivec2 hiZLevelSize(const glm::ivec2& _screenSize, int _level)
+	{
+		return glm::max(glm::ivec2(_screenSize.x >> (_level + 1), _screenSize.y >> (_level + 1)), glm::ivec2(1));
+	}
+}
\ No newline at end of file
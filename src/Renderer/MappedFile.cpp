@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Renderer
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& _path)
+	{
+		HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		m_file = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+			return;
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+			return;
+		m_mapping = mapping;
+
+		m_data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_data)
+			m_size = (size_t)size.QuadPart;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file) CloseHandle(m_file);
+	}
+#else
+	MappedFile::MappedFile(const std::string& _path)
+	{
+		m_fd = open(_path.c_str(), O_RDONLY);
+		if (m_fd < 0)
+			return;
+
+		struct stat info;
+		if (fstat(m_fd, &info) != 0 || info.st_size == 0)
+			return;
+
+		void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+		if (data == MAP_FAILED)
+			return;
+
+		m_data = static_cast<const unsigned char*>(data);
+		m_size = (size_t)info.st_size;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+		if (m_fd >= 0) close(m_fd);
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace Renderer
+{
+	// Read-only memory mapping of a whole file. The OS pages it in on demand, so nothing is copied until it is touched
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& _path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// False if the file couldn't be opened or mapped (or is empty)
+		bool isOpen() const { return m_data != nullptr; }
+
+		const unsigned char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+		const unsigned char* m_data = nullptr;
+		size_t m_size = 0;
+
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#else
+		int m_fd = -1;
+#endif
+	};
+}
\ No newline at end of file
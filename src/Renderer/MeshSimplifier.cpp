@@ -0,0 +1,326 @@
+#include "MeshSimplifier.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace Renderer
+{
+	namespace
+	{
+		// Sum of squared distances to a set of planes, weighted by the area of the triangle each came from
+		struct Quadric
+		{
+			double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			void addPlane(const glm::dvec3& _n, double _d, double _weight)
+			{
+				a00 += _weight * _n.x * _n.x;
+				a11 += _weight * _n.y * _n.y;
+				a22 += _weight * _n.z * _n.z;
+				a01 += _weight * _n.x * _n.y;
+				a02 += _weight * _n.x * _n.z;
+				a12 += _weight * _n.y * _n.z;
+				b0 += _weight * _n.x * _d;
+				b1 += _weight * _n.y * _d;
+				b2 += _weight * _n.z * _d;
+				c += _weight * _d * _d;
+				weight += _weight;
+			}
+
+			void add(const Quadric& _other)
+			{
+				a00 += _other.a00; a11 += _other.a11; a22 += _other.a22;
+				a01 += _other.a01; a02 += _other.a02; a12 += _other.a12;
+				b0 += _other.b0; b1 += _other.b1; b2 += _other.b2;
+				c += _other.c;
+				weight += _other.weight;
+			}
+
+			double error(const glm::dvec3& _p) const
+			{
+				double e = _p.x * _p.x * a00 + _p.y * _p.y * a11 + _p.z * _p.z * a22
+					+ 2.0 * (_p.x * _p.y * a01 + _p.x * _p.z * a02 + _p.y * _p.z * a12)
+					+ 2.0 * (_p.x * b0 + _p.y * b1 + _p.z * b2)
+					+ c;
+				return std::max(e, 0.0);
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			double cost; // Mean squared distance moved
+		};
+	}
+
+	std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& _indices, const float* _positions, size_t _vertexCount, size_t _stride,
+		size_t _targetIndexCount, float& _error)
+	{
+		_error = 0.0f;
+
+		std::vector<uint32_t> indices = _indices;
+		if (indices.size() <= _targetIndexCount || _vertexCount == 0)
+			return indices;
+
+		auto position = [&](uint32_t _vertex)
+			{
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(_positions) + _vertex * _stride);
+				return glm::dvec3(p[0], p[1], p[2]);
+			};
+
+		// Vertices at the same position (split by a uv or normal seam) are wedges of one point. Quadrics and borders are tracked on the first wedge
+		std::vector<uint32_t> remap(_vertexCount);
+		std::vector<uint32_t> wedgeCount(_vertexCount, 0);
+		{
+			const uint32_t kEmpty = 0xFFFFFFFF;
+			size_t tableSize = 16;
+			while (tableSize < _vertexCount * 2)
+				tableSize <<= 1;
+			std::vector<uint32_t> table(tableSize, kEmpty);
+
+			for (uint32_t v = 0; v < _vertexCount; ++v)
+			{
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(_positions) + v * _stride);
+
+				uint32_t bits[3];
+				std::memcpy(bits, p, sizeof(bits));
+				size_t slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (tableSize - 1);
+
+				while (true)
+				{
+					uint32_t other = table[slot];
+					if (other == kEmpty)
+					{
+						table[slot] = v;
+						remap[v] = v;
+						break;
+					}
+
+					const float* q = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(_positions) + other * _stride);
+					if (std::memcmp(p, q, sizeof(bits)) == 0)
+					{
+						remap[v] = other;
+						break;
+					}
+
+					slot = (slot + 1) & (tableSize - 1);
+				}
+
+				wedgeCount[remap[v]]++;
+			}
+		}
+
+		// Seams, borders and non-manifold edges stay where they are
+		std::vector<uint8_t> locked(_vertexCount, 0);
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUses;
+			edgeUses.reserve(indices.size());
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					uint32_t a = remap[indices[i + e]];
+					uint32_t b = remap[indices[i + (e + 1) % 3]];
+					uint64_t key = (uint64_t(std::min(a, b)) << 32) | uint64_t(std::max(a, b));
+					edgeUses[key]++;
+				}
+			}
+
+			for (const auto& [key, uses] : edgeUses)
+			{
+				if (uses != 2)
+				{
+					locked[uint32_t(key >> 32)] = 1;
+					locked[uint32_t(key & 0xFFFFFFFF)] = 1;
+				}
+			}
+
+			for (uint32_t v = 0; v < _vertexCount; ++v)
+			{
+				if (wedgeCount[remap[v]] > 1 || locked[remap[v]])
+					locked[v] = 1;
+			}
+		}
+
+		std::vector<Quadric> quadrics(_vertexCount);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			glm::dvec3 p0 = position(indices[i]);
+			glm::dvec3 p1 = position(indices[i + 1]);
+			glm::dvec3 p2 = position(indices[i + 2]);
+
+			glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+			double length = glm::length(n);
+			if (length <= 0.0)
+				continue;
+
+			n /= length;
+			double d = -glm::dot(n, p0);
+			for (int k = 0; k < 3; ++k)
+				quadrics[remap[indices[i + k]]].addPlane(n, d, length * 0.5);
+		}
+
+		auto collapseCost = [&](uint32_t _from, uint32_t _to)
+			{
+				Quadric q = quadrics[remap[_from]];
+				q.add(quadrics[remap[_to]]);
+				return q.weight > 0.0 ? q.error(position(_to)) / q.weight : 0.0;
+			};
+
+		std::vector<uint32_t> collapseTo(_vertexCount);
+		std::vector<uint8_t> touched(_vertexCount);
+		std::vector<uint32_t> triangleStart(_vertexCount + 1);
+		std::vector<uint32_t> triangleList;
+		std::vector<Collapse> candidates;
+		double maxCost = 0.0;
+
+		while (indices.size() > _targetIndexCount)
+		{
+			// Triangles around each vertex. An unlocked vertex has a single wedge, so this is every triangle it is in
+			std::fill(triangleStart.begin(), triangleStart.end(), 0);
+			for (uint32_t index : indices)
+				triangleStart[index + 1]++;
+			for (size_t v = 0; v < _vertexCount; ++v)
+				triangleStart[v + 1] += triangleStart[v];
+
+			triangleList.resize(indices.size());
+			{
+				std::vector<uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+				for (size_t i = 0; i < indices.size(); ++i)
+					triangleList[fill[indices[i]]++] = uint32_t(i / 3);
+			}
+
+			// The cheaper direction of each edge. Interior edges are in two triangles, once each way round, so only the a < b one is looked at
+			candidates.clear();
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					uint32_t a = indices[i + e];
+					uint32_t b = indices[i + (e + 1) % 3];
+					if (a >= b)
+						continue;
+
+					bool canAB = !locked[a];
+					bool canBA = !locked[b];
+					if (!canAB && !canBA)
+						continue;
+
+					double costAB = canAB ? collapseCost(a, b) : 0.0;
+					double costBA = canBA ? collapseCost(b, a) : 0.0;
+
+					if (canAB && (!canBA || costAB <= costBA))
+						candidates.push_back({ a, b, costAB });
+					else
+						candidates.push_back({ b, a, costBA });
+				}
+			}
+
+			if (candidates.empty())
+				break;
+
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& _a, const Collapse& _b) { return _a.cost < _b.cost; });
+
+			for (uint32_t v = 0; v < _vertexCount; ++v)
+				collapseTo[v] = v;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			// Each collapse removes about two triangles. Vertices around a collapse aren't touched again this pass, so every flip check sees up to date positions
+			const size_t trianglesToRemove = (indices.size() - _targetIndexCount) / 3;
+			size_t removed = 0;
+
+			for (const Collapse& collapse : candidates)
+			{
+				if (removed >= trianglesToRemove)
+					break;
+
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				const glm::dvec3 target = position(collapse.to);
+
+				bool flips = false;
+				size_t removes = 0;
+				for (uint32_t t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1]; ++t)
+				{
+					const uint32_t* tri = &indices[triangleList[t] * 3];
+
+					bool hasTarget = false;
+					for (int k = 0; k < 3; ++k)
+					{
+						if (remap[tri[k]] == remap[collapse.to])
+							hasTarget = true;
+					}
+					if (hasTarget)
+					{
+						removes++;
+						continue;
+					}
+
+					// The triangle's normal before and after moving the vertex, anything that turns over is rejected
+					glm::dvec3 p[3];
+					glm::dvec3 moved[3];
+					for (int k = 0; k < 3; ++k)
+					{
+						p[k] = position(tri[k]);
+						moved[k] = tri[k] == collapse.from ? target : p[k];
+					}
+
+					glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+					glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+					if (glm::dot(before, after) <= 0.0)
+					{
+						flips = true;
+						break;
+					}
+				}
+
+				if (flips)
+					continue;
+
+				collapseTo[collapse.from] = collapse.to;
+				quadrics[remap[collapse.to]].add(quadrics[remap[collapse.from]]);
+				maxCost = std::max(maxCost, collapse.cost);
+				removed += removes;
+
+				for (uint32_t t = triangleStart[collapse.from]; t < triangleStart[collapse.from + 1]; ++t)
+				{
+					const uint32_t* tri = &indices[triangleList[t] * 3];
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+				}
+			}
+
+			if (removed == 0)
+				break;
+
+			// Apply the collapses, dropping triangles that lost an edge
+			size_t write = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t a = collapseTo[indices[i]];
+				uint32_t b = collapseTo[indices[i + 1]];
+				uint32_t c = collapseTo[indices[i + 2]];
+
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+					continue;
+
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+		}
+
+		_error = static_cast<float>(std::sqrt(maxCost));
+		return indices;
+	}
+}
\ No newline at end of file
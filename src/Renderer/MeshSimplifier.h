@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	// Simplifies an indexed triangle mesh with quadric error metric edge collapses. Vertices are only ever moved onto a neighbouring vertex,
+	// so the result indexes the same vertex buffer and every LOD of a mesh can share it.
+	// Vertices on a border, a uv/normal seam or a non-manifold edge never move, which keeps neighbouring meshes and seams watertight.
+	//
+	// _positions points at the first vertex's xyz floats, with _stride bytes from one vertex to the next.
+	// Stops once _targetIndexCount is reached or nothing else can collapse. _error is set to how far the surface moved, in the same units as the positions
+	std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& _indices, const float* _positions, size_t _vertexCount, size_t _stride,
+		size_t _targetIndexCount, float& _error);
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Renderer
+{
+	namespace
+	{
+		// Spreads the low 10 bits of _value out to every third bit
+		uint32_t spreadBits(uint32_t _value)
+		{
+			_value &= 0x3FF;
+			_value = (_value | (_value << 16)) & 0x030000FF;
+			_value = (_value | (_value << 8)) & 0x0300F00F;
+			_value = (_value | (_value << 4)) & 0x030C30C3;
+			_value = (_value | (_value << 2)) & 0x09249249;
+			return _value;
+		}
+
+		// Smaller than this and a meshlet carries on with the next nearby unconnected triangle, so lots of tiny separate pieces don't each get their own
+		const size_t kMinConnectedTriangles = 32;
+	}
+
+	std::vector<Meshlet> buildMeshlets(std::vector<uint32_t>& _indices, const float* _positions, size_t _vertexCount, size_t _stride)
+	{
+		std::vector<Meshlet> meshlets;
+
+		const size_t triangleCount = _indices.size() / 3;
+		if (triangleCount == 0 || _vertexCount == 0)
+			return meshlets;
+
+		auto position = [&](uint32_t _vertex)
+			{
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(_positions) + _vertex * _stride);
+				return glm::vec3(p[0], p[1], p[2]);
+			};
+
+		std::vector<glm::vec3> centroids(triangleCount);
+		std::vector<glm::vec3> normals(triangleCount);
+		glm::vec3 minv(std::numeric_limits<float>::max());
+		glm::vec3 maxv(std::numeric_limits<float>::lowest());
+
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			glm::vec3 p0 = position(_indices[t * 3]);
+			glm::vec3 p1 = position(_indices[t * 3 + 1]);
+			glm::vec3 p2 = position(_indices[t * 3 + 2]);
+
+			centroids[t] = (p0 + p1 + p2) / 3.0f;
+
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(n);
+			normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+
+			minv = glm::min(minv, centroids[t]);
+			maxv = glm::max(maxv, centroids[t]);
+		}
+
+		// Seeds are taken in Morton order, so each new meshlet starts next to where the last one finished
+		std::vector<uint32_t> seedOrder(triangleCount);
+		{
+			std::vector<uint32_t> codes(triangleCount);
+			glm::vec3 extent = glm::max(maxv - minv, glm::vec3(1e-6f));
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				glm::vec3 unit = (centroids[t] - minv) / extent;
+				codes[t] = spreadBits(uint32_t(unit.x * 1023.0f)) | (spreadBits(uint32_t(unit.y * 1023.0f)) << 1) | (spreadBits(uint32_t(unit.z * 1023.0f)) << 2);
+				seedOrder[t] = uint32_t(t);
+			}
+			std::sort(seedOrder.begin(), seedOrder.end(), [&](uint32_t _a, uint32_t _b) { return codes[_a] < codes[_b]; });
+		}
+
+		// Triangles around each vertex
+		std::vector<uint32_t> triangleStart(_vertexCount + 1, 0);
+		for (uint32_t index : _indices)
+			triangleStart[index + 1]++;
+		for (size_t v = 0; v < _vertexCount; ++v)
+			triangleStart[v + 1] += triangleStart[v];
+
+		std::vector<uint32_t> triangleList(_indices.size());
+		{
+			std::vector<uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+			for (size_t i = 0; i < _indices.size(); ++i)
+				triangleList[fill[_indices[i]]++] = uint32_t(i / 3);
+		}
+
+		std::vector<uint8_t> assigned(triangleCount, 0);
+		std::vector<uint32_t> candidateStamp(triangleCount, 0xFFFFFFFF); // Meshlet a triangle was last a candidate for
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> meshletTriangles;
+		meshletTriangles.reserve(kMeshletMaxTriangles);
+
+		std::vector<uint32_t> reordered;
+		reordered.reserve(_indices.size());
+
+		size_t seedCursor = 0;
+
+		while (true)
+		{
+			while (seedCursor < triangleCount && assigned[seedOrder[seedCursor]])
+				seedCursor++;
+			if (seedCursor == triangleCount)
+				break;
+
+			const uint32_t meshletIndex = uint32_t(meshlets.size());
+			meshletTriangles.clear();
+			candidates.clear();
+
+			glm::vec3 centroidSum(0.0f);
+			glm::vec3 normalSum(0.0f);
+
+			auto addTriangle = [&](uint32_t _triangle)
+				{
+					assigned[_triangle] = 1;
+					meshletTriangles.push_back(_triangle);
+					centroidSum += centroids[_triangle];
+					normalSum += normals[_triangle];
+
+					for (int k = 0; k < 3; ++k)
+					{
+						uint32_t vertex = _indices[_triangle * 3 + k];
+						for (uint32_t i = triangleStart[vertex]; i < triangleStart[vertex + 1]; ++i)
+						{
+							uint32_t neighbour = triangleList[i];
+							if (!assigned[neighbour] && candidateStamp[neighbour] != meshletIndex)
+							{
+								candidateStamp[neighbour] = meshletIndex;
+								candidates.push_back(neighbour);
+							}
+						}
+					}
+				};
+
+			addTriangle(seedOrder[seedCursor]);
+
+			while (meshletTriangles.size() < kMeshletMaxTriangles)
+			{
+				// Closest connected triangle, with distance stretched for triangles facing away from the rest so the normal cone stays tight
+				const glm::vec3 center = centroidSum / float(meshletTriangles.size());
+				const float normalLength = glm::length(normalSum);
+				const glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+
+				size_t best = candidates.size();
+				float bestScore = std::numeric_limits<float>::max();
+				for (size_t i = 0; i < candidates.size(); )
+				{
+					uint32_t candidate = candidates[i];
+					if (assigned[candidate])
+					{
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					float score = glm::length(centroids[candidate] - center) * (2.0f - glm::dot(normals[candidate], axis));
+					if (score < bestScore)
+					{
+						bestScore = score;
+						best = i;
+					}
+					++i;
+				}
+
+				if (best < candidates.size())
+				{
+					uint32_t triangle = candidates[best];
+					candidates[best] = candidates.back();
+					candidates.pop_back();
+					addTriangle(triangle);
+					continue;
+				}
+
+				if (meshletTriangles.size() >= kMinConnectedTriangles)
+					break;
+
+				while (seedCursor < triangleCount && assigned[seedOrder[seedCursor]])
+					seedCursor++;
+				if (seedCursor == triangleCount)
+					break;
+
+				addTriangle(seedOrder[seedCursor]);
+			}
+
+			Meshlet meshlet;
+			meshlet.indexOffset = uint32_t(reordered.size());
+			meshlet.indexCount = uint32_t(meshletTriangles.size() * 3);
+
+			glm::vec3 boundsMin(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+			for (uint32_t triangle : meshletTriangles)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t vertex = _indices[triangle * 3 + k];
+					reordered.push_back(vertex);
+
+					glm::vec3 p = position(vertex);
+					boundsMin = glm::min(boundsMin, p);
+					boundsMax = glm::max(boundsMax, p);
+				}
+			}
+
+			meshlet.center = 0.5f * (boundsMin + boundsMax);
+			for (uint32_t triangle : meshletTriangles)
+			{
+				for (int k = 0; k < 3; ++k)
+					meshlet.radius = std::max(meshlet.radius, glm::length(position(_indices[triangle * 3 + k]) - meshlet.center));
+			}
+
+			// Cone of normals. Past about 85 degrees either side the cluster can almost never be back facing as a whole, so it isn't worth testing
+			float normalLength = glm::length(normalSum);
+			if (normalLength > 0.0f)
+			{
+				glm::vec3 axis = normalSum / normalLength;
+
+				float minDot = 1.0f;
+				for (uint32_t triangle : meshletTriangles)
+				{
+					if (normals[triangle] != glm::vec3(0.0f))
+						minDot = std::min(minDot, glm::dot(normals[triangle], axis));
+				}
+
+				if (minDot > 0.1f)
+				{
+					meshlet.coneAxis = axis;
+					meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+				}
+			}
+
+			meshlets.push_back(meshlet);
+		}
+
+		_indices.swap(reordered);
+		return meshlets;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	// A small cluster of neighbouring triangles, culled on its own. Bounds are in model space
+	struct Meshlet
+	{
+		uint32_t indexOffset = 0; // Into the group's indices
+		uint32_t indexCount = 0;
+
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+
+		// Every triangle's normal is within the cone around coneAxis. coneCutoff is the sine of the cone's half angle, 1 when the cone is too wide to cull with
+		glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		float coneCutoff = 1.0f;
+	};
+
+	static constexpr size_t kMeshletMaxTriangles = 128;
+
+	// Splits a triangle list into meshlets of up to kMeshletMaxTriangles connected triangles facing roughly the same way.
+	// _indices is reordered so each meshlet is one contiguous range, the returned meshlets are in index order and cover all of it.
+	// _positions points at the first vertex's xyz floats, with _stride bytes from one vertex to the next
+	std::vector<Meshlet> buildMeshlets(std::vector<uint32_t>& _indices, const float* _positions, size_t _vertexCount, size_t _stride);
+}
\ No newline at end of file
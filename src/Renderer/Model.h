@@ -1,12 +1,19 @@
 #pragma once
 
 #include "Texture.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "FrustumCull.h"
+#include "GeometryArena.h"
 
 #include "tiny_gltf.h" 
+#include "stb_image.h" // Cooked models decode their embedded images themselves
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <string>
 #include <fstream>
@@ -16,7 +23,13 @@
 #include <map>
 #include <stdexcept>
 #include <cstdlib>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
 #include <algorithm>
+#include <memory>
+#include <filesystem>
+#include <mutex>
 
 namespace Renderer
 {
@@ -24,14 +37,30 @@ namespace Renderer
     {
     public:
         Model();
-        Model(const std::string& _path);
+        // _uploadToGPU false only loads the geometry, for when there is no GL context (headless, or loading on another thread)
+        Model(const std::string& _path, bool _uploadToGPU = true);
         Model(const Model& _copy);
         Model& operator=(const Model& _assign);
         virtual ~Model();
 
+        // Unique vertices after welding, the legacy (no materials) path draws index_count() indices of index_type()
         GLsizei vertex_count() const;
+        GLsizei index_count() const;
+        GLenum index_type() const;
         GLuint vao_id();
 
+        // Creates the vertex buffers for the faces (or each material group), for a model made with _uploadToGPU false. Needs a GL context
+        void upload();
+
+        // How material group vertices are stored on the GPU. Compact is 16 bytes instead of 32: positions as 16 bit snorm within the
+        // group's bounds, half float uvs and octahedral 16 bit normals. Shaders drawing material groups decode it, see Shader::draw(MaterialGroup).
+        // Every model's groups of one format share a GeometryArena, so they can all be drawn from one vertex array
+        enum class VertexFormat { Float, Compact };
+
+        // Takes effect on the next upload(), re-uploads straight away if already on the GPU. Models without materials always use Float
+        void set_vertex_format(VertexFormat _format);
+        VertexFormat vertex_format() const { return m_vertexFormat; }
+
         void Unload();
 
         float get_width() const;
@@ -53,6 +82,7 @@ namespace Renderer
             Vertex c;
         };
 
+        // Every triangle as its own three vertices. Only built the first time it is asked for (by colliders), drawing uses the indexed data
         const std::vector<Model::Face>& GetFaces() const;
 
         // Returns true if the model was loaded with material support.
@@ -89,13 +119,46 @@ namespace Renderer
 			float ior = 1.5f;
         };
 
+        // A simplified version of a material group. Every level indexes the group's one vertex buffer
+        struct LodLevel
+        {
+            uint32_t indexOffset = 0; // Into the group's indices
+            GLsizei indexCount = 0;
+            float error = 0.0f; // Furthest the surface has moved from the full mesh, in model units
+        };
+
+        static constexpr int kMaxLods = 4;
+
         // Structure for material-specific geometry.
         struct MaterialGroup
         {
             std::string materialName;
-            std::vector<Face> faces;
+            std::vector<Face> faces; // Only used while loading, then welded into vertices and indices
             std::string texturePath; // Diffuse texture from the MTL file.
 
+            // Welded geometry, each unique vertex once. indices holds every LOD one after another, full detail first.
+            // Both stay empty for groups loaded from a cooked .jmesh, read them through vertex_data() and index_data() instead
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+
+            const Vertex* vertex_data() const { return cookedFile ? reinterpret_cast<const Vertex*>(cookedFile->data() + cookedVertexOffset) : vertices.data(); }
+            const uint32_t* index_data() const { return cookedFile ? reinterpret_cast<const uint32_t*>(cookedFile->data() + cookedIndexOffset) : indices.data(); }
+            // Every LOD's indices, not just the full detail indexCount
+            size_t index_data_count() const { return cookedFile ? size_t(cookedIndexCount) : indices.size(); }
+
+            // The mapped .jmesh a cooked group's geometry sits in, shared by every group of the model (and copies of it) so it stays mapped
+            // as long as any of them are around. The pages are the file's own, so this costs address space rather than memory
+            std::shared_ptr<const MappedFile> cookedFile;
+            uint64_t cookedVertexOffset = 0;
+            uint64_t cookedIndexOffset = 0;
+            uint64_t cookedIndexCount = 0;
+
+            GLsizei vertexCount = 0;
+            GLsizei indexCount = 0; // Full detail, the same as lods[0]
+            std::vector<LodLevel> lods;
+            std::vector<Meshlet> meshlets; // Split the full detail LOD's indices into small clusters for culling
+            SphereSoA meshletSpheres; // The meshlets' bounding spheres again, laid out for cullSpheres
+
             glm::vec3 boundsCenterMS = glm::vec3(0.0f);
             glm::vec3 boundsHalfExtentsMS = glm::vec3(0.0f);
             float boundsSphereRadiusMS = 0.0f;
@@ -103,25 +166,50 @@ namespace Renderer
 
             PBRMaterial pbr;
 
+            // The arena's vertex array once uploaded, 0 until then. Draws add geometry.firstVertex as the base vertex and geometry.firstIndex to
+            // every index offset (LOD, meshlet), the indices are always GL_UNSIGNED_INT
             GLuint vao = 0;
-            GLuint vbo = 0;
+            GeometryArena::Range geometry;
+
+            // Decodes the uploaded vertices, position = positionOffset + positionScale * stored position. Set by upload()
+            glm::vec3 positionScale = glm::vec3(1.0f);
+            glm::vec3 positionOffset = glm::vec3(0.0f);
+            bool octNormals = false;
         };
 
+        // Size of one material's MaterialData struct (see ObjShader.frag)
+        static constexpr GLsizeiptr kMaterialDataSize = 96;
+
+        // Every material group's factors and has-texture flags, group i's MaterialData at i * kMaterialDataSize. Made by upload(), 0 until then
+        // or without materials. Renderers copy it into the one material table they index per draw
+        GLuint material_buffer() const { return m_materialBuffer; }
+
         // Returns the material groups (for multi-textured models).
         const std::vector<MaterialGroup>& GetMaterialGroups() const { return m_materialGroups; }
 
 		const std::vector<Texture>& GetEmbeddedTextures() const { return m_embeddedTextures; }
 
     private:
-        // Legacy face data.
-        std::vector<Face> m_faces;
+        // Built on demand by GetFaces()
+        mutable std::vector<Face> m_faces;
+        mutable std::mutex m_facesMutex;
         // Material groups when using multi-material mode.
         std::vector<MaterialGroup> m_materialGroups;
 
+        // Welded geometry that is not in a material group. Everything without materials, or primitives with no material in a glTF
+        std::vector<Vertex> m_vertices;
+        std::vector<uint32_t> m_indices;
+
         GLuint m_vaoid = 0;
         GLuint m_vboid = 0;
+        GLuint m_eboid = 0;
+        GLenum m_indexType = GL_UNSIGNED_INT;
         bool m_dirty = true;
 
+        GLuint m_materialBuffer = 0;
+
+        VertexFormat m_vertexFormat = VertexFormat::Float;
+
         float m_width = 0.0f;
         float m_height = 0.0f;
         float m_length = 0.0f;
@@ -139,13 +227,133 @@ namespace Renderer
         void LoadMTL(const std::string& mtlFilePath, std::map<std::string, std::string>& materialToTextureMap);
 
         bool LoadGLTF(const std::string& path);
+
+        // Merges identical vertices so each is stored and shaded once, _faces becomes a vertex and index buffer
+        static void weld(const std::vector<Face>& _faces, std::vector<Vertex>& _vertices, std::vector<uint32_t>& _indices);
+        // Welds every group and the unassigned faces, then frees the faces
+        void weld_geometry();
+        // Appends up to kMaxLods - 1 simplified versions of the group's indices. Stops early once simplifying stops paying off
+        static void generate_lods(MaterialGroup& _group);
+        // Copies the meshlets' bounds into meshletSpheres
+        static void cache_meshlet_spheres(MaterialGroup& _group);
+
+        // Layout of a VertexFormat::Compact vertex
+        struct CompactVertex
+        {
+            int16_t position[4]; // xyz, w is padding
+            uint32_t texcoord;   // Two halfs
+            int16_t normal[2];   // Octahedral
+        };
+        static_assert(sizeof(CompactVertex) == 16, "CompactVertex must stay tightly packed to match its attribute offsets");
+
+        // The shared arena for a vertex format, made on first use. Needs a GL context
+        static GeometryArena& geometry_arena(VertexFormat _format);
+
+        void upload_group(MaterialGroup& _group);
+
+        // std430 layout of the MaterialData struct, mirrored here so the offsets can be checked
+        struct MaterialData
+        {
+            glm::vec4 baseColorFactor;
+            glm::vec3 emissiveFactor;
+            float metallicFactor;
+            float roughnessFactor;
+            float normalScale;
+            float occlusionStrength;
+            float transmissionFactor;
+            float ior;
+            float alphaCutoff;
+            int32_t alphaMode; // 0 opaque, 1 mask, 2 blend
+            int32_t hasAlbedoMap;
+            int32_t hasNormalMap;
+            int32_t hasMetallicRoughnessMap;
+            int32_t hasOcclusionMap;
+            int32_t hasEmissiveMap;
+            int32_t hasTransmissionTex;
+            int32_t padding[3];
+        };
+        static_assert(offsetof(MaterialData, emissiveFactor) == 16 && offsetof(MaterialData, metallicFactor) == 28, "MaterialData must follow std430");
+        static_assert(offsetof(MaterialData, alphaMode) == 56 && offsetof(MaterialData, hasTransmissionTex) == 80, "MaterialData must follow std430");
+        static_assert(sizeof(MaterialData) == kMaterialDataSize, "MaterialData must be the array stride of the std430 struct");
+
+        // Fills material_buffer() with every group's MaterialData, tightly packed in group order
+        void upload_materials();
+
+        // The legacy (no materials) geometry, in its own vertex array. Picks 16 bit indices when there are few enough vertices
+        void upload_indexed(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, GLuint& _vao, GLuint& _vbo, GLuint& _ebo, GLenum& _indexType);
+
+        // Cooked models. The first load of a .glb writes the final material groups, bounds and welded geometry to <path>.jmesh.
+        // Later loads map that file and use it as is, as long as the content hash of the .glb still matches. Material groups are uploaded
+        // straight from the mapping and never copied, the unassigned geometry is small and still copied into m_vertices and m_indices
+        static constexpr uint32_t kCookedVersion = 4;
+
+        struct CookedHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t vertexSize;   // sizeof(Vertex) and sizeof(PBRMaterial), so a change to either invalidates old files
+            uint32_t materialSize;
+            uint64_t sourceHash;
+            uint64_t sourceSize;
+            uint32_t useMaterials;
+            uint32_t groupCount;
+            uint32_t textureCount;
+            uint32_t namesSize;
+            uint64_t unassignedVertexOffset;
+            uint64_t unassignedVertexCount;
+            uint64_t unassignedIndexOffset;
+            uint64_t unassignedIndexCount;
+            float width;
+            float height;
+            float length;
+            uint32_t padding;
+        };
+
+        struct CookedGroup
+        {
+            PBRMaterial pbr;
+            glm::vec3 boundsCenterMS;
+            glm::vec3 boundsHalfExtentsMS;
+            float boundsSphereRadiusMS;
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint64_t vertexOffset;
+            uint64_t vertexCount;
+            uint64_t indexOffset;   // Indices are always 32 bit in the file
+            uint64_t indexCount;    // Every LOD, they are stored one after another
+            uint32_t lodCount;
+            uint32_t lodIndexCount[kMaxLods];
+            float lodError[kMaxLods];
+            uint32_t padding;
+            uint64_t meshletOffset;
+            uint64_t meshletCount;
+        };
+
+        // Where an embedded image's encoded bytes are in the source .glb, they are decoded from there rather than stored again
+        struct CookedTexture
+        {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        bool load_cooked(const std::string& _cookedPath, const MappedFile& _source, uint64_t _sourceHash);
+        void write_cooked(const std::string& _cookedPath, const MappedFile& _source, uint64_t _sourceHash);
+        static uint64_t hash_bytes(const unsigned char* _data, size_t _size);
+
+        // Only used while cooking. Each embedded image's bufferView range in the .glb's binary chunk, and whether every image has one
+        std::vector<CookedTexture> m_embeddedImageViews;
+        bool m_cookable = false;
+        // Only used while loading. Faces that are not in a material group (all of them without materials), welded into m_vertices
+        std::vector<Face> m_unassignedFaces;
     };
 
+    static_assert(sizeof(Model::Vertex) == 8 * sizeof(float), "Vertex is uploaded as is, it must match the interleaved vertex layout");
+
     inline Model::Model()
     {
     }
 
-    inline Model::Model(const std::string& _path)
+    inline Model::Model(const std::string& _path, bool _uploadToGPU)
     {
         // extract extension
         std::string ext;
@@ -155,10 +363,36 @@ namespace Renderer
 
         if (ext == "glb" || ext == "gltf")
         {
+            // Only .glb files are cooked, a .gltf can reference images outside of the file
+            std::unique_ptr<MappedFile> source;
+            uint64_t sourceHash = 0;
+            if (ext == "glb")
+            {
+                source = std::make_unique<MappedFile>(_path);
+                if (source->isOpen())
+                    sourceHash = hash_bytes(source->data(), source->size());
+            }
+
+            const std::string cookedPath = _path + ".jmesh";
+
+            if (source && source->isOpen() && load_cooked(cookedPath, *source, sourceHash))
+            {
+                if (_uploadToGPU)
+                    upload();
+                return;
+            }
+
             if (!LoadGLTF(_path))
                 throw std::runtime_error("Failed to load GLTF model: " + _path);
             calculate_dimensions();
-            m_dirty = false;
+
+            if (source && source->isOpen() && m_cookable)
+                write_cooked(cookedPath, *source, sourceHash);
+
+            m_embeddedImageViews.clear();
+
+            if (_uploadToGPU)
+                upload();
             return;
         }
 
@@ -274,11 +508,10 @@ namespace Renderer
                     {
                         size_t index = materialGroupIndices[currentMaterial];
                         m_materialGroups[index].faces.emplace_back(f);
-                        m_faces.emplace_back(f);
                     }
                     else
                     {
-                        m_faces.push_back(f);
+                        m_unassignedFaces.push_back(f);
                     }
                 }
             }
@@ -288,130 +521,11 @@ namespace Renderer
 
         if (!m_useMaterials)
         {
-            if (m_faces.empty())
+            if (m_unassignedFaces.empty())
                 throw std::runtime_error("Model is empty");
-
-            glGenBuffers(1, &m_vboid);
-            if (!m_vboid)
-                throw std::runtime_error("Failed to generate vertex buffer");
-
-            glGenVertexArrays(1, &m_vaoid);
-            if (!m_vaoid)
-                throw std::runtime_error("Failed to generate vertex array");
-
-            std::vector<GLfloat> data;
-            for (size_t fi = 0; fi < m_faces.size(); ++fi)
-            {
-                data.push_back(m_faces[fi].a.position.x);
-                data.push_back(m_faces[fi].a.position.y);
-                data.push_back(m_faces[fi].a.position.z);
-                data.push_back(m_faces[fi].a.texcoord.x);
-                data.push_back(m_faces[fi].a.texcoord.y);
-                data.push_back(m_faces[fi].a.normal.x);
-                data.push_back(m_faces[fi].a.normal.y);
-                data.push_back(m_faces[fi].a.normal.z);
-
-                data.push_back(m_faces[fi].b.position.x);
-                data.push_back(m_faces[fi].b.position.y);
-                data.push_back(m_faces[fi].b.position.z);
-                data.push_back(m_faces[fi].b.texcoord.x);
-                data.push_back(m_faces[fi].b.texcoord.y);
-                data.push_back(m_faces[fi].b.normal.x);
-                data.push_back(m_faces[fi].b.normal.y);
-                data.push_back(m_faces[fi].b.normal.z);
-
-                data.push_back(m_faces[fi].c.position.x);
-                data.push_back(m_faces[fi].c.position.y);
-                data.push_back(m_faces[fi].c.position.z);
-                data.push_back(m_faces[fi].c.texcoord.x);
-                data.push_back(m_faces[fi].c.texcoord.y);
-                data.push_back(m_faces[fi].c.normal.x);
-                data.push_back(m_faces[fi].c.normal.y);
-                data.push_back(m_faces[fi].c.normal.z);
-            }
-
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboid);
-            glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), &data.at(0), GL_STATIC_DRAW);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-            glBindVertexArray(m_vaoid);
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboid);
-
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-            glEnableVertexAttribArray(2);
-
-            glBindVertexArray(0);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
         else
         {
-            // New: Set up buffers for each material group.
-            for (size_t gi = 0; gi < m_materialGroups.size(); ++gi)
-            {
-                MaterialGroup& group = m_materialGroups[gi];
-                if (group.faces.empty())
-                    continue;
-
-                std::vector<GLfloat> data;
-                for (size_t fi = 0; fi < group.faces.size(); ++fi)
-                {
-                    data.push_back(group.faces[fi].a.position.x);
-                    data.push_back(group.faces[fi].a.position.y);
-                    data.push_back(group.faces[fi].a.position.z);
-                    data.push_back(group.faces[fi].a.texcoord.x);
-                    data.push_back(group.faces[fi].a.texcoord.y);
-                    data.push_back(group.faces[fi].a.normal.x);
-                    data.push_back(group.faces[fi].a.normal.y);
-                    data.push_back(group.faces[fi].a.normal.z);
-
-                    data.push_back(group.faces[fi].b.position.x);
-                    data.push_back(group.faces[fi].b.position.y);
-                    data.push_back(group.faces[fi].b.position.z);
-                    data.push_back(group.faces[fi].b.texcoord.x);
-                    data.push_back(group.faces[fi].b.texcoord.y);
-                    data.push_back(group.faces[fi].b.normal.x);
-                    data.push_back(group.faces[fi].b.normal.y);
-                    data.push_back(group.faces[fi].b.normal.z);
-
-                    data.push_back(group.faces[fi].c.position.x);
-                    data.push_back(group.faces[fi].c.position.y);
-                    data.push_back(group.faces[fi].c.position.z);
-                    data.push_back(group.faces[fi].c.texcoord.x);
-                    data.push_back(group.faces[fi].c.texcoord.y);
-                    data.push_back(group.faces[fi].c.normal.x);
-                    data.push_back(group.faces[fi].c.normal.y);
-                    data.push_back(group.faces[fi].c.normal.z);
-                }
-
-                glGenBuffers(1, &group.vbo);
-                if (!group.vbo)
-                    throw std::runtime_error("Failed to generate vertex buffer for material group");
-                glGenVertexArrays(1, &group.vao);
-                if (!group.vao)
-                    throw std::runtime_error("Failed to generate vertex array for material group");
-
-                glBindBuffer(GL_ARRAY_BUFFER, group.vbo);
-                glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), &data.at(0), GL_STATIC_DRAW);
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-                glBindVertexArray(group.vao);
-                glBindBuffer(GL_ARRAY_BUFFER, group.vbo);
-
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(2);
-
-                glBindVertexArray(0);
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
-            }
-
             std::cout << _path << " uses: " << std::endl;
             for (auto& group : GetMaterialGroups())
             {
@@ -419,8 +533,11 @@ namespace Renderer
             }
         }
 
-        m_dirty = false;
+        weld_geometry();
         calculate_dimensions();
+
+        if (_uploadToGPU)
+            upload();
     }
 
     inline Model::~Model()
@@ -430,15 +547,34 @@ namespace Renderer
 
     inline Model::Model(const Model& _copy)
     {
-        m_faces = _copy.m_faces;
+        m_vertexFormat = _copy.m_vertexFormat;
         m_materialGroups = _copy.m_materialGroups;
+        m_vertices = _copy.m_vertices;
+        m_indices = _copy.m_indices;
+
+        // The arena ranges belong to _copy, freeing them twice would hand the same space out again. The copy is uploaded with upload()
+        for (auto& group : m_materialGroups)
+        {
+            group.vao = 0;
+            group.geometry = GeometryArena::Range();
+        }
     }
 
     inline Model& Model::operator=(const Model& _assign)
     {
-        m_faces = _assign.m_faces;
+        Unload();
+        m_faces.clear();
+        m_vertexFormat = _assign.m_vertexFormat;
         m_materialGroups = _assign.m_materialGroups;
+        m_vertices = _assign.m_vertices;
+        m_indices = _assign.m_indices;
         m_dirty = true;
+
+        for (auto& group : m_materialGroups)
+        {
+            group.vao = 0;
+            group.geometry = GeometryArena::Range();
+        }
         return *this;
     }
 
@@ -510,7 +646,22 @@ namespace Renderer
         for (const auto& img : scene.images)
             m_embeddedTextures.emplace_back(img.image.data(), img.width, img.height, img.component);
 
-        m_faces.clear();
+        // Cooked models point back at the encoded images in the .glb, which only works if they are all in its binary chunk
+        m_cookable = true;
+        m_embeddedImageViews.clear();
+        for (const auto& img : scene.images)
+        {
+            if (img.bufferView < 0 || scene.bufferViews[img.bufferView].buffer != 0)
+            {
+                m_cookable = false;
+                break;
+            }
+
+            const auto& view = scene.bufferViews[img.bufferView];
+            m_embeddedImageViews.push_back({ uint64_t(view.byteOffset), uint64_t(view.byteLength) });
+        }
+
+        m_unassignedFaces.clear();
         m_materialGroups.clear();
         m_useMaterials = false;
 
@@ -739,7 +890,7 @@ namespace Renderer
                     fetchVert(face.c, i2);
 
                     if (useMat) m_materialGroups[groupIndex].faces.push_back(face);
-                    m_faces.push_back(face);
+                    else m_unassignedFaces.push_back(face);
                 }
             }
         }
@@ -876,137 +1027,707 @@ namespace Renderer
             group.boundsSphereRadiusMS = glm::length(group.boundsHalfExtentsMS); // AABB-based sphere
         }
 
+        weld_geometry();
+
+        return true;
+    }
+
+    inline void Model::weld(const std::vector<Face>& _faces, std::vector<Vertex>& _vertices, std::vector<uint32_t>& _indices)
+    {
+        _vertices.clear();
+        _indices.clear();
+        _indices.reserve(_faces.size() * 3);
+
+        // Open addressing table of indices into _vertices, kept at most two thirds full
+        const uint32_t kEmpty = 0xFFFFFFFF;
+        size_t tableSize = 16;
+        while (tableSize * 2 < _faces.size() * 3 * 3)
+            tableSize <<= 1;
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, kEmpty);
+
+        // Only bitwise identical vertices are merged, anything with a different normal or uv stays separate
+        auto add = [&](const Vertex& _vertex)
+            {
+                size_t slot = hash_bytes(reinterpret_cast<const unsigned char*>(&_vertex), sizeof(Vertex)) & mask;
+                while (true)
+                {
+                    uint32_t index = table[slot];
+                    if (index == kEmpty)
+                    {
+                        index = static_cast<uint32_t>(_vertices.size());
+                        table[slot] = index;
+                        _vertices.push_back(_vertex);
+                        _indices.push_back(index);
+                        return;
+                    }
+
+                    if (std::memcmp(&_vertices[index], &_vertex, sizeof(Vertex)) == 0)
+                    {
+                        _indices.push_back(index);
+                        return;
+                    }
+
+                    slot = (slot + 1) & mask;
+                }
+            };
+
+        for (const Face& face : _faces)
+        {
+            add(face.a);
+            add(face.b);
+            add(face.c);
+        }
+
+        _vertices.shrink_to_fit();
+    }
+
+    inline void Model::weld_geometry()
+    {
+        for (auto& group : m_materialGroups)
+        {
+            weld(group.faces, group.vertices, group.indices);
+            group.vertexCount = static_cast<GLsizei>(group.vertices.size());
+            std::vector<Face>().swap(group.faces);
+            if (!group.indices.empty())
+                group.meshlets = buildMeshlets(group.indices, &group.vertices[0].position.x, group.vertices.size(), sizeof(Vertex));
+            cache_meshlet_spheres(group);
+            generate_lods(group);
+        }
+
+        weld(m_unassignedFaces, m_vertices, m_indices);
+        std::vector<Face>().swap(m_unassignedFaces);
+
+        m_faces.clear();
+    }
+
+    inline void Model::generate_lods(MaterialGroup& _group)
+    {
+        _group.indexCount = static_cast<GLsizei>(_group.indices.size());
+        _group.lods.assign(1, LodLevel{ 0, _group.indexCount, 0.0f });
+
+        // Not worth an extra draw range for something this small
+        if (_group.indices.size() < 64 * 3)
+            return;
+
+        // Each level halves the one before, simplifying from the previous level rather than the full mesh is much quicker.
+        // Quadrics restart each time, so the errors add up as an upper bound
+        std::vector<uint32_t> previous = _group.indices;
+        float error = 0.0f;
+
+        for (int level = 1; level < kMaxLods; ++level)
+        {
+            size_t target = (previous.size() / 2) / 3 * 3;
+
+            float levelError = 0.0f;
+            std::vector<uint32_t> simplified = simplifyMesh(previous, &_group.vertices[0].position.x, _group.vertices.size(), sizeof(Vertex), target, levelError);
+
+            // Locked borders and seams can stop it getting much smaller, a level barely smaller than the last only costs memory
+            if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+                break;
+
+            error += levelError;
+
+            LodLevel lod;
+            lod.indexOffset = static_cast<uint32_t>(_group.indices.size());
+            lod.indexCount = static_cast<GLsizei>(simplified.size());
+            lod.error = error;
+            _group.lods.push_back(lod);
+
+            _group.indices.insert(_group.indices.end(), simplified.begin(), simplified.end());
+            previous = std::move(simplified);
+        }
+    }
+
+    inline void Model::cache_meshlet_spheres(MaterialGroup& _group)
+    {
+        _group.meshletSpheres.clear();
+        for (const Meshlet& meshlet : _group.meshlets)
+            _group.meshletSpheres.push_back(meshlet.center, meshlet.radius);
+    }
+
+    inline void Model::upload()
+    {
         if (!m_useMaterials)
         {
-            glGenBuffers(1, &m_vboid);
-            glGenVertexArrays(1, &m_vaoid);
-            std::vector<GLfloat> data;
-            data.reserve(m_faces.size() * 3 * 8);
-            for (auto& f : m_faces)
-            {
-                auto push = [&](const Vertex& v) {
-                    data.insert(data.end(), { v.position.x, v.position.y, v.position.z,
-                                              v.texcoord.x, v.texcoord.y,
-                                              v.normal.x,   v.normal.y,   v.normal.z });
-                    };
-                push(f.a); push(f.b); push(f.c);
-            }
-            glBindBuffer(GL_ARRAY_BUFFER, m_vboid);
-            glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
-            glBindVertexArray(m_vaoid);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-            glEnableVertexAttribArray(1);
-            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-            glEnableVertexAttribArray(2);
-            glBindVertexArray(0);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            upload_indexed(m_vertices, m_indices, m_vaoid, m_vboid, m_eboid, m_indexType);
             m_dirty = false;
         }
         else
         {
             for (auto& group : m_materialGroups)
             {
-                if (group.faces.empty()) continue;
-                glGenBuffers(1, &group.vbo);
-                glGenVertexArrays(1, &group.vao);
-                std::vector<GLfloat> data;
-                data.reserve(group.faces.size() * 3 * 8);
-                for (auto& f : group.faces)
+                if (group.index_data_count() == 0)
+                    continue;
+
+                upload_group(group);
+            }
+
+            upload_materials();
+        }
+    }
+
+    inline void Model::upload_materials()
+    {
+        if (m_materialGroups.empty())
+            return;
+
+        std::vector<MaterialData> data(m_materialGroups.size());
+
+        for (size_t i = 0; i < m_materialGroups.size(); ++i)
+        {
+            const PBRMaterial& pbr = m_materialGroups[i].pbr;
+
+            auto hasTexture = [&](int _index) { return (_index >= 0 && _index < (int)m_embeddedTextures.size()) ? 1 : 0; };
+
+            MaterialData material{};
+            material.baseColorFactor = pbr.baseColorFactor;
+            material.emissiveFactor = pbr.emissiveFactor;
+            material.metallicFactor = pbr.metallicFactor;
+            material.roughnessFactor = pbr.roughnessFactor;
+            material.normalScale = pbr.normalScale;
+            material.occlusionStrength = pbr.occlusionStrength;
+            material.transmissionFactor = pbr.transmissionFactor;
+            material.ior = pbr.ior;
+            material.alphaCutoff = pbr.alphaCutoff;
+            material.alphaMode = static_cast<int32_t>(pbr.alphaMode);
+            material.hasAlbedoMap = hasTexture(pbr.baseColorTexIndex);
+            material.hasNormalMap = hasTexture(pbr.normalTexIndex);
+            material.hasMetallicRoughnessMap = hasTexture(pbr.metallicRoughnessTexIndex);
+            material.hasOcclusionMap = hasTexture(pbr.occlusionTexIndex);
+            material.hasEmissiveMap = hasTexture(pbr.emissiveTexIndex);
+            material.hasTransmissionTex = hasTexture(pbr.transmissionTexIndex);
+
+            data[i] = material;
+        }
+
+        if (!m_materialBuffer)
+            glGenBuffers(1, &m_materialBuffer);
+
+        // Materials never change after loading
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_materialBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, data.size() * sizeof(MaterialData), data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    inline void Model::set_vertex_format(VertexFormat _format)
+    {
+        if (_format == m_vertexFormat)
+            return;
+
+        bool uploaded = false;
+        for (const auto& group : m_materialGroups)
+        {
+            if (group.vao)
+                uploaded = true;
+        }
+
+        // Unloaded before switching, so the ranges go back to the arena they came from
+        if (m_useMaterials && uploaded)
+        {
+            Unload();
+            m_vertexFormat = _format;
+            upload();
+        }
+        else
+        {
+            m_vertexFormat = _format;
+        }
+    }
+
+    inline GeometryArena& Model::geometry_arena(VertexFormat _format)
+    {
+        // Never destroyed, the GL context is already gone by the time statics are
+        if (_format == VertexFormat::Compact)
+        {
+            static GeometryArena* compact = new GeometryArena(sizeof(CompactVertex), {
+                { 0, 3, GL_SHORT, GL_TRUE, offsetof(CompactVertex, position) },
+                { 1, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CompactVertex, texcoord) },
+                { 2, 2, GL_SHORT, GL_TRUE, offsetof(CompactVertex, normal) } });
+            return *compact;
+        }
+
+        static GeometryArena* full = new GeometryArena(sizeof(Vertex), {
+            { 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position) },
+            { 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texcoord) },
+            { 2, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) } });
+        return *full;
+    }
+
+    inline void Model::upload_group(MaterialGroup& _group)
+    {
+        // For cooked groups these point into the mapped file, so the float format goes from the file to the GPU without a copy
+        const Vertex* vertices = _group.vertex_data();
+        const size_t vertexCount = size_t(_group.vertexCount);
+
+        if (m_vertexFormat == VertexFormat::Float)
+        {
+            _group.positionScale = glm::vec3(1.0f);
+            _group.positionOffset = glm::vec3(0.0f);
+            _group.octNormals = false;
+
+            GeometryArena& arena = geometry_arena(VertexFormat::Float);
+            _group.geometry = arena.allocate(vertices, vertexCount, _group.index_data(), _group.index_data_count());
+            _group.vao = arena.vao();
+            return;
+        }
+
+        // Quantized to the bounds of this group's own vertices, so a small group keeps much more precision than the whole model would
+        glm::vec3 minv(0.0f), maxv(0.0f);
+        if (vertexCount > 0)
+            minv = maxv = vertices[0].position;
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            minv = glm::min(minv, vertices[i].position);
+            maxv = glm::max(maxv, vertices[i].position);
+        }
+
+        _group.positionOffset = 0.5f * (minv + maxv);
+        _group.positionScale = 0.5f * (maxv - minv);
+        _group.octNormals = true;
+
+        auto toSnorm = [](float _value) { return static_cast<int16_t>(std::round(glm::clamp(_value, -1.0f, 1.0f) * 32767.0f)); };
+
+        std::vector<CompactVertex> compact(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const Vertex& vertex = vertices[i];
+            CompactVertex& packed = compact[i];
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float extent = _group.positionScale[axis];
+                packed.position[axis] = extent > 0.0f ? toSnorm((vertex.position[axis] - _group.positionOffset[axis]) / extent) : 0;
+            }
+            packed.position[3] = 0;
+
+            packed.texcoord = glm::packHalf2x16(vertex.texcoord);
+
+            // Octahedral encoding, the normal projected onto an octahedron and the lower half folded over the upper
+            glm::vec3 n = vertex.normal;
+            float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+            glm::vec2 oct(0.0f);
+            if (sum > 0.0f)
+            {
+                n /= sum;
+                oct = glm::vec2(n.x, n.y);
+                if (n.z < 0.0f)
                 {
-                    auto push = [&](const Vertex& v) {
-                        data.insert(data.end(), { v.position.x, v.position.y, v.position.z,
-                                                  v.texcoord.x, v.texcoord.y,
-                                                  v.normal.x,   v.normal.y,   v.normal.z });
-                        };
-                    push(f.a); push(f.b); push(f.c);
+                    oct.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+                    oct.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
                 }
-                glBindBuffer(GL_ARRAY_BUFFER, group.vbo);
-                glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
-                glBindVertexArray(group.vao);
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(2);
-                glBindVertexArray(0);
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
             }
+            packed.normal[0] = toSnorm(oct.x);
+            packed.normal[1] = toSnorm(oct.y);
         }
 
-        return true;
+        GeometryArena& arena = geometry_arena(VertexFormat::Compact);
+        _group.geometry = arena.allocate(compact.data(), compact.size(), _group.index_data(), _group.index_data_count());
+        _group.vao = arena.vao();
     }
 
-    inline GLuint Model::vao_id()
+    inline void Model::upload_indexed(const std::vector<Vertex>& _vertices, const std::vector<uint32_t>& _indices, GLuint& _vao, GLuint& _vbo, GLuint& _ebo, GLenum& _indexType)
     {
-        if (!m_useMaterials)
+        glGenBuffers(1, &_vbo);
+        if (!_vbo)
+            throw std::runtime_error("Failed to generate vertex buffer");
+
+        glGenBuffers(1, &_ebo);
+        if (!_ebo)
+            throw std::runtime_error("Failed to generate index buffer");
+
+        glGenVertexArrays(1, &_vao);
+        if (!_vao)
+            throw std::runtime_error("Failed to generate vertex array");
+
+        glBindVertexArray(_vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+        glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), _vertices.data(), GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(2);
+
+        // The element buffer binding is part of the VAO, so it stays bound to it
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ebo);
+        if (_vertices.size() < 0xFFFF)
         {
-            if (m_faces.empty())
-                throw std::runtime_error("Model is empty");
-            if (!m_vboid)
+            std::vector<uint16_t> shortIndices(_indices.begin(), _indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+            _indexType = GL_UNSIGNED_SHORT;
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(uint32_t), _indices.data(), GL_STATIC_DRAW);
+            _indexType = GL_UNSIGNED_INT;
+        }
+
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    inline uint64_t Model::hash_bytes(const unsigned char* _data, size_t _size)
+    {
+        // Multiply-xorshift over 8 bytes at a time, quick enough to hash the whole track on every load
+        const uint64_t k = 0x9E3779B97F4A7C15ull;
+        uint64_t h = 0xCBF29CE484222325ull ^ (uint64_t(_size) * k);
+
+        size_t i = 0;
+        for (; i + 8 <= _size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, _data + i, 8);
+            word *= k;
+            word ^= word >> 32;
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        }
+
+        uint64_t tail = 0;
+        std::memcpy(&tail, _data + i, _size - i);
+        h = (h ^ (tail * k)) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+
+        return h;
+    }
+
+    inline bool Model::load_cooked(const std::string& _cookedPath, const MappedFile& _source, uint64_t _sourceHash)
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(_cookedPath, ec))
+            return false;
+
+        // Stays mapped after loading, the material groups are uploaded (and read by colliders and occluders) straight from it
+        auto cooked = std::make_shared<const MappedFile>(_cookedPath);
+        if (!cooked->isOpen() || cooked->size() < sizeof(CookedHeader))
+            return false;
+
+        const unsigned char* base = cooked->data();
+        const uint64_t fileSize = cooked->size();
+
+        CookedHeader header;
+        std::memcpy(&header, base, sizeof(header));
+
+        if (std::memcmp(header.magic, "JMSH", 4) != 0 || header.version != kCookedVersion
+            || header.vertexSize != sizeof(Vertex) || header.materialSize != sizeof(PBRMaterial))
+        {
+            std::cout << "Cooked model is from an older version, recooking: " << _cookedPath << std::endl;
+            return false;
+        }
+
+        if (header.sourceSize != _source.size() || header.sourceHash != _sourceHash)
+        {
+            std::cout << "Cooked model is out of date, recooking: " << _cookedPath << std::endl;
+            return false;
+        }
+
+        auto inBounds = [](uint64_t _offset, uint64_t _bytes, uint64_t _size) { return _offset <= _size && _bytes <= _size - _offset; };
+
+        // Only the ranges are checked. The indices themselves are trusted, write_cooked() made them and the file only ever appears
+        // whole (it is renamed into place), scanning every one would touch every page of the mapping before it is needed
+        auto geometryInBounds = [&](uint64_t _vertexOffset, uint64_t _vertexCount, uint64_t _indexOffset, uint64_t _indexCount)
             {
-                glGenBuffers(1, &m_vboid);
-                if (!m_vboid)
-                    throw std::runtime_error("Failed to generate vertex buffer");
+                return _vertexOffset % alignof(Vertex) == 0 && _indexOffset % alignof(uint32_t) == 0
+                    && inBounds(_vertexOffset, _vertexCount * sizeof(Vertex), fileSize) && inBounds(_indexOffset, _indexCount * sizeof(uint32_t), fileSize);
+            };
+
+        const uint64_t groupsOffset = sizeof(CookedHeader);
+        const uint64_t texturesOffset = groupsOffset + uint64_t(header.groupCount) * sizeof(CookedGroup);
+        const uint64_t namesOffset = texturesOffset + uint64_t(header.textureCount) * sizeof(CookedTexture);
+        if (!inBounds(groupsOffset, namesOffset + header.namesSize - groupsOffset, fileSize))
+        {
+            std::cout << "Cooked model is truncated: " << _cookedPath << std::endl;
+            return false;
+        }
+
+        const char* names = reinterpret_cast<const char*>(base + namesOffset);
+
+        std::vector<MaterialGroup> groups(header.groupCount);
+        for (uint32_t i = 0; i < header.groupCount; ++i)
+        {
+            CookedGroup cookedGroup;
+            std::memcpy(&cookedGroup, base + groupsOffset + i * sizeof(CookedGroup), sizeof(CookedGroup));
+
+            MaterialGroup& group = groups[i];
+            if (!inBounds(cookedGroup.nameOffset, cookedGroup.nameLength, header.namesSize)
+                || !geometryInBounds(cookedGroup.vertexOffset, cookedGroup.vertexCount, cookedGroup.indexOffset, cookedGroup.indexCount))
+            {
+                std::cout << "Cooked model is corrupt: " << _cookedPath << std::endl;
+                return false;
             }
-            if (!m_vaoid)
+
+            group.cookedFile = cooked;
+            group.cookedVertexOffset = cookedGroup.vertexOffset;
+            group.cookedIndexOffset = cookedGroup.indexOffset;
+            group.cookedIndexCount = cookedGroup.indexCount;
+
+            group.materialName.assign(names + cookedGroup.nameOffset, cookedGroup.nameLength);
+            group.pbr = cookedGroup.pbr;
+            group.boundsCenterMS = cookedGroup.boundsCenterMS;
+            group.boundsHalfExtentsMS = cookedGroup.boundsHalfExtentsMS;
+            group.boundsSphereRadiusMS = cookedGroup.boundsSphereRadiusMS;
+            group.vertexCount = static_cast<GLsizei>(cookedGroup.vertexCount);
+
+            // The LOD ranges have to cover the indices exactly, full detail first
+            uint64_t lodIndices = 0;
+            if (cookedGroup.lodCount < 1 || cookedGroup.lodCount > kMaxLods)
+                lodIndices = ~uint64_t(0);
+            for (uint32_t lodIndex = 0; lodIndex < cookedGroup.lodCount && lodIndex < kMaxLods; ++lodIndex)
             {
-                glGenVertexArrays(1, &m_vaoid);
-                if (!m_vaoid)
-                    throw std::runtime_error("Failed to generate vertex array");
+                LodLevel lod;
+                lod.indexOffset = static_cast<uint32_t>(lodIndices);
+                lod.indexCount = static_cast<GLsizei>(cookedGroup.lodIndexCount[lodIndex]);
+                lod.error = cookedGroup.lodError[lodIndex];
+                group.lods.push_back(lod);
+                lodIndices += cookedGroup.lodIndexCount[lodIndex];
             }
-            if (m_dirty)
+
+            if (lodIndices != cookedGroup.indexCount)
+            {
+                std::cout << "Cooked model is corrupt: " << _cookedPath << std::endl;
+                return false;
+            }
+
+            group.indexCount = group.lods[0].indexCount;
+
+            // Meshlets have to stay inside the full detail LOD
+            if (!inBounds(cookedGroup.meshletOffset, cookedGroup.meshletCount * sizeof(Meshlet), fileSize))
             {
-                std::vector<GLfloat> data;
-                for (size_t fi = 0; fi < m_faces.size(); ++fi)
+                std::cout << "Cooked model is corrupt: " << _cookedPath << std::endl;
+                return false;
+            }
+
+            group.meshlets.resize(cookedGroup.meshletCount);
+            if (cookedGroup.meshletCount > 0)
+                std::memcpy(group.meshlets.data(), base + cookedGroup.meshletOffset, cookedGroup.meshletCount * sizeof(Meshlet));
+
+            for (const Meshlet& meshlet : group.meshlets)
+            {
+                if (uint64_t(meshlet.indexOffset) + meshlet.indexCount > uint64_t(group.indexCount))
                 {
-                    data.push_back(m_faces[fi].a.position.x);
-                    data.push_back(m_faces[fi].a.position.y);
-                    data.push_back(m_faces[fi].a.position.z);
-                    data.push_back(m_faces[fi].a.texcoord.x);
-                    data.push_back(m_faces[fi].a.texcoord.y);
-                    data.push_back(m_faces[fi].a.normal.x);
-                    data.push_back(m_faces[fi].a.normal.y);
-                    data.push_back(m_faces[fi].a.normal.z);
-
-                    data.push_back(m_faces[fi].b.position.x);
-                    data.push_back(m_faces[fi].b.position.y);
-                    data.push_back(m_faces[fi].b.position.z);
-                    data.push_back(m_faces[fi].b.texcoord.x);
-                    data.push_back(m_faces[fi].b.texcoord.y);
-                    data.push_back(m_faces[fi].b.normal.x);
-                    data.push_back(m_faces[fi].b.normal.y);
-                    data.push_back(m_faces[fi].b.normal.z);
-
-                    data.push_back(m_faces[fi].c.position.x);
-                    data.push_back(m_faces[fi].c.position.y);
-                    data.push_back(m_faces[fi].c.position.z);
-                    data.push_back(m_faces[fi].c.texcoord.x);
-                    data.push_back(m_faces[fi].c.texcoord.y);
-                    data.push_back(m_faces[fi].c.normal.x);
-                    data.push_back(m_faces[fi].c.normal.y);
-                    data.push_back(m_faces[fi].c.normal.z);
+                    std::cout << "Cooked model is corrupt: " << _cookedPath << std::endl;
+                    return false;
                 }
+            }
+
+            cache_meshlet_spheres(group);
+        }
+
+        // The unassigned geometry is copied out, the legacy path uploads it again whenever it is marked dirty
+        if (!geometryInBounds(header.unassignedVertexOffset, header.unassignedVertexCount, header.unassignedIndexOffset, header.unassignedIndexCount))
+        {
+            std::cout << "Cooked model is corrupt: " << _cookedPath << std::endl;
+            return false;
+        }
+
+        const Vertex* unassignedBegin = reinterpret_cast<const Vertex*>(base + header.unassignedVertexOffset);
+        const uint32_t* unassignedIndexBegin = reinterpret_cast<const uint32_t*>(base + header.unassignedIndexOffset);
+        std::vector<Vertex> unassignedVertices(unassignedBegin, unassignedBegin + header.unassignedVertexCount);
+        std::vector<uint32_t> unassignedIndices(unassignedIndexBegin, unassignedIndexBegin + header.unassignedIndexCount);
+
+        // Images are the only thing still decoded, straight from where they sit in the .glb
+        std::vector<Texture> textures;
+        textures.reserve(header.textureCount);
+        for (uint32_t i = 0; i < header.textureCount; ++i)
+        {
+            CookedTexture cookedTexture;
+            std::memcpy(&cookedTexture, base + texturesOffset + i * sizeof(CookedTexture), sizeof(CookedTexture));
+
+            if (!inBounds(cookedTexture.offset, cookedTexture.size, _source.size()))
+                return false;
+
+            int width = 0, height = 0, channels = 0;
+            unsigned char* pixels = stbi_load_from_memory(_source.data() + cookedTexture.offset, (int)cookedTexture.size, &width, &height, &channels, 4);
+            if (!pixels)
+            {
+                std::cout << "Failed to decode embedded image " << i << " of cooked model: " << _cookedPath << std::endl;
+                return false;
+            }
+
+            textures.emplace_back(pixels, width, height, 4);
+            stbi_image_free(pixels);
+        }
+
+        m_materialGroups = std::move(groups);
+        m_vertices = std::move(unassignedVertices);
+        m_indices = std::move(unassignedIndices);
+        m_embeddedTextures = std::move(textures);
+        m_useMaterials = header.useMaterials != 0;
+        m_width = header.width;
+        m_height = header.height;
+        m_length = header.length;
+
+        return true;
+    }
+
+    inline void Model::write_cooked(const std::string& _cookedPath, const MappedFile& _source, uint64_t _sourceHash)
+    {
+        // Images are referenced by their position in the file, so find where the binary chunk starts (12 byte header, then the JSON chunk)
+        const unsigned char* glb = _source.data();
+        if (_source.size() < 28 || std::memcmp(glb, "glTF", 4) != 0)
+            return;
+
+        uint32_t jsonLength = 0;
+        std::memcpy(&jsonLength, glb + 12, 4);
+        const uint64_t binChunk = 20 + uint64_t(jsonLength);
+        if (binChunk + 8 > _source.size())
+            return;
+
+        uint32_t binType = 0;
+        std::memcpy(&binType, glb + binChunk + 4, 4);
+        if (binType != 0x004E4942) // "BIN\0"
+            return;
+        const uint64_t binStart = binChunk + 8;
+
+        std::string names;
+        std::vector<CookedGroup> cookedGroups(m_materialGroups.size());
+        std::vector<CookedTexture> cookedTextures(m_embeddedImageViews.size());
+
+        const uint64_t groupsOffset = sizeof(CookedHeader);
+        const uint64_t texturesOffset = groupsOffset + cookedGroups.size() * sizeof(CookedGroup);
+        const uint64_t namesOffset = texturesOffset + cookedTextures.size() * sizeof(CookedTexture);
+
+        for (size_t i = 0; i < m_materialGroups.size(); ++i)
+        {
+            const MaterialGroup& group = m_materialGroups[i];
+            CookedGroup cookedGroup{};
+
+            cookedGroup.pbr = group.pbr;
+            cookedGroup.boundsCenterMS = group.boundsCenterMS;
+            cookedGroup.boundsHalfExtentsMS = group.boundsHalfExtentsMS;
+            cookedGroup.boundsSphereRadiusMS = group.boundsSphereRadiusMS;
+            cookedGroup.nameOffset = (uint32_t)names.size();
+            cookedGroup.nameLength = (uint32_t)group.materialName.size();
+            cookedGroup.vertexCount = group.vertices.size();
+            cookedGroup.indexCount = group.indices.size();
+            cookedGroup.lodCount = (uint32_t)group.lods.size();
+            for (size_t lodIndex = 0; lodIndex < group.lods.size(); ++lodIndex)
+            {
+                cookedGroup.lodIndexCount[lodIndex] = (uint32_t)group.lods[lodIndex].indexCount;
+                cookedGroup.lodError[lodIndex] = group.lods[lodIndex].error;
+            }
+            names += group.materialName;
+
+            cookedGroups[i] = cookedGroup;
+        }
+
+        for (size_t i = 0; i < m_embeddedImageViews.size(); ++i)
+        {
+            cookedTextures[i].offset = binStart + m_embeddedImageViews[i].offset;
+            cookedTextures[i].size = m_embeddedImageViews[i].size;
+        }
+
+        // Every vertex range, then every index range, starting 16 byte aligned after the tables
+        uint64_t offset = (namesOffset + names.size() + 15) & ~uint64_t(15);
+        const uint64_t padding = offset - (namesOffset + names.size());
+
+        for (CookedGroup& cookedGroup : cookedGroups)
+        {
+            cookedGroup.vertexOffset = offset;
+            offset += cookedGroup.vertexCount * sizeof(Vertex);
+        }
+        const uint64_t unassignedVertexOffset = offset;
+        offset += m_vertices.size() * sizeof(Vertex);
+
+        for (CookedGroup& cookedGroup : cookedGroups)
+        {
+            cookedGroup.indexOffset = offset;
+            offset += cookedGroup.indexCount * sizeof(uint32_t);
+        }
+        const uint64_t unassignedIndexOffset = offset;
+        offset += m_indices.size() * sizeof(uint32_t);
+
+        for (size_t i = 0; i < cookedGroups.size(); ++i)
+        {
+            cookedGroups[i].meshletOffset = offset;
+            cookedGroups[i].meshletCount = m_materialGroups[i].meshlets.size();
+            offset += cookedGroups[i].meshletCount * sizeof(Meshlet);
+        }
+
+        CookedHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "JMSH", 4);
+        header.version = kCookedVersion;
+        header.vertexSize = sizeof(Vertex);
+        header.materialSize = sizeof(PBRMaterial);
+        header.sourceHash = _sourceHash;
+        header.sourceSize = _source.size();
+        header.useMaterials = m_useMaterials ? 1 : 0;
+        header.groupCount = (uint32_t)cookedGroups.size();
+        header.textureCount = (uint32_t)cookedTextures.size();
+        header.namesSize = (uint32_t)names.size();
+        header.unassignedVertexOffset = unassignedVertexOffset;
+        header.unassignedVertexCount = m_vertices.size();
+        header.unassignedIndexOffset = unassignedIndexOffset;
+        header.unassignedIndexCount = m_indices.size();
+        header.width = m_width;
+        header.height = m_height;
+        header.length = m_length;
+
+        // Written to a temporary file first so a crash part way through never leaves a bad cooked file behind
+        const std::string tempPath = _cookedPath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                std::cout << "Failed to write cooked model: " << _cookedPath << std::endl;
+                return;
+            }
+
+            const char zeros[16] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(cookedGroups.data()), cookedGroups.size() * sizeof(CookedGroup));
+            out.write(reinterpret_cast<const char*>(cookedTextures.data()), cookedTextures.size() * sizeof(CookedTexture));
+            out.write(names.data(), names.size());
+            out.write(zeros, padding);
+
+            for (const MaterialGroup& group : m_materialGroups)
+                out.write(reinterpret_cast<const char*>(group.vertices.data()), group.vertices.size() * sizeof(Vertex));
+            out.write(reinterpret_cast<const char*>(m_vertices.data()), m_vertices.size() * sizeof(Vertex));
+
+            for (const MaterialGroup& group : m_materialGroups)
+                out.write(reinterpret_cast<const char*>(group.indices.data()), group.indices.size() * sizeof(uint32_t));
+            out.write(reinterpret_cast<const char*>(m_indices.data()), m_indices.size() * sizeof(uint32_t));
 
-                glBindBuffer(GL_ARRAY_BUFFER, m_vboid);
-                glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), &data.at(0), GL_STATIC_DRAW);
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            for (const MaterialGroup& group : m_materialGroups)
+                out.write(reinterpret_cast<const char*>(group.meshlets.data()), group.meshlets.size() * sizeof(Meshlet));
 
-                glBindVertexArray(m_vaoid);
-                glBindBuffer(GL_ARRAY_BUFFER, m_vboid);
+            if (!out.good())
+            {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(tempPath, ec);
+                std::cout << "Failed to write cooked model: " << _cookedPath << std::endl;
+                return;
+            }
+        }
 
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
-                glEnableVertexAttribArray(0);
-                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(1);
-                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-                glEnableVertexAttribArray(2);
+        std::error_code ec;
+        std::filesystem::rename(tempPath, _cookedPath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tempPath, ec);
+            std::cout << "Failed to write cooked model: " << _cookedPath << std::endl;
+            return;
+        }
 
-                glBindVertexArray(0);
-                glBindBuffer(GL_ARRAY_BUFFER, 0);
+        std::cout << "Cooked model to: " << _cookedPath << std::endl;
+    }
+
+    inline GLuint Model::vao_id()
+    {
+        if (!m_useMaterials)
+        {
+            if (m_indices.empty())
+                throw std::runtime_error("Model is empty");
 
+            if (m_dirty)
+            {
+                Unload();
+                upload_indexed(m_vertices, m_indices, m_vaoid, m_vboid, m_eboid, m_indexType);
                 m_dirty = false;
             }
             return m_vaoid;
@@ -1033,38 +1754,57 @@ namespace Renderer
                 m_vboid = 0;
                 m_dirty = true;
             }
+            if (m_eboid)
+            {
+                glDeleteBuffers(1, &m_eboid);
+                m_eboid = 0;
+                m_dirty = true;
+            }
         }
         else
         {
             for (auto& group : m_materialGroups)
             {
+                // The vertex array is the arena's, only the range is given back
                 if (group.vao)
                 {
-                    glDeleteVertexArrays(1, &group.vao);
+                    geometry_arena(m_vertexFormat).free(group.geometry);
                     group.vao = 0;
-                }
-                if (group.vbo)
-                {
-                    glDeleteBuffers(1, &group.vbo);
-                    group.vbo = 0;
+                    group.geometry = GeometryArena::Range();
                 }
             }
+
+            if (m_materialBuffer)
+            {
+                glDeleteBuffers(1, &m_materialBuffer);
+                m_materialBuffer = 0;
+            }
         }
     }
 
     inline GLsizei Model::vertex_count() const
     {
         if (!m_useMaterials)
-            return static_cast<GLsizei>(m_faces.size() * 3);
+            return static_cast<GLsizei>(m_vertices.size());
         else
         {
             GLsizei count = 0;
             for (const auto& group : m_materialGroups)
-                count += static_cast<GLsizei>(group.faces.size() * 3);
+                count += group.vertexCount;
             return count;
         }
     }
 
+    inline GLsizei Model::index_count() const
+    {
+        return static_cast<GLsizei>(m_indices.size());
+    }
+
+    inline GLenum Model::index_type() const
+    {
+        return m_indexType;
+    }
+
     inline void Model::calculate_dimensions()
     {
         bool first = true;
@@ -1086,23 +1826,15 @@ namespace Renderer
 
         if (!m_useMaterials)
         {
-            for (const auto& face : m_faces)
-            {
-                processVertex(face.a.position);
-                processVertex(face.b.position);
-                processVertex(face.c.position);
-            }
+            for (const auto& vertex : m_vertices)
+                processVertex(vertex.position);
         }
         else
         {
             for (const auto& group : m_materialGroups)
             {
-                for (const auto& face : group.faces)
-                {
-                    processVertex(face.a.position);
-                    processVertex(face.b.position);
-                    processVertex(face.c.position);
-                }
+                for (const auto& vertex : group.vertices)
+                    processVertex(vertex.position);
             }
         }
 
@@ -1117,6 +1849,27 @@ namespace Renderer
 
     inline const std::vector<Model::Face>& Model::GetFaces() const
     {
+        std::lock_guard<std::mutex> lock(m_facesMutex);
+
+        if (m_faces.empty())
+        {
+            auto expand = [this](const Vertex* _vertices, const uint32_t* _indices, size_t _count)
+                {
+                    for (size_t i = 0; i + 2 < _count; i += 3)
+                        m_faces.push_back({ _vertices[_indices[i]], _vertices[_indices[i + 1]], _vertices[_indices[i + 2]] });
+                };
+
+            // Full detail only, the LODs after it are just for drawing
+            size_t count = m_indices.size() / 3;
+            for (const auto& group : m_materialGroups)
+                count += group.indexCount / 3;
+            m_faces.reserve(count);
+
+            for (const auto& group : m_materialGroups)
+                expand(group.vertex_data(), group.index_data(), group.indexCount);
+            expand(m_vertices.data(), m_indices.data(), m_indices.size());
+        }
+
         return m_faces;
     }
 }
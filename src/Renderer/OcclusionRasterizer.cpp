@@ -0,0 +1,354 @@
+#include "OcclusionRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RENDERER_OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace Renderer
+{
+	namespace
+	{
+		// Boxes are tested as this much nearer than they are, so an occluder never hides its own bounds through rounding
+		constexpr float kDepthTolerance = 1e-4f;
+
+		glm::vec4 lerpClip(const glm::vec4& _a, const glm::vec4& _b, float _t)
+		{
+			return _a + (_b - _a) * _t;
+		}
+	}
+
+	bool OcclusionRasterizer::usesSimd()
+	{
+#ifdef RENDERER_OCCLUSION_SSE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void OcclusionRasterizer::resize(int _width, int _height)
+	{
+		const int tilesX = std::max((_width + kTileWidth - 1) / kTileWidth, 1);
+		const int tilesY = std::max((_height + kTileHeight - 1) / kTileHeight, 1);
+		if (tilesX == m_tilesX && tilesY == m_tilesY)
+			return;
+
+		m_tilesX = tilesX;
+		m_tilesY = tilesY;
+		m_width = tilesX * kTileWidth;
+		m_height = tilesY * kTileHeight;
+
+		m_depth.assign(size_t(m_width) * m_height, 0.0f);
+		m_tileFarthest.assign(size_t(m_tilesX) * m_tilesY, 0.0f);
+	}
+
+	void OcclusionRasterizer::beginFrame(const glm::mat4& _viewProj)
+	{
+		m_viewProj = _viewProj;
+		m_occluderCount = 0;
+
+		std::fill(m_depth.begin(), m_depth.end(), 0.0f);
+		std::fill(m_tileFarthest.begin(), m_tileFarthest.end(), 0.0f);
+	}
+
+	void OcclusionRasterizer::addOccluder(const glm::mat4& _transform, const float* _positions, size_t _stride, const uint32_t* _indices, size_t _indexCount, bool _doubleSided)
+	{
+		if (m_occluderCount == m_occluders.size())
+			m_occluders.emplace_back();
+
+		Occluder& occluder = m_occluders[m_occluderCount++];
+		occluder.clipFromModel = m_viewProj * _transform;
+		occluder.positions = _positions;
+		occluder.stride = _stride;
+		occluder.indices = _indices;
+		occluder.indexCount = _indexCount;
+		occluder.doubleSided = _doubleSided;
+		occluder.triangles.clear();
+	}
+
+	size_t OcclusionRasterizer::triangleCount() const
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < m_occluderCount; ++i)
+			count += m_occluders[i].triangles.size();
+		return count;
+	}
+
+	void OcclusionRasterizer::setupOccluder(size_t _occluder)
+	{
+		Occluder& occluder = m_occluders[_occluder];
+		occluder.triangles.clear();
+
+		auto clipPosition = [&](uint32_t _vertex)
+			{
+				const float* p = reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(occluder.positions) + _vertex * occluder.stride);
+				return occluder.clipFromModel * glm::vec4(p[0], p[1], p[2], 1.0f);
+			};
+
+		for (size_t i = 0; i + 2 < occluder.indexCount; i += 3)
+		{
+			const glm::vec4 c[3] = { clipPosition(occluder.indices[i]), clipPosition(occluder.indices[i + 1]), clipPosition(occluder.indices[i + 2]) };
+
+			// All three outside the same side of the frustum. The near plane is handled below
+			if ((c[0].x < -c[0].w && c[1].x < -c[1].w && c[2].x < -c[2].w) ||
+				(c[0].x > c[0].w && c[1].x > c[1].w && c[2].x > c[2].w) ||
+				(c[0].y < -c[0].w && c[1].y < -c[1].w && c[2].y < -c[2].w) ||
+				(c[0].y > c[0].w && c[1].y > c[1].w && c[2].y > c[2].w) ||
+				(c[0].z > c[0].w && c[1].z > c[1].w && c[2].z > c[2].w))
+				continue;
+
+			// Distance in front of the near plane, z = -w
+			const float d[3] = { c[0].z + c[0].w, c[1].z + c[1].w, c[2].z + c[2].w };
+			const int inFront = (d[0] >= 0.0f) + (d[1] >= 0.0f) + (d[2] >= 0.0f);
+
+			if (inFront == 0)
+				continue;
+
+			if (inFront == 3)
+			{
+				addTriangle(occluder.triangles, c[0], c[1], c[2], occluder.doubleSided);
+				continue;
+			}
+
+			// Clipped against the near plane, which leaves a triangle or a quad
+			glm::vec4 polygon[4];
+			int count = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				const int next = (k + 1) % 3;
+				if (d[k] >= 0.0f)
+					polygon[count++] = c[k];
+				if ((d[k] >= 0.0f) != (d[next] >= 0.0f))
+					polygon[count++] = lerpClip(c[k], c[next], d[k] / (d[k] - d[next]));
+			}
+
+			addTriangle(occluder.triangles, polygon[0], polygon[1], polygon[2], occluder.doubleSided);
+			if (count == 4)
+				addTriangle(occluder.triangles, polygon[0], polygon[2], polygon[3], occluder.doubleSided);
+		}
+	}
+
+	void OcclusionRasterizer::addTriangle(std::vector<Triangle>& _triangles, const glm::vec4& _c0, const glm::vec4& _c1, const glm::vec4& _c2, bool _doubleSided) const
+	{
+		// Screen x and y in pixels, and 1/w. Done in double as near clipped vertices can land a long way off screen
+		glm::dvec3 s[3];
+		const glm::vec4* clip[3] = { &_c0, &_c1, &_c2 };
+		for (int k = 0; k < 3; ++k)
+		{
+			const double invW = 1.0 / double(clip[k]->w);
+			s[k] = glm::dvec3((double(clip[k]->x) * invW * 0.5 + 0.5) * m_width, (double(clip[k]->y) * invW * 0.5 + 0.5) * m_height, invW);
+		}
+
+		// Counter clockwise on screen is front facing, the GL default
+		double area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[2].x - s[0].x) * (s[1].y - s[0].y);
+		if (area < 0.0)
+		{
+			if (!_doubleSided)
+				return;
+			std::swap(s[1], s[2]);
+			area = -area;
+		}
+		if (!(area > 0.0))
+			return;
+
+		Triangle triangle;
+		triangle.minX = std::max(int(std::ceil(std::min({ s[0].x, s[1].x, s[2].x }) - 0.5)), 0);
+		triangle.minY = std::max(int(std::ceil(std::min({ s[0].y, s[1].y, s[2].y }) - 0.5)), 0);
+		triangle.maxX = std::min(int(std::floor(std::max({ s[0].x, s[1].x, s[2].x }) - 0.5)), m_width - 1);
+		triangle.maxY = std::min(int(std::floor(std::max({ s[0].y, s[1].y, s[2].y }) - 0.5)), m_height - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			return;
+
+		const double originX = triangle.minX + 0.5;
+		const double originY = triangle.minY + 0.5;
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const glm::dvec3& a = s[k];
+			const glm::dvec3& b = s[(k + 1) % 3];
+			const double edgeA = -(b.y - a.y);
+			const double edgeB = b.x - a.x;
+
+			triangle.edgeA[k] = float(edgeA);
+			triangle.edgeB[k] = float(edgeB);
+			triangle.edgeC[k] = float(edgeA * (originX - a.x) + edgeB * (originY - a.y));
+		}
+
+		const double depthA = ((s[1].z - s[0].z) * (s[2].y - s[0].y) - (s[2].z - s[0].z) * (s[1].y - s[0].y)) / area;
+		const double depthB = ((s[1].x - s[0].x) * (s[2].z - s[0].z) - (s[2].x - s[0].x) * (s[1].z - s[0].z)) / area;
+		triangle.depthA = float(depthA);
+		triangle.depthB = float(depthB);
+		triangle.depthC = float(s[0].z + depthA * (originX - s[0].x) + depthB * (originY - s[0].y));
+		triangle.depthMax = float(std::max({ s[0].z, s[1].z, s[2].z }));
+
+		_triangles.push_back(triangle);
+	}
+
+	void OcclusionRasterizer::rasterizeBand(int _band)
+	{
+		const int rowBegin = _band * kTileHeight;
+		const int rowEnd = rowBegin + kTileHeight;
+
+		for (size_t o = 0; o < m_occluderCount; ++o)
+		{
+			for (const Triangle& triangle : m_occluders[o].triangles)
+			{
+				if (triangle.maxY >= rowBegin && triangle.minY < rowEnd)
+					rasterizeTriangle(triangle, std::max(triangle.minY, rowBegin), std::min(triangle.maxY + 1, rowEnd));
+			}
+		}
+
+		// Farthest depth of each of the band's tiles
+		for (int tx = 0; tx < m_tilesX; ++tx)
+		{
+			float farthest = std::numeric_limits<float>::max();
+			for (int y = rowBegin; y < rowEnd; ++y)
+			{
+				const float* row = &m_depth[size_t(y) * m_width + tx * kTileWidth];
+				for (int x = 0; x < kTileWidth; ++x)
+					farthest = std::min(farthest, row[x]);
+			}
+			m_tileFarthest[size_t(_band) * m_tilesX + tx] = farthest;
+		}
+	}
+
+	void OcclusionRasterizer::rasterizeTriangle(const Triangle& _triangle, int _rowBegin, int _rowEnd)
+	{
+		const Triangle& t = _triangle;
+
+#ifdef RENDERER_OCCLUSION_SSE
+		// Four pixels at a time, starting from a multiple of four. Rows are a whole number of tiles wide so the last group never runs off the end
+		const int firstX = t.minX & ~3;
+
+		const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+		const __m128 depthA = _mm_set1_ps(t.depthA);
+		const __m128 depthMax = _mm_set1_ps(t.depthMax);
+
+		for (int y = _rowBegin; y < _rowEnd; ++y)
+		{
+			const float dy = float(y - t.minY);
+			const __m128 row0 = _mm_set1_ps(t.edgeB[0] * dy + t.edgeC[0]);
+			const __m128 row1 = _mm_set1_ps(t.edgeB[1] * dy + t.edgeC[1]);
+			const __m128 row2 = _mm_set1_ps(t.edgeB[2] * dy + t.edgeC[2]);
+			const __m128 rowDepth = _mm_set1_ps(t.depthB * dy + t.depthC);
+
+			float* row = &m_depth[size_t(y) * m_width];
+
+			for (int x = firstX; x <= t.maxX; x += 4)
+			{
+				const __m128 dx = _mm_add_ps(_mm_set1_ps(float(x - t.minX)), lane);
+
+				const __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, dx), row0);
+				const __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, dx), row1);
+				const __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, dx), row2);
+				const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				const __m128 depth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(depthA, dx), rowDepth), depthMax);
+				const __m128 old = _mm_loadu_ps(row + x);
+				const __m128 nearer = _mm_max_ps(old, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+		}
+#else
+		for (int y = _rowBegin; y < _rowEnd; ++y)
+		{
+			const float dy = float(y - t.minY);
+			const float row0 = t.edgeB[0] * dy + t.edgeC[0];
+			const float row1 = t.edgeB[1] * dy + t.edgeC[1];
+			const float row2 = t.edgeB[2] * dy + t.edgeC[2];
+			const float rowDepth = t.depthB * dy + t.depthC;
+
+			float* row = &m_depth[size_t(y) * m_width];
+
+			for (int x = t.minX; x <= t.maxX; ++x)
+			{
+				const float dx = float(x - t.minX);
+				if (t.edgeA[0] * dx + row0 < 0.0f || t.edgeA[1] * dx + row1 < 0.0f || t.edgeA[2] * dx + row2 < 0.0f)
+					continue;
+
+				const float depth = std::min(t.depthA * dx + rowDepth, t.depthMax);
+				row[x] = std::max(row[x], depth);
+			}
+		}
+#endif
+	}
+
+	bool OcclusionRasterizer::isVisible(const glm::vec3& _min, const glm::vec3& _max) const
+	{
+		if (m_depth.empty())
+			return true;
+
+		glm::vec2 screenMin(std::numeric_limits<float>::max());
+		glm::vec2 screenMax(std::numeric_limits<float>::lowest());
+		float nearest = 0.0f;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			const glm::vec3 corner((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+			const glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.0f);
+
+			if (clip.z < -clip.w || clip.w <= 0.0f)
+				return true;
+
+			const float invW = 1.0f / clip.w;
+			screenMin = glm::min(screenMin, glm::vec2(clip.x * invW, clip.y * invW));
+			screenMax = glm::max(screenMax, glm::vec2(clip.x * invW, clip.y * invW));
+			nearest = std::max(nearest, invW);
+		}
+
+		nearest *= 1.0f + kDepthTolerance;
+
+		const glm::vec2 size(m_width, m_height);
+		screenMin = (screenMin * 0.5f + 0.5f) * size;
+		screenMax = (screenMax * 0.5f + 0.5f) * size;
+
+		// Off screen there's nothing to hide it behind
+		if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= size.x || screenMin.y >= size.y)
+			return true;
+
+		const int x0 = std::clamp(int(std::floor(screenMin.x)), 0, m_width - 1);
+		const int y0 = std::clamp(int(std::floor(screenMin.y)), 0, m_height - 1);
+		const int x1 = std::clamp(int(std::floor(screenMax.x)), 0, m_width - 1);
+		const int y1 = std::clamp(int(std::floor(screenMax.y)), 0, m_height - 1);
+
+		for (int ty = y0 / kTileHeight; ty <= y1 / kTileHeight; ++ty)
+		{
+			for (int tx = x0 / kTileWidth; tx <= x1 / kTileWidth; ++tx)
+			{
+				// Every pixel of the tile is in front of the box
+				if (m_tileFarthest[size_t(ty) * m_tilesX + tx] > nearest)
+					continue;
+
+				const int px0 = std::max(x0, tx * kTileWidth);
+				const int py0 = std::max(y0, ty * kTileHeight);
+				const int px1 = std::min(x1, tx * kTileWidth + kTileWidth - 1);
+				const int py1 = std::min(y1, ty * kTileHeight + kTileHeight - 1);
+
+				// Covers the whole tile, so it covers the pixel that isn't in front of it too
+				if (px1 - px0 == kTileWidth - 1 && py1 - py0 == kTileHeight - 1)
+					return true;
+
+				for (int y = py0; y <= py1; ++y)
+				{
+					const float* row = &m_depth[size_t(y) * m_width];
+					for (int x = px0; x <= px1; ++x)
+					{
+						if (row[x] <= nearest)
+							return true;
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	// Low resolution depth buffer that big occluders are rasterised into on the CPU, so whatever they hide can be dropped before anything
+	// is sent to GL. Unlike anything read back from the GPU it is for this frame's camera.
+	//
+	// Depth is 1/w, so bigger is nearer and it interpolates linearly in screen space, 0 is nothing drawn. The buffer is split into
+	// kTileWidth x kTileHeight tiles that also keep their farthest depth, so most tests are answered without looking at single pixels.
+	//
+	// A frame goes beginFrame, addOccluder for each occluder, setupOccluder for each of occluderCount(), rasterizeBand for each of bandCount(),
+	// then isVisible. Different occluders can be set up and different bands rasterised on different threads, and isVisible is const
+	class OcclusionRasterizer
+	{
+	public:
+		static constexpr int kTileWidth = 32;
+		static constexpr int kTileHeight = 8;
+
+		// Sizes the buffer for about _width x _height pixels, rounded up to whole tiles
+		void resize(int _width, int _height);
+
+		// Clears the depth and forgets last frame's occluders
+		void beginFrame(const glm::mat4& _viewProj);
+
+		// Queues a triangle list to rasterise. _positions points at the first vertex's model space xyz floats, with _stride bytes from one vertex to the next.
+		// Nothing is copied, the positions and indices have to stay put until the frame's bands are rasterised.
+		// Triangles facing away are skipped unless _doubleSided, as the GPU would cull them too
+		void addOccluder(const glm::mat4& _transform, const float* _positions, size_t _stride, const uint32_t* _indices, size_t _indexCount, bool _doubleSided);
+
+		size_t occluderCount() const { return m_occluderCount; }
+
+		// Transforms, clips and sets up the edges of one occluder's triangles
+		void setupOccluder(size_t _occluder);
+
+		// Each band is one row of tiles, rasterised from every set up occluder
+		int bandCount() const { return m_tilesY; }
+		void rasterizeBand(int _band);
+
+		// False only when the world space box is behind the occluders everywhere it covers. Boxes crossing the near plane are visible
+		bool isVisible(const glm::vec3& _min, const glm::vec3& _max) const;
+
+		// Triangles that survived setup this frame
+		size_t triangleCount() const;
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+
+		// Row major from the bottom left, m_width floats a row
+		const float* depth() const { return m_depth.data(); }
+
+		// Whether rasterising uses SSE or plain scalar code
+		static bool usesSimd();
+
+	private:
+		// Edges are E = a * x + b * y + c, evaluated relative to the centre of pixel (minX, minY). Inside is every edge >= 0
+		struct Triangle
+		{
+			float edgeA[3];
+			float edgeB[3];
+			float edgeC[3];
+			float depthA, depthB, depthC; // Plane of 1/w, relative to the same pixel
+			float depthMax; // Nearest vertex, the plane is clamped to it so rounding never brings an occluder closer
+			int minX, minY, maxX, maxY; // Pixels whose centres might be inside, clamped to the buffer
+		};
+
+		struct Occluder
+		{
+			glm::mat4 clipFromModel{ 1.0f };
+			const float* positions = nullptr;
+			size_t stride = 0;
+			const uint32_t* indices = nullptr;
+			size_t indexCount = 0;
+			bool doubleSided = false;
+
+			std::vector<Triangle> triangles; // Kept between frames so the memory is reused
+		};
+
+		void addTriangle(std::vector<Triangle>& _triangles, const glm::vec4& _c0, const glm::vec4& _c1, const glm::vec4& _c2, bool _doubleSided) const;
+		void rasterizeTriangle(const Triangle& _triangle, int _rowBegin, int _rowEnd);
+
+		int m_width = 0;
+		int m_height = 0;
+		int m_tilesX = 0;
+		int m_tilesY = 0;
+
+		std::vector<float> m_depth;
+		std::vector<float> m_tileFarthest; // Smallest 1/w in each tile
+
+		glm::mat4 m_viewProj{ 1.0f };
+
+		std::vector<Occluder> m_occluders;
+		size_t m_occluderCount = 0;
+	};
+}
\ No newline at end of file
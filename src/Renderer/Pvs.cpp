@@ -0,0 +1,391 @@
+#include "Pvs.h"
+
+#include "Model.h"
+#include "OcclusionRasterizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace Renderer
+{
+	namespace
+	{
+		// World space box around a material group's model space bounds
+		void groupBounds(const Model::MaterialGroup& _group, const glm::mat4& _transform, glm::vec3& _min, glm::vec3& _max)
+		{
+			const glm::vec3 center = glm::vec3(_transform * glm::vec4(_group.boundsCenterMS, 1.0f));
+			const glm::mat3 A = glm::mat3(_transform);
+			const glm::vec3 e = _group.boundsHalfExtentsMS;
+			const glm::vec3 extent = glm::abs(A[0]) * e.x + glm::abs(A[1]) * e.y + glm::abs(A[2]) * e.z;
+
+			_min = center - extent;
+			_max = center + extent;
+		}
+
+		// Whether the box is entirely outside one side of _viewProj's frustum
+		bool outsideFrustum(const glm::mat4& _viewProj, const glm::vec3& _min, const glm::vec3& _max)
+		{
+			int outside[6] = {};
+			for (int i = 0; i < 8; ++i)
+			{
+				const glm::vec3 corner((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+				const glm::vec4 clip = _viewProj * glm::vec4(corner, 1.0f);
+
+				outside[0] += clip.x < -clip.w;
+				outside[1] += clip.x > clip.w;
+				outside[2] += clip.y < -clip.w;
+				outside[3] += clip.y > clip.w;
+				outside[4] += clip.z < -clip.w;
+				outside[5] += clip.z > clip.w;
+			}
+
+			for (int count : outside)
+			{
+				if (count == 8)
+					return true;
+			}
+			return false;
+		}
+
+		// Shrinks a world space box to the part of it inside a 90 degree cube face's frustum, false if none of it is.
+		// The occlusion test treats boxes reaching behind the camera as visible, and with six faces around each viewpoint most boxes near
+		// it reach behind one of them. A cube face's view only swaps and flips axes, so the box stays exact going to view space and back
+		bool clipToFace(const glm::mat4& _view, float _near, float _far, glm::vec3& _min, glm::vec3& _max)
+		{
+			glm::vec3 viewMin(std::numeric_limits<float>::max());
+			glm::vec3 viewMax(std::numeric_limits<float>::lowest());
+			for (int i = 0; i < 8; ++i)
+			{
+				const glm::vec3 corner((i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z);
+				const glm::vec3 p = glm::vec3(_view * glm::vec4(corner, 1.0f));
+				viewMin = glm::min(viewMin, p);
+				viewMax = glm::max(viewMax, p);
+			}
+
+			// Looking down -z, inside is near <= depth <= far with |x| and |y| no more than the depth
+			auto closestToZero = [](float _lo, float _hi) { return _lo > 0.0f ? _lo : (_hi < 0.0f ? -_hi : 0.0f); };
+
+			const float depthMax = std::min(-viewMin.z, _far);
+			const float depthMin = std::max({ -viewMax.z, _near, closestToZero(viewMin.x, viewMax.x), closestToZero(viewMin.y, viewMax.y) });
+			if (depthMin > depthMax)
+				return false;
+
+			viewMin = glm::vec3(std::max(viewMin.x, -depthMax), std::max(viewMin.y, -depthMax), -depthMax);
+			viewMax = glm::vec3(std::min(viewMax.x, depthMax), std::min(viewMax.y, depthMax), -depthMin);
+			if (viewMin.x > viewMax.x || viewMin.y > viewMax.y)
+				return false;
+
+			const glm::mat4 world = glm::inverse(_view);
+			_min = glm::vec3(std::numeric_limits<float>::max());
+			_max = glm::vec3(std::numeric_limits<float>::lowest());
+			for (int i = 0; i < 8; ++i)
+			{
+				const glm::vec3 corner((i & 1) ? viewMax.x : viewMin.x, (i & 2) ? viewMax.y : viewMin.y, (i & 4) ? viewMax.z : viewMin.z);
+				const glm::vec3 p = glm::vec3(world * glm::vec4(corner, 1.0f));
+				_min = glm::min(_min, p);
+				_max = glm::max(_max, p);
+			}
+			return true;
+		}
+	}
+
+	void Pvs::setPath(const std::vector<glm::vec3>& _path, bool _closed, float _cellLength, float _corridorRadius, size_t _itemCount, uint64_t _sourceKey,
+		const glm::mat4& _transform)
+	{
+		m_closed = _closed;
+		m_cellLength = std::max(_cellLength, 1e-3f);
+		m_corridorRadius = _corridorRadius;
+		m_itemCount = _itemCount;
+		m_wordsPerCell = (_itemCount + 63) / 64;
+		m_sourceKey = _sourceKey;
+		m_transform = _transform;
+
+		m_points.resize(_path.size());
+		float distance = 0.0f;
+		for (size_t i = 0; i < _path.size(); ++i)
+		{
+			if (i > 0)
+				distance += glm::length(_path[i] - _path[i - 1]);
+
+			m_points[i].position = _path[i];
+			m_points[i].cell = uint32_t(distance / m_cellLength);
+		}
+
+		m_cellCount = m_points.empty() ? 0 : size_t(m_points.back().cell) + 1;
+		m_bits.assign(m_cellCount * m_wordsPerCell, 0);
+	}
+
+	void Pvs::bakeCell(int _cell, const Model& _model, const PvsBakeSettings& _settings)
+	{
+		const auto& groups = _model.GetMaterialGroups();
+		if (_cell < 0 || size_t(_cell) >= m_cellCount || groups.size() != m_itemCount)
+			return;
+
+		const glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+		// Every point of the cell, the middle of each segment leaving one and the point the last one ends on, each moved across the corridor and up to each eye height
+		std::vector<glm::vec3> viewpoints;
+		auto addViewpoints = [&](const glm::vec3& _point, const glm::vec3& _tangent)
+			{
+				glm::vec3 side = glm::cross(_tangent, up);
+				const float sideLength = glm::length(side);
+				side = sideLength > 1e-6f ? side / sideLength : glm::vec3(1.0f, 0.0f, 0.0f);
+
+				for (float across : { -_settings.corridorHalfWidth, 0.0f, _settings.corridorHalfWidth })
+				{
+					for (float height : _settings.eyeHeights)
+						viewpoints.push_back(_point + side * across + up * height);
+				}
+			};
+
+		for (size_t i = 0; i < m_points.size(); ++i)
+		{
+			if (m_points[i].cell != uint32_t(_cell))
+				continue;
+
+			const bool hasNext = i + 1 < m_points.size() || m_closed;
+			const glm::vec3 a = m_points[i].position;
+			const glm::vec3 b = hasNext ? m_points[(i + 1) % m_points.size()].position : a;
+			const glm::vec3 tangent = b - a;
+
+			addViewpoints(a, tangent);
+			if (hasNext)
+			{
+				addViewpoints(0.5f * (a + b), tangent);
+				addViewpoints(b, tangent);
+			}
+		}
+
+		std::vector<glm::vec3> boundsMin(groups.size());
+		std::vector<glm::vec3> boundsMax(groups.size());
+		for (size_t g = 0; g < groups.size(); ++g)
+			groupBounds(groups[g], m_transform, boundsMin[g], boundsMax[g]);
+
+		uint64_t* bits = &m_bits[size_t(_cell) * m_wordsPerCell];
+
+		OcclusionRasterizer rasterizer;
+		rasterizer.resize(_settings.faceSize, _settings.faceSize);
+
+		// Faces are rendered a little wider than the 90 degrees boxes are clipped to, so a box clipped right onto a face's edge doesn't round off screen
+		const glm::mat4 proj = glm::perspective(glm::radians(92.0f), 1.0f, _settings.nearPlane, _settings.farPlane);
+		const glm::vec3 faceDirections[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		const glm::vec3 faceUps[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+		for (const glm::vec3& eye : viewpoints)
+		{
+			for (int face = 0; face < 6; ++face)
+			{
+				const glm::mat4 view = glm::lookAt(eye, eye + faceDirections[face], faceUps[face]);
+				const glm::mat4 viewProj = proj * view;
+
+				// Alpha tested groups have holes, so only solid ones hide anything
+				rasterizer.beginFrame(viewProj);
+				for (size_t g = 0; g < groups.size(); ++g)
+				{
+					const auto& group = groups[g];
+					if (group.pbr.alphaMode != Model::PBRMaterial::AlphaMode::AlphaOpaque || group.vertexCount == 0 || outsideFrustum(viewProj, boundsMin[g], boundsMax[g]))
+						continue;
+
+					rasterizer.addOccluder(m_transform, &group.vertex_data()->position.x, sizeof(Model::Vertex), group.index_data(), size_t(group.indexCount), group.pbr.doubleSided);
+				}
+
+				for (size_t o = 0; o < rasterizer.occluderCount(); ++o)
+					rasterizer.setupOccluder(o);
+				for (int band = 0; band < rasterizer.bandCount(); ++band)
+					rasterizer.rasterizeBand(band);
+
+				for (size_t g = 0; g < groups.size(); ++g)
+				{
+					if ((bits[g >> 6] >> (g & 63)) & 1)
+						continue;
+
+					glm::vec3 clippedMin = boundsMin[g];
+					glm::vec3 clippedMax = boundsMax[g];
+					if (clipToFace(view, _settings.nearPlane, _settings.farPlane, clippedMin, clippedMax) && rasterizer.isVisible(clippedMin, clippedMax))
+						bits[g >> 6] |= uint64_t(1) << (g & 63);
+				}
+			}
+		}
+	}
+
+	int Pvs::findCell(const glm::vec3& _position) const
+	{
+		if (m_points.empty())
+			return -1;
+
+		int cell = -1;
+		float best = m_corridorRadius * m_corridorRadius;
+
+		if (m_points.size() == 1)
+			return glm::dot(_position - m_points[0].position, _position - m_points[0].position) <= best ? int(m_points[0].cell) : -1;
+
+		const size_t segmentCount = m_closed ? m_points.size() : m_points.size() - 1;
+		for (size_t i = 0; i < segmentCount; ++i)
+		{
+			const PathPoint& a = m_points[i];
+			const PathPoint& b = m_points[(i + 1) % m_points.size()];
+
+			const glm::vec3 ab = b.position - a.position;
+			const float lengthSquared = glm::dot(ab, ab);
+			const float t = lengthSquared > 0.0f ? std::clamp(glm::dot(_position - a.position, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+
+			const glm::vec3 offset = _position - (a.position + ab * t);
+			const float distanceSquared = glm::dot(offset, offset);
+			if (distanceSquared <= best)
+			{
+				best = distanceSquared;
+				cell = int(t < 0.5f ? a.cell : b.cell);
+			}
+		}
+
+		return cell;
+	}
+
+	size_t Pvs::visibleCount(int _cell) const
+	{
+		size_t count = 0;
+		for (size_t w = 0; w < m_wordsPerCell; ++w)
+		{
+			uint64_t word = m_bits[size_t(_cell) * m_wordsPerCell + w];
+			for (; word; word &= word - 1)
+				count++;
+		}
+		return count;
+	}
+
+	bool Pvs::save(const std::string& _path) const
+	{
+		FileHeader header{};
+		std::memcpy(header.magic, "JPVS", 4);
+		header.version = kVersion;
+		header.sourceKey = m_sourceKey;
+		header.pointCount = uint32_t(m_points.size());
+		header.cellCount = uint32_t(m_cellCount);
+		header.itemCount = uint32_t(m_itemCount);
+		header.closed = m_closed ? 1 : 0;
+		header.cellLength = m_cellLength;
+		header.corridorRadius = m_corridorRadius;
+		std::memcpy(header.transform, &m_transform[0][0], sizeof(header.transform));
+
+		// Written to a temporary file first so a crash part way through never leaves a bad file behind
+		const std::string tempPath = _path + ".tmp";
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			if (!out)
+			{
+				std::cout << "Failed to write PVS: " << _path << std::endl;
+				return false;
+			}
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(m_points.data()), m_points.size() * sizeof(PathPoint));
+			out.write(reinterpret_cast<const char*>(m_bits.data()), m_bits.size() * sizeof(uint64_t));
+
+			if (!out.good())
+			{
+				out.close();
+				std::error_code ec;
+				std::filesystem::remove(tempPath, ec);
+				std::cout << "Failed to write PVS: " << _path << std::endl;
+				return false;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, _path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempPath, ec);
+			std::cout << "Failed to write PVS: " << _path << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Pvs::load(const std::string& _path)
+	{
+		std::ifstream in(_path, std::ios::binary);
+		if (!in)
+			return false;
+
+		FileHeader header;
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+
+		if (std::memcmp(header.magic, "JPVS", 4) != 0 || header.version != kVersion)
+		{
+			std::cout << "PVS is from an older version, it needs baking again: " << _path << std::endl;
+			return false;
+		}
+
+		std::vector<PathPoint> points(header.pointCount);
+		const size_t wordsPerCell = (size_t(header.itemCount) + 63) / 64;
+		std::vector<uint64_t> bits(size_t(header.cellCount) * wordsPerCell);
+
+		in.read(reinterpret_cast<char*>(points.data()), points.size() * sizeof(PathPoint));
+		in.read(reinterpret_cast<char*>(bits.data()), bits.size() * sizeof(uint64_t));
+		if (!in)
+		{
+			std::cout << "PVS is truncated: " << _path << std::endl;
+			return false;
+		}
+
+		for (const PathPoint& point : points)
+		{
+			if (point.cell >= header.cellCount)
+			{
+				std::cout << "PVS is corrupt: " << _path << std::endl;
+				return false;
+			}
+		}
+
+		m_points.swap(points);
+		m_bits.swap(bits);
+		m_closed = header.closed != 0;
+		m_cellLength = header.cellLength;
+		m_corridorRadius = header.corridorRadius;
+		m_cellCount = header.cellCount;
+		m_itemCount = header.itemCount;
+		m_wordsPerCell = wordsPerCell;
+		m_sourceKey = header.sourceKey;
+		std::memcpy(&m_transform[0][0], header.transform, sizeof(header.transform));
+		return true;
+	}
+
+	uint64_t Pvs::sourceKey(const Model& _model)
+	{
+		// FNV-1a over what identifies each group: its size and where it is
+		uint64_t h = 0xCBF29CE484222325ull;
+		auto mix = [&](const void* _data, size_t _size)
+			{
+				const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+				for (size_t i = 0; i < _size; ++i)
+				{
+					h ^= bytes[i];
+					h *= 0x100000001B3ull;
+				}
+			};
+
+		const auto& groups = _model.GetMaterialGroups();
+		const uint64_t groupCount = groups.size();
+		mix(&groupCount, sizeof(groupCount));
+
+		for (const auto& group : groups)
+		{
+			const int32_t counts[2] = { int32_t(group.vertexCount), int32_t(group.indexCount) };
+			mix(counts, sizeof(counts));
+			mix(&group.boundsCenterMS, sizeof(glm::vec3));
+			mix(&group.boundsHalfExtentsMS, sizeof(glm::vec3));
+		}
+
+		return h;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace Renderer
+{
+	class Model;
+
+	// Where the camera can be when a cell is baked, around the path
+	struct PvsBakeSettings
+	{
+		float corridorHalfWidth = 8.0f; // How far either side of the path
+		std::vector<float> eyeHeights{ 1.0f, 3.0f }; // Above the path, an in car and a chase camera
+		int faceSize = 256; // Each viewpoint is rasterised as a cube of faceSize x faceSize faces
+		float nearPlane = 0.1f;
+		float farPlane = 5000.0f;
+	};
+
+	// Potentially visible sets baked along a path, like a lap of a circuit. The path is cut into cells of about the same length,
+	// and each cell has a bit per item (a model's material groups, in order) that can be seen from somewhere in the corridor around it.
+	// Anything without its bit set can be skipped while the camera is in that cell
+	class Pvs
+	{
+	public:
+		// Starts a new bake. Each path point goes in the cell its distance along the path falls in, and every cell starts with nothing visible.
+		// _closed joins the last point back to the first. The camera is only in a cell when it is within _corridorRadius of the path.
+		// _transform is where the model is placed for the bake, and is saved with it
+		void setPath(const std::vector<glm::vec3>& _path, bool _closed, float _cellLength, float _corridorRadius, size_t _itemCount, uint64_t _sourceKey,
+			const glm::mat4& _transform);
+
+		// Fills in one cell by rasterising _model, placed by the transform given to setPath, on the CPU from viewpoints across the corridor around it.
+		// Items are its material groups. Different cells can be baked on different threads
+		void bakeCell(int _cell, const Model& _model, const PvsBakeSettings& _settings);
+
+		// The cell of the nearest part of the path, or -1 if the path is further away than the corridor radius
+		int findCell(const glm::vec3& _position) const;
+
+		bool isVisible(int _cell, size_t _item) const { return (m_bits[size_t(_cell) * m_wordsPerCell + (_item >> 6)] >> (_item & 63)) & 1; }
+		size_t visibleCount(int _cell) const;
+
+		size_t cellCount() const { return m_cellCount; }
+		size_t itemCount() const { return m_itemCount; }
+		uint64_t sourceKey() const { return m_sourceKey; }
+		// The model's world matrix when it was baked. The sets only hold for a model placed there
+		const glm::mat4& transform() const { return m_transform; }
+
+		bool save(const std::string& _path) const;
+		bool load(const std::string& _path);
+
+		// Changes whenever _model's material groups do, so a PVS baked from an older version of a model can be spotted and ignored
+		static uint64_t sourceKey(const Model& _model);
+
+	private:
+		static constexpr uint32_t kVersion = 2;
+
+		struct FileHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint64_t sourceKey;
+			uint32_t pointCount;
+			uint32_t cellCount;
+			uint32_t itemCount;
+			uint32_t closed;
+			float cellLength;
+			float corridorRadius;
+			float transform[16];
+		};
+
+		struct PathPoint
+		{
+			glm::vec3 position;
+			uint32_t cell;
+		};
+
+		std::vector<PathPoint> m_points;
+		bool m_closed = false;
+		float m_cellLength = 0.0f;
+		float m_corridorRadius = 0.0f;
+
+		size_t m_cellCount = 0;
+		size_t m_itemCount = 0;
+		size_t m_wordsPerCell = 0;
+		uint64_t m_sourceKey = 0;
+		glm::mat4 m_transform{ 1.0f };
+
+		std::vector<uint64_t> m_bits; // m_wordsPerCell words per cell, bit i of word i / 64 for item i
+	};
+}
\ No newline at end of file
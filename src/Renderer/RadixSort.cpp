@@ -0,0 +1,45 @@
+#include "RadixSort.h"
+
+#include <cstddef>
+
+namespace Renderer
+{
+	void radixSort(std::vector<SortItem>& _items, std::vector<SortItem>& _scratch)
+	{
+		const size_t count = _items.size();
+		if (count < 2)
+			return;
+
+		_scratch.resize(count);
+
+		// Every byte's histogram in one read of the keys
+		uint32_t histograms[8][256] = {};
+		for (const SortItem& item : _items)
+		{
+			for (int byte = 0; byte < 8; ++byte)
+				histograms[byte][(item.key >> (byte * 8)) & 0xFF]++;
+		}
+
+		for (int byte = 0; byte < 8; ++byte)
+		{
+			uint32_t* histogram = histograms[byte];
+
+			// All keys share this byte, the pass wouldn't move anything
+			if (histogram[(_items[0].key >> (byte * 8)) & 0xFF] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (int bucket = 0; bucket < 256; ++bucket)
+			{
+				uint32_t bucketCount = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (const SortItem& item : _items)
+				_scratch[histogram[(item.key >> (byte * 8)) & 0xFF]++] = item;
+
+			_items.swap(_scratch);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace Renderer
+{
+	// A draw's sort key and the index of the record it was made from
+	struct SortItem
+	{
+		uint64_t key = 0;
+		uint32_t index = 0;
+	};
+
+	// Stable least significant byte first radix sort of _items by key. Bytes that are the same in every key are skipped.
+	// _scratch is only working space, keep it between calls so neither buffer is reallocated every frame
+	void radixSort(std::vector<SortItem>& _items, std::vector<SortItem>& _scratch);
+}
\ No newline at end of file
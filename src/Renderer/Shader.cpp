@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <exception>
+#include <algorithm>
 
 namespace Renderer
 {
@@ -94,6 +95,8 @@ namespace Renderer
 				throw std::exception();
 			}
 
+			cache_uniforms();
+
 			glDetachShader(m_id, v_id);
 			glDeleteShader(v_id);
 			glDetachShader(m_id, f_id);
@@ -105,102 +108,243 @@ namespace Renderer
 		return m_id;
 	}
 
+	void Shader::cache_uniforms()
+	{
+		m_uniformSlots.clear();
+		m_uniforms.clear();
+
+		GLint count = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &count);
+		GLint maxLength = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+
+		// Names for a location already seen share its slot, so setting one through either name keeps one shadowed value
+		std::unordered_map<GLint, int> slotAt;
+		auto addSlot = [&](const std::string& _name, GLint _location, int _arrayRemaining)
+			{
+				auto existing = slotAt.find(_location);
+				if (existing != slotAt.end())
+				{
+					m_uniformSlots[_name] = existing->second;
+					return;
+				}
+
+				int index = (int)m_uniforms.size();
+				slotAt[_location] = index;
+				m_uniformSlots[_name] = index;
+				UniformSlot slot;
+				slot.location = _location;
+				slot.arrayRemaining = _arrayRemaining;
+				m_uniforms.push_back(slot);
+			};
+
+		for (GLint i = 0; i < count; ++i)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(m_id, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+			std::string name(nameBuffer.data(), length);
+			GLint location = glGetUniformLocation(m_id, name.c_str());
+			if (location < 0)
+				continue; // In a uniform block
+
+			// Arrays are reported as "name[0]", they can also be set through "name" and each element through "name[i]"
+			bool isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+			addSlot(name, location, isArray ? size : 1);
+
+			if (isArray)
+			{
+				std::string baseName = name.substr(0, name.size() - 3);
+				addSlot(baseName, location, size);
+
+				for (GLint element = 1; element < size; ++element)
+				{
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					GLint elementLocation = glGetUniformLocation(m_id, elementName.c_str());
+					if (elementLocation >= 0)
+						addSlot(elementName, elementLocation, size - element);
+				}
+			}
+		}
+	}
+
+	int Shader::find_slot(const std::string& _name)
+	{
+		id();
+
+		auto iterator = m_uniformSlots.find(_name);
+		if (iterator == m_uniformSlots.end())
+			return -1;
+
+		return iterator->second;
+	}
+
+	GLint Shader::array_location(const std::string& _name)
+	{
+		int slot = find_slot(_name);
+		if (slot < 0)
+			return -1;
+
+		bind();
+
+		// The upload can reach any element after this one
+		int end = std::min(slot + m_uniforms[slot].arrayRemaining, (int)m_uniforms.size());
+		for (int element = slot; element < end; ++element)
+			m_uniforms[element].hasValue = false;
+
+		return m_uniforms[slot].location;
+	}
+
+	void Shader::set(int _slot, int _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniform1i(m_uniforms[_slot].location, _value);
+		}
+	}
+
+	void Shader::set(int _slot, float _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniform1f(m_uniforms[_slot].location, _value);
+		}
+	}
+
+	void Shader::set(int _slot, const glm::vec2& _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniform2fv(m_uniforms[_slot].location, 1, glm::value_ptr(_value));
+		}
+	}
+
+	void Shader::set(int _slot, const glm::vec3& _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniform3fv(m_uniforms[_slot].location, 1, glm::value_ptr(_value));
+		}
+	}
+
+	void Shader::set(int _slot, const glm::vec4& _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniform4fv(m_uniforms[_slot].location, 1, glm::value_ptr(_value));
+		}
+	}
+
+	void Shader::set(int _slot, const glm::mat3& _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniformMatrix3fv(m_uniforms[_slot].location, 1, GL_FALSE, glm::value_ptr(_value));
+		}
+	}
+
+	void Shader::set(int _slot, const glm::mat4& _value)
+	{
+		if (_slot >= 0 && changed(m_uniforms[_slot], _value))
+		{
+			bind();
+			glUniformMatrix4fv(m_uniforms[_slot].location, 1, GL_FALSE, glm::value_ptr(_value));
+		}
+	}
+
 	void Shader::uniform(const std::string& _name, bool value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform1i(loc, value);
+		set(find_slot(_name), value ? 1 : 0);
 	}
 
 	void Shader::uniform(const std::string& _name, int value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform1i(loc, value);
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, float value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform1f(loc, value);
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, const glm::mat3& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(value));
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, const glm::mat4& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, const glm::vec2& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform2fv(loc, 1, glm::value_ptr(value));
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, const glm::vec3& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform3fv(loc, 1, glm::value_ptr(value));
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, const glm::vec4& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
-		glUniform4fv(loc, 1, glm::value_ptr(value));
+		set(find_slot(_name), value);
 	}
 
 	void Shader::uniform(const std::string& _name, std::vector<int> value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
+		GLint loc = array_location(_name);
 		glUniform1iv(loc, value.size(), value.data());
 	}
 
 	void Shader::uniform(const std::string& _name, std::vector<float> value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
+		GLint loc = array_location(_name);
 		glUniform1fv(loc, value.size(), value.data());
 	}
 
 	void Shader::uniform(const std::string& _name, const std::vector<glm::vec2>& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
+		GLint loc = array_location(_name);
 		glUniform2fv(loc, value.size(), glm::value_ptr(value[0]));
 	}
 
 	void Shader::uniform(const std::string& _name, const std::vector<glm::vec3>& value)
 	{
-		// Find uniform locations
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
+		GLint loc = array_location(_name);
 		glUniform3fv(loc, value.size(), glm::value_ptr(value[0]));
 	}
 
 	void Shader::uniform(const std::string& _name, const std::vector<glm::mat4>& values)
 	{
-		GLint loc = glGetUniformLocation(id(), _name.c_str());
+		GLint loc = array_location(_name);
 		glUniformMatrix4fv(loc, static_cast<GLsizei>(values.size()), GL_FALSE, glm::value_ptr(values[0]));
 	}
 
+	void Shader::uniform(UniformHandle<int> _sampler, const Texture& _texture, int _textureUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + _textureUnit);
+		glBindTexture(GL_TEXTURE_2D, _texture.id());
+		set(_sampler.slot, _textureUnit);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
 	void Shader::uniform(const std::string& name, const std::shared_ptr<Texture> texture, int startingTextureUnit)
 	{
 		glActiveTexture(GL_TEXTURE0 + startingTextureUnit);
 		glBindTexture(GL_TEXTURE_2D, texture->id());
-		GLint loc = glGetUniformLocation(id(), name.c_str());
-		glUniform1i(loc, startingTextureUnit);
+		set(find_slot(name), startingTextureUnit);
 		glActiveTexture(GL_TEXTURE0);
 	}
 
@@ -208,8 +352,7 @@ namespace Renderer
 	{
 		glActiveTexture(GL_TEXTURE0 + startingTextureUnit);
 		glBindTexture(GL_TEXTURE_2D, texture->getTextureId());
-		GLint loc = glGetUniformLocation(id(), name.c_str());
-		glUniform1i(loc, startingTextureUnit);
+		set(find_slot(name), startingTextureUnit);
 		glActiveTexture(GL_TEXTURE0);
 	}
 
@@ -217,8 +360,7 @@ namespace Renderer
 	{
 		glActiveTexture(GL_TEXTURE0 + startingTextureUnit);
 		glBindTexture(GL_TEXTURE_2D, _fbo);
-		GLint loc = glGetUniformLocation(id(), name.c_str());
-		glUniform1i(loc, startingTextureUnit);
+		set(find_slot(name), startingTextureUnit);
 		glActiveTexture(GL_TEXTURE0);
 	}
 
@@ -228,8 +370,7 @@ namespace Renderer
 		glActiveTexture(GL_TEXTURE0 + startingTextureUnit);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id());
 
-		GLint loc = glGetUniformLocation(id(), name.c_str());
-		glUniform1i(loc, startingTextureUnit);
+		set(find_slot(name), startingTextureUnit);
 
 		glActiveTexture(GL_TEXTURE0);
 	}
@@ -239,8 +380,7 @@ namespace Renderer
 		glActiveTexture(GL_TEXTURE0 + startingTextureUnit);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, texture->getTextureId());
 
-		GLint loc = glGetUniformLocation(id(), name.c_str());
-		glUniform1i(loc, startingTextureUnit);
+		set(find_slot(name), startingTextureUnit);
 
 		glActiveTexture(GL_TEXTURE0);
 	}
@@ -255,8 +395,7 @@ namespace Renderer
 			glBindTexture(GL_TEXTURE_2D, textures[i]->getTextureId());
 
 			std::string arrayName = name + "[" + std::to_string(i) + "]";
-			GLint loc = glGetUniformLocation(id(), arrayName.c_str());
-			glUniform1i(loc, texUnit);
+			set(find_slot(arrayName), texUnit);
 		}
 
 		glActiveTexture(GL_TEXTURE0);
@@ -271,27 +410,27 @@ namespace Renderer
 			{
 				glActiveTexture(GL_TEXTURE0);
 				glBindTexture(GL_TEXTURE_2D, _textures[0]->id());
-				glUniform1i(glGetUniformLocation(id(), "u_AlbedoMap"), 0);
-				glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), true);
-
-				glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), false);
-				glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), false);
-				glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), false);
-				glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), false);
-
-				glUniform1i(glGetUniformLocation(id(), "u_AlphaMode"), 0);
-				glUniform1f(glGetUniformLocation(id(), "u_AlphaCutoff"), 0.5f);
-
-				glUniform1f(glGetUniformLocation(id(), "u_NormalScale"), 1.0f);
-				glUniform1f(glGetUniformLocation(id(), "u_OcclusionStrength"), 1.0f);
-				glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFactor"), 1, glm::value_ptr(glm::vec3(0.0f)));
-				glUniform1f(glGetUniformLocation(id(), "u_TransmissionFactor"), 0.0f);
-				glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 0);
-				glUniform1f(glGetUniformLocation(id(), "u_IOR"), 1.5f);
+				uniform("u_AlbedoMap", 0);
+				uniform("u_HasAlbedoMap", true);
+
+				uniform("u_HasNormalMap", false);
+				uniform("u_HasMetallicRoughnessMap", false);
+				uniform("u_HasOcclusionMap", false);
+				uniform("u_HasEmissiveMap", false);
+
+				uniform("u_AlphaMode", 0);
+				uniform("u_AlphaCutoff", 0.5f);
+
+				uniform("u_NormalScale", 1.0f);
+				uniform("u_OcclusionStrength", 1.0f);
+				uniform("u_EmissiveFactor", glm::vec3(0.0f));
+				uniform("u_TransmissionFactor", 0.0f);
+				uniform("u_HasTransmissionTex", 0);
+				uniform("u_IOR", 1.5f);
 			}
 			GLuint legacyVAO = _model->vao_id();
 			glBindVertexArray(legacyVAO);
-			glDrawArrays(GL_TRIANGLES, 0, _model->vertex_count());
+			glDrawElements(GL_TRIANGLES, _model->index_count(), _model->index_type(), nullptr);
 		}
 		else
 		{
@@ -324,118 +463,117 @@ namespace Renderer
 					{
 						glActiveTexture(GL_TEXTURE0);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.baseColorTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_AlbedoMap"), 0);
-						glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), true);
+						uniform("u_AlbedoMap", 0);
+						uniform("u_HasAlbedoMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), false);
+						uniform("u_HasAlbedoMap", false);
 
 					// Normal map
 					if (pbr.normalTexIndex >= 0 && pbr.normalTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE1);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.normalTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_NormalMap"), 1);
-						glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), 1);
+						uniform("u_NormalMap", 1);
+						uniform("u_HasNormalMap", 1);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), false);
+						uniform("u_HasNormalMap", false);
 
 					// Metallic-Roughness
 					if (pbr.metallicRoughnessTexIndex >= 0 && pbr.metallicRoughnessTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE2);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.metallicRoughnessTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_MetallicRoughnessMap"), 2);
-						glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), true);
+						uniform("u_MetallicRoughnessMap", 2);
+						uniform("u_HasMetallicRoughnessMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), false);
+						uniform("u_HasMetallicRoughnessMap", false);
 
 					// Occlusion
 					if (pbr.occlusionTexIndex >= 0 && pbr.occlusionTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE3);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.occlusionTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_OcclusionMap"), 3);
-						glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), true);
+						uniform("u_OcclusionMap", 3);
+						uniform("u_HasOcclusionMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), false);
+						uniform("u_HasOcclusionMap", false);
 
 					// Emissive
 					if (pbr.emissiveTexIndex >= 0 && pbr.emissiveTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE4);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.emissiveTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_EmissiveMap"), 4);
-						glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), true);
+						uniform("u_EmissiveMap", 4);
+						uniform("u_HasEmissiveMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), false);
+						uniform("u_HasEmissiveMap", false);
 
 					// Material factors
-					glUniform4fv(glGetUniformLocation(id(), "u_BaseColorFactor"), 1, glm::value_ptr(pbr.baseColorFactor));
-					glUniform1f(glGetUniformLocation(id(), "u_MetallicFactor"), pbr.metallicFactor);
-					glUniform1f(glGetUniformLocation(id(), "u_RoughnessFactor"), pbr.roughnessFactor);
+					uniform("u_BaseColorFactor", pbr.baseColorFactor);
+					uniform("u_MetallicFactor", pbr.metallicFactor);
+					uniform("u_RoughnessFactor", pbr.roughnessFactor);
 
-					glUniform4fv(glGetUniformLocation(id(), "u_AlbedoFallback"), 1, glm::value_ptr(glm::vec4(1, 1, 1, 1)));
-					glUniform1f(glGetUniformLocation(id(), "u_MetallicFallback"), 0.f);
-					glUniform1f(glGetUniformLocation(id(), "u_RoughnessFallback"), 1.f);
-					glUniform1f(glGetUniformLocation(id(), "u_AOFallback"), 1.f);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFallback"), 1, glm::value_ptr(glm::vec3(0, 0, 0)));
+					uniform("u_AlbedoFallback", glm::vec4(1, 1, 1, 1));
+					uniform("u_MetallicFallback", 0.f);
+					uniform("u_RoughnessFallback", 1.f);
+					uniform("u_AOFallback", 1.f);
+					uniform("u_EmissiveFallback", glm::vec3(0, 0, 0));
 
-					glUniform1f(glGetUniformLocation(id(), "u_NormalScale"), pbr.normalScale);
-					glUniform1f(glGetUniformLocation(id(), "u_OcclusionStrength"), pbr.occlusionStrength);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFactor"), 1, glm::value_ptr(pbr.emissiveFactor));
+					uniform("u_NormalScale", pbr.normalScale);
+					uniform("u_OcclusionStrength", pbr.occlusionStrength);
+					uniform("u_EmissiveFactor", pbr.emissiveFactor);
 
 					// Transmission / IOR
-					glUniform1f(glGetUniformLocation(id(), "u_TransmissionFactor"), pbr.transmissionFactor);
+					uniform("u_TransmissionFactor", pbr.transmissionFactor);
 					if (pbr.transmissionTexIndex >= 0 && pbr.transmissionTexIndex < (int)embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE5);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.transmissionTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_TransmissionTex"), 5);
-						glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 1);
+						uniform("u_TransmissionTex", 5);
+						uniform("u_HasTransmissionTex", 1);
 					}
 					else
 					{
-						glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 0);
+						uniform("u_HasTransmissionTex", 0);
 					}
-					glUniform1f(glGetUniformLocation(id(), "u_IOR"), pbr.ior);
+					uniform("u_IOR", pbr.ior);
 
 					// Alpha uniforms (Opaque/Mask -> non-blend)
 					int alphaMode = 0;
 					if (pbr.alphaMode == Renderer::Model::PBRMaterial::AlphaMode::AlphaMask) alphaMode = 1;
 					// AlphaBlend is skipped in this pass
-					glUniform1i(glGetUniformLocation(id(), "u_AlphaMode"), alphaMode);
-					glUniform1f(glGetUniformLocation(id(), "u_AlphaCutoff"), pbr.alphaCutoff);
+					uniform("u_AlphaMode", alphaMode);
+					uniform("u_AlphaCutoff", pbr.alphaCutoff);
 				}
 				else if (i < _textures.size())
 				{
 					glActiveTexture(GL_TEXTURE0);
 					glBindTexture(GL_TEXTURE_2D, _textures[i]->id());
-					glUniform1i(glGetUniformLocation(id(), "u_AlbedoMap"), 0);
-					glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), true);
-
-					glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), false);
-
-					glUniform1i(glGetUniformLocation(id(), "u_AlphaMode"), 0);
-					glUniform1f(glGetUniformLocation(id(), "u_AlphaCutoff"), 0.5f);
-
-					glUniform1f(glGetUniformLocation(id(), "u_NormalScale"), 1.0f);
-					glUniform1f(glGetUniformLocation(id(), "u_OcclusionStrength"), 1.0f);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFactor"), 1, glm::value_ptr(glm::vec3(0.0f)));
-					glUniform1f(glGetUniformLocation(id(), "u_TransmissionFactor"), 0.0f);
-					glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 0);
-					glUniform1f(glGetUniformLocation(id(), "u_IOR"), 1.5f);
+					uniform("u_AlbedoMap", 0);
+					uniform("u_HasAlbedoMap", true);
+
+					uniform("u_HasNormalMap", false);
+					uniform("u_HasMetallicRoughnessMap", false);
+					uniform("u_HasOcclusionMap", false);
+					uniform("u_HasEmissiveMap", false);
+
+					uniform("u_AlphaMode", 0);
+					uniform("u_AlphaCutoff", 0.5f);
+
+					uniform("u_NormalScale", 1.0f);
+					uniform("u_OcclusionStrength", 1.0f);
+					uniform("u_EmissiveFactor", glm::vec3(0.0f));
+					uniform("u_TransmissionFactor", 0.0f);
+					uniform("u_HasTransmissionTex", 0);
+					uniform("u_IOR", 1.5f);
 				}
 
-				glBindVertexArray(group.vao);
-				glDrawArrays(GL_TRIANGLES, 0, group.faces.size() * 3);
+				draw(group);
 
 				// Restore previous cull state
 				if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
@@ -467,115 +605,114 @@ namespace Renderer
 					{
 						glActiveTexture(GL_TEXTURE0);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.baseColorTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_AlbedoMap"), 0);
-						glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), true);
+						uniform("u_AlbedoMap", 0);
+						uniform("u_HasAlbedoMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), false);
+						uniform("u_HasAlbedoMap", false);
 
 					// Normal map
 					if (pbr.normalTexIndex >= 0 && pbr.normalTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE1);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.normalTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_NormalMap"), 1);
-						glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), 1);
+						uniform("u_NormalMap", 1);
+						uniform("u_HasNormalMap", 1);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), false);
+						uniform("u_HasNormalMap", false);
 
 					// Metallic-Roughness
 					if (pbr.metallicRoughnessTexIndex >= 0 && pbr.metallicRoughnessTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE2);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.metallicRoughnessTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_MetallicRoughnessMap"), 2);
-						glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), true);
+						uniform("u_MetallicRoughnessMap", 2);
+						uniform("u_HasMetallicRoughnessMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), false);
+						uniform("u_HasMetallicRoughnessMap", false);
 
 					// Occlusion
 					if (pbr.occlusionTexIndex >= 0 && pbr.occlusionTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE3);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.occlusionTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_OcclusionMap"), 3);
-						glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), true);
+						uniform("u_OcclusionMap", 3);
+						uniform("u_HasOcclusionMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), false);
+						uniform("u_HasOcclusionMap", false);
 
 					// Emissive
 					if (pbr.emissiveTexIndex >= 0 && pbr.emissiveTexIndex < embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE4);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.emissiveTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_EmissiveMap"), 4);
-						glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), true);
+						uniform("u_EmissiveMap", 4);
+						uniform("u_HasEmissiveMap", true);
 					}
 					else
-						glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), false);
+						uniform("u_HasEmissiveMap", false);
 
 					// Material factors
-					glUniform4fv(glGetUniformLocation(id(), "u_BaseColorFactor"), 1, glm::value_ptr(pbr.baseColorFactor));
-					glUniform1f(glGetUniformLocation(id(), "u_MetallicFactor"), pbr.metallicFactor);
-					glUniform1f(glGetUniformLocation(id(), "u_RoughnessFactor"), pbr.roughnessFactor);
+					uniform("u_BaseColorFactor", pbr.baseColorFactor);
+					uniform("u_MetallicFactor", pbr.metallicFactor);
+					uniform("u_RoughnessFactor", pbr.roughnessFactor);
 
-					glUniform4fv(glGetUniformLocation(id(), "u_AlbedoFallback"), 1, glm::value_ptr(glm::vec4(1, 1, 1, 1)));
-					glUniform1f(glGetUniformLocation(id(), "u_MetallicFallback"), 0.f);
-					glUniform1f(glGetUniformLocation(id(), "u_RoughnessFallback"), 1.f);
-					glUniform1f(glGetUniformLocation(id(), "u_AOFallback"), 1.f);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFallback"), 1, glm::value_ptr(glm::vec3(0, 0, 0)));
+					uniform("u_AlbedoFallback", glm::vec4(1, 1, 1, 1));
+					uniform("u_MetallicFallback", 0.f);
+					uniform("u_RoughnessFallback", 1.f);
+					uniform("u_AOFallback", 1.f);
+					uniform("u_EmissiveFallback", glm::vec3(0, 0, 0));
 
-					glUniform1f(glGetUniformLocation(id(), "u_NormalScale"), pbr.normalScale);
-					glUniform1f(glGetUniformLocation(id(), "u_OcclusionStrength"), pbr.occlusionStrength);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFactor"), 1, glm::value_ptr(pbr.emissiveFactor));
+					uniform("u_NormalScale", pbr.normalScale);
+					uniform("u_OcclusionStrength", pbr.occlusionStrength);
+					uniform("u_EmissiveFactor", pbr.emissiveFactor);
 
 					// Transmission / IOR
-					glUniform1f(glGetUniformLocation(id(), "u_TransmissionFactor"), pbr.transmissionFactor);
+					uniform("u_TransmissionFactor", pbr.transmissionFactor);
 					if (pbr.transmissionTexIndex >= 0 && pbr.transmissionTexIndex < (int)embeddedTextures.size())
 					{
 						glActiveTexture(GL_TEXTURE5);
 						glBindTexture(GL_TEXTURE_2D, embeddedTextures[pbr.transmissionTexIndex].id());
-						glUniform1i(glGetUniformLocation(id(), "u_TransmissionTex"), 5);
-						glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 1);
+						uniform("u_TransmissionTex", 5);
+						uniform("u_HasTransmissionTex", 1);
 					}
 					else
 					{
-						glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 0);
+						uniform("u_HasTransmissionTex", 0);
 					}
-					glUniform1f(glGetUniformLocation(id(), "u_IOR"), pbr.ior);
+					uniform("u_IOR", pbr.ior);
 
 					// Alpha uniforms (Blend)
-					glUniform1i(glGetUniformLocation(id(), "u_AlphaMode"), 2);
-					glUniform1f(glGetUniformLocation(id(), "u_AlphaCutoff"), pbr.alphaCutoff);
+					uniform("u_AlphaMode", 2);
+					uniform("u_AlphaCutoff", pbr.alphaCutoff);
 				}
 				else if (i < _textures.size())
 				{
 					glActiveTexture(GL_TEXTURE0);
 					glBindTexture(GL_TEXTURE_2D, _textures[i]->id());
-					glUniform1i(glGetUniformLocation(id(), "u_AlbedoMap"), 0);
-					glUniform1i(glGetUniformLocation(id(), "u_HasAlbedoMap"), true);
-
-					glUniform1i(glGetUniformLocation(id(), "u_HasNormalMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasMetallicRoughnessMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasOcclusionMap"), false);
-					glUniform1i(glGetUniformLocation(id(), "u_HasEmissiveMap"), false);
-
-					glUniform1i(glGetUniformLocation(id(), "u_AlphaMode"), 0);
-					glUniform1f(glGetUniformLocation(id(), "u_AlphaCutoff"), 0.5f);
-
-					glUniform1f(glGetUniformLocation(id(), "u_NormalScale"), 1.0f);
-					glUniform1f(glGetUniformLocation(id(), "u_OcclusionStrength"), 1.0f);
-					glUniform3fv(glGetUniformLocation(id(), "u_EmissiveFactor"), 1, glm::value_ptr(glm::vec3(0.0f)));
-					glUniform1f(glGetUniformLocation(id(), "u_TransmissionFactor"), 0.0f);
-					glUniform1i(glGetUniformLocation(id(), "u_HasTransmissionTex"), 0);
-					glUniform1f(glGetUniformLocation(id(), "u_IOR"), 1.5f);
+					uniform("u_AlbedoMap", 0);
+					uniform("u_HasAlbedoMap", true);
+
+					uniform("u_HasNormalMap", false);
+					uniform("u_HasMetallicRoughnessMap", false);
+					uniform("u_HasOcclusionMap", false);
+					uniform("u_HasEmissiveMap", false);
+
+					uniform("u_AlphaMode", 0);
+					uniform("u_AlphaCutoff", 0.5f);
+
+					uniform("u_NormalScale", 1.0f);
+					uniform("u_OcclusionStrength", 1.0f);
+					uniform("u_EmissiveFactor", glm::vec3(0.0f));
+					uniform("u_TransmissionFactor", 0.0f);
+					uniform("u_HasTransmissionTex", 0);
+					uniform("u_IOR", 1.5f);
 				}
 
-				glBindVertexArray(group.vao);
-				glDrawArrays(GL_TRIANGLES, 0, group.faces.size() * 3);
+				draw(group);
 
 				// Restore previous cull state
 				if (prevCullEnabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
@@ -601,12 +738,70 @@ namespace Renderer
 		glBindVertexArray(0);
 	}
 
+	void Shader::drawIndexed(GLuint _vaoId, GLsizei _indexCount, GLenum _indexType, size_t _firstIndex)
+	{
+		size_t indexSize = _indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+		glBindVertexArray(_vaoId);
+		glDrawElements(GL_TRIANGLES, _indexCount, _indexType, reinterpret_cast<const void*>(_firstIndex * indexSize));
+		glBindVertexArray(0);
+	}
+
+	void Shader::draw(const Model::MaterialGroup& _group, int _lod)
+	{
+		// Set every draw, the group before may have used the other vertex format
+		uniform("u_PositionScale", _group.positionScale);
+		uniform("u_PositionOffset", _group.positionOffset);
+		uniform("u_OctNormals", _group.octNormals);
+
+		GLsizei indexCount = _group.indexCount;
+		size_t firstIndex = _group.geometry.firstIndex;
+		if (!_group.lods.empty())
+		{
+			const Model::LodLevel& lod = _group.lods[std::clamp(_lod, 0, (int)_group.lods.size() - 1)];
+			indexCount = lod.indexCount;
+			firstIndex += lod.indexOffset;
+		}
+
+		// The group shares its arena's buffers, so its indices count from its first vertex
+		glBindVertexArray(_group.vao);
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, reinterpret_cast<void*>(firstIndex * sizeof(uint32_t)), GLint(_group.geometry.firstVertex));
+		glBindVertexArray(0);
+	}
+
+	void Shader::drawIndirect(const Model::MaterialGroup& _group, GLuint _commandBuffer, size_t _firstCommand, GLsizei _commandCount)
+	{
+		if (_commandCount <= 0)
+			return;
+
+		uniform("u_PositionScale", _group.positionScale);
+		uniform("u_PositionOffset", _group.positionOffset);
+		uniform("u_OctNormals", _group.octNormals);
+
+		multiDrawIndirect(_group.vao, _commandBuffer, _firstCommand, _commandCount);
+	}
+
+	void Shader::multiDrawIndirect(GLuint _vao, GLuint _commandBuffer, size_t _firstCommand, GLsizei _commandCount)
+	{
+		if (_commandCount <= 0)
+			return;
+
+		// count, instanceCount, firstIndex, baseVertex, baseInstance
+		const size_t commandSize = 5 * sizeof(GLuint);
+
+		glBindVertexArray(_vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(_firstCommand * commandSize), _commandCount, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
 	void Shader::draw(Model* _model, Texture* _tex)
 	{
 		glBindVertexArray(_model->vao_id());
 		glBindTexture(GL_TEXTURE_2D, _tex->id());
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
-		glDrawArrays(GL_TRIANGLES, 0, _model->vertex_count());
+		uniform("u_Texture", 0);
+		glDrawElements(GL_TRIANGLES, _model->index_count(), _model->index_type(), nullptr);
 		glBindVertexArray(0);
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
@@ -616,7 +811,7 @@ namespace Renderer
 		glBindVertexArray(_mesh->id());
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, _tex->id());
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
+		uniform("u_Texture", 0);
 		glDrawArrays(GL_TRIANGLES, 0, _mesh->vertex_count());
 		glBindVertexArray(0);
 		glBindTexture(GL_TEXTURE_2D, 0);
@@ -626,7 +821,7 @@ namespace Renderer
 	{
 		glBindVertexArray(_mesh.id());
 		glBindTexture(GL_TEXTURE_2D, _tex.id());
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
+		uniform("u_Texture", 0);
 		glDrawArrays(GL_TRIANGLES, 0, _mesh.vertex_count());
 		glBindVertexArray(0);
 		glBindTexture(GL_TEXTURE_2D, 0);
@@ -636,7 +831,7 @@ namespace Renderer
 	{
 		glBindVertexArray(_mesh->id());
 		glBindTexture(GL_TEXTURE_2D, _texId);
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
+		uniform("u_Texture", 0);
 		glDrawArrays(GL_TRIANGLES, 0, _mesh->vertex_count());
 		glBindVertexArray(0);
 	}
@@ -645,7 +840,7 @@ namespace Renderer
 	{
 		glBindVertexArray(_mesh.id());
 		glBindTexture(GL_TEXTURE_2D, _texId);
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
+		uniform("u_Texture", 0);
 		glDrawArrays(GL_TRIANGLES, 0, _mesh.vertex_count());
 	}
 
@@ -653,16 +848,16 @@ namespace Renderer
 	{
 		glBindVertexArray(_model.vao_id());
 		glBindTexture(GL_TEXTURE_2D, _tex.id());
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
-		glDrawArrays(GL_TRIANGLES, 0, _model.vertex_count());
+		uniform("u_Texture", 0);
+		glDrawElements(GL_TRIANGLES, _model.index_count(), _model.index_type(), nullptr);
 	}
 
 	void Shader::draw(Model& _model, GLuint _texId)
 	{
 		glBindVertexArray(_model.vao_id());
 		glBindTexture(GL_TEXTURE_2D, _texId);
-		glUniform1i(glGetUniformLocation(id(), "u_Texture"), 0);
-		glDrawArrays(GL_TRIANGLES, 0, _model.vertex_count());
+		uniform("u_Texture", 0);
+		glDrawElements(GL_TRIANGLES, _model.index_count(), _model.index_type(), nullptr);
 	}
 
 	void Shader::draw(Model& _model, Texture& _tex, RenderTexture& _renderTex)
@@ -676,7 +871,7 @@ namespace Renderer
 
 		glBindVertexArray(_model.vao_id());
 		glBindTexture(GL_TEXTURE_2D, _tex.id());
-		glDrawArrays(GL_TRIANGLES, 0, _model.vertex_count());
+		glDrawElements(GL_TRIANGLES, _model.index_count(), _model.index_type(), nullptr);
 
 		_renderTex.unbind();
 
@@ -708,8 +903,7 @@ namespace Renderer
 		glDepthMask(GL_FALSE);
 
 		glBindTexture(GL_TEXTURE_CUBE_MAP, _tex.id());
-		GLuint textureLocation = glGetUniformLocation(id(), "uTexEnv");
-		glUniform1i(textureLocation, 0);
+		uniform("uTexEnv", 0);
 		glBindVertexArray(_skyboxMesh.id());
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 		glBindVertexArray(0);
@@ -725,8 +919,7 @@ namespace Renderer
 		glDepthMask(GL_FALSE);
 
 		glBindTexture(GL_TEXTURE_CUBE_MAP, _tex->id());
-		GLuint textureLocation = glGetUniformLocation(id(), "uTexEnv");
-		glUniform1i(textureLocation, 0);
+		uniform("uTexEnv", 0);
 		glBindVertexArray(_skyboxMesh->id());
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 		glBindVertexArray(0);
@@ -800,7 +993,7 @@ namespace Renderer
 	void Shader::drawOutline(Model* _model)
 	{
 		glBindVertexArray(_model->vao_id());
-		glDrawArrays(GL_LINE_LOOP, 0, _model->vertex_count());
+		glDrawElements(GL_LINE_LOOP, _model->index_count(), _model->index_type(), nullptr);
 		glBindVertexArray(0);
 	}
 }
\ No newline at end of file
@@ -9,17 +9,29 @@
 #include <GL/glew.h>
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
 
 namespace Renderer
 {
+	// A uniform's slot in one shader's location cache, from Shader::handle(). Typed so it can only be set with the type it was looked up as
+	template <typename T>
+	struct UniformHandle
+	{
+		int slot = -1;
+
+		bool valid() const { return slot >= 0; }
+	};
+
 	class Shader
 	{
 	public:
 		Shader(const std::string& _vertpath, const std::string& _fragpath);
 		GLuint id();
 
-		void use() { glUseProgram(id()); }
-		void unuse() { glUseProgram(0); }
+		void use() { glUseProgram(id()); s_bound = m_id; }
+		void unuse() { glUseProgram(0); s_bound = 0; }
 
 		void uniform(const std::string& _name, bool _value);
 		void uniform(const std::string& _name, int _value);
@@ -41,9 +53,40 @@ namespace Renderer
 		void cubemapUniform(const std::string& name, const std::shared_ptr<RenderTexture> texture, int startingTextureUnit = 0);
 		void uniform(const std::string& name, const std::vector<std::shared_ptr<RenderTexture>>& textures, int startingTextureUnit = 0);
 
+		// Looks the name up once, for code that sets the same uniform every draw. Invalid (and ignored when set) if the shader doesn't use it
+		template <typename T>
+		UniformHandle<T> handle(const std::string& _name)
+		{
+			id();
+			UniformHandle<T> rtn;
+			rtn.slot = find_slot(_name);
+			return rtn;
+		}
+
+		void uniform(UniformHandle<bool> _handle, bool _value) { set(_handle.slot, _value ? 1 : 0); }
+		void uniform(UniformHandle<int> _handle, int _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<float> _handle, float _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<glm::vec2> _handle, const glm::vec2& _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<glm::vec3> _handle, const glm::vec3& _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<glm::vec4> _handle, const glm::vec4& _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<glm::mat3> _handle, const glm::mat3& _value) { set(_handle.slot, _value); }
+		void uniform(UniformHandle<glm::mat4> _handle, const glm::mat4& _value) { set(_handle.slot, _value); }
+		// Binds _texture to _textureUnit and points the sampler at that unit
+		void uniform(UniformHandle<int> _sampler, const Texture& _texture, int _textureUnit);
+
 		void draw(Model* _model, std::vector<Texture*>& _textures);
 		void draw(Mesh* _mesh);
 		void draw(GLuint _vao, GLsizei _vertexCount);
+		// For an indexed VAO, like a model's material group. _firstIndex is counted in indices, not bytes
+		void drawIndexed(GLuint _vao, GLsizei _indexCount, GLenum _indexType, size_t _firstIndex = 0);
+		// Sets the uniforms that decode the group's vertex format (u_PositionScale, u_PositionOffset, u_OctNormals) and draws it.
+		// _lod picks one of the group's simplified levels, 0 is full detail and anything past the last level draws the last
+		void draw(const Model::MaterialGroup& _group, int _lod = 0);
+		// Draws _commandCount DrawElementsIndirectCommands of the group from _commandBuffer, starting at command _firstCommand.
+		// Sets the same uniforms as draw(), the commands' firstIndex and baseVertex are already offset to the group's place in its arena
+		void drawIndirect(const Model::MaterialGroup& _group, GLuint _commandBuffer, size_t _firstCommand, GLsizei _commandCount);
+		// The same draw without any uniforms, for commands from many groups of one vertex array. Shaders find each draw's values through gl_BaseInstance
+		void multiDrawIndirect(GLuint _vao, GLuint _commandBuffer, size_t _firstCommand, GLsizei _commandCount);
 		void draw(Model* _model, Texture* _tex);
 		void draw(Mesh* _mesh, Texture* _tex);
 		void draw(Mesh& _mesh, Texture& _tex);
@@ -68,5 +111,52 @@ namespace Renderer
 		std::string m_fragsrc;
 
 		bool m_dirty = true;
+
+		// Every active uniform, cached when the program links. Also remembers the last value set, so setting the same value again
+		// skips the GL call. Uniform values belong to the program, so this stays right across use() of other shaders.
+		// One slot per location, so "name" and "name[0]" share theirs. An array's elements have consecutive slots
+		struct UniformSlot
+		{
+			GLint location = -1;
+			bool hasValue = false;
+			int arrayRemaining = 1; // This slot and the array elements after it
+			float value[16] = {}; // Raw bytes of the last value, a mat4 at most
+		};
+
+		std::unordered_map<std::string, int> m_uniformSlots;
+		std::vector<UniformSlot> m_uniforms;
+
+		void cache_uniforms();
+		// -1 if the program has no active uniform by that name
+		int find_slot(const std::string& _name);
+		// For arrays, which go straight to GL. Binds the program and forgets the shadowed values of the elements from _name on
+		GLint array_location(const std::string& _name);
+
+		// The program glUseProgram was last given through use() or unuse(), nothing else in the renderer calls it
+		inline static GLuint s_bound = 0;
+		// glUniform only reaches the bound program, so the setters bind this one before uploading
+		void bind() { if (s_bound != m_id) use(); }
+
+		void set(int _slot, int _value);
+		void set(int _slot, float _value);
+		void set(int _slot, const glm::vec2& _value);
+		void set(int _slot, const glm::vec3& _value);
+		void set(int _slot, const glm::vec4& _value);
+		void set(int _slot, const glm::mat3& _value);
+		void set(int _slot, const glm::mat4& _value);
+
+		// True if _value differs from what the slot last uploaded, and records it
+		template <typename T>
+		bool changed(UniformSlot& _slot, const T& _value)
+		{
+			static_assert(sizeof(T) <= sizeof(UniformSlot::value), "Uniform value too big to shadow");
+
+			if (_slot.hasValue && std::memcmp(_slot.value, &_value, sizeof(T)) == 0)
+				return false;
+
+			std::memcpy(_slot.value, &_value, sizeof(T));
+			_slot.hasValue = true;
+			return true;
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Times component lookups on a headless Core with 10k entities of a few components each:
+//   componentbench [entity count] [repeats]
+// Entity::GetComponent by type id, the dynamic_pointer_cast scan it replaced, and Core::GetComponents over the registry's bucket
+
+#include "JamesEngine/JamesEngine.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace JamesEngine;
+
+namespace
+{
+	struct Health : public Component { float value = 100.f; };
+	struct Ammo : public Component { int value = 30; };
+	struct Velocity : public Component { glm::vec3 value{ 1.f, 0.f, 0.f }; };
+
+	// Found last on every entity, so every lookup walks past the transform and the other components first
+	struct Target : public Component { int value = 1; };
+
+	// The lookup Entity::GetComponent did before the registry, kept here to compare against
+	template <typename T>
+	std::shared_ptr<T> FindByCast(const std::vector<std::shared_ptr<Component>>& _components)
+	{
+		for (const auto& component : _components)
+		{
+			std::shared_ptr<T> rtn = std::dynamic_pointer_cast<T>(component);
+			if (rtn)
+				return rtn;
+		}
+		return nullptr;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t entityCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+	const int repeats = argc > 2 ? std::stoi(argv[2]) : 100;
+
+	std::shared_ptr<Core> core = Core::InitializeHeadless();
+
+	std::vector<std::shared_ptr<Entity>> entities;
+	std::vector<std::vector<std::shared_ptr<Component>>> componentLists;
+	for (size_t i = 0; i < entityCount; ++i)
+	{
+		std::shared_ptr<Entity> entity = core->AddEntity();
+		std::vector<std::shared_ptr<Component>> components = { entity->GetComponent<Transform>() };
+		components.push_back(entity->AddComponent<Health>());
+		components.push_back(entity->AddComponent<Ammo>());
+		components.push_back(entity->AddComponent<Velocity>());
+		components.push_back(entity->AddComponent<Target>());
+
+		entities.push_back(entity);
+		componentLists.push_back(components);
+	}
+
+	auto time = [&](const char* _name, auto&& _lookup)
+		{
+			long long sum = _lookup(); // Warm the caches
+
+			const auto start = std::chrono::steady_clock::now();
+			for (int r = 0; r < repeats; ++r)
+				sum += _lookup();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			std::cout << "  " << _name << ": " << seconds * 1e9 / (double(entityCount) * repeats) << " ns per entity (checksum " << sum << ")" << std::endl;
+		};
+
+	std::cout << entityCount << " entities, " << repeats << " repeats" << std::endl;
+
+	time("Entity::GetComponent", [&]
+		{
+			long long sum = 0;
+			for (const auto& entity : entities)
+				sum += entity->GetComponent<Target>()->value;
+			return sum;
+		});
+
+	time("dynamic_pointer_cast scan", [&]
+		{
+			long long sum = 0;
+			for (const auto& components : componentLists)
+				sum += FindByCast<Target>(components)->value;
+			return sum;
+		});
+
+	time("Core::GetComponents", [&]
+		{
+			long long sum = 0;
+			for (const auto& target : core->GetComponents<Target>())
+				sum += target->value;
+			return sum;
+		});
+
+	return 0;
+}
\ No newline at end of file
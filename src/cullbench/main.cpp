@@ -0,0 +1,77 @@
+// Times the frustum culling functions (Renderer/FrustumCull) on every instruction set this CPU has, with a camera's 6 planes:
+//   cullbench [item count] [repeats]
+
+#include "Renderer/FrustumCull.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 100000;
+	const int repeats = argc > 2 ? std::stoi(argv[2]) : 200;
+
+	// A 90 degree camera looking down -z from the origin, with items scattered all around it so about a sixth are visible
+	const glm::mat4 viewProj = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	glm::vec4 planes[6];
+	for (int i = 0; i < 3; ++i)
+	{
+		planes[i * 2] = glm::vec4(viewProj[0][3] + viewProj[0][i], viewProj[1][3] + viewProj[1][i], viewProj[2][3] + viewProj[2][i], viewProj[3][3] + viewProj[3][i]);
+		planes[i * 2 + 1] = glm::vec4(viewProj[0][3] - viewProj[0][i], viewProj[1][3] - viewProj[1][i], viewProj[2][3] - viewProj[2][i], viewProj[3][3] - viewProj[3][i]);
+	}
+	for (auto& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-400.0f, 400.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+	Renderer::SphereSoA spheres;
+	Renderer::AabbSoA boxes;
+	boxes.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 center(position(rng), position(rng), position(rng));
+		spheres.push_back(center, size(rng));
+		boxes.set(i, center, glm::vec3(size(rng), size(rng), size(rng)));
+	}
+
+	std::vector<uint64_t> visible(Renderer::cullMaskWords(count));
+	std::vector<uint64_t> inside(Renderer::cullMaskWords(count));
+
+	auto time = [&](const char* _name, auto&& _cull)
+		{
+			_cull(); // Warm the caches
+
+			const auto start = std::chrono::steady_clock::now();
+			for (int r = 0; r < repeats; ++r)
+				_cull();
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			size_t kept = 0;
+			for (size_t i = 0; i < count; ++i)
+				kept += Renderer::cullMaskTest(visible.data(), i) ? 1 : 0;
+
+			std::cout << "  " << _name << ": " << seconds * 1e9 / (double(count) * repeats) << " ns per item, " << kept << " visible" << std::endl;
+		};
+
+	std::cout << count << " items, " << repeats << " repeats" << std::endl;
+
+	for (const char* instructionSet : { "Scalar", "SSE", "AVX2" })
+	{
+		if (!Renderer::setCullInstructionSet(instructionSet))
+			continue;
+
+		std::cout << instructionSet << std::endl;
+		time("spheres", [&] { Renderer::cullSpheres(planes, 6, spheres, 0, count, visible.data()); });
+		time("boxes", [&] { Renderer::cullAabbs(planes, 6, boxes, 0, count, visible.data()); });
+		time("boxes with inside mask", [&] { Renderer::cullAabbs(planes, 6, boxes, 0, count, visible.data(), inside.data()); });
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+// Checks the SIMD frustum culling paths (Renderer/FrustumCull) against the scalar ones on random planes, spheres and boxes.
+// Every instruction set this CPU has is tried in turn. Prints each mismatch and returns 1 if there were any, run by ctest:
+//   culltest [seed]
+
+#include "Renderer/FrustumCull.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::mt19937 rng;
+
+	float random(float _min, float _max)
+	{
+		return std::uniform_real_distribution<float>(_min, _max)(rng);
+	}
+
+	glm::vec4 randomPlane()
+	{
+		glm::vec3 normal(random(-1.0f, 1.0f), random(-1.0f, 1.0f), random(-1.0f, 1.0f));
+		if (glm::length(normal) < 0.01f)
+			normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		return glm::vec4(glm::normalize(normal), random(-20.0f, 20.0f));
+	}
+
+	// Only the bits of the _count items culled, the rest of the last word doesn't mean anything
+	bool sameBits(const std::vector<uint64_t>& _a, const std::vector<uint64_t>& _b, size_t _count)
+	{
+		for (size_t i = 0; i < _count; ++i)
+		{
+			if (Renderer::cullMaskTest(_a.data(), i) != Renderer::cullMaskTest(_b.data(), i))
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	rng.seed(argc > 1 ? std::stoul(argv[1]) : 1234u);
+
+	// Around every SIMD width, and with and without the starting offset, so the tail and misaligned loads are covered
+	const size_t counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 17, 63, 64, 65, 127, 130, 1000, 1001 };
+	const size_t firsts[] = { 0, 1, 3, 4, 7, 8, 13 };
+	// 9 and 12 planes are over the SIMD paths' limit, and have to fall back to the scalar one
+	const int planeCounts[] = { 1, 2, 5, 6, 8, 9, 12 };
+
+	const size_t maxItems = 1001 + 13;
+
+	int failures = 0;
+	int checks = 0;
+
+	for (const char* instructionSet : { "Scalar", "SSE", "AVX2" })
+	{
+		if (!Renderer::setCullInstructionSet(instructionSet))
+		{
+			std::cout << instructionSet << ": not available, skipped" << std::endl;
+			continue;
+		}
+
+		for (int round = 0; round < 20; ++round)
+		{
+			// Some of the spheres and boxes sit right on a plane, where < and <= would disagree
+			std::vector<glm::vec4> planes(12);
+			for (auto& plane : planes)
+				plane = randomPlane();
+
+			Renderer::SphereSoA spheres;
+			Renderer::AabbSoA boxes;
+			boxes.resize(maxItems);
+			for (size_t i = 0; i < maxItems; ++i)
+			{
+				glm::vec3 center(random(-30.0f, 30.0f), random(-30.0f, 30.0f), random(-30.0f, 30.0f));
+				float radius = random(0.0f, 8.0f);
+
+				if (i % 11 == 0)
+				{
+					const glm::vec4& plane = planes[i % planes.size()];
+					center = -plane.w * glm::vec3(plane) + glm::vec3(plane) * -radius;
+				}
+
+				spheres.push_back(center, radius);
+				boxes.set(i, center, glm::vec3(random(0.0f, 6.0f), random(0.0f, 6.0f), random(0.0f, 6.0f)));
+			}
+
+			for (int planeCount : planeCounts)
+			{
+				for (size_t count : counts)
+				{
+					for (size_t first : firsts)
+					{
+						const size_t words = Renderer::cullMaskWords(count);
+						std::vector<uint64_t> visible(words + 1, ~0ull), expectedVisible(words + 1, 0ull);
+						std::vector<uint64_t> inside(words + 1, ~0ull), expectedInside(words + 1, 0ull);
+
+						Renderer::cullSpheres(planes.data(), planeCount, spheres, first, count, visible.data());
+						Renderer::cullSpheresScalar(planes.data(), planeCount, spheres, first, count, expectedVisible.data());
+						++checks;
+						if (!sameBits(visible, expectedVisible, count))
+						{
+							std::cout << instructionSet << ": cullSpheres differs with " << planeCount << " planes, count " << count << ", first " << first << std::endl;
+							++failures;
+						}
+
+						Renderer::cullAabbs(planes.data(), planeCount, boxes, first, count, visible.data(), inside.data());
+						Renderer::cullAabbsScalar(planes.data(), planeCount, boxes, first, count, expectedVisible.data(), expectedInside.data());
+						++checks;
+						if (!sameBits(visible, expectedVisible, count) || !sameBits(inside, expectedInside, count))
+						{
+							std::cout << instructionSet << ": cullAabbs differs with " << planeCount << " planes, count " << count << ", first " << first << std::endl;
+							++failures;
+						}
+
+						// Without the inside mask
+						Renderer::cullAabbs(planes.data(), planeCount, boxes, first, count, visible.data());
+						++checks;
+						if (!sameBits(visible, expectedVisible, count))
+						{
+							std::cout << instructionSet << ": cullAabbs (no inside mask) differs with " << planeCount << " planes, count " << count << ", first " << first << std::endl;
+							++failures;
+						}
+
+						// Whole words past the end are never touched
+						if (visible[words] != ~0ull || inside[words] != ~0ull)
+						{
+							std::cout << instructionSet << ": wrote past the end of the mask with count " << count << std::endl;
+							++failures;
+						}
+					}
+				}
+			}
+		}
+
+		std::cout << instructionSet << ": done" << std::endl;
+	}
+
+	std::cout << checks << " checks, " << failures << " failed" << std::endl;
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -91,18 +91,20 @@ namespace JamesEngine
 
     void Suspension::OnAlive()
     {
-        if (!mCarBody || !mWheel || !mAnchorPoint)
+        std::shared_ptr<Entity> carBody = GetCore()->GetEntity(mCarBody);
+        if (!carBody || !mWheel || !mAnchorPoint)
         {
             std::cout << "Suspension component is missing a car body, wheel, or anchor point" << std::endl;
             return;
         }
-        mCarRb = mCarBody->GetComponent<Rigidbody>();
+        std::shared_ptr<Rigidbody> carRb = carBody->GetComponent<Rigidbody>();
 
-        if (!mCarRb)
+        if (!carRb)
         {
             std::cout << "Suspension component is missing a rigidbody on the car" << std::endl;
             return;
         }
+        mCarRb = GetCore()->GetHandle(carRb);
 
 		// Lots more things that would break if they weren't set, but a small check to make sure you haven't forgotten to set any params
         if (mSuspensionParams.stiffness == 0)
@@ -196,10 +198,15 @@ namespace JamesEngine
         if (!mGroundContact)
             return;
 
+        // Gone if the car has been removed
+        std::shared_ptr<Rigidbody> carRb = GetCore()->GetComponent(mCarRb);
+        if (!carRb)
+            return;
+
         float targetLength = glm::clamp(mSuspensionParams.rideHeight + mTireRadius, 0.0f, mSuspensionParams.restLength);
 
         // Get velocity of anchor point projected along suspension direction
-        glm::vec3 pointVelocity = mCarRb->GetVelocityAtPoint(anchorPos);
+        glm::vec3 pointVelocity = carRb->GetVelocityAtPoint(anchorPos);
         float relativeVelocity = glm::dot(pointVelocity, suspensionDir);
 
         // Apply spring force
@@ -251,7 +258,7 @@ namespace JamesEngine
         glm::vec3 totalForce = -suspensionDir * totalMag;
 
         // Apply force to car body
-        mCarRb->ApplyForce(totalForce, anchorPos);
+        carRb->ApplyForce(totalForce, anchorPos);
 
         mForce = totalMag; // Stiffness + damping
 
@@ -262,7 +269,7 @@ namespace JamesEngine
             float antiRollForce = mSuspensionParams.antiRollBarStiffness * displacementDiff;
 
             glm::vec3 antiRollCorrection = -suspensionDir * antiRollForce;
-            mCarRb->ApplyForce(antiRollCorrection, anchorPos);
+            carRb->ApplyForce(antiRollCorrection, anchorPos);
 
             mForce += antiRollForce;
         }
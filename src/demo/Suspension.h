@@ -35,8 +35,11 @@ namespace JamesEngine
 		void OnLateFixedTick();
 		void OnTick();
 
+		// The early tick only raycasts and writes our own contact state, so the four wheels can do it at the same time
+		bool IsParallelSafe(TickPhase _phase) override { return _phase == TickPhase::EarlyFixedTick; }
+
 		void SetWheel(std::shared_ptr<Entity> _wheel) { mWheel = _wheel; }
-		void SetCarBody(std::shared_ptr<Entity> _carBody) { mCarBody = _carBody; }
+		void SetCarBody(std::shared_ptr<Entity> _carBody) { mCarBody = _carBody->GetHandle(); }
 		void SetAnchorPoint(std::shared_ptr<Entity> _anchorPoint) { mAnchorPoint = _anchorPoint; }
 		void SetOppositeAxelSuspension(std::shared_ptr<Suspension> _suspension) { mOppositeAxelSuspension = _suspension; }
 
@@ -60,11 +63,11 @@ namespace JamesEngine
 
 	private:
 		std::shared_ptr<Entity> mWheel;
-		std::shared_ptr<Entity> mCarBody;
+		EntityHandle mCarBody;
 		std::shared_ptr<Entity> mAnchorPoint;
 		std::shared_ptr<Suspension> mOppositeAxelSuspension;
 
-		std::shared_ptr<Rigidbody> mCarRb;
+		Handle<Rigidbody> mCarRb;
 
 		bool mGroundContact = false;
 		glm::vec3 mContactPoint{ 0 };
@@ -82,7 +85,7 @@ namespace JamesEngine
 
 #ifdef JAMES_DEBUG
 		std::shared_ptr<Renderer::Shader> mShader = std::make_shared<Renderer::Shader>("../assets/shaders/OutlineShader.vert", "../assets/shaders/OutlineShader.frag");
-		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/capsule.obj");
+		std::shared_ptr<Renderer::Model> mModel = std::make_shared<Renderer::Model>("../assets/shapes/capsule.obj", false);
 #endif
 	};
 
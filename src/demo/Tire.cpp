@@ -1,7 +1,7 @@
 #include "Tire.h"
 
 #include "Suspension.h"
-#include "../JamesEngine/Timer.h"
+#include "../JamesEngine/Profiler.h"
 
 #ifdef JAMES_DEBUG
 #include <External/imgui/imgui.h>
@@ -22,18 +22,20 @@ namespace JamesEngine
         mAudioSource->SetSound(GetCore()->GetResources()->Load<Sound>("sounds/tire screech"));
         mAudioSource->SetLooping(true);
 
-        if (!mCarBody || !mAnchorPoint)
+        std::shared_ptr<Entity> carBody = GetCore()->GetEntity(mCarBody);
+        if (!carBody || !mAnchorPoint)
         {
             std::cout << "Tire component is missing a car body or anchor point" << std::endl;
             return;
         }
 
-        mCarRb = mCarBody->GetComponent<Rigidbody>();
-        if (!mCarRb)
+        std::shared_ptr<Rigidbody> carRb = carBody->GetComponent<Rigidbody>();
+        if (!carRb)
         {
             std::cout << "Tire component is missing a rigidbody on the car body" << std::endl;
             return;
         }
+        mCarRb = GetCore()->GetHandle(carRb);
 
         mSuspension = GetEntity()->GetComponent<Suspension>();
         if (!mSuspension)
@@ -45,7 +47,7 @@ namespace JamesEngine
 
     void Tire::OnFixedTick()
     {
-		//ScopedTimer timer("Tire::OnFixedTick");
+		JAMES_PROFILE_ZONE("Tire::OnFixedTick");
         float dt = GetCore()->FixedDeltaTime();
 
         // If wheel is off the ground, don't do tire model, just deal with inputs
@@ -86,6 +88,11 @@ namespace JamesEngine
             return;
         }
 
+        // Gone if the car has been removed
+        std::shared_ptr<Rigidbody> carRb = GetCore()->GetComponent(mCarRb);
+        if (!carRb)
+            return;
+
         /*{
             float Fz = 5500.0f;
             float Vx = 20.0f;
@@ -114,7 +121,7 @@ namespace JamesEngine
         }*/
 
         // Compute vehicle velocity at contact
-        glm::vec3 carVel = mCarRb->GetVelocityAtPoint(mSuspension->GetContactPoint());
+        glm::vec3 carVel = carRb->GetVelocityAtPoint(mSuspension->GetContactPoint());
 
         // Build contact plane basis vectors
         glm::vec3 tireForward = glm::normalize(GetEntity()->GetComponent<Transform>()->GetForward());
@@ -227,7 +234,7 @@ namespace JamesEngine
         float Fy = tireForce.y;
 
         glm::vec3 forceWorld = projForward * Fx + projSide * Fy;
-        mCarRb->ApplyForce(forceWorld, mSuspension->GetContactPoint());
+        carRb->ApplyForce(forceWorld, mSuspension->GetContactPoint());
 
 #ifdef JAMES_DEBUG
 
@@ -283,7 +290,7 @@ namespace JamesEngine
         // Apply rolling resistance
         glm::vec3 rollingResistanceDir = -projForward * glm::sign(Vx);
         glm::vec3 rollingResistanceForce = rollingResistanceDir * mTireParams.rollingResistance * Fz;
-        mCarRb->ApplyForce(rollingResistanceForce, mSuspension->GetContactPoint());
+        carRb->ApplyForce(rollingResistanceForce, mSuspension->GetContactPoint());
 
         // Clear torques for next frame
         mDriveTorque = 0.0f;
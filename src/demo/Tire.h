@@ -48,7 +48,7 @@ namespace JamesEngine
 		void AddDriveTorque(float _torque) { mDriveTorque += _torque; }
 		void AddBrakeTorque(float _torque) { mBrakeTorque += _torque; }
 
-		void SetCarBody(std::shared_ptr<Entity> _carBody) { mCarBody = _carBody; }
+		void SetCarBody(std::shared_ptr<Entity> _carBody) { mCarBody = _carBody->GetHandle(); }
 		void SetAnchorPoint(std::shared_ptr<Entity> _anchorPoint) { mAnchorPoint = _anchorPoint; }
 
 		void SetTireParams(const TireParams& _tireParams) { mTireParams = _tireParams; }
@@ -69,11 +69,11 @@ namespace JamesEngine
 	private:
 		glm::vec2 BrushTireModel(float Vx, float Vy, float omega, float Fz);
 
-		std::shared_ptr<Entity> mCarBody;
+		EntityHandle mCarBody;
 		std::shared_ptr<Entity> mAnchorPoint;
 
 		std::shared_ptr<Rigidbody> mWheelRb;
-		std::shared_ptr<Rigidbody> mCarRb;
+		Handle<Rigidbody> mCarRb;
 
 		std::shared_ptr<Suspension> mSuspension;
 
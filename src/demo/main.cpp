@@ -5,7 +5,7 @@
 #include "Engine.h"
 #include "Drivetrain.h"
 
-#include "JamesEngine/Timer.h"
+#include "JamesEngine/Profiler.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/norm.hpp>
@@ -95,7 +95,7 @@ struct StartFinishLine : public Component
 
 	int lastSampleIndex = 0;
 
-	std::shared_ptr<Entity> car;
+	EntityHandle car;
 	std::shared_ptr<Entity> ghostCar;
 
 	int lastGhostIndex = 0;
@@ -112,7 +112,7 @@ struct StartFinishLine : public Component
 
 	void SaveFastestLap()
 	{
-		ScopedTimer timer("Saving fastest lap");
+		JAMES_PROFILE_ZONE("Saving fastest lap");
 		std::ostringstream out;
 		out.setf(std::ios::fixed);
 		out << bestLapTime << " " << fastestLapSamples.size() << "\n";
@@ -190,15 +190,21 @@ struct StartFinishLine : public Component
 		if (sampleTimer >= recordSamplesEvery)
 		{
 			sampleTimer = 0.f;
+			std::shared_ptr<Entity> carEntity = GetCore()->GetEntity(car);
+			if (!carEntity)
+				return;
+
+			std::shared_ptr<Transform> carTransform = carEntity->GetComponent<Transform>();
+
 			sample s;
 			s.timestamp = lapTime;
-			s.position = car->GetComponent<Transform>()->GetPosition();
-			s.rotation = car->GetComponent<Transform>()->GetQuaternion();
+			s.position = carTransform->GetPosition();
+			s.rotation = carTransform->GetQuaternion();
 			currentLapSamples.push_back(s);
 
 			if (!fastestLapSamples.empty())
 			{
-				glm::vec3 currentPos = car->GetComponent<Transform>()->GetPosition();
+				glm::vec3 currentPos = carTransform->GetPosition();
 
 				float bestT = 0.0f;
 				float minDistSq = std::numeric_limits<float>::max();
@@ -1377,10 +1383,20 @@ int main()
 		track->GetComponent<Transform>()->SetPosition(vec3(0, 0, 0));
 		track->GetComponent<Transform>()->SetRotation(vec3(0, 0, 0));
 		std::shared_ptr<ModelRenderer> trackMR = track->AddComponent<ModelRenderer>();
-		trackMR->SetModel(core->GetResources()->Load<Model>("models/Imola/Imola.glb"));
-		trackMR->SetShadowModel(core->GetResources()->Load<Model>("models/Imola/ImolaShadow.glb"));
+		// The biggest assets by far, decoded in the background while the rest of the scene is set up (waited on before Run)
+		std::shared_ptr<Model> trackModel = core->GetResources()->LoadAsync<Model>("models/Imola/Imola.glb");
+		std::shared_ptr<Model> trackShadowModel = core->GetResources()->LoadAsync<Model>("models/Imola/ImolaShadow.glb");
+		// Static and mostly drawn in the shadow passes, so half size vertices are worth the small loss of precision
+		trackModel->SetVertexFormat(Renderer::Model::VertexFormat::Compact);
+		trackShadowModel->SetVertexFormat(Renderer::Model::VertexFormat::Compact);
+		trackMR->SetModel(trackModel);
+		trackMR->SetShadowModel(trackShadowModel);
+		// Track groups visible from each stretch of the lap, baked offline by pvsbake. Ignored if missing or baked from a different track model
+		std::shared_ptr<Renderer::Pvs> trackPvs = std::make_shared<Renderer::Pvs>();
+		if (trackPvs->load("../assets/models/Imola/Imola.pvs"))
+			core->GetSceneRenderer()->SetPvs(trackModel, trackPvs);
 		std::shared_ptr<ModelCollider> trackCollider = track->AddComponent<ModelCollider>();
-		trackCollider->SetModel(core->GetResources()->Load<Model>("models/Imola/ImolaCollision.glb"));
+		trackCollider->SetModel(core->GetResources()->LoadAsync<Model>("models/Imola/ImolaCollision.glb"));
 
 		// Start/finish line
 		std::shared_ptr<Entity> startFinishLine = core->AddEntity();
@@ -1433,7 +1449,7 @@ int main()
 
 		//freeCamEntity->GetComponent<Transform>()->SetParent(carBody);
 
-		startFinishLineComponent->car = carBody;
+		startFinishLineComponent->car = carBody->GetHandle();
 
 		std::shared_ptr<Entity> rearDownForcePos = core->AddEntity();
 		rearDownForcePos->SetTag("rear downforce pos");
@@ -1597,5 +1613,6 @@ int main()
 
 	}
 
+	core->WaitForAsyncLoads();
 	core->Run();
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+// Rasterises known occluders with Renderer::OcclusionRasterizer and checks what isVisible says about boxes around them. Needs no GPU.
+// Prints each wrong answer and returns 1 if there were any, run by ctest
+
+#include "Renderer/OcclusionRasterizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void expect(const Renderer::OcclusionRasterizer& _rasterizer, const std::string& _name, const glm::vec3& _min, const glm::vec3& _max, bool _visible)
+	{
+		const bool visible = _rasterizer.isVisible(_min, _max);
+		if (visible != _visible)
+		{
+			std::cout << "FAILED: " << _name << " should be " << (_visible ? "visible" : "hidden") << std::endl;
+			++failures;
+		}
+		else
+		{
+			std::cout << "ok: " << _name << std::endl;
+		}
+	}
+
+	// One frame with the given occluders, each a triangle list over _positions
+	struct Occluder
+	{
+		glm::mat4 transform{ 1.0f };
+		std::vector<uint32_t> indices;
+		bool doubleSided = false;
+	};
+
+	void rasterize(Renderer::OcclusionRasterizer& _rasterizer, const glm::mat4& _viewProj, const std::vector<glm::vec3>& _positions, const std::vector<Occluder>& _occluders)
+	{
+		_rasterizer.beginFrame(_viewProj);
+		for (const Occluder& occluder : _occluders)
+			_rasterizer.addOccluder(occluder.transform, &_positions[0].x, sizeof(glm::vec3), occluder.indices.data(), occluder.indices.size(), occluder.doubleSided);
+
+		for (size_t i = 0; i < _rasterizer.occluderCount(); ++i)
+			_rasterizer.setupOccluder(i);
+		for (int band = 0; band < _rasterizer.bandCount(); ++band)
+			_rasterizer.rasterizeBand(band);
+	}
+}
+
+int main()
+{
+	std::cout << "Rasterising with " << (Renderer::OcclusionRasterizer::usesSimd() ? "SSE" : "scalar code") << std::endl;
+
+	Renderer::OcclusionRasterizer rasterizer;
+	rasterizer.resize(256, 256);
+
+	// Camera at the origin looking down -z, square so the wall's edges are easy to work out. A box at depth d is behind the wall where |x|, |y| < d / 2
+	const glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 viewProj = proj * view;
+
+	// A 10 x 10 wall 10 units away, counter clockwise from the camera
+	const std::vector<glm::vec3> wall = { { -5.0f, -5.0f, -10.0f }, { 5.0f, -5.0f, -10.0f }, { 5.0f, 5.0f, -10.0f }, { -5.0f, 5.0f, -10.0f } };
+	Occluder quad;
+	quad.indices = { 0, 1, 2, 0, 2, 3 };
+
+	rasterize(rasterizer, viewProj, wall, {});
+	expect(rasterizer, "box with no occluders", glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f), true);
+
+	rasterize(rasterizer, viewProj, wall, { quad });
+	if (rasterizer.triangleCount() != 2)
+	{
+		std::cout << "FAILED: wall should set up 2 triangles, got " << rasterizer.triangleCount() << std::endl;
+		++failures;
+	}
+
+	expect(rasterizer, "box fully behind the wall", glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f), false);
+	expect(rasterizer, "box far behind the wall", glm::vec3(-50.0f, -50.0f, -500.0f), glm::vec3(50.0f, 50.0f, -400.0f), false);
+	expect(rasterizer, "box partly behind the wall, sticking out past its edge", glm::vec3(6.0f, -1.0f, -21.0f), glm::vec3(14.0f, 1.0f, -20.0f), true);
+	expect(rasterizer, "box beside the wall", glm::vec3(20.0f, -1.0f, -21.0f), glm::vec3(24.0f, 1.0f, -20.0f), true);
+	expect(rasterizer, "box in front of the wall", glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f), true);
+	expect(rasterizer, "box cutting through the wall", glm::vec3(-1.0f, -1.0f, -12.0f), glm::vec3(1.0f, 1.0f, -8.0f), true);
+	expect(rasterizer, "box straddling the near plane", glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, 0.5f, 0.05f), true);
+	expect(rasterizer, "box behind the camera", glm::vec3(-1.0f, -1.0f, 5.0f), glm::vec3(1.0f, 1.0f, 6.0f), true);
+
+	// Turned to face away it is culled like the GPU would, unless it is double sided
+	Occluder backFacing = quad;
+	backFacing.indices = { 0, 2, 1, 0, 3, 2 };
+	rasterize(rasterizer, viewProj, wall, { backFacing });
+	expect(rasterizer, "box behind a wall facing away", glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f), true);
+
+	backFacing.doubleSided = true;
+	rasterize(rasterizer, viewProj, wall, { backFacing });
+	expect(rasterizer, "box behind a double sided wall facing away", glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f), false);
+
+	// Two walls side by side, moved into place by their transforms. Only together do they cover the box
+	Occluder left = quad, right = quad;
+	left.transform = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f, 0.0f, 0.0f));
+	right.transform = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f));
+	rasterize(rasterizer, viewProj, wall, { left, right });
+	expect(rasterizer, "box behind where two walls meet", glm::vec3(-3.0f, -1.0f, -21.0f), glm::vec3(3.0f, 1.0f, -20.0f), false);
+
+	rasterize(rasterizer, viewProj, wall, { left });
+	expect(rasterizer, "box half behind one of the walls", glm::vec3(-3.0f, -1.0f, -21.0f), glm::vec3(3.0f, 1.0f, -20.0f), true);
+
+	// A wall crossing the near plane is clipped rather than dropped, so it still hides what is behind it
+	const std::vector<glm::vec3> floor = { { -20.0f, -1.0f, 5.0f }, { 20.0f, -1.0f, 5.0f }, { 20.0f, -1.0f, -100.0f }, { -20.0f, -1.0f, -100.0f } };
+	Occluder ground;
+	ground.indices = { 0, 1, 2, 0, 2, 3 };
+	rasterize(rasterizer, viewProj, floor, { ground });
+	expect(rasterizer, "box under a floor that crosses the near plane", glm::vec3(-1.0f, -4.0f, -12.0f), glm::vec3(1.0f, -3.0f, -10.0f), false);
+	expect(rasterizer, "box on top of the floor", glm::vec3(-1.0f, 0.0f, -12.0f), glm::vec3(1.0f, 1.0f, -10.0f), true);
+
+	std::cout << (failures == 0 ? "All passed" : std::to_string(failures) + " failed") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// Bakes the potentially visible sets SceneRenderer::SetPvs uses, for a track model along a recorded lap.
+// Run from the same folder as the demo, paths are relative to the assets folder:
+//   pvsbake [model] [lap] [output] [cell length] [corridor half width] [x y z]
+// The lap is the demo's save/fastestLap.txt format. The model is baked at x y z, the origin by default where the demo places the track.
+// SceneRenderer ignores the PVS for a model placed anywhere else
+
+#include "JamesEngine/JobSystem.h"
+
+#include "Renderer/Model.h"
+#include "Renderer/Pvs.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+	const std::string modelPath = argc > 1 ? argv[1] : "models/Imola/Imola.glb";
+	const std::string lapPath = argc > 2 ? argv[2] : "save/fastestLap.txt";
+	const std::string outputPath = argc > 3 ? argv[3] : "models/Imola/Imola.pvs";
+	const float cellLength = argc > 4 ? std::stof(argv[4]) : 25.0f;
+
+	Renderer::PvsBakeSettings settings;
+	if (argc > 5)
+		settings.corridorHalfWidth = std::stof(argv[5]);
+
+	glm::mat4 transform(1.0f);
+	if (argc > 8)
+		transform = glm::translate(transform, glm::vec3(std::stof(argv[6]), std::stof(argv[7]), std::stof(argv[8])));
+
+	// Lap time and sample count, then a time, position and rotation per sample
+	std::vector<glm::vec3> path;
+	{
+		std::ifstream in("../assets/" + lapPath);
+		float lapTime = 0.0f;
+		size_t count = 0;
+		if (!(in >> lapTime >> count))
+		{
+			std::cout << "Couldn't read lap: " << lapPath << std::endl;
+			return 1;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			float timestamp;
+			glm::vec3 position;
+			glm::vec4 rotation;
+			if (!(in >> timestamp >> position.x >> position.y >> position.z >> rotation.x >> rotation.y >> rotation.z >> rotation.w))
+			{
+				std::cout << "Malformed lap: " << lapPath << std::endl;
+				return 1;
+			}
+			path.push_back(position);
+		}
+	}
+
+	if (path.size() < 2)
+	{
+		std::cout << "Lap has too few samples to bake along" << std::endl;
+		return 1;
+	}
+
+	std::cout << "Loading " << modelPath << std::endl;
+	Renderer::Model model("../assets/" + modelPath, false);
+
+	// A lap ends about where it started
+	const bool closed = glm::length(path.back() - path.front()) < cellLength * 2.0f;
+	const float corridorRadius = settings.corridorHalfWidth + settings.eyeHeights.back();
+
+	Renderer::Pvs pvs;
+	pvs.setPath(path, closed, cellLength, corridorRadius, model.GetMaterialGroups().size(), Renderer::Pvs::sourceKey(model), transform);
+
+	std::cout << "Baking " << pvs.cellCount() << " cells of " << pvs.itemCount() << " material groups" << std::endl;
+	const auto start = std::chrono::steady_clock::now();
+
+	JamesEngine::JobSystem jobSystem;
+	jobSystem.ParallelFor(pvs.cellCount(), 1, [&](size_t _begin, size_t _end)
+		{
+			for (size_t cell = _begin; cell < _end; ++cell)
+				pvs.bakeCell(int(cell), model, settings);
+		});
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t visible = 0;
+	for (size_t cell = 0; cell < pvs.cellCount(); ++cell)
+		visible += pvs.visibleCount(int(cell));
+
+	std::cout << "Baked in " << seconds << "s, each cell sees " << (pvs.cellCount() > 0 ? visible / pvs.cellCount() : 0) << " of " << pvs.itemCount() << " groups on average" << std::endl;
+
+	if (!pvs.save("../assets/" + outputPath))
+		return 1;
+
+	std::cout << "Saved " << outputPath << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+// Times the per-frame hook dispatch of a headless Core, where most components override nothing:
+//   tickbench [entity count] [frames]
+// Core::Run only calls the components on each hook's list. The "every component" line makes the virtual call on every component
+// of every entity for each hook, as Core did before the hook lists
+
+#include "JamesEngine/JamesEngine.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace JamesEngine;
+
+namespace
+{
+	// Overrides nothing, like most of the components in a scene
+	struct Marker : public Component { int value = 0; };
+	struct Tag : public Component { int value = 0; };
+
+	// One entity in ten has one of these
+	struct Spinner : public Component
+	{
+		float angle = 0.f;
+		void OnFixedTick() override { angle += 0.01f; }
+	};
+
+	struct ParallelSpinner : public Component
+	{
+		float angle = 0.f;
+		void OnFixedTick() override { angle += 0.01f; }
+		bool IsParallelSafe(TickPhase /*_phase*/) override { return true; }
+	};
+
+	// Stops the run after the given number of frames
+	struct FrameLimit : public Component
+	{
+		int frames = 0;
+		void OnTick() override
+		{
+			if (--frames <= 0)
+				GetCore()->End();
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t entityCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+	const int frames = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+	std::shared_ptr<Core> core = Core::InitializeHeadless();
+
+	for (size_t i = 0; i < entityCount; ++i)
+	{
+		std::shared_ptr<Entity> entity = core->AddEntity();
+		entity->AddComponent<Marker>();
+		entity->AddComponent<Tag>();
+		if (i % 20 == 0)
+			entity->AddComponent<Spinner>();
+		else if (i % 20 == 10)
+			entity->AddComponent<ParallelSpinner>();
+	}
+
+	std::shared_ptr<FrameLimit> limit = core->AddEntity()->AddComponent<FrameLimit>();
+
+	std::cout << entityCount << " entities, " << frames << " frames" << std::endl;
+
+	limit->frames = frames;
+	auto start = std::chrono::steady_clock::now();
+	core->Run();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "  Core::Run (hook lists): " << seconds * 1e6 / frames << " us per frame" << std::endl;
+
+	// Every component in entity order, less the frame limit
+	std::vector<std::shared_ptr<Component>> components = core->GetComponents<Component>();
+	components.pop_back();
+
+	// Tick, then the three fixed tick phases, each calling every component
+	start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		for (const auto& component : components)
+			component->OnTick();
+		for (const auto& component : components)
+			component->OnEarlyFixedTick();
+		for (const auto& component : components)
+			component->OnFixedTick();
+		for (const auto& component : components)
+			component->OnLateFixedTick();
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "  every component: " << seconds * 1e6 / frames << " us per frame" << std::endl;
+
+	return 0;
+}
\ No newline at end of file
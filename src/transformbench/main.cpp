@@ -0,0 +1,109 @@
+// Times world transform updates on deep hierarchies on a headless Core:
+//   transformbench [chain count] [chain depth] [frames]
+// Each frame reads GetModel on every transform, after moving nothing, every root, or every leaf. The uncached line walks each
+// transform's parent chain on every read, as GetModel did before world transforms were cached
+
+#include "JamesEngine/JamesEngine.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace JamesEngine;
+
+int main(int argc, char* argv[])
+{
+	const size_t chainCount = argc > 1 ? std::stoul(argv[1]) : 200;
+	const size_t depth = argc > 2 ? std::stoul(argv[2]) : 64;
+	const int frames = argc > 3 ? std::stoi(argv[3]) : 100;
+
+	std::shared_ptr<Core> core = Core::InitializeHeadless();
+
+	// Every child is offset and turned a little from its parent, like the links of a chain
+	const glm::vec3 offset(0.f, 1.f, 0.f);
+	const glm::vec3 turn(0.f, 5.f, 0.f);
+
+	std::vector<std::vector<std::shared_ptr<Transform>>> chains(chainCount);
+	for (auto& chain : chains)
+	{
+		std::shared_ptr<Entity> parent;
+		for (size_t d = 0; d < depth; ++d)
+		{
+			std::shared_ptr<Entity> entity = core->AddEntity();
+			std::shared_ptr<Transform> transform = entity->GetComponent<Transform>();
+			transform->SetPosition(offset);
+			transform->SetRotation(turn);
+			if (parent)
+				transform->SetParent(parent);
+
+			chain.push_back(transform);
+			parent = entity;
+		}
+	}
+
+	const size_t transformCount = chainCount * depth;
+
+	auto time = [&](const char* _name, auto&& _move, auto&& _read)
+		{
+			float sum = 0.f;
+			const auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frames; ++frame)
+			{
+				_move(frame);
+				for (const auto& chain : chains)
+				{
+					for (size_t d = 0; d < depth; ++d)
+					{
+						const glm::mat4 model = _read(chain, d);
+						sum += model[3][0] + model[3][1];
+					}
+				}
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			std::cout << "  " << _name << ": " << seconds * 1e3 / frames << " ms per frame, " << seconds * 1e9 / (double(transformCount) * frames)
+				<< " ns per transform (checksum " << sum << ")" << std::endl;
+		};
+
+	auto cached = [](const std::vector<std::shared_ptr<Transform>>& _chain, size_t _d) { return _chain[_d]->GetModel(); };
+
+	// Rebuilds the world matrix from the root down on every read, the same maths as Transform::UpdateWorld
+	auto uncached = [&](const std::vector<std::shared_ptr<Transform>>& _chain, size_t _d)
+		{
+			glm::vec3 position = _chain[0]->GetLocalPosition();
+			glm::quat rotation = _chain[0]->GetQuaternion();
+			for (size_t d = 1; d <= _d; ++d)
+			{
+				position += glm::vec3(glm::toMat4(rotation) * glm::vec4(_chain[d]->GetLocalPosition(), 1.f));
+				rotation *= _chain[d]->GetQuaternion();
+			}
+
+			glm::mat4 model = glm::translate(glm::mat4(1.f), position);
+			return model * glm::toMat4(rotation);
+		};
+
+	auto moveNothing = [](int) {};
+	auto moveRoots = [&](int _frame)
+		{
+			for (const auto& chain : chains)
+				chain.front()->SetPosition(glm::vec3(float(_frame), 0.f, 0.f));
+		};
+	auto moveLeaves = [&](int _frame)
+		{
+			for (const auto& chain : chains)
+				chain.back()->SetPosition(offset + glm::vec3(float(_frame) * 0.01f, 0.f, 0.f));
+		};
+
+	std::cout << chainCount << " chains " << depth << " deep (" << transformCount << " transforms), " << frames << " frames" << std::endl;
+
+	time("nothing moved", moveNothing, cached);
+	time("every root moved", moveRoots, cached);
+	time("every leaf moved", moveLeaves, cached);
+	time("every root moved, uncached", moveRoots, uncached);
+
+	return 0;
+}
\ No newline at end of file